@@ -74,9 +74,9 @@ int main() {
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	GLuint brickTexture = Util::loadTexture("assets/Bricks059_2K-JPG_Color.jpg", GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
-	GLuint noiseTexture = Util::loadTexture("assets/noiseTexture.png", GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
-	GLuint characterTexture = Util::loadTexture("assets/character.png", GL_CLAMP_TO_EDGE, GL_NEAREST);
+	Util::GpuResource brickTexture = Util::loadTexture("assets/Bricks059_2K-JPG_Color.jpg", GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
+	Util::GpuResource noiseTexture = Util::loadTexture("assets/noiseTexture.png", GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR);
+	Util::GpuResource characterTexture = Util::loadTexture("assets/character.png", GL_CLAMP_TO_EDGE, GL_NEAREST);
 
 	Util::Shader backgroundShader("assets/background.vert", "assets/background.frag");
 	Util::Shader characterShader("assets/character.vert", "assets/character.frag");
@@ -94,8 +94,8 @@ int main() {
 
 		//Draw background
 		backgroundShader.exec();
-		SET_SHADER_TEXTURE(backgroundShader, "_backgroundTexture", brickTexture, 0);
-		SET_SHADER_TEXTURE(backgroundShader, "_noiseTexture", noiseTexture, 1);
+		SET_SHADER_TEXTURE(backgroundShader, "_backgroundTexture", brickTexture.get(), 0);
+		SET_SHADER_TEXTURE(backgroundShader, "_noiseTexture", noiseTexture.get(), 1);
 		backgroundShader.setFloat("_time", time);
 		backgroundShader.setVec3("_waterColor", waterColor[0], waterColor[1], waterColor[2]);
 		backgroundShader.setFloat("_waveSpeed", waveSpeed);
@@ -104,7 +104,7 @@ int main() {
 
 		//Draw character
 		characterShader.exec();
-		SET_SHADER_TEXTURE(characterShader, "_texture", characterTexture, 2);
+		SET_SHADER_TEXTURE(characterShader, "_texture", characterTexture.get(), 2);
 		characterShader.setFloat("_time", time);
 		characterShader.setFloat("_scale", characterScale);
 		characterShader.setVec2("_minOffset", characterMinOffset[0], characterMinOffset[1]);
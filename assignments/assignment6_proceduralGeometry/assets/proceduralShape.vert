@@ -0,0 +1,140 @@
+#version 450
+//Util::ProceduralRenderer: the Util::ProcGen shapes built from gl_VertexID, no vertex attributes.
+//Same outputs as vertexShader.vert
+
+//Util::ProceduralShape
+const int PLANE = 0;
+const int CYLINDER = 1;
+const int SPHERE = 2;
+const int TORUS = 3;
+
+const float PI = 3.14159265359;
+const float TAU = 6.28318530718;
+
+//Util::ProceduralInstance, size in the argument order of the Util::ProcGen function
+struct Instance
+{
+	mat4 model;
+	vec4 size;
+};
+
+//PROCEDURAL_INSTANCE_STORAGE_BINDING
+layout(std430, binding = 1) readonly buffer Instances
+{
+	Instance _Instances[];
+};
+
+uniform int _Shape;
+//Grid of quads, columns x rows
+uniform ivec2 _Segments;
+uniform int _FirstInstance;
+uniform mat4 _ViewProjection;
+
+out vec3 Normal;
+out vec2 UV;
+
+//Grid corners of the six vertices of a quad, matching the index order of the CPU meshes
+const ivec2 PLANE_CORNERS[6] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1), ivec2(1, 1), ivec2(0, 1), ivec2(0, 0));
+const ivec2 SPHERE_CORNERS[6] = ivec2[](ivec2(0, 0), ivec2(0, 1), ivec2(1, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1));
+const ivec2 TORUS_CORNERS[6] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1), ivec2(0, 1));
+//Side quads, y 0 is the top ring
+const ivec2 CYLINDER_CORNERS[6] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1), ivec2(0, 1));
+
+void plane(ivec2 grid, vec2 size, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	vec2 t = vec2(grid) / vec2(_Segments);
+	position = vec3(size * t, 0.0);
+	normal = vec3(0.0, 0.0, 1.0);
+	uv = size * t;
+}
+
+void sphere(ivec2 grid, float radius, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	int segments = _Segments.x;
+	float pitch = grid.y * PI / segments;
+	float yaw = grid.x * TAU / segments;
+	normal = vec3(sin(pitch) * sin(yaw), cos(pitch), sin(pitch) * cos(yaw));
+	position = normal * radius;
+	uv = vec2(float(grid.x) / segments, float(grid.y + 1) / (segments + 2));
+}
+
+void torus(ivec2 grid, float innerRadius, float outerRadius, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	float outerAngle = grid.x * TAU / _Segments.x;
+	float innerAngle = grid.y * TAU / _Segments.y;
+	normal = vec3(cos(outerAngle) * cos(innerAngle), sin(outerAngle) * cos(innerAngle), sin(innerAngle));
+	position = vec3(cos(outerAngle), sin(outerAngle), 0.0) * outerRadius + normal * innerRadius;
+	uv = vec2(float(grid.x) / _Segments.x, float(grid.y) / _Segments.y);
+}
+
+//ring -1 is the cap's center
+void cylinderCap(int ring, bool top, float height, float radius, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	float y = top ? height * 0.5 : -height * 0.5;
+	normal = vec3(0.0, top ? 1.0 : -1.0, 0.0);
+	if (ring < 0)
+	{
+		position = vec3(0.0, y, 0.0);
+		uv = vec2(0.5);
+		return;
+	}
+	float angle = ring * TAU / _Segments.x;
+	position = vec3(cos(angle) * radius, y, sin(angle) * radius);
+	uv = vec2(cos(angle), sin(angle)) * 0.5 + 0.5;
+}
+
+void cylinderSide(ivec2 grid, float height, float radius, out vec3 position, out vec3 normal, out vec2 uv)
+{
+	float angle = grid.x * TAU / _Segments.x;
+	normal = vec3(cos(angle), 0.0, sin(angle));
+	position = vec3(normal.x * radius, grid.y == 0 ? height * 0.5 : -height * 0.5, normal.z * radius);
+	uv = vec2(float(grid.x) / _Segments.x, grid.y == 0 ? 1.0 : 0.0);
+}
+
+void main(){
+	Instance instance = _Instances[_FirstInstance + gl_InstanceID];
+
+	int quad = gl_VertexID / 6;
+	int corner = gl_VertexID % 6;
+	ivec2 cell = ivec2(quad % _Segments.x, quad / _Segments.x);
+
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+	if (_Shape == PLANE)
+	{
+		plane(cell + PLANE_CORNERS[corner], instance.size.xy, position, normal, uv);
+	}
+	else if (_Shape == SPHERE)
+	{
+		//Cap rows only have one triangle, the second collapses onto a single vertex
+		ivec2 offset = SPHERE_CORNERS[corner];
+		if (cell.y == 0) offset = corner < 3 ? ivec2[](ivec2(0, 0), ivec2(0, 1), ivec2(1, 1))[corner] : ivec2(0, 0);
+		else if (cell.y == _Segments.y - 1 && corner >= 3) offset = ivec2(0, 0);
+		sphere(cell + offset, instance.size.x, position, normal, uv);
+	}
+	else if (_Shape == TORUS)
+	{
+		torus(cell + TORUS_CORNERS[corner], instance.size.x, instance.size.y, position, normal, uv);
+	}
+	else if (cell.y == 1)
+	{
+		cylinderSide(ivec2(cell.x, 0) + CYLINDER_CORNERS[corner], instance.size.x, instance.size.y, position, normal, uv);
+	}
+	else
+	{
+		//Caps are fans around the center, one triangle per quad. Top (ring, center, ring + 1), bottom (center, ring, ring + 1)
+		bool top = cell.y == 0;
+		int ring = -1;
+		if (corner < 3)
+		{
+			int fanCorner = top ? ivec3(0, -1, 1)[corner] : ivec3(-1, 0, 1)[corner];
+			ring = fanCorner < 0 ? -1 : cell.x + fanCorner;
+		}
+		cylinderCap(ring, top, instance.size.x, instance.size.y, position, normal, uv);
+	}
+
+	Normal = normal;
+	UV = uv;
+	gl_Position = _ViewProjection * instance.model * vec4(position, 1.0);
+}
@@ -1,7 +1,7 @@
 #version 450
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
-layout(location = 2) in vec2 vUV;
+layout(location = 4) in vec2 vUV;
 
 out vec3 Normal;
 out vec2 UV;
@@ -15,14 +15,24 @@
 #include <ew/camera.h>
 #include <ew/cameraController.h>
 
+#include "util/GLStateCache.h"
+#include "util/GpuResources.h"
+#include "util/JobSystem.h"
+#include "util/Mesh.h"
+#include "util/MeshRebuilder.h"
 #include "util/ProcGen.h"
+#include "util/ProceduralRenderer.h"
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void resetCamera(ew::Camera& camera, ew::CameraController& cameraController);
+void setShadingUniforms(ew::Shader& shader, const ew::Mat4& viewProjection, const ew::Vec3& lightDir);
 
 int SCREEN_WIDTH = 1080;
 int SCREEN_HEIGHT = 720;
 
+//Patch grid of the tessellated shapes, the tessellator adds everything finer
+const int TESSELLATION_BASE_SEGMENTS = 8;
+
 float prevTime;
 
 struct AppSettings {
@@ -34,6 +44,11 @@ struct AppSettings {
 	bool wireframe = true;
 	bool drawAsPoints = false;
 	bool backFaceCulling = true;
+	//Build the plane, cylinder, sphere and torus in the vertex shader instead of uploading meshes
+	bool generateOnGpu = false;
+	//On top of generateOnGpu: coarse patches refined by the tessellator, segment sliders don't apply
+	bool tessellate = false;
+	float tessellationPixels = 8.f;
 
 	//Euler angles (degrees)
 	ew::Vec3 lightRotation = ew::Vec3(0, 0, 0);
@@ -92,14 +107,19 @@ int main() {
 	glPolygonMode(GL_FRONT_AND_BACK, appSettings.wireframe ? GL_LINE : GL_FILL);
 
 	ew::Shader shader("assets/vertexShader.vert", "assets/fragmentShader.frag");
+	ew::Shader proceduralShader("assets/proceduralShape.vert", "assets/fragmentShader.frag");
+	ew::Shader tessellatedShader("assets/proceduralPatch.vert", "assets/proceduralPatch.tesc", "assets/proceduralPatch.tese", "assets/fragmentShader.frag");
+	Util::ProceduralRenderer proceduralRenderer(4);
+	Util::GLStateCache stateCache;
+	//Meshes are rebuilt on the workers while the sliders move
+	Util::JobSystem jobs;
 	unsigned int brickTexture = ew::loadTexture("assets/brick_color.jpg",GL_REPEAT,GL_LINEAR);
 
 	//Plane
 	float planeWidth = 1.f;
 	float planeHeight = 1.f;
 	int planeSubdivisions = 5;
-	ew::MeshData planeMeshData = Util::createPlane(planeWidth, planeHeight, planeSubdivisions);
-	ew::Mesh planeMesh(planeMeshData);
+	Util::Mesh planeMesh(Util::createPlane(planeWidth, planeHeight, planeSubdivisions));
 	ew::Transform planeTransform;
 	planeTransform.position = ew::Vec3(-3.f, 0.f, 0.f);
 
@@ -107,16 +127,14 @@ int main() {
 	float cylinderHeight = 2.f;
 	float cylinderRadius = 1.f;
 	int cylinderSegments = 8;
-	ew::MeshData cylinderMeshData = Util::createCylidner(cylinderHeight, cylinderRadius, cylinderSegments);
-	ew::Mesh cylinderMesh(cylinderMeshData);
+	Util::Mesh cylinderMesh(Util::createCylidner(cylinderHeight, cylinderRadius, cylinderSegments));
 	ew::Transform cylinderTransform;
 	cylinderTransform.position = ew::Vec3(-6.f, 0.f, 0.f);
 
 	//Sphere
 	float sphereRadius = 1.f;
 	int sphereSegments = 8;
-	ew::MeshData sphereMeshData = Util::createSphere(sphereRadius, sphereSegments);
-	ew::Mesh sphereMesh(sphereMeshData);
+	Util::Mesh sphereMesh(Util::createSphere(sphereRadius, sphereSegments));
 	ew::Transform sphereTransform;
 	sphereTransform.position = ew::Vec3(3.f, 0.f, 0.f);
 
@@ -125,14 +143,19 @@ int main() {
 	float torusOuterRadius = 1.f;
 	int torusInnerSegments = 16;
 	int torusOuterSegments = 16;
-	ew::MeshData torusMeshData = Util::createTorus(torusInnerRadius, torusOuterRadius, torusInnerSegments, torusOuterSegments);
-	ew::Mesh torusMesh(torusMeshData);
+	Util::Mesh torusMesh(Util::createTorus(torusInnerRadius, torusOuterRadius, torusInnerSegments, torusOuterSegments));
 	ew::Transform torusTransform;
 	torusTransform.position = ew::Vec3(6.f, 0.f, 0.f);
 
 	//Create cube
-	ew::MeshData cubeMeshData = ew::createCube(0.5f);
-	ew::Mesh cubeMesh(cubeMeshData);
+	Util::Mesh cubeMesh(ew::createCube(0.5f));
+
+	//After the meshes, it finishes its builds before they go away
+	Util::MeshRebuilder rebuilder(jobs);
+	auto rebuildPlane = [&]() { rebuilder.request(planeMesh, [=]() { return Util::createPlane(planeWidth, planeHeight, planeSubdivisions); }); };
+	auto rebuildCylinder = [&]() { rebuilder.request(cylinderMesh, [=]() { return Util::createCylidner(cylinderHeight, cylinderRadius, cylinderSegments); }); };
+	auto rebuildSphere = [&]() { rebuilder.request(sphereMesh, [=]() { return Util::createSphere(sphereRadius, sphereSegments); }); };
+	auto rebuildTorus = [&]() { rebuilder.request(torusMesh, [=]() { return Util::createTorus(torusInnerRadius, torusOuterRadius, torusInnerSegments, torusOuterSegments); }); };
 
 	//Initialize transforms
 	ew::Transform cubeTransform;
@@ -149,43 +172,76 @@ int main() {
 
 		cameraController.Move(window, &camera, deltaTime);
 
+		//Swaps in the meshes that finished building since last frame
+		jobs.runMainThreadJobs();
+
 		//Render
 		glClearColor(appSettings.bgColor.x, appSettings.bgColor.y, appSettings.bgColor.z,1.0f);
 
 		//Clear both color buffer AND depth buffer
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		shader.use();
 		glBindTexture(GL_TEXTURE_2D, brickTexture);
-		shader.setInt("_Texture", 0);
-		shader.setInt("_Mode", appSettings.shadingModeIndex);
-		shader.setVec3("_Color", appSettings.shapeColor);
-		shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
+		ew::Mat4 viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
 
 		//Euler angels to forward vector
 		ew::Vec3 lightRot = appSettings.lightRotation * ew::DEG2RAD;
 		ew::Vec3 lightF = ew::Vec3(sinf(lightRot.y) * cosf(lightRot.x), sinf(lightRot.x), -cosf(lightRot.y) * cosf(lightRot.x));
-		shader.setVec3("_LightDir", lightF);
+
+		shader.use();
+		setShadingUniforms(shader, viewProjection, lightF);
 
 		//Draw cube
 		shader.setMat4("_Model", cubeTransform.getModelMatrix());
 		cubeMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
+		//ew::Shader::use and ew::Mesh::draw bind straight through GL
+		stateCache.invalidate();
 
-		//Draw plane
-		shader.setMat4("_Model", planeTransform.getModelMatrix());
-		planeMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
+		if (appSettings.generateOnGpu && appSettings.tessellate)
+		{
+			const int base = TESSELLATION_BASE_SEGMENTS;
+			proceduralRenderer.add(Util::ProceduralPrimitive::plane(planeWidth, planeHeight, 1), planeTransform.getModelMatrix());
+			proceduralRenderer.add(Util::ProceduralPrimitive::cylinder(cylinderHeight, cylinderRadius, base), cylinderTransform.getModelMatrix());
+			proceduralRenderer.add(Util::ProceduralPrimitive::sphere(sphereRadius, base), sphereTransform.getModelMatrix());
+			proceduralRenderer.add(Util::ProceduralPrimitive::torus(torusInnerRadius, torusOuterRadius, base, base), torusTransform.getModelMatrix());
+
+			stateCache.useProgram(tessellatedShader.getId());
+			setShadingUniforms(tessellatedShader, viewProjection, lightF);
+			proceduralRenderer.setTessellationTarget(camera, SCREEN_HEIGHT, appSettings.tessellationPixels);
+			//Patches can't be drawn as points, wireframe shows the tessellation instead
+			proceduralRenderer.draw(stateCache, tessellatedShader.getId(), GL_PATCHES);
+			proceduralRenderer.clear();
+		}
+		else if (appSettings.generateOnGpu)
+		{
+			proceduralRenderer.add(Util::ProceduralPrimitive::plane(planeWidth, planeHeight, planeSubdivisions), planeTransform.getModelMatrix());
+			proceduralRenderer.add(Util::ProceduralPrimitive::cylinder(cylinderHeight, cylinderRadius, cylinderSegments), cylinderTransform.getModelMatrix());
+			proceduralRenderer.add(Util::ProceduralPrimitive::sphere(sphereRadius, sphereSegments), sphereTransform.getModelMatrix());
+			proceduralRenderer.add(Util::ProceduralPrimitive::torus(torusInnerRadius, torusOuterRadius, torusInnerSegments, torusOuterSegments), torusTransform.getModelMatrix());
+
+			stateCache.useProgram(proceduralShader.getId());
+			setShadingUniforms(proceduralShader, viewProjection, lightF);
+			proceduralRenderer.draw(stateCache, proceduralShader.getId(), appSettings.drawAsPoints ? GL_POINTS : GL_TRIANGLES);
+			proceduralRenderer.clear();
+		}
+		else
+		{
+			//Draw plane
+			shader.setMat4("_Model", planeTransform.getModelMatrix());
+			planeMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
 
-		//Draw cylidner
-		shader.setMat4("_Model", cylinderTransform.getModelMatrix());
-		cylinderMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
+			//Draw cylidner
+			shader.setMat4("_Model", cylinderTransform.getModelMatrix());
+			cylinderMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
 
-		//Draw sphere
-		shader.setMat4("_Model", sphereTransform.getModelMatrix());
-		sphereMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
+			//Draw sphere
+			shader.setMat4("_Model", sphereTransform.getModelMatrix());
+			sphereMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
 
-		//Draw torus
-		shader.setMat4("_Model", torusTransform.getModelMatrix());
-		torusMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
+			//Draw torus
+			shader.setMat4("_Model", torusTransform.getModelMatrix());
+			torusMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
+		}
 
 		//Render UI
 		{
@@ -220,6 +276,21 @@ int main() {
 				ImGui::DragFloat3("Light Rotation", &appSettings.lightRotation.x, 1.0f);
 			}
 			ImGui::Checkbox("Draw as points", &appSettings.drawAsPoints);
+			if (Util::ProceduralRenderer::isSupported()) {
+				//The meshes weren't kept up to date meanwhile
+				if (ImGui::Checkbox("Generate on GPU", &appSettings.generateOnGpu) && !appSettings.generateOnGpu) {
+					rebuildPlane();
+					rebuildCylinder();
+					rebuildSphere();
+					rebuildTorus();
+				}
+				if (appSettings.generateOnGpu) {
+					ImGui::Checkbox("Tessellate", &appSettings.tessellate);
+					if (appSettings.tessellate) {
+						ImGui::SliderFloat("Pixels per segment", &appSettings.tessellationPixels, 2.f, 64.f);
+					}
+				}
+			}
 			if (ImGui::Checkbox("Wireframe", &appSettings.wireframe)) {
 				glPolygonMode(GL_FRONT_AND_BACK, appSettings.wireframe ? GL_LINE : GL_FILL);
 			}
@@ -229,55 +300,71 @@ int main() {
 				else
 					glDisable(GL_CULL_FACE);
 			}
+			//Only rebuilt when a value changed, the old mesh keeps drawing until the new one is swapped in
 			if (ImGui::CollapsingHeader("Plane"))
 			{
-				ImGui::DragFloat("Plane width", &planeWidth, 0.05f, 0.05f, 10.f);
-				ImGui::DragFloat("Plane height", &planeHeight, 0.05f, 0.05f, 10.f);
-				ImGui::SliderInt("Plane subdivisions", &planeSubdivisions, 1, 20);
+				bool changed = ImGui::DragFloat("Plane width", &planeWidth, 0.05f, 0.05f, 10.f);
+				changed |= ImGui::DragFloat("Plane height", &planeHeight, 0.05f, 0.05f, 10.f);
+				changed |= ImGui::SliderInt("Plane subdivisions", &planeSubdivisions, 1, 20);
 				ImGuiTransformGroup(planeTransform);
 				
-				planeMeshData = Util::createPlane(planeWidth, planeHeight, planeSubdivisions);
-				planeMesh = ew::Mesh(planeMeshData);
+				if (changed && !appSettings.generateOnGpu) {
+					rebuildPlane();
+				}
 			}
 			if (ImGui::CollapsingHeader("Cylinder"))
 			{
-				ImGui::DragFloat("Cylinder height", &cylinderHeight, 0.05f, 0.2f, 10.f);
-				ImGui::DragFloat("Cylinder radius", &cylinderRadius, 0.05f, 0.1f, 5.f);
-				ImGui::SliderInt("Cuylinder segments", &cylinderSegments, 1, 20);
+				bool changed = ImGui::DragFloat("Cylinder height", &cylinderHeight, 0.05f, 0.2f, 10.f);
+				changed |= ImGui::DragFloat("Cylinder radius", &cylinderRadius, 0.05f, 0.1f, 5.f);
+				changed |= ImGui::SliderInt("Cuylinder segments", &cylinderSegments, 1, 20);
 				ImGuiTransformGroup(cylinderTransform);
 
-				cylinderMeshData = Util::createCylidner(cylinderHeight, cylinderRadius, cylinderSegments);
-				cylinderMesh = ew::Mesh(cylinderMeshData);;
+				if (changed && !appSettings.generateOnGpu) {
+					rebuildCylinder();
+				}
 
 			}
 			if (ImGui::CollapsingHeader("Sphere"))
 			{
-				ImGui::DragFloat("Sphere radius", &sphereRadius, 0.05f, 0.05f, 10.f);
-				ImGui::SliderInt("Sphere segments", &sphereSegments, 3, 64);
+				bool changed = ImGui::DragFloat("Sphere radius", &sphereRadius, 0.05f, 0.05f, 10.f);
+				changed |= ImGui::SliderInt("Sphere segments", &sphereSegments, 3, 64);
 				ImGuiTransformGroup(sphereTransform);
 
-				sphereMeshData = Util::createSphere(sphereRadius, sphereSegments);
-				sphereMesh = ew::Mesh(sphereMeshData);
+				if (changed && !appSettings.generateOnGpu) {
+					rebuildSphere();
+				}
 			}
 			if (ImGui::CollapsingHeader("Torus"))
 			{
-				ImGui::DragFloat("Torus inner radius", &torusInnerRadius, 0.05f, 0.05f, 5.f);
-				ImGui::DragFloat("Torus outer radius", &torusOuterRadius, 0.05f, 0.05f, 10.f);
-				ImGui::SliderInt("Torus inner segments", &torusInnerSegments, 3, 64);
-				ImGui::SliderInt("Torus outer segments", &torusOuterSegments, 3, 64);
+				bool changed = ImGui::DragFloat("Torus inner radius", &torusInnerRadius, 0.05f, 0.05f, 5.f);
+				changed |= ImGui::DragFloat("Torus outer radius", &torusOuterRadius, 0.05f, 0.05f, 10.f);
+				changed |= ImGui::SliderInt("Torus inner segments", &torusInnerSegments, 3, 64);
+				changed |= ImGui::SliderInt("Torus outer segments", &torusOuterSegments, 3, 64);
 				ImGuiTransformGroup(torusTransform);
 
-				torusMeshData = Util::createTorus(torusInnerRadius, torusOuterRadius, torusInnerSegments, torusOuterSegments);
-				torusMesh = ew::Mesh(torusMeshData);
+				if (changed && !appSettings.generateOnGpu) {
+					rebuildTorus();
+				}
+			}
+			if (!appSettings.generateOnGpu && ImGui::CollapsingHeader("Mesh rebuilds"))
+			{
+				Util::MeshRebuildStats rebuilds = rebuilder.getStats();
+				ImGui::Text("Requested %d, coalesced %d, cancelled %d, swapped %d", rebuilds.requests, rebuilds.coalesced, rebuilds.cancelled, rebuilds.swapped);
+				ImGui::Text("Last build %.2f ms on a worker, upload %.2f ms", rebuilds.buildMs, rebuilds.uploadMs);
 			}
 			ImGui::End();
 			
 			ImGui::Render();
 			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			//ImGui's renderer binds its own program, vertex array and texture
+			stateCache.invalidate();
 		}
 
+		//Meshes replaced by the UI above are deleted once the GPU finished drawing them
+		Util::GpuResourceRegistry::get().endFrame();
 		glfwSwapBuffers(window);
 	}
+	ew::deleteTexture(brickTexture);
 	printf("Shutting down...");
 }
 
@@ -289,6 +376,15 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 	camera.aspectRatio = (float)SCREEN_WIDTH / SCREEN_HEIGHT;
 }
 
+void setShadingUniforms(ew::Shader& shader, const ew::Mat4& viewProjection, const ew::Vec3& lightDir)
+{
+	shader.setInt("_Texture", 0);
+	shader.setInt("_Mode", appSettings.shadingModeIndex);
+	shader.setVec3("_Color", appSettings.shapeColor);
+	shader.setMat4("_ViewProjection", viewProjection);
+	shader.setVec3("_LightDir", lightDir);
+}
+
 void resetCamera(ew::Camera& camera, ew::CameraController& cameraController) {
 	camera.position = ew::Vec3(0, 0, 3);
 	camera.target = ew::Vec3(0);
@@ -274,6 +274,7 @@ int main() {
 
 		glfwSwapBuffers(window);
 	}
+	ew::deleteTexture(brickTexture);
 	printf("Shutting down...");
 }
 
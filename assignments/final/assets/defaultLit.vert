@@ -23,6 +23,9 @@ out Surface
 uniform mat4 _Model;
 uniform mat4 _ViewProjection;
 
+//Depth pre-pass relies on bit-identical positions (GL_EQUAL)
+invariant gl_Position;
+
 void main()
 {
 	vec3 t = normalize(mat3(_Model) * vTangent);
@@ -0,0 +1,42 @@
+#version 450
+//Util::SphereImpostorRenderer: the pixel's ray is intersected with the sphere, misses are discarded and hits write
+//their own depth, so impostors intersect each other and the scene like the mesh would
+
+in vec3 WorldPos;
+flat in vec4 CenterRadius;
+flat in vec3 Color;
+
+uniform mat4 _ViewProjection;
+uniform vec3 _CameraPosition;
+uniform vec3 _CameraForward;
+uniform int _Orthographic;
+//0 is a flat color like emissive.frag for gizmos, 1 lights distant objects from _LightDirection
+uniform int _Lit;
+uniform vec3 _LightDirection;
+
+out vec4 FragColor;
+
+void main()
+{
+	//Orthographic rays are parallel and start on the quad, the front surface can be behind their origin
+	vec3 origin = _Orthographic != 0 ? WorldPos : _CameraPosition;
+	vec3 direction = _Orthographic != 0 ? _CameraForward : normalize(WorldPos - _CameraPosition);
+	vec3 center = CenterRadius.xyz;
+	float radius = CenterRadius.w;
+
+	//Closest approach to the center first, far more precise than the quadratic's discriminant for small spheres
+	float along = dot(center - origin, direction);
+	vec3 closest = origin + direction * along - center;
+	float h = radius * radius - dot(closest, closest);
+	if (h < 0.0) discard;
+
+	vec3 hit = origin + direction * (along - sqrt(h));
+	vec4 clip = _ViewProjection * vec4(hit, 1.0);
+	//Hit in front of the near plane
+	if (clip.z < -clip.w) discard;
+	gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+	vec3 normal = (hit - center) / radius;
+	float light = _Lit != 0 ? 0.3 + 0.7 * max(dot(normal, -normalize(_LightDirection)), 0.0) : 1.0;
+	FragColor = vec4(Color * light, 1.0);
+}
@@ -0,0 +1,60 @@
+#version 450
+//Util::SphereImpostorRenderer: a camera facing quad per instance, just big enough to cover the sphere's silhouette.
+//No vertex attributes, the corner comes from gl_VertexID
+
+//Util::SphereImpostor
+struct Sphere
+{
+	vec4 centerRadius;
+	vec4 color;
+};
+
+//SPHERE_IMPOSTOR_STORAGE_BINDING
+layout(std430, binding = 2) readonly buffer Spheres
+{
+	Sphere _Spheres[];
+};
+
+uniform mat4 _ViewProjection;
+uniform vec3 _CameraPosition;
+uniform vec3 _CameraForward;
+uniform int _Orthographic;
+
+out vec3 WorldPos;
+flat out vec4 CenterRadius;
+flat out vec3 Color;
+
+void main()
+{
+	Sphere sphere = _Spheres[gl_InstanceID];
+	vec3 center = sphere.centerRadius.xyz;
+	float radius = sphere.centerRadius.w;
+	CenterRadius = sphere.centerRadius;
+	Color = sphere.color.rgb;
+
+	vec3 forward = _CameraForward;
+	float halfSize = radius;
+	if (_Orthographic == 0)
+	{
+		vec3 toCenter = center - _CameraPosition;
+		float distance = length(toCenter);
+		//Camera inside the sphere, collapse the quad
+		if (distance <= radius)
+		{
+			gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+			return;
+		}
+		forward = toCenter / distance;
+		//The silhouette cone is wider than the sphere where it crosses the plane through the center
+		halfSize = radius * distance / sqrt(distance * distance - radius * radius);
+	}
+
+	vec3 up = abs(forward.y) > 0.99 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+	vec3 right = normalize(cross(forward, up));
+	up = cross(right, forward);
+
+	//Strip corners (-1,-1), (1,-1), (-1,1), (1,1), counter clockwise facing the camera
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	WorldPos = center + (right * corner.x + up * corner.y) * halfSize;
+	gl_Position = _ViewProjection * vec4(WorldPos, 1.0);
+}
@@ -20,14 +20,33 @@
 #include <ew/camera.h>
 #include <ew/cameraController.h>
 
+//Counts heap allocations for the profiler panel, the hooks are compiled into this file only
+#define UTIL_ALLOCATION_TRACKER_HOOKS
+#include "util/AllocationTracker.h"
+#include "util/FramePipeline.h"
+#include "util/FrameSync.h"
+#include "util/GLStateCache.h"
+#include "util/GpuResources.h"
+#include "util/ImGuiSnapshot.h"
+#include "util/JobSystem.h"
 #include "util/Mesh.h"
+#include "util/MeshStaging.h"
+#include "util/OcclusionCuller.h"
+#include "util/Profiler.h"
+#include "util/Renderer.h"
+#include "util/RenderThread.h"
+#include "util/SphereImpostors.h"
 #include "util/Texture.h"
+#include "util/VertexFormat.h"
 
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <sstream>
+#include <vector>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void resetCamera(ew::Camera& camera, ew::CameraController& cameraController);
@@ -36,6 +55,10 @@ int SCREEN_WIDTH = 1080;
 int SCREEN_HEIGHT = 720;
 
 constexpr int MAX_LIGHTS = 4;
+//Light gizmo sphere, as a mesh or an impostor
+constexpr float LIGHT_RADIUS = 0.3f;
+//Width of the CPU occlusion buffer, the height follows the window's aspect ratio
+constexpr int OCCLUSION_BUFFER_WIDTH = 256;
 
 struct Light
 {
@@ -53,6 +76,262 @@ void renderLight(const Light& light, ew::Shader& emissiveShader, const ew::Mesh&
 	lightMesh.draw();
 }
 
+enum SceneMesh
+{
+	CUBE_MESH = 0,
+	PLANE_MESH,
+	SPHERE_MESH,
+	CYLINDER_MESH,
+	SCENE_MESH_COUNT
+};
+
+//Same shapes on the render thread and for the main thread's bounds
+ew::MeshData createSceneMesh(SceneMesh mesh, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+{
+	switch (mesh)
+	{
+	case CUBE_MESH: return ew::createCube(1.0f, resource);
+	case PLANE_MESH: return ew::createPlane(5.0f, 5.0f, 10, resource);
+	case SPHERE_MESH: return ew::createSphere(0.5f, 64, resource);
+	default: return ew::createCylinder(0.5f, 1.0f, 32, resource);
+	}
+}
+
+struct MaterialSettings
+{
+	float ambientK = 0.2f;
+	ew::Vec3 ambientColor = ew::Vec3(0.341f, 0.365f, 0.51f);
+	float diffuseK = 0.4f;
+	float specularK = 0.5f;
+	float shininess = 10.f;
+
+	//Parallax mapping settings
+	int parallaxMethod = 0;
+	bool discardOutOfBoundFrags = true;
+	float heightScale = 0.1f;
+	int minLayers = 8;
+	int maxLayers = 32;
+	int textureUsed = 0;
+};
+
+//Everything the render thread needs for one frame. Filled by the main thread, never touched again once published
+struct FramePacket
+{
+	struct Draw
+	{
+		SceneMesh mesh;
+		ew::Mat4 model;
+		//Stays with the object when culled draws are dropped, the renderer's occlusion queries key on it
+		int id;
+	};
+
+	int viewportWidth = 0;
+	int viewportHeight = 0;
+	ew::Vec3 bgColor;
+
+	ew::Camera camera;
+	ew::Mat4 viewProjection;
+
+	std::vector<Draw> draws;
+
+	int activeLights = 0;
+	Light lights[MAX_LIGHTS];
+	//Ray cast sphere impostors rather than the sphere mesh
+	bool lightImpostors = true;
+
+	MaterialSettings material;
+	Util::RenderSettings rendererSettings;
+
+	Util::ImGuiSnapshot ui;
+};
+
+//Render thread results the UI shows, a frame or two late
+struct RenderFeedback
+{
+	std::mutex mutex;
+	Util::RenderStats stats;
+	Util::OcclusionQueryStats occlusionQueries;
+	Util::GLStateStats binds;
+	bool depthPrePass = false;
+	Util::FrameSyncStats frameSync;
+	Util::GpuResourceStats gpuResources;
+};
+
+//Owns every GL object, only ever created, used and destroyed on the render thread
+struct RenderResources
+{
+	ew::Shader shader;
+	ew::Shader emissiveShader;
+	ew::Shader impostorShader;
+	Util::Renderer renderer;
+
+	//Every program/VAO/texture bind in the frame goes through here so redundant ones are skipped
+	Util::GLStateCache stateCache;
+	//Fences every frame so the CPU never runs more than two frames ahead of the GPU
+	Util::FrameSync frameSync;
+
+	//Swapping the material releases the old pair, deleted once the GPU is done with them
+	Util::GpuResource colorTexture;
+	Util::GpuResource heightTexture;
+	int loadedTexture = -1;
+
+	//Using extended Mesh class, with a position-only stream for the depth pre-pass
+	Util::Mesh meshes[SCENE_MESH_COUNT];
+	//Light mesh (reused)
+	ew::Mesh lightMesh;
+	Util::SphereImpostorRenderer lightImpostors;
+
+	//Light uniform names, built once so setting them never allocates
+	char lightPositionNames[MAX_LIGHTS][32];
+	char lightColorNames[MAX_LIGHTS][32];
+
+	RenderResources()
+		: shader("assets/defaultLit.vert", "assets/defaultLit.frag"),
+		emissiveShader("assets/emissive.vert", "assets/emissive.frag"),
+		impostorShader("assets/sphereImpostor.vert", "assets/sphereImpostor.frag"),
+		renderer("assets/depthOnly.vert", "assets/depthOnly.frag"),
+		lightMesh(ew::createSphere(LIGHT_RADIUS, 12)),
+		lightImpostors(MAX_LIGHTS)
+	{
+		//Generated straight into mapped memory and copied into the meshes by the GPU
+		Util::MeshStaging staging;
+		for (int i = 0; i < SCENE_MESH_COUNT; i++) meshes[i].load(createSceneMesh(SceneMesh(i), &staging), true);
+
+		//Sampler units never change, textures are bound per draw by the renderer
+		stateCache.useProgram(shader.getId());
+		shader.setInt("_colorTexture", 0);
+		shader.setInt("_heightTexture", 1);
+
+		for (int i = 0; i < MAX_LIGHTS; i++)
+		{
+			snprintf(lightPositionNames[i], sizeof(lightPositionNames[i]), "_lights[%d].position", i);
+			snprintf(lightColorNames[i], sizeof(lightColorNames[i]), "_lights[%d].color", i);
+		}
+	}
+};
+
+void renderFrame(RenderResources& resources, const FramePacket& packet, RenderFeedback& feedback)
+{
+	ew::Shader& shader = resources.shader;
+	Util::GLStateCache& stateCache = resources.stateCache;
+	Util::Renderer& renderer = resources.renderer;
+	const MaterialSettings& material = packet.material;
+
+	if (resources.loadedTexture != material.textureUsed)
+	{
+		if (material.textureUsed == 0)
+		{
+			resources.colorTexture = Util::loadTexture("assets/rock_color.jpg", GL_REPEAT, GL_LINEAR);
+			resources.heightTexture = Util::loadTexture("assets/rock_height.jpg", GL_REPEAT, GL_LINEAR);
+		}
+		else
+		{
+			resources.colorTexture = Util::loadTexture("assets/bamboo_color.jpg", GL_REPEAT, GL_LINEAR);
+			resources.heightTexture = Util::loadTexture("assets/bamboo_height.jpg", GL_REPEAT, GL_LINEAR);
+		}
+
+		resources.loadedTexture = material.textureUsed;
+	}
+
+	//RENDER
+	glViewport(0, 0, packet.viewportWidth, packet.viewportHeight);
+	glClearColor(packet.bgColor.x, packet.bgColor.y, packet.bgColor.z, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	stateCache.resetStats();
+	stateCache.useProgram(shader.getId());
+	shader.setVec3("_cameraPosition", packet.camera.position);
+
+	//Change light uniforms
+	shader.setInt("_activeLights", packet.activeLights);
+	for (int i = 0; i < packet.activeLights; i++)
+	{
+		shader.setVec3(resources.lightPositionNames[i], packet.lights[i].positon);
+		shader.setVec3(resources.lightColorNames[i], packet.lights[i].color);
+	}
+
+	//Set material/light props
+	shader.setFloat("_material.ambientK", material.ambientK);
+	shader.setVec3("_ambientColor", material.ambientColor);
+	shader.setFloat("_material.diffuseK", material.diffuseK);
+	shader.setFloat("_material.specularK", material.specularK);
+	shader.setFloat("_material.shininess", material.shininess);
+
+	//Set parallax mapping props
+	shader.setInt("_parallaxMethod", material.parallaxMethod);
+	shader.setInt("_discardOutOfBoundFrags", int(material.discardOutOfBoundFrags));
+	shader.setFloat("_heightScale", material.heightScale);
+	shader.setFloat("_minLayers", float(material.minLayers));
+	shader.setFloat("_maxLayers", float(material.maxLayers));
+
+	//Draw shapes
+	renderer.settings = packet.rendererSettings;
+	Util::MaterialTextures materialTextures;
+	materialTextures.units[0] = resources.colorTexture.get();
+	materialTextures.units[1] = resources.heightTexture.get();
+
+	//Parallax mapped shading is what a hidden object costs, so those wait on their query on the GPU instead of popping in
+	bool expensive = material.parallaxMethod != 0;
+	renderer.begin(packet.camera);
+	for (const FramePacket::Draw& draw : packet.draws)
+	{
+		renderer.submit(resources.meshes[draw.mesh], draw.model, materialTextures, draw.id, expensive);
+	}
+	renderer.flush(shader, packet.viewportWidth, packet.viewportHeight, stateCache);
+
+	//Render point lights
+	{
+		PROFILE_SCOPE("Lights");
+		PROFILE_GPU_SCOPE("Lights");
+
+		if (packet.lightImpostors && Util::SphereImpostorRenderer::isSupported())
+		{
+			//All lights in one instanced draw, flat colored like the emissive shader
+			Util::SphereImpostorRenderer& impostors = resources.lightImpostors;
+			impostors.clear();
+			for (int i = 0; i < packet.activeLights; i++) impostors.add(packet.lights[i].positon, LIGHT_RADIUS, packet.lights[i].color);
+
+			stateCache.useProgram(resources.impostorShader.getId());
+			resources.impostorShader.setMat4("_ViewProjection", packet.viewProjection);
+			resources.impostorShader.setInt("_Lit", 0);
+			impostors.draw(stateCache, resources.impostorShader.getId(), packet.camera, &resources.frameSync);
+		}
+		else
+		{
+			//Setup emissive shader
+			stateCache.useProgram(resources.emissiveShader.getId());
+			resources.emissiveShader.setMat4("_ViewProjection", packet.viewProjection);
+			//Render all lights
+			for (int i = 0; i < packet.activeLights; i++)
+			{
+				renderLight(packet.lights[i], resources.emissiveShader, resources.lightMesh);
+			}
+			//ew::Mesh::draw binds its vertex array straight through GL
+			stateCache.invalidate();
+		}
+	}
+
+	//UI binds behind the cache's back, so only count the scene's binds
+	{
+		std::lock_guard<std::mutex> lock(feedback.mutex);
+		feedback.stats = renderer.getStats();
+		feedback.occlusionQueries = renderer.getOcclusionStats();
+		feedback.binds = stateCache.getStats();
+		feedback.depthPrePass = renderer.settings.depthPrePass;
+		feedback.frameSync = resources.frameSync.getStats();
+		feedback.gpuResources = Util::GpuResourceRegistry::get().getStats();
+	}
+
+	//Render UI
+	{
+		PROFILE_SCOPE("UI");
+		PROFILE_GPU_SCOPE("UI");
+		if (ImDrawData* drawData = packet.ui.getDrawData()) ImGui_ImplOpenGL3_RenderDrawData(drawData);
+	}
+	//ImGui binds its own program, VAO and textures
+	stateCache.invalidate();
+}
+
 float prevTime;
 ew::Vec3 bgColor = ew::Vec3(0.1f);
 
@@ -78,30 +357,13 @@ int main() {
 		printf("GLAD Failed to load GL headers");
 		return 1;
 	}
+	//The render thread owns the context from here on
+	glfwMakeContextCurrent(NULL);
 
-	//Initialize ImGUI
+	//Initialize ImGUI, the OpenGL backend is initialized on the render thread
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
-	ImGui_ImplOpenGL3_Init();
-
-	//Global settings
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-	glEnable(GL_DEPTH_TEST);
-
-	ew::Shader shader("assets/defaultLit.vert", "assets/defaultLit.frag");
-	GLuint colorTexture = Util::loadTexture("assets/rock_color.jpg", GL_REPEAT, GL_LINEAR);
-	GLuint heightTexture = Util::loadTexture("assets/rock_height.jpg", GL_REPEAT, GL_LINEAR);
-
-	ew::Shader emissiveShader("assets/emissive.vert", "assets/emissive.frag");
-
-	//Create cube
-	//Using extended Mesh class
-	Util::Mesh cubeMesh(ew::createCube(1.0f));
-	Util::Mesh planeMesh(ew::createPlane(5.0f, 5.0f, 10));
-	Util::Mesh sphereMesh(ew::createSphere(0.5f, 64));
-	Util::Mesh cylinderMesh(ew::createCylinder(0.5f, 1.0f, 32));
 
 	//Initialize transforms
 	ew::Transform cubeTransform;
@@ -112,10 +374,29 @@ int main() {
 	sphereTransform.position = ew::Vec3(-1.5f, 0.0f, 0.0f);
 	cylinderTransform.position = ew::Vec3(1.5f, 0.0f, 0.0f);
 
-	//Light mesh (reused)
-	ew::Mesh lightMesh(ew::createSphere(0.3f, 12));
-	
+	//The cube and the plane occlude, every draw is tested against them by its local AABB
+	Util::JobSystem jobs;
+	Util::OcclusionCuller occlusionCuller(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_WIDTH * SCREEN_HEIGHT / SCREEN_WIDTH, jobs);
+	Util::OccluderMesh cubeOccluder(createSceneMesh(CUBE_MESH));
+	Util::OccluderMesh planeOccluder(ew::createPlane(5.0f, 5.0f, 1));
+	ew::Vec3 meshBoundsMin[SCENE_MESH_COUNT];
+	ew::Vec3 meshBoundsMax[SCENE_MESH_COUNT];
+	for (int i = 0; i < SCENE_MESH_COUNT; i++)
+	{
+		ew::MeshData meshData = createSceneMesh(SceneMesh(i));
+		meshBoundsMin[i] = meshBoundsMax[i] = meshData.vertices[0].pos;
+		for (const ew::Vertex& vertex : meshData.vertices)
+		{
+			meshBoundsMin[i] = ew::Vec3(fminf(meshBoundsMin[i].x, vertex.pos.x), fminf(meshBoundsMin[i].y, vertex.pos.y), fminf(meshBoundsMin[i].z, vertex.pos.z));
+			meshBoundsMax[i] = ew::Vec3(fmaxf(meshBoundsMax[i].x, vertex.pos.x), fmaxf(meshBoundsMax[i].y, vertex.pos.y), fmaxf(meshBoundsMax[i].z, vertex.pos.z));
+		}
+	}
+	bool occlusionCulling = true;
+	std::vector<Util::OcclusionBounds> occlusionBounds;
+	std::vector<unsigned char> occlusionVisible;
+
 	bool animateLights = true;
+	bool lightImpostors = true;
 	int activeLights = MAX_LIGHTS;
 	float lightOrbitRadius = 3.f;
 	float lightOrbitSpeed = 1.f;
@@ -129,112 +410,164 @@ int main() {
 	};
 
 	//Material properties
-	float ambientK = 0.2f;
-	ew::Vec3 ambientColor = ew::Vec3(0.341f, 0.365f, 0.51f);
-	float diffuseK = 0.4f;
-	float specularK = 0.5f;
-	float shininess = 10.f;
+	MaterialSettings material;
 
-	//Parallax mapping settings
-	int parallaxMethod = 0;
-	bool discardOutOfBoundFrags = true;
-	float heightScale = 0.1f;
-	int minLayers = 8;
-	int maxLayers = 32;
-	int prevTextureUsed = 0;
-	int textureUsed = 0;
+	Util::RenderSettings rendererSettings;
+	bool useDepthPrePass = true;
 
 	resetCamera(camera,cameraController);
 
+	Util::Profiler& profiler = Util::Profiler::get();
+	profiler.setThreadName("Main");
+	bool showProfiler = false;
+
+	//Main thread simulates and records frame N+1 while the render thread draws frame N
+	Util::FramePipeline pipeline(1);
+	int pipelineDepth = pipeline.getDepth();
+	FramePacket packets[FRAME_PIPELINE_SLOTS];
+	RenderFeedback feedback;
+
+	std::unique_ptr<RenderResources> resources;
+	Util::RenderThread renderThread(pipeline);
+	renderThread.start(
+		[&]()
+		{
+			glfwMakeContextCurrent(window);
+			ImGui_ImplOpenGL3_Init();
+			//Creates the font texture now, before the main thread's first ImGui::NewFrame() needs the atlas
+			ImGui_ImplOpenGL3_NewFrame();
+
+			//Global settings
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_BACK);
+			glEnable(GL_DEPTH_TEST);
+
+			resources.reset(new RenderResources());
+		},
+		[&](int slot)
+		{
+			resources->frameSync.beginFrame();
+			renderFrame(*resources, packets[slot], feedback);
+			//Fence before the swap, which may block on vsync
+			resources->frameSync.endFrame();
+			Util::GpuResourceRegistry::get().endFrame();
+			glfwSwapBuffers(window);
+		},
+		[&]()
+		{
+			resources.reset();
+			Util::VertexFormatRegistry::get().clear();
+			//Anything still registered after this was never released
+			Util::GpuResourceRegistry::get().flush();
+			Util::GpuResourceRegistry::get().printLive();
+			ImGui_ImplOpenGL3_Shutdown();
+			glfwMakeContextCurrent(NULL);
+		});
+
 	while (!glfwWindowShouldClose(window)) {
+		profiler.beginFrame();
+
+		//Wait for a free packet before sampling input, with depth 0 this keeps both threads in lockstep
+		int slot = pipeline.beginWrite();
+		FramePacket& packet = packets[slot];
+
 		glfwPollEvents();
+		uint64_t inputNs = Util::Profiler::nowNs();
 
 		float time = (float)glfwGetTime();
 		float deltaTime = time - prevTime;
 		prevTime = time;
 
-		//Update camera
-		camera.aspectRatio = (float)SCREEN_WIDTH / SCREEN_HEIGHT;
-		cameraController.Move(window, &camera, deltaTime);
-
-		//Animate lights
-		if (animateLights)
 		{
-			float lightAngleDiff = 2.f * M_PI / activeLights;
-			for (int i = 0; i < activeLights; i++)
+			PROFILE_SCOPE("Update");
+
+			//Update camera
+			camera.aspectRatio = (float)SCREEN_WIDTH / SCREEN_HEIGHT;
+			cameraController.Move(window, &camera, deltaTime);
+
+			//Animate lights
+			if (animateLights)
 			{
-				lights[i].positon = ew::Vec3(lightOrbitRadius * cos(time * lightOrbitSpeed + i * lightAngleDiff), lightHeight, lightOrbitRadius * sin(time * lightOrbitSpeed + i * lightAngleDiff));
+				float lightAngleDiff = 2.f * M_PI / activeLights;
+				for (int i = 0; i < activeLights; i++)
+				{
+					lights[i].positon = ew::Vec3(lightOrbitRadius * cos(time * lightOrbitSpeed + i * lightAngleDiff), lightHeight, lightOrbitRadius * sin(time * lightOrbitSpeed + i * lightAngleDiff));
+				}
 			}
 		}
 
-		//RENDER
-		glClearColor(bgColor.x, bgColor.y,bgColor.z,1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		//Record the frame packet
+		{
+			PROFILE_SCOPE("Record");
+
+			packet.viewportWidth = SCREEN_WIDTH;
+			packet.viewportHeight = SCREEN_HEIGHT;
+			packet.bgColor = bgColor;
+			packet.camera = camera;
+			packet.viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
+
+			packet.draws.clear();
+			packet.draws.push_back(FramePacket::Draw{ CUBE_MESH, cubeTransform.getModelMatrix(), 0 });
+			packet.draws.push_back(FramePacket::Draw{ PLANE_MESH, planeTransform.getModelMatrix(), 1 });
+			packet.draws.push_back(FramePacket::Draw{ SPHERE_MESH, sphereTransform.getModelMatrix(), 2 });
+			packet.draws.push_back(FramePacket::Draw{ CYLINDER_MESH, cylinderTransform.getModelMatrix(), 3 });
+
+			//Hidden draws never reach the render thread
+			if (occlusionCulling)
+			{
+				PROFILE_SCOPE("Occlusion culling");
+
+				int occlusionHeight = std::max(OCCLUSION_BUFFER_WIDTH * SCREEN_HEIGHT / std::max(SCREEN_WIDTH, 1), 1);
+				if (occlusionCuller.getHeight() != occlusionHeight) occlusionCuller.resize(OCCLUSION_BUFFER_WIDTH, occlusionHeight);
 
-		shader.use();
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, colorTexture);
-		shader.setInt("_colorTexture", 0);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, heightTexture);
-		shader.setInt("_heightTexture", 1);
-		shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
-		shader.setVec3("_cameraPosition", camera.position);
+				occlusionCuller.begin(packet.viewProjection);
+				occlusionCuller.addOccluder(cubeOccluder, cubeTransform.getModelMatrix());
+				occlusionCuller.addOccluder(planeOccluder, planeTransform.getModelMatrix());
+				occlusionCuller.flush();
 
-		//Change light uniforms
-		shader.setInt("_activeLights", activeLights);
-		for (int i = 0; i < activeLights; i++)
-		{
-			std::stringstream lightPositionStream;
-			lightPositionStream << "_lights[" << i << "].position";
-			std::stringstream lightColorStream;
-			lightColorStream << "_lights[" << i << "].color";
+				occlusionBounds.clear();
+				for (const FramePacket::Draw& draw : packet.draws) occlusionBounds.push_back({ meshBoundsMin[draw.mesh], meshBoundsMax[draw.mesh], draw.model });
+				occlusionCuller.test(occlusionBounds, occlusionVisible);
 
-			shader.setVec3(lightPositionStream.str(), lights[i].positon);
-			shader.setVec3(lightColorStream.str(), lights[i].color);
-		}
+				size_t kept = 0;
+				for (size_t i = 0; i < packet.draws.size(); i++)
+				{
+					if (occlusionVisible[i]) packet.draws[kept++] = packet.draws[i];
+				}
+				packet.draws.resize(kept);
+			}
 
-		//Draw shapes
-		shader.setMat4("_Model", cubeTransform.getModelMatrix());
-		cubeMesh.draw();
-
-		shader.setMat4("_Model", planeTransform.getModelMatrix());
-		planeMesh.draw();
-
-		shader.setMat4("_Model", sphereTransform.getModelMatrix());
-		sphereMesh.draw();
-
-		shader.setMat4("_Model", cylinderTransform.getModelMatrix());
-		cylinderMesh.draw();
-
-		//Set material/light props
-		shader.setFloat("_material.ambientK", ambientK);
-		shader.setVec3("_ambientColor", ambientColor);
-		shader.setFloat("_material.diffuseK", diffuseK);
-		shader.setFloat("_material.specularK", specularK);
-		shader.setFloat("_material.shininess", shininess);
-
-		//Set parallax mapping props
-		shader.setInt("_parallaxMethod", parallaxMethod);
-		shader.setInt("_discardOutOfBoundFrags", int(discardOutOfBoundFrags));
-		shader.setFloat("_heightScale", heightScale);
-		shader.setFloat("_minLayers", float(minLayers));
-		shader.setFloat("_maxLayers", float(maxLayers));
-
-		//Render point lights
-		//Setup emissive shader
-		emissiveShader.use();
-		emissiveShader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
-		//Render all lights
-		for (int i = 0; i < activeLights; i++)
-		{
-			renderLight(lights[i], emissiveShader, lightMesh);
+			packet.activeLights = activeLights;
+			packet.lightImpostors = lightImpostors;
+			for (int i = 0; i < activeLights; i++) packet.lights[i] = lights[i];
+
+			packet.material = material;
+			//Discarded fragments would still write depth in the pre-pass, so it's only safe when nothing is discarded
+			rendererSettings.depthPrePass = useDepthPrePass && !(material.discardOutOfBoundFrags && material.parallaxMethod != 0);
+			packet.rendererSettings = rendererSettings;
 		}
-		
-		//Render UI
+
+		//Build UI
 		{
+			PROFILE_SCOPE("UI");
+
+			Util::RenderStats stats;
+			Util::OcclusionQueryStats occlusionQueryStats;
+			Util::GLStateStats lastFrameBinds;
+			bool depthPrePassActive;
+			Util::FrameSyncStats frameSyncStats;
+			Util::GpuResourceStats gpuResourceStats;
+			{
+				std::lock_guard<std::mutex> lock(feedback.mutex);
+				stats = feedback.stats;
+				occlusionQueryStats = feedback.occlusionQueries;
+				lastFrameBinds = feedback.binds;
+				depthPrePassActive = feedback.depthPrePass;
+				frameSyncStats = feedback.frameSync;
+				gpuResourceStats = feedback.gpuResources;
+			}
+
 			ImGui_ImplGlfw_NewFrame();
-			ImGui_ImplOpenGL3_NewFrame();
 			ImGui::NewFrame();
 
 			ImGui::Begin("Settings");
@@ -258,11 +591,11 @@ int main() {
 			}
 			if (ImGui::CollapsingHeader("Material"))
 			{
-				ImGui::SliderFloat("Ambient light intensity", &ambientK, 0.f, 1.f);
-				ImGui::ColorEdit3("Ambient light color", &ambientColor.x, ImGuiColorEditFlags_Float);
-				ImGui::SliderFloat("Diffuse intensity", &diffuseK, 0.f, 1.f);
-				ImGui::SliderFloat("Specular intenisty", &specularK, 0.f, 1.f);
-				ImGui::DragFloat("Shininess", &shininess, 0.05f, 0.f);
+				ImGui::SliderFloat("Ambient light intensity", &material.ambientK, 0.f, 1.f);
+				ImGui::ColorEdit3("Ambient light color", &material.ambientColor.x, ImGuiColorEditFlags_Float);
+				ImGui::SliderFloat("Diffuse intensity", &material.diffuseK, 0.f, 1.f);
+				ImGui::SliderFloat("Specular intenisty", &material.specularK, 0.f, 1.f);
+				ImGui::DragFloat("Shininess", &material.shininess, 0.05f, 0.f);
 			}
 			if (ImGui::CollapsingHeader("Lights"))
 			{
@@ -271,6 +604,7 @@ int main() {
 				ImGui::SliderInt("Active lights", &activeLights, 1, MAX_LIGHTS);
 
 				ImGui::Checkbox("Animate lights", &animateLights);
+				ImGui::Checkbox("Sphere impostors", &lightImpostors);
 				ImGui::DragFloat("Light orbit radius", &lightOrbitRadius, 0.05f, 0.05f);
 				ImGui::DragFloat("Light orbit speed", &lightOrbitSpeed, 0.05f, 0.05f);
 				ImGui::DragFloat("Light height", &lightHeight, 0.05f);
@@ -288,48 +622,103 @@ int main() {
 				
 				ImGui::Unindent();
 			}
-			if (ImGui::CollapsingHeader("Parallax mapping"))
+			if (ImGui::CollapsingHeader("Renderer"))
 			{
-				const char* parallaxMethodItems[] = { "Off", "Simple", "Steep", "Occlusion" };
-				ImGui::Combo("Method", &parallaxMethod, parallaxMethodItems, 4);
-				ImGui::Checkbox("Discard out of bound frags", &discardOutOfBoundFrags);
-				ImGui::DragFloat("Height scale", &heightScale, 0.01f, 0.f);
-				ImGui::DragInt("Min layers", &minLayers, 1.f, 1, 9999);
-				ImGui::DragInt("Max layers", &maxLayers, 1.f, 2, 9999);
-				const char* textureItems[] = { "Rock", "Bamboo" };
-				ImGui::Combo("Texture", &textureUsed, textureItems, 2);
-				if (prevTextureUsed != textureUsed)
+				ImGui::Checkbox("Depth pre-pass", &useDepthPrePass);
+				if (useDepthPrePass && !depthPrePassActive)
 				{
-					if (textureUsed == 0)
-					{
-						colorTexture = Util::loadTexture("assets/rock_color.jpg", GL_REPEAT, GL_LINEAR);
-						heightTexture = Util::loadTexture("assets/rock_height.jpg", GL_REPEAT, GL_LINEAR);
-					}
-					else
-					{
-						colorTexture = Util::loadTexture("assets/bamboo_color.jpg", GL_REPEAT, GL_LINEAR);
-						heightTexture = Util::loadTexture("assets/bamboo_height.jpg", GL_REPEAT, GL_LINEAR);
-					}
+					ImGui::TextDisabled("Pre-pass disabled while out of bound frags are discarded");
+				}
+				ImGui::Checkbox("Sort front to back", &rendererSettings.sortFrontToBack);
+				ImGui::Checkbox("Count overdraw", &rendererSettings.countOverdraw);
+				ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+				if (occlusionCulling)
+				{
+					const Util::OcclusionStats& occlusionStats = occlusionCuller.getStats();
+					ImGui::Text("Occluded: %d of %d draws, %.3f ms", occlusionStats.occluded, occlusionStats.tested,
+						occlusionStats.setupMs + occlusionStats.rasterMs + occlusionStats.testMs);
+				}
+				ImGui::Checkbox("Occlusion queries", &rendererSettings.occlusionQueries);
+				if (rendererSettings.occlusionQueries)
+				{
+					ImGui::Text("Queries: %d, %d trusted visible, %d pending", occlusionQueryStats.queries, occlusionQueryStats.unqueried, occlusionQueryStats.pending);
+					ImGui::Text("Skipped: %d, conditional: %d", occlusionQueryStats.skipped, occlusionQueryStats.conditional);
+				}
 
-					prevTextureUsed = textureUsed;
+				ImGui::Text("Draw calls: %d (+%d pre-pass)", stats.drawCalls, stats.prePassDrawCalls);
+				ImGui::Text("Shaded samples: %llu", (unsigned long long)stats.shadedSamples);
+				ImGui::Text("Pre-pass samples: %llu", (unsigned long long)stats.prePassSamples);
+				ImGui::Text("Overdraw: %.2fx", stats.overdraw);
+
+				const char* bindNames[] = { "Program", "VAO", "Texture", "Buffer", "Vertex buffer" };
+				ImGui::Text("Binds: %d issued, %d skipped", lastFrameBinds.getIssued(), lastFrameBinds.getSkipped());
+				for (int i = 0; i < int(Util::BindType::COUNT); i++)
+				{
+					ImGui::BulletText("%s: %d issued, %d skipped", bindNames[i], lastFrameBinds.issued[i], lastFrameBinds.skipped[i]);
 				}
 			}
+			if (ImGui::CollapsingHeader("Threading"))
+			{
+				//0 waits for the previous frame to be presented before sampling input
+				if (ImGui::SliderInt("Pipeline depth", &pipelineDepth, 0, FRAME_PIPELINE_MAX_DEPTH)) pipeline.setDepth(pipelineDepth);
+
+				Util::FramePipelineStats pipelineStats = pipeline.getStats();
+				ImGui::Text("Input to present: %.2f ms (max %.2f ms)", pipelineStats.latencyMs, pipelineStats.maxLatencyMs);
+				ImGui::Text("Render thread: %.2f ms per frame", pipelineStats.renderMs);
+				ImGui::Text("Main thread waiting: %.2f ms", pipelineStats.producerWaitMs);
+				ImGui::Text("Render thread waiting: %.2f ms", pipelineStats.consumerWaitMs);
+
+				ImGui::Separator();
+				ImGui::Text("GPU frames in flight: %d", frameSyncStats.framesInFlight);
+				ImGui::Text("Waiting for GPU: %.2f ms (max %.2f ms, %.0f%% of frames)", frameSyncStats.stallMs, frameSyncStats.maxStallMs, frameSyncStats.stalledFrameRatio * 100.f);
+				ImGui::Text("Fences: %llu passed, %llu waited on", (unsigned long long)frameSyncStats.fenceHits, (unsigned long long)frameSyncStats.fenceWaits);
+				ImGui::Text("Transient data: %.1f KB (peak %.1f KB)", frameSyncStats.bytesUsed / 1024.f, frameSyncStats.peakBytesUsed / 1024.f);
+			}
+			if (ImGui::CollapsingHeader("GPU memory"))
+			{
+				for (int i = 0; i < int(Util::GpuResourceType::COUNT); i++)
+				{
+					ImGui::Text("%s: %d, %.2f MB (peak %.2f MB)", Util::getGpuResourceTypeName(Util::GpuResourceType(i)), gpuResourceStats.count[i],
+						gpuResourceStats.bytes[i] / (1024.f * 1024.f), gpuResourceStats.peakBytes[i] / (1024.f * 1024.f));
+				}
+				ImGui::Text("Total: %.2f MB", gpuResourceStats.getBytes() / (1024.f * 1024.f));
+				ImGui::Text("Waiting for deletion: %d, %.2f MB", gpuResourceStats.pendingCount, gpuResourceStats.pendingBytes / (1024.f * 1024.f));
+			}
+			if (ImGui::CollapsingHeader("Parallax mapping"))
+			{
+				const char* parallaxMethodItems[] = { "Off", "Simple", "Steep", "Occlusion" };
+				ImGui::Combo("Method", &material.parallaxMethod, parallaxMethodItems, 4);
+				ImGui::Checkbox("Discard out of bound frags", &material.discardOutOfBoundFrags);
+				ImGui::DragFloat("Height scale", &material.heightScale, 0.01f, 0.f);
+				ImGui::DragInt("Min layers", &material.minLayers, 1.f, 1, 9999);
+				ImGui::DragInt("Max layers", &material.maxLayers, 1.f, 2, 9999);
+				//The render thread reloads the textures when the packet's selection changes
+				const char* textureItems[] = { "Rock", "Bamboo" };
+				ImGui::Combo("Texture", &material.textureUsed, textureItems, 2);
+			}
 
 			ImGui::ColorEdit3("BG color", &bgColor.x);
+			ImGui::Checkbox("Show profiler", &showProfiler);
 			ImGui::End();
+
+			if (showProfiler) profiler.drawImGui();
 			
 			ImGui::Render();
-			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			packet.ui.capture(ImGui::GetDrawData());
 		}
 
-		glfwSwapBuffers(window);
+		pipeline.endWrite(inputNs);
+		profiler.endFrame();
 	}
+
+	//Draws the packets still in flight before the GL objects go away
+	renderThread.stop();
 	printf("Shutting down...");
 }
 
+//Runs on the main thread inside glfwPollEvents(), the render thread sets the viewport from the packet
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
 	SCREEN_WIDTH = width;
 	SCREEN_HEIGHT = height;
 }
@@ -0,0 +1,38 @@
+/*
+* Created by Adam Gyenes
+* Installs the heap allocation hooks for the whole benchmark executable
+*/
+
+#define UTIL_ALLOCATION_TRACKER_HOOKS
+#include <util/AllocationTracker.h>
+
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <string>
+
+void Bench::addAllocationMetrics(const std::vector<uint64_t>& frameAllocations, const std::vector<uint64_t>& frameBytes,
+	const BenchmarkConfig& config, BenchmarkResult& result, Report& report)
+{
+	uint64_t maxAllocations = 0;
+	uint64_t totalAllocations = 0;
+	uint64_t maxBytes = 0;
+	int allocatingFrames = 0;
+	for (size_t i = 0; i < frameAllocations.size(); i++)
+	{
+		maxAllocations = std::max(maxAllocations, frameAllocations[i]);
+		totalAllocations += frameAllocations[i];
+		maxBytes = std::max(maxBytes, frameBytes[i]);
+		if (frameAllocations[i] > 0) allocatingFrames++;
+	}
+
+	result.addMetric("allocations_per_frame_max", double(maxAllocations));
+	result.addMetric("allocations_per_frame_mean", frameAllocations.empty() ? 0.0 : double(totalAllocations) / frameAllocations.size());
+	result.addMetric("allocated_bytes_per_frame_max", double(maxBytes));
+
+	if (allocatingFrames > 0 && !config.allowAllocations)
+	{
+		report.addFailure(result.name + ": " + std::to_string(allocatingFrames) + " of " + std::to_string(frameAllocations.size())
+			+ " measured frames allocated (up to " + std::to_string(maxAllocations) + " allocations)");
+	}
+}
@@ -0,0 +1,98 @@
+/*
+* Created by Adam Gyenes
+* Benchmark suites runnable by the benchmark executable
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "OffscreenContext.h"
+#include "Report.h"
+
+namespace Bench
+{
+	struct BenchmarkConfig
+	{
+		int width = 1280;
+		int height = 720;
+		int frames = 300;
+		//Frames rendered before measuring, lets drivers settle and query rings fill up
+		int warmupFrames = 30;
+		int objects = 64;
+
+		//Software rasterizer suite: frames per run (CPU frames are much slower).
+		//Highest thread count for the software and job suites, 0 = all cores
+		int softwareFrames = 20;
+		int maxThreads = 0;
+		//When set, suites that can write reference images put them here
+		const char* imageDirectory = nullptr;
+
+		//Pipeline suite: main thread busy time per frame, standing in for game logic
+		double simulationMs = 4.0;
+
+		//Measured frames must not touch the heap, suites that check it fail the run otherwise
+		bool allowAllocations = false;
+	};
+
+	struct Suite
+	{
+		const char* name;
+		const char* description;
+		//Suites that need a GL context get it created before they run, others get nullptr
+		bool needsGL;
+		void (*run)(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	};
+
+	//Adds allocations_per_frame_max/_mean and allocated_bytes_per_frame_max for the measured frames, and a report
+	//failure if any of them allocated (unless config.allowAllocations)
+	void addAllocationMetrics(const std::vector<uint64_t>& frameAllocations, const std::vector<uint64_t>& frameBytes,
+		const BenchmarkConfig& config, BenchmarkResult& result, Report& report);
+
+	//Samples of the measured frames of runTimedFrames
+	struct TimedFrames
+	{
+		std::vector<double> cpuMs;
+		std::vector<double> gpuMs;
+		std::vector<uint64_t> allocations;
+		std::vector<uint64_t> bytes;
+	};
+
+	//Runs config.warmupFrames then config.frames frames of render(frame), each inside a GL_TIME_ELAPSED query, a
+	//profiler frame and a Util::AllocationScope, and waited on with glFinish. measured(frame) runs after each measured
+	//frame, outside all of that, for the suite's own per-frame stats
+	TimedFrames runTimedFrames(const BenchmarkConfig& config, const std::function<void(int frame)>& render,
+		const std::function<void(int frame)>& measured = nullptr);
+
+	struct FrameDifference
+	{
+		//Over the color channels, alpha is left out
+		double meanAbs = 0.0;
+		//Pixels whose color channels differ by more than FRAME_DIFFERENCE_THRESHOLD in total
+		double differentFraction = 0.0;
+	};
+
+	constexpr int FRAME_DIFFERENCE_THRESHOLD = 24;
+
+	//The whole color buffer as RGBA8
+	void readFrame(OffscreenContext* context, std::vector<unsigned char>& pixels);
+	//Frames from readFrame of the same size, all zero if they are empty
+	FrameDifference compareFrames(const std::vector<unsigned char>& frame, const std::vector<unsigned char>& reference);
+
+	void runSceneSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runSoftwareSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runPipelineSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runJobSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runStreamingSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runMeshGenSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runVertexPullSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runProceduralSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runSphereSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runWeldSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runMeshletSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runOcclusionSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runOcclusionQuerySuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+	void runImpostorSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report);
+}
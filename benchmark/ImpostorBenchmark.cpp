@@ -0,0 +1,212 @@
+/*
+* Created by Adam Gyenes
+* Thousands of light gizmo sized spheres: the final project's sphere mesh drawn once per sphere and instanced, against
+* Util::SphereImpostorRenderer, and the two mixed as a distance LOD
+*/
+
+#include "Benchmarks.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <ew/camera.h>
+#include <ew/procGen.h>
+#include <ew/shader.h>
+
+#include <util/FrameSync.h>
+#include <util/GLStateCache.h>
+#include <util/GpuResources.h>
+#include <util/Mesh.h>
+#include <util/SphereImpostors.h>
+
+//A 32x16x32 block of spheres
+constexpr int IMPOSTOR_BENCH_COLUMNS = 32;
+constexpr int IMPOSTOR_BENCH_LAYERS = 16;
+constexpr float IMPOSTOR_BENCH_SPACING = 1.5f;
+//The final project's light gizmo, ew::createSphere(0.3f, 12)
+constexpr float IMPOSTOR_BENCH_RADIUS = 0.3f;
+constexpr int IMPOSTOR_BENCH_SEGMENTS = 12;
+//Spheres covering more pixels than this keep the mesh in the LOD path
+constexpr float IMPOSTOR_BENCH_LOD_PIXELS = 16.f;
+
+enum class ImpostorPath
+{
+	MESH_DRAWS = 0,
+	MESH_INSTANCED,
+	IMPOSTORS,
+	LOD
+};
+
+static Bench::BenchmarkResult runImpostorPath(const char* name, ImpostorPath path, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report, std::vector<unsigned char>& lastFrame)
+{
+	std::vector<Util::SphereImpostor> spheres;
+	float extent = IMPOSTOR_BENCH_COLUMNS * IMPOSTOR_BENCH_SPACING * 0.5f;
+	for (int layer = 0; layer < IMPOSTOR_BENCH_LAYERS; layer++)
+	{
+		for (int row = 0; row < IMPOSTOR_BENCH_COLUMNS; row++)
+		{
+			for (int column = 0; column < IMPOSTOR_BENCH_COLUMNS; column++)
+			{
+				Util::SphereImpostor sphere;
+				sphere.center = ew::Vec3(column * IMPOSTOR_BENCH_SPACING - extent, layer * IMPOSTOR_BENCH_SPACING, row * IMPOSTOR_BENCH_SPACING - extent);
+				sphere.radius = IMPOSTOR_BENCH_RADIUS;
+				sphere.color = ew::Vec3(float(column) / IMPOSTOR_BENCH_COLUMNS, float(layer) / IMPOSTOR_BENCH_LAYERS, float(row) / IMPOSTOR_BENCH_COLUMNS);
+				sphere.padding = 0.f;
+				spheres.push_back(sphere);
+			}
+		}
+	}
+	int sphereCount = int(spheres.size());
+
+	//Unit sphere, sphereInstanced.vert scales it by each instance's radius
+	Util::Mesh sphereMesh(ew::createSphere(1.f, IMPOSTOR_BENCH_SEGMENTS));
+	Util::SphereImpostorRenderer impostors(sphereCount);
+
+	//Same layout as the impostors' instances, so both shaders read the same buffer format
+	Util::GpuResource meshInstances = Util::GpuResource::create(Util::GpuResourceType::BUFFER, "Impostor benchmark mesh instances");
+	glNamedBufferStorage(meshInstances.get(), sizeof(Util::SphereImpostor) * sphereCount, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	meshInstances.setBytes(sizeof(Util::SphereImpostor) * sphereCount);
+	std::vector<Util::SphereImpostor> nearSpheres;
+	nearSpheres.reserve(sphereCount);
+
+	ew::Shader meshShader("assets/benchmark/sphereInstanced.vert", "assets/benchmark/sphereMesh.frag");
+	ew::Shader impostorShader("assets/benchmark/sphereImpostor.vert", "assets/benchmark/sphereImpostor.frag");
+	GLint firstInstanceLocation = glGetUniformLocation(meshShader.getId(), "_FirstInstance");
+	Util::GLStateCache stateCache;
+	//The impostors' instances go through a ring like the final project's, so no frame waits on the last one's draw
+	Util::FrameSync frameSync;
+
+	int width = context->getWidth();
+	int height = context->getHeight();
+	ew::Vec3 lightDirection = ew::Normalize(ew::Vec3(-0.4f, -1.f, -0.3f));
+
+	std::vector<double> meshSpheres, vertices;
+	meshSpheres.reserve(config.frames);
+	vertices.reserve(config.frames);
+	int drawCalls = 0;
+	GLsizei frameVertices = 0;
+
+	auto render = [&](int frame)
+		{
+			//Orbit just outside the block, the nearest spheres are a few dozen pixels across and the far side a few
+			float time = frame / 60.f;
+			ew::Camera camera;
+			camera.position = ew::Vec3((extent + 6.f) * cosf(time * 0.5f), IMPOSTOR_BENCH_LAYERS * IMPOSTOR_BENCH_SPACING * 0.75f, (extent + 6.f) * sinf(time * 0.5f));
+			camera.target = ew::Vec3(0.f, IMPOSTOR_BENCH_LAYERS * IMPOSTOR_BENCH_SPACING * 0.25f, 0.f);
+			camera.nearPlane = 0.1f;
+			camera.aspectRatio = float(width) / height;
+			ew::Mat4 viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
+
+			frameSync.beginFrame();
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_BACK);
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			stateCache.resetStats();
+
+			//Both paths rebuild their instances every frame, like gizmos of moving lights
+			nearSpheres.clear();
+			impostors.clear();
+			for (const Util::SphereImpostor& sphere : spheres)
+			{
+				bool useMesh = path == ImpostorPath::MESH_DRAWS || path == ImpostorPath::MESH_INSTANCED;
+				if (path == ImpostorPath::LOD) useMesh = Util::SphereImpostorRenderer::getScreenRadius(camera, height, sphere.center, sphere.radius) > IMPOSTOR_BENCH_LOD_PIXELS;
+				if (useMesh) nearSpheres.push_back(sphere);
+				else impostors.add(sphere.center, sphere.radius, sphere.color);
+			}
+
+			drawCalls = 0;
+			frameVertices = 0;
+			if (!nearSpheres.empty())
+			{
+				glNamedBufferSubData(meshInstances.get(), 0, sizeof(Util::SphereImpostor) * nearSpheres.size(), nearSpheres.data());
+				stateCache.useProgram(meshShader.getId());
+				meshShader.setMat4("_ViewProjection", viewProjection);
+				meshShader.setInt("_Lit", 1);
+				meshShader.setVec3("_LightDirection", lightDirection);
+				stateCache.bindVertexBindings(sphereMesh.getVertexBindings());
+				stateCache.bindBufferRange(GL_SHADER_STORAGE_BUFFER, SPHERE_IMPOSTOR_STORAGE_BINDING, meshInstances.get());
+
+				GLsizei nearCount = GLsizei(nearSpheres.size());
+				if (path == ImpostorPath::MESH_DRAWS)
+				{
+					//What renderLight does per light: a uniform and a draw each
+					for (GLsizei i = 0; i < nearCount; i++)
+					{
+						glUniform1i(firstInstanceLocation, i);
+						glDrawElements(GL_TRIANGLES, sphereMesh.getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					}
+					drawCalls += nearCount;
+				}
+				else
+				{
+					glUniform1i(firstInstanceLocation, 0);
+					glDrawElementsInstanced(GL_TRIANGLES, sphereMesh.getIndexCount(), GL_UNSIGNED_INT, nullptr, nearCount);
+					drawCalls++;
+				}
+				frameVertices += sphereMesh.getIndexCount() * nearCount;
+			}
+
+			stateCache.useProgram(impostorShader.getId());
+			impostorShader.setMat4("_ViewProjection", viewProjection);
+			impostorShader.setInt("_Lit", 1);
+			impostorShader.setVec3("_LightDirection", lightDirection);
+			impostors.draw(stateCache, impostorShader.getId(), camera, &frameSync);
+			drawCalls += impostors.getStats().draws;
+			frameVertices += impostors.getStats().vertices;
+			frameSync.endFrame();
+		};
+	auto measured = [&](int)
+		{
+			meshSpheres.push_back(double(nearSpheres.size()));
+			vertices.push_back(frameVertices);
+		};
+	Bench::TimedFrames timed = Bench::runTimedFrames(config, render, measured);
+
+	Bench::readFrame(context, lastFrame);
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("impostors/") + name;
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", width);
+	result.addMetric("height", height);
+	result.addMetric("spheres", sphereCount);
+	result.addMetric("mesh_segments", IMPOSTOR_BENCH_SEGMENTS);
+	result.addSummary("frame_ms", Bench::summarize(timed.cpuMs));
+	result.addSummary("gpu_ms", Bench::summarize(timed.gpuMs));
+	result.addMetric("draw_calls", drawCalls);
+	//Indices for the mesh, each one is a vertex shader invocation without a post-transform cache
+	result.addSummary("vertices", Bench::summarize(vertices));
+	if (path == ImpostorPath::LOD) result.addSummary("mesh_spheres", Bench::summarize(meshSpheres));
+	Bench::addAllocationMetrics(timed.allocations, timed.bytes, config, result, report);
+	return result;
+}
+
+void Bench::runImpostorSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	if (!Util::SphereImpostorRenderer::isSupported())
+	{
+		report.addInfo("impostors", "skipped, sphere impostors need GL 4.5");
+		return;
+	}
+
+	std::vector<unsigned char> meshFrame;
+	std::vector<unsigned char> frame;
+	report.addResult(runImpostorPath("mesh_draws", ImpostorPath::MESH_DRAWS, config, context, report, frame));
+	report.addResult(runImpostorPath("mesh_instanced", ImpostorPath::MESH_INSTANCED, config, context, report, meshFrame));
+
+	const struct { const char* name; ImpostorPath path; } paths[] = { { "impostors", ImpostorPath::IMPOSTORS }, { "lod", ImpostorPath::LOD } };
+	for (const auto& path : paths)
+	{
+		BenchmarkResult result = runImpostorPath(path.name, path.path, config, context, report, frame);
+
+		//Only silhouettes and shading differ: the mesh is a 12 segment polygon with interpolated normals, the impostor
+		//a perfect sphere
+		FrameDifference difference = compareFrames(frame, meshFrame);
+		result.addMetric("mean_abs_pixel_difference", difference.meanAbs);
+		result.addMetric("different_pixel_fraction", difference.differentFraction);
+		report.addResult(result);
+	}
+}
@@ -0,0 +1,193 @@
+/*
+* Created by Adam Gyenes
+* Scaling of Util::JobSystem from 1 to N threads on typical core workloads
+*/
+
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ew/camera.h>
+#include <ew/procGen.h>
+#include <ew/transform.h>
+
+#include <util/JobSystem.h>
+#include <util/Mesh.h>
+#include <util/ProcGen.h>
+
+//Timed repetitions per workload and thread count, after one untimed run
+constexpr int JOB_BENCH_RUNS = 10;
+constexpr int JOB_BENCH_MESHES = 32;
+constexpr int JOB_BENCH_INSTANCES = 200000;
+constexpr int JOB_BENCH_EMPTY_JOBS = 100000;
+
+struct BoundingSphere
+{
+	ew::Vec3 center;
+	float radius;
+};
+
+struct Workload
+{
+	const char* name;
+	//Items processed per run, reported as throughput
+	int items;
+	std::function<void(Util::JobSystem&)> run;
+};
+
+//Every mesh generated and given tangents in its own job, the tangent job depends on the generation job
+static void generateMeshes(Util::JobSystem& jobs, std::vector<ew::MeshData>& meshes, std::vector<Util::Mesh::TBArray>& tangents)
+{
+	std::unique_ptr<Util::JobCounter[]> generated(new Util::JobCounter[JOB_BENCH_MESHES]);
+	Util::JobCounter done;
+
+	for (int i = 0; i < JOB_BENCH_MESHES; i++)
+	{
+		ew::MeshData* mesh = &meshes[i];
+		Util::Mesh::TBArray* meshTangents = &tangents[i];
+
+		jobs.run([mesh, i]()
+			{
+				switch (i % 4)
+				{
+				case 0: *mesh = ew::createSphere(0.5f, 96); break;
+				case 1: *mesh = Util::createTorus(0.25f, 0.5f, 96, 48); break;
+				case 2: *mesh = ew::createCylinder(0.5f, 1.f, 128); break;
+				default: *mesh = ew::createPlane(1.f, 1.f, 96); break;
+				}
+			}, &generated[i]);
+		jobs.run([mesh, meshTangents]() { *meshTangents = Util::Mesh::calculateTB(*mesh); }, &done, &generated[i]);
+	}
+
+	jobs.wait(done);
+}
+
+static void updateTransforms(Util::JobSystem& jobs, const std::vector<ew::Transform>& transforms, std::vector<ew::Mat4>& models)
+{
+	jobs.parallelFor(int(transforms.size()), [&](int begin, int end, int)
+		{
+			for (int i = begin; i < end; i++) models[i] = transforms[i].getModelMatrix();
+		});
+}
+
+//Gribb/Hartmann planes from the view projection rows, spheres outside any plane are culled
+static void cullSpheres(Util::JobSystem& jobs, const ew::Mat4& viewProjection, const std::vector<BoundingSphere>& spheres, std::vector<unsigned char>& visible)
+{
+	ew::Vec4 rows[4];
+	for (int r = 0; r < 4; r++) rows[r] = ew::Vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+
+	ew::Vec4 planes[6];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		planes[axis * 2] = rows[3] + rows[axis];
+		planes[axis * 2 + 1] = rows[3] - rows[axis];
+	}
+	for (ew::Vec4& plane : planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane = ew::Vec4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+
+	jobs.parallelFor(int(spheres.size()), [&](int begin, int end, int)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				const BoundingSphere& sphere = spheres[i];
+				bool inside = true;
+				for (const ew::Vec4& plane : planes)
+				{
+					inside &= plane.x * sphere.center.x + plane.y * sphere.center.y + plane.z * sphere.center.z + plane.w >= -sphere.radius;
+				}
+				visible[i] = inside;
+			}
+		});
+}
+
+static void runEmptyJobs(Util::JobSystem& jobs)
+{
+	Util::JobCounter counter;
+	for (int i = 0; i < JOB_BENCH_EMPTY_JOBS; i++)
+	{
+		jobs.run([]() {}, &counter);
+	}
+	jobs.wait(counter);
+}
+
+void Bench::runJobSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	int maxThreads = config.maxThreads > 0 ? config.maxThreads : int(std::thread::hardware_concurrency());
+	if (maxThreads < 1) maxThreads = 1;
+
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	std::vector<ew::MeshData> meshes(JOB_BENCH_MESHES);
+	std::vector<Util::Mesh::TBArray> tangents(JOB_BENCH_MESHES);
+
+	//Deterministic scatter of instances around the origin
+	std::vector<ew::Transform> transforms(JOB_BENCH_INSTANCES);
+	std::vector<ew::Mat4> models(JOB_BENCH_INSTANCES);
+	std::vector<BoundingSphere> spheres(JOB_BENCH_INSTANCES);
+	std::vector<unsigned char> visible(JOB_BENCH_INSTANCES);
+	unsigned int seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / float(1 << 24); };
+	for (int i = 0; i < JOB_BENCH_INSTANCES; i++)
+	{
+		transforms[i].position = ew::Vec3(random() * 200.f - 100.f, random() * 20.f - 10.f, random() * 200.f - 100.f);
+		transforms[i].rotation = ew::Vec3(random() * 360.f, random() * 360.f, random() * 360.f);
+		transforms[i].scale = ew::Vec3(0.5f + random());
+		spheres[i] = BoundingSphere{ transforms[i].position, transforms[i].scale.x };
+	}
+
+	ew::Camera camera;
+	camera.position = ew::Vec3(0.f, 5.f, 40.f);
+	camera.farPlane = 150.f;
+	ew::Mat4 viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
+
+	const Workload workloads[] = {
+		{ "mesh_generation", JOB_BENCH_MESHES, [&](Util::JobSystem& jobs) { generateMeshes(jobs, meshes, tangents); } },
+		{ "transforms", JOB_BENCH_INSTANCES, [&](Util::JobSystem& jobs) { updateTransforms(jobs, transforms, models); } },
+		{ "culling", JOB_BENCH_INSTANCES, [&](Util::JobSystem& jobs) { cullSpheres(jobs, viewProjection, spheres, visible); } },
+		{ "empty_jobs", JOB_BENCH_EMPTY_JOBS, [](Util::JobSystem& jobs) { runEmptyJobs(jobs); } },
+	};
+
+	for (const Workload& workload : workloads)
+	{
+		double singleThreadMs = 0.0;
+		for (int threads : threadCounts)
+		{
+			Util::JobSystem jobs(threads);
+
+			std::vector<double> runMs;
+			for (int run = 0; run <= JOB_BENCH_RUNS; run++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				workload.run(jobs);
+				auto end = std::chrono::steady_clock::now();
+
+				if (run > 0) runMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+			}
+
+			FrameTimeSummary summary = summarize(runMs);
+			if (threads == 1) singleThreadMs = summary.mean;
+
+			BenchmarkResult result;
+			result.name = std::string("jobs/") + workload.name + "/t" + std::to_string(threads);
+			result.addMetric("runs", JOB_BENCH_RUNS);
+			result.addMetric("threads", threads);
+			result.addMetric("items", workload.items);
+			result.addSummary("run_ms", summary);
+			result.addMetric("items_per_ms", workload.items / summary.mean);
+			result.addMetric("speedup", singleThreadMs / summary.mean);
+			result.addMetric("efficiency", singleThreadMs / summary.mean / threads);
+			report.addResult(result);
+		}
+	}
+}
@@ -0,0 +1,153 @@
+/*
+* Created by Adam Gyenes
+* Bulk procedural generation (mesh + tangents) against the default heap and std::pmr scratch resources
+*/
+
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include <ew/procGen.h>
+
+#include <util/AllocationTracker.h>
+#include <util/FrameArena.h>
+#include <util/Mesh.h>
+#include <util/ProcGen.h>
+
+//Timed batches per resource, after one untimed batch that sizes the scratch memory
+constexpr int MESHGEN_BATCHES = 20;
+//Meshes per batch, small and medium sizes like an editor regenerating a scene's primitives
+constexpr int MESHGEN_MESHES = 512;
+//Initial buffer of the monotonic resource and first block of the arena, a batch peaks at about 36MB
+constexpr size_t MESHGEN_SCRATCH_BYTES = 64 << 20;
+
+enum class MeshGenResource
+{
+	//std::pmr::get_default_resource(), every array is its own new/delete
+	DEFAULT,
+	//std::pmr::monotonic_buffer_resource over a preallocated buffer, released after each batch
+	MONOTONIC,
+	//std::pmr::unsynchronized_pool_resource that keeps freed chunks for the next batch
+	POOL,
+	//Util::ArenaResource over a FrameArena, reset after each batch
+	ARENA
+};
+
+//Meshes only live until the end of the batch, so everything they own goes back to the resource at once
+static void generateBatch(std::pmr::memory_resource* resource, size_t& vertexCount)
+{
+	std::pmr::vector<ew::MeshData> meshes(resource);
+	std::pmr::vector<Util::Mesh::TBArray> tangents(resource);
+	meshes.reserve(MESHGEN_MESHES);
+	tangents.reserve(MESHGEN_MESHES);
+
+	for (int i = 0; i < MESHGEN_MESHES; i++)
+	{
+		int detail = 8 + (i % 8) * 8;
+		switch (i % 6)
+		{
+		case 0: meshes.push_back(ew::createSphere(0.5f, detail, resource)); break;
+		case 1: meshes.push_back(ew::createCylinder(0.5f, 1.f, detail, resource)); break;
+		case 2: meshes.push_back(ew::createPlane(1.f, 1.f, detail, resource)); break;
+		case 3: meshes.push_back(Util::createTorus(0.25f, 0.5f, detail, detail / 2, resource)); break;
+		case 4: meshes.push_back(Util::createSphere(0.5f, detail, resource)); break;
+		default: meshes.push_back(ew::createCube(1.f, resource)); break;
+		}
+		tangents.push_back(Util::Mesh::calculateTB(meshes.back(), resource, resource));
+		vertexCount += meshes.back().vertices.size();
+	}
+}
+
+static Bench::BenchmarkResult runMeshGen(const char* name, MeshGenResource mode)
+{
+	std::unique_ptr<unsigned char[]> monotonicBuffer;
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> monotonic;
+	std::unique_ptr<std::pmr::unsynchronized_pool_resource> pool;
+	std::unique_ptr<Util::FrameArena> arena;
+	std::unique_ptr<Util::ArenaResource> arenaResource;
+
+	std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+	switch (mode)
+	{
+	case MeshGenResource::MONOTONIC:
+		monotonicBuffer.reset(new unsigned char[MESHGEN_SCRATCH_BYTES]);
+		monotonic.reset(new std::pmr::monotonic_buffer_resource(monotonicBuffer.get(), MESHGEN_SCRATCH_BYTES));
+		resource = monotonic.get();
+		break;
+	case MeshGenResource::POOL:
+		pool.reset(new std::pmr::unsynchronized_pool_resource());
+		resource = pool.get();
+		break;
+	case MeshGenResource::ARENA:
+		arena.reset(new Util::FrameArena(MESHGEN_SCRATCH_BYTES));
+		arenaResource.reset(new Util::ArenaResource(*arena));
+		resource = arenaResource.get();
+		break;
+	default:
+		break;
+	}
+
+	std::vector<double> batchMs;
+	std::vector<uint64_t> batchAllocations;
+	std::vector<uint64_t> batchBytes;
+	batchMs.reserve(MESHGEN_BATCHES);
+	batchAllocations.reserve(MESHGEN_BATCHES);
+	batchBytes.reserve(MESHGEN_BATCHES);
+	size_t vertexCount = 0;
+
+	for (int batch = 0; batch <= MESHGEN_BATCHES; batch++)
+	{
+		vertexCount = 0;
+		Util::AllocationScope allocations;
+		auto start = std::chrono::steady_clock::now();
+
+		generateBatch(resource, vertexCount);
+		//Releasing is part of the cost, it's the one-shot free the scratch resources are for
+		if (monotonic) monotonic->release();
+		if (arena) arena->reset();
+
+		auto end = std::chrono::steady_clock::now();
+		Util::AllocationCounts counts = allocations.getCounts();
+
+		if (batch == 0) continue;
+		batchMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		batchAllocations.push_back(counts.allocations);
+		batchBytes.push_back(counts.bytes);
+	}
+
+	Bench::FrameTimeSummary summary = Bench::summarize(batchMs);
+
+	uint64_t maxAllocations = 0;
+	uint64_t maxBytes = 0;
+	for (int i = 0; i < MESHGEN_BATCHES; i++)
+	{
+		maxAllocations = std::max(maxAllocations, batchAllocations[i]);
+		maxBytes = std::max(maxBytes, batchBytes[i]);
+	}
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("meshgen/") + name;
+	result.addMetric("batches", MESHGEN_BATCHES);
+	result.addMetric("meshes_per_batch", MESHGEN_MESHES);
+	result.addMetric("vertices_per_batch", double(vertexCount));
+	result.addSummary("batch_ms", summary);
+	result.addMetric("meshes_per_ms", MESHGEN_MESHES / summary.mean);
+	//Heap traffic a batch still causes, the resource's own buffers are allocated before the first batch
+	result.addMetric("heap_allocations_per_batch_max", double(maxAllocations));
+	result.addMetric("heap_bytes_per_batch_max", double(maxBytes));
+	if (arena) result.addMetric("arena_peak_bytes", double(arena->getStats().peak));
+	return result;
+}
+
+void Bench::runMeshGenSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	report.addResult(runMeshGen("default", MeshGenResource::DEFAULT));
+	report.addResult(runMeshGen("monotonic", MeshGenResource::MONOTONIC));
+	report.addResult(runMeshGen("pool", MeshGenResource::POOL));
+	report.addResult(runMeshGen("arena", MeshGenResource::ARENA));
+}
@@ -0,0 +1,172 @@
+/*
+* Created by Adam Gyenes
+* Whole meshes against meshlets culled per frame by Util::MeshletCuller and drawn as multi-draw ranges, same dense
+* scene and shading
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ew/shader.h>
+
+#include <util/GLStateCache.h>
+#include <util/Mesh.h>
+#include <util/Meshlets.h>
+
+//Finely tessellated so every object has hundreds of meshlets to cull
+constexpr int MESHLET_BENCH_SEGMENTS = 128;
+
+static Bench::BenchmarkResult runMeshletPath(const char* name, bool culled, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report, std::vector<unsigned char>& lastFrame)
+{
+	Bench::SceneParams params;
+	params.objects = config.objects;
+	params.segments = MESHLET_BENCH_SEGMENTS;
+	Bench::SceneLayout layout(params);
+	std::vector<ew::MeshData> meshData = layout.createMeshes();
+
+	//Both paths draw the reordered indices, so the frames only differ in what culling skips
+	std::vector<Util::Mesh> meshes;
+	std::vector<Util::MeshletCuller> cullers;
+	meshes.reserve(meshData.size());
+	cullers.reserve(meshData.size());
+	size_t maxMeshlets = 0;
+	size_t meshletCount = 0;
+	for (ew::MeshData& mesh : meshData)
+	{
+		std::vector<Util::Meshlet> meshlets = Util::buildMeshlets(mesh);
+		meshes.emplace_back(mesh);
+		cullers.emplace_back(meshlets);
+		if (meshlets.size() > maxMeshlets) maxMeshlets = meshlets.size();
+		meshletCount += meshlets.size();
+	}
+
+	Util::MeshletDrawRanges ranges;
+	ranges.reserve(maxMeshlets);
+
+	ew::Shader shader("assets/benchmark/defaultLit.vert", "assets/benchmark/surface.frag");
+	GLint modelLocation = glGetUniformLocation(shader.getId(), "_Model");
+	Util::GLStateCache stateCache;
+
+	int width = context->getWidth();
+	int height = context->getHeight();
+
+	std::vector<double> cullMs;
+	std::vector<double> trianglesCulled;
+	cullMs.reserve(config.frames);
+	trianglesCulled.reserve(config.frames);
+	Util::MeshletCullStats totals;
+	double frameCullMs = 0.0;
+	double trianglesPerFrame = 0.0;
+
+	auto render = [&](int frame)
+		{
+			layout.animate(frame);
+			ew::Camera camera = layout.getCamera();
+			camera.aspectRatio = float(width) / height;
+			ew::Mat4 viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
+
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_BACK);
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			stateCache.resetStats();
+			stateCache.useProgram(shader.getId());
+			shader.setMat4("_ViewProjection", viewProjection);
+
+			for (Util::MeshletCuller& culler : cullers) culler.resetStats();
+			frameCullMs = 0.0;
+			trianglesPerFrame = 0.0;
+			for (const Bench::SceneLayout::Object& object : layout.getObjects())
+			{
+				ew::Mat4 model = object.transform.getModelMatrix();
+				const Util::Mesh& mesh = meshes[object.mesh];
+				trianglesPerFrame += mesh.getIndexCount() / 3;
+
+				if (culled)
+				{
+					auto cullStart = std::chrono::steady_clock::now();
+					ranges.clear();
+					cullers[object.mesh].cull(viewProjection, model, camera.position, ranges);
+					frameCullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+					if (ranges.size() == 0) continue;
+
+					glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
+					stateCache.bindVertexBindings(mesh.getVertexBindings());
+					glMultiDrawElements(GL_TRIANGLES, ranges.counts.data(), GL_UNSIGNED_INT, ranges.offsets.data(), ranges.size());
+				}
+				else
+				{
+					glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
+					stateCache.bindVertexBindings(mesh.getVertexBindings());
+					glDrawElements(GL_TRIANGLES, mesh.getIndexCount(), GL_UNSIGNED_INT, nullptr);
+				}
+			}
+		};
+	auto measured = [&](int)
+		{
+			cullMs.push_back(frameCullMs);
+
+			int frameTrianglesCulled = 0;
+			for (const Util::MeshletCuller& culler : cullers)
+			{
+				const Util::MeshletCullStats& stats = culler.getStats();
+				frameTrianglesCulled += stats.trianglesCulled;
+				totals.meshlets += stats.meshlets;
+				totals.frustumCulled += stats.frustumCulled;
+				totals.coneCulled += stats.coneCulled;
+				totals.trianglesSubmitted += stats.trianglesSubmitted;
+				totals.trianglesCulled += stats.trianglesCulled;
+				totals.ranges += stats.ranges;
+			}
+			trianglesCulled.push_back(frameTrianglesCulled);
+		};
+	Bench::TimedFrames timed = Bench::runTimedFrames(config, render, measured);
+
+	Bench::readFrame(context, lastFrame);
+
+	int frames = config.frames > 0 ? config.frames : 1;
+	Bench::BenchmarkResult result;
+	result.name = std::string("meshlets/") + name;
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", width);
+	result.addMetric("height", height);
+	result.addMetric("objects", params.objects);
+	result.addMetric("segments", params.segments);
+	result.addMetric("meshlets_per_mesh", double(meshletCount) / meshes.size());
+	result.addSummary("frame_ms", Bench::summarize(timed.cpuMs));
+	result.addSummary("gpu_ms", Bench::summarize(timed.gpuMs));
+	result.addMetric("triangles_per_frame", trianglesPerFrame);
+	if (culled)
+	{
+		//Culled frames have exactly the meshlets' triangles the GPU would otherwise have to transform and reject
+		Bench::FrameTimeSummary culledSummary = Bench::summarize(trianglesCulled);
+		result.addSummary("cull_ms", Bench::summarize(cullMs));
+		result.addSummary("triangles_culled", culledSummary);
+		result.addMetric("triangles_submitted_per_frame", double(totals.trianglesSubmitted) / frames);
+		result.addMetric("triangles_culled_fraction", trianglesPerFrame > 0.0 ? culledSummary.mean / trianglesPerFrame : 0.0);
+		result.addMetric("meshlets_per_frame", double(totals.meshlets) / frames);
+		result.addMetric("frustum_culled_per_frame", double(totals.frustumCulled) / frames);
+		result.addMetric("cone_culled_per_frame", double(totals.coneCulled) / frames);
+		result.addMetric("ranges_per_frame", double(totals.ranges) / frames);
+	}
+	Bench::addAllocationMetrics(timed.allocations, timed.bytes, config, result, report);
+	return result;
+}
+
+void Bench::runMeshletSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	std::vector<unsigned char> wholeFrame;
+	std::vector<unsigned char> culledFrame;
+	report.addResult(runMeshletPath("whole", false, config, context, report, wholeFrame));
+	BenchmarkResult culled = runMeshletPath("culled", true, config, context, report, culledFrame);
+
+	//Culling is conservative, it only skips triangles the rasterizer would have clipped or back face culled anyway
+	culled.addMetric("mean_abs_pixel_difference", compareFrames(culledFrame, wholeFrame).meanAbs);
+	report.addResult(culled);
+}
@@ -0,0 +1,290 @@
+/*
+* Created by Adam Gyenes
+* Util::OcclusionCuller: share of a dense grid hidden behind walls against the cost of building and testing the masked
+* depth buffer, at several buffer resolutions and thread counts. Checked against an exact per pixel depth buffer
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ew/procGen.h>
+
+#include <util/AllocationTracker.h>
+#include <util/JobSystem.h>
+#include <util/OcclusionCuller.h>
+#include <util/Profiler.h>
+
+//Objects in the grid, enough that testing them shows up next to the rasterization
+constexpr int OCCLUSION_BENCH_OBJECTS = 4096;
+//Distance between the walls across the grid, a dozen rows of objects
+constexpr float OCCLUSION_BENCH_WALL_SPACING = 18.f;
+
+struct OcclusionResolution
+{
+	int width;
+	int height;
+};
+
+static const OcclusionResolution OCCLUSION_RESOLUTIONS[] = { { 128, 64 }, { 256, 128 }, { 512, 256 } };
+
+struct OccluderInstance
+{
+	const Util::OccluderMesh* mesh;
+	const ew::MeshData* data;
+	ew::Mat4 model;
+};
+
+//Brute force reference: nearest depth of every pixel center, no masks or layers
+static void rasterizeReference(const std::vector<OccluderInstance>& occluders, const ew::Mat4& viewProjection, int width, int height, std::vector<float>& depth)
+{
+	depth.assign(size_t(width) * height, 1.f);
+	for (const OccluderInstance& occluder : occluders)
+	{
+		ew::Mat4 modelViewProjection = viewProjection * occluder.model;
+		const std::pmr::vector<unsigned int>& indices = occluder.data->indices;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			ew::Vec4 clip[3];
+			for (int i = 0; i < 3; i++) clip[i] = modelViewProjection * ew::Vec4(occluder.data->vertices[indices[t + i]].pos, 1.f);
+
+			//Near plane only, same as the culler
+			ew::Vec4 polygon[4];
+			int count = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				const ew::Vec4& a = clip[i];
+				const ew::Vec4& b = clip[(i + 1) % 3];
+				float da = a.z + a.w;
+				float db = b.z + b.w;
+				if (da >= 0.f) polygon[count++] = a;
+				if ((da >= 0.f) != (db >= 0.f))
+				{
+					//ew::Vec4's arithmetic leaves w alone
+					float s = da / (da - db);
+					polygon[count++] = ew::Vec4(a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s, a.z + (b.z - a.z) * s, a.w + (b.w - a.w) * s);
+				}
+			}
+
+			for (int i = 1; i + 1 < count; i++)
+			{
+				const ew::Vec4* v[3] = { &polygon[0], &polygon[i], &polygon[i + 1] };
+				double x[3];
+				double y[3];
+				double z[3];
+				for (int k = 0; k < 3; k++)
+				{
+					x[k] = (v[k]->x / v[k]->w * 0.5 + 0.5) * width;
+					y[k] = (v[k]->y / v[k]->w * 0.5 + 0.5) * height;
+					z[k] = v[k]->z / v[k]->w * 0.5 + 0.5;
+				}
+				double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+				if (area <= 0.0) continue;
+
+				//Clamped before the casts, nothing is clipped sideways
+				int minX = int(floor(std::max(std::min({ x[0], x[1], x[2] }), 0.0)));
+				int maxX = int(ceil(std::min(std::max({ x[0], x[1], x[2] }), double(width - 1))));
+				int minY = int(floor(std::max(std::min({ y[0], y[1], y[2] }), 0.0)));
+				int maxY = int(ceil(std::min(std::max({ y[0], y[1], y[2] }), double(height - 1))));
+				for (int py = minY; py <= maxY; py++)
+				{
+					for (int px = minX; px <= maxX; px++)
+					{
+						double cx = px + 0.5;
+						double cy = py + 0.5;
+						double w0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+						double w1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+						double w2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+						if (w0 < 0.0 || w1 < 0.0 || w2 < 0.0) continue;
+
+						float pixelDepth = float(std::min((z[0] * w0 + z[1] * w1 + z[2] * w2) / area, 1.0));
+						float& stored = depth[size_t(py) * width + px];
+						stored = std::min(stored, pixelDepth);
+					}
+				}
+			}
+		}
+	}
+}
+
+//Same box footprint as Util::OcclusionCuller::isVisible, tested against every pixel
+static bool isVisibleReference(const Util::OcclusionBounds& bounds, const ew::Mat4& viewProjection, int width, int height, const std::vector<float>& depth)
+{
+	ew::Mat4 modelViewProjection = viewProjection * bounds.model;
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minDepth = 1.f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		ew::Vec3 position((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y, (corner & 4) ? bounds.max.z : bounds.min.z);
+		ew::Vec4 clip = modelViewProjection * ew::Vec4(position, 1.f);
+		if (clip.z < -clip.w || clip.w <= 0.f) return true;
+		minX = std::min(minX, (clip.x / clip.w * 0.5f + 0.5f) * width);
+		maxX = std::max(maxX, (clip.x / clip.w * 0.5f + 0.5f) * width);
+		minY = std::min(minY, (clip.y / clip.w * 0.5f + 0.5f) * height);
+		maxY = std::max(maxY, (clip.y / clip.w * 0.5f + 0.5f) * height);
+		minDepth = std::min(minDepth, clip.z / clip.w * 0.5f + 0.5f);
+	}
+
+	int pixelMinX = int(floorf(std::max(minX, 0.f)));
+	int pixelMinY = int(floorf(std::max(minY, 0.f)));
+	int pixelMaxX = int(ceilf(std::min(maxX, float(width)))) - 1;
+	int pixelMaxY = int(ceilf(std::min(maxY, float(height)))) - 1;
+	if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY) return true;
+
+	for (int y = pixelMinY; y <= pixelMaxY; y++)
+	{
+		for (int x = pixelMinX; x <= pixelMaxX; x++)
+		{
+			if (depth[size_t(y) * width + x] >= minDepth) return true;
+		}
+	}
+	return false;
+}
+
+void Bench::runOcclusionSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	SceneParams params;
+	params.objects = OCCLUSION_BENCH_OBJECTS;
+	SceneLayout layout(params);
+	std::vector<ew::MeshData> meshes = layout.createMeshes();
+
+	std::vector<Util::OcclusionBounds> bounds;
+	std::vector<int> objectTriangles;
+	float extent = 0.f;
+	for (const SceneLayout::Object& object : layout.getObjects())
+	{
+		const ew::MeshData& mesh = meshes[object.mesh];
+		Util::OcclusionBounds box;
+		box.min = box.max = mesh.vertices[0].pos;
+		for (const ew::Vertex& vertex : mesh.vertices)
+		{
+			box.min = ew::Vec3(std::min(box.min.x, vertex.pos.x), std::min(box.min.y, vertex.pos.y), std::min(box.min.z, vertex.pos.z));
+			box.max = ew::Vec3(std::max(box.max.x, vertex.pos.x), std::max(box.max.y, vertex.pos.y), std::max(box.max.z, vertex.pos.z));
+		}
+		box.model = object.transform.getModelMatrix();
+		bounds.push_back(box);
+		objectTriangles.push_back(int(mesh.indices.size() / 3));
+		extent = std::max(extent, fabsf(object.transform.position.x));
+	}
+
+	//The final project's occluders: a ground plane under everything and cubes, here stretched into walls across the grid
+	ew::MeshData cubeData = ew::createCube(1.f);
+	ew::MeshData planeData = ew::createPlane(1.f, 1.f, 1);
+	Util::OccluderMesh cube(cubeData);
+	Util::OccluderMesh plane(planeData);
+
+	std::vector<OccluderInstance> occluders;
+	ew::Transform ground;
+	ground.position = ew::Vec3(0.f, -0.5f, 0.f);
+	ground.scale = ew::Vec3(extent * 2.f + 2.f, 1.f, extent * 2.f + 2.f);
+	occluders.push_back({ &plane, &planeData, ground.getModelMatrix() });
+	for (float z = -extent + OCCLUSION_BENCH_WALL_SPACING * 0.5f; z < extent; z += OCCLUSION_BENCH_WALL_SPACING)
+	{
+		ew::Transform wall;
+		wall.position = ew::Vec3(0.f, 0.5f, z);
+		wall.scale = ew::Vec3(extent * 2.f, 2.f, 0.2f);
+		occluders.push_back({ &cube, &cubeData, wall.getModelMatrix() });
+	}
+
+	int maxThreads = config.maxThreads > 0 ? config.maxThreads : int(std::thread::hardware_concurrency());
+	if (maxThreads < 1) maxThreads = 1;
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	for (const OcclusionResolution& resolution : OCCLUSION_RESOLUTIONS)
+	{
+		for (int threads : threadCounts)
+		{
+			Util::JobSystem jobs(threads);
+			Util::OcclusionCuller culler(resolution.width, resolution.height, jobs);
+
+			std::vector<unsigned char> visible;
+			std::vector<float> referenceDepth;
+			std::vector<double> setupMs, rasterMs, testMs, totalMs, occludedFraction, trianglesCulled;
+			std::vector<uint64_t> frameAllocations, frameBytes;
+			int referenceOccluded = 0;
+			int occluded = 0;
+			int falseCulls = 0;
+			Util::OcclusionStats stats;
+
+			for (int frame = 0; frame < config.warmupFrames + config.frames; frame++)
+			{
+				//Eye level orbit, the walls hide the rows behind them from most angles
+				float time = frame / 60.f;
+				ew::Camera camera;
+				camera.position = ew::Vec3((extent + 4.f) * cosf(time * 0.5f), 1.f, (extent + 4.f) * sinf(time * 0.5f));
+				camera.target = ew::Vec3(0.f, 0.5f, 0.f);
+				camera.nearPlane = 0.1f;
+				camera.aspectRatio = float(resolution.width) / resolution.height;
+				ew::Mat4 viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
+
+				Util::AllocationScope allocations;
+				Util::Profiler::get().beginFrame();
+				auto start = std::chrono::steady_clock::now();
+				culler.begin(viewProjection);
+				for (const OccluderInstance& occluder : occluders) culler.addOccluder(*occluder.mesh, occluder.model);
+				culler.flush();
+				culler.test(bounds, visible);
+				auto end = std::chrono::steady_clock::now();
+				Util::Profiler::get().endFrame();
+				Util::AllocationCounts frameCounts = allocations.getCounts();
+
+				if (frame < config.warmupFrames) continue;
+
+				stats = culler.getStats();
+				setupMs.push_back(stats.setupMs);
+				rasterMs.push_back(stats.rasterMs);
+				testMs.push_back(stats.testMs);
+				totalMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+				occludedFraction.push_back(double(stats.occluded) / stats.tested);
+				frameAllocations.push_back(frameCounts.allocations);
+				frameBytes.push_back(frameCounts.bytes);
+
+				double culledTriangles = 0.0;
+				for (size_t i = 0; i < visible.size(); i++) culledTriangles += visible[i] ? 0 : objectTriangles[i];
+				trianglesCulled.push_back(culledTriangles);
+
+				rasterizeReference(occluders, viewProjection, resolution.width, resolution.height, referenceDepth);
+				for (size_t i = 0; i < bounds.size(); i++)
+				{
+					bool referenceVisible = isVisibleReference(bounds[i], viewProjection, resolution.width, resolution.height, referenceDepth);
+					referenceOccluded += !referenceVisible;
+					occluded += !visible[i];
+					falseCulls += referenceVisible && !visible[i];
+				}
+			}
+
+			BenchmarkResult result;
+			result.name = "occlusion/" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height) + "/t" + std::to_string(threads);
+			result.addMetric("frames", config.frames);
+			result.addMetric("width", resolution.width);
+			result.addMetric("height", resolution.height);
+			result.addMetric("threads", threads);
+			result.addMetric("objects", int(bounds.size()));
+			result.addMetric("occluders", stats.occluders);
+			result.addMetric("occluder_triangles", stats.occluderTriangles);
+			result.addSummary("setup_ms", summarize(setupMs));
+			result.addSummary("raster_ms", summarize(rasterMs));
+			result.addSummary("test_ms", summarize(testMs));
+			result.addSummary("total_ms", summarize(totalMs));
+			result.addSummary("occluded_fraction", summarize(occludedFraction));
+			result.addSummary("triangles_culled", summarize(trianglesCulled));
+			//Of the boxes an exact depth buffer at the same resolution hides, how many the masked buffer finds
+			result.addMetric("reference_occluded_per_frame", double(referenceOccluded) / std::max(config.frames, 1));
+			result.addMetric("efficiency", referenceOccluded > 0 ? double(occluded) / referenceOccluded : 1.0);
+			result.addMetric("false_culls", falseCulls);
+			addAllocationMetrics(frameAllocations, frameBytes, config, result, report);
+			if (falseCulls > 0)
+			{
+				report.addFailure(result.name + ": " + std::to_string(falseCulls) + " boxes culled that the exact depth buffer shows");
+			}
+			report.addResult(result);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/*
+* Created by Adam Gyenes
+* Util::Renderer's occlusion queries on a parallax mapped grid behind walls: drawing everything against skipping what
+* last frame's queries hid, and against drawing it under conditional rendering
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+//A 32x32 grid, big enough that most of it sits behind a wall from eye level
+constexpr int QUERY_BENCH_OBJECTS = 1024;
+//Distance between the walls across the grid, four rows of objects
+constexpr float QUERY_BENCH_WALL_SPACING = 6.f;
+
+static Bench::BenchmarkResult runQueryPath(const char* name, bool queries, bool conditional, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report, std::vector<unsigned char>& lastFrame)
+{
+	Bench::SceneParams params;
+	params.objects = QUERY_BENCH_OBJECTS;
+	params.occlusionQueries = queries;
+	params.conditionalRender = conditional;
+	Bench::Scene scene(params);
+	Bench::SceneLayout layout(params);
+
+	float extent = 0.f;
+	for (const Bench::SceneLayout::Object& object : layout.getObjects()) extent = std::max(extent, fabsf(object.transform.position.x));
+	for (float z = -extent + QUERY_BENCH_WALL_SPACING * 0.5f; z < extent; z += QUERY_BENCH_WALL_SPACING)
+	{
+		ew::Transform wall;
+		wall.position = ew::Vec3(0.f, 0.5f, z);
+		wall.scale = ew::Vec3(extent * 2.f + 1.f, 2.f, 0.2f);
+		scene.addOccluder(wall.getModelMatrix());
+	}
+
+	int width = context->getWidth();
+	int height = context->getHeight();
+
+	std::vector<double> drawCalls, boxQueries, skipped, unqueried, conditionalDraws;
+	drawCalls.reserve(config.frames);
+	boxQueries.reserve(config.frames);
+	skipped.reserve(config.frames);
+	unqueried.reserve(config.frames);
+	conditionalDraws.reserve(config.frames);
+
+	auto render = [&](int frame)
+		{
+			//Eye level orbit, slow enough that objects cross the walls' edges a few at a time like in the final project
+			float time = frame / 60.f;
+			layout.animate(frame);
+			ew::Camera& camera = layout.getCamera();
+			camera.position = ew::Vec3((extent + 4.f) * cosf(time * 0.25f), 1.f, (extent + 4.f) * sinf(time * 0.25f));
+			camera.target = ew::Vec3(0.f, 0.5f, 0.f);
+			scene.render(layout, width, height);
+		};
+	auto measured = [&](int)
+		{
+			const Util::OcclusionQueryStats& stats = scene.getOcclusionStats();
+			drawCalls.push_back(scene.getStats().drawCalls);
+			boxQueries.push_back(stats.queries);
+			skipped.push_back(stats.skipped);
+			unqueried.push_back(stats.unqueried);
+			conditionalDraws.push_back(stats.conditional);
+		};
+	Bench::TimedFrames timed = Bench::runTimedFrames(config, render, measured);
+
+	Bench::readFrame(context, lastFrame);
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("queries/") + name;
+	result.addInfo("parallax_method", std::to_string(params.parallaxMethod));
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", width);
+	result.addMetric("height", height);
+	result.addMetric("objects", params.objects);
+	result.addSummary("frame_ms", Bench::summarize(timed.cpuMs));
+	result.addSummary("gpu_ms", Bench::summarize(timed.gpuMs));
+	result.addSummary("draw_calls", Bench::summarize(drawCalls));
+	if (queries)
+	{
+		result.addSummary("box_queries", Bench::summarize(boxQueries));
+		result.addSummary("skipped", Bench::summarize(skipped));
+		//Always visible objects coast between re-tests, the cost the adaptive interval saves
+		result.addSummary("unqueried", Bench::summarize(unqueried));
+		result.addSummary("conditional_draws", Bench::summarize(conditionalDraws));
+		result.addMetric("query_pool_size", scene.getOcclusionStats().poolSize);
+	}
+	Bench::addAllocationMetrics(timed.allocations, timed.bytes, config, result, report);
+	return result;
+}
+
+void Bench::runOcclusionQuerySuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	std::vector<unsigned char> directFrame;
+	std::vector<unsigned char> frame;
+	report.addResult(runQueryPath("direct", false, false, config, context, report, directFrame));
+
+	const struct { const char* name; bool conditional; } paths[] = { { "queried", false }, { "conditional", true } };
+	for (const auto& path : paths)
+	{
+		BenchmarkResult result = runQueryPath(path.name, true, path.conditional, config, context, report, frame);
+
+		//Skipped objects show up a frame after they come out from behind a wall, conditional ones don't
+		result.addMetric("mean_abs_pixel_difference", compareFrames(frame, directFrame).meanAbs);
+		report.addResult(result);
+	}
+}
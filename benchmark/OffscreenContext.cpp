@@ -0,0 +1,146 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "OffscreenContext.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <EGL/eglext.h>
+
+static bool hasExtension(const char* extensions, const char* name)
+{
+	return extensions && strstr(extensions, name) != nullptr;
+}
+
+Bench::OffscreenContext::~OffscreenContext()
+{
+	if (_display == EGL_NO_DISPLAY) return;
+
+	if (_fbo)
+	{
+		glDeleteFramebuffers(1, &_fbo);
+		glDeleteRenderbuffers(1, &_colorBuffer);
+		glDeleteRenderbuffers(1, &_depthBuffer);
+	}
+
+	eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (_surface != EGL_NO_SURFACE) eglDestroySurface(_display, _surface);
+	if (_context != EGL_NO_CONTEXT) eglDestroyContext(_display, _context);
+	eglTerminate(_display);
+}
+
+bool Bench::OffscreenContext::create(int width, int height)
+{
+	//Prefer Mesa's surfaceless platform, it needs neither X11 nor a GPU
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+	{
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if (getPlatformDisplay) _display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (_display == EGL_NO_DISPLAY) _display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major;
+	EGLint minor;
+	if (_display == EGL_NO_DISPLAY || !eglInitialize(_display, &major, &minor))
+	{
+		printf("Failed to initialize EGL (0x%x)\n", eglGetError());
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		printf("EGL has no desktop OpenGL support\n");
+		return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	//Without config-less contexts fall back to a tiny pbuffer, rendering still goes to our FBO
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	if (!hasExtension(eglQueryString(_display, EGL_EXTENSIONS), "EGL_KHR_no_config_context"))
+	{
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(_display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+		{
+			printf("No pbuffer capable EGL config\n");
+			return false;
+		}
+
+		const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		_surface = eglCreatePbufferSurface(_display, config, pbufferAttributes);
+	}
+
+	_context = eglCreateContext(_display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (_context == EGL_NO_CONTEXT)
+	{
+		printf("Failed to create GL 4.5 core context (0x%x)\n", eglGetError());
+		return false;
+	}
+
+	if (!eglMakeCurrent(_display, _surface, _surface, _context))
+	{
+		printf("Failed to make context current (0x%x)\n", eglGetError());
+		return false;
+	}
+
+	if (!gladLoadGL(reinterpret_cast<GLADloadfunc>(eglGetProcAddress)))
+	{
+		printf("GLAD Failed to load GL headers\n");
+		return false;
+	}
+
+	resize(width, height);
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void Bench::OffscreenContext::resize(int width, int height)
+{
+	if (!_fbo)
+	{
+		glGenFramebuffers(1, &_fbo);
+		glGenRenderbuffers(1, &_colorBuffer);
+		glGenRenderbuffers(1, &_depthBuffer);
+	}
+
+	_width = width;
+	_height = height;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+	glViewport(0, 0, width, height);
+}
+
+bool Bench::OffscreenContext::makeCurrent()
+{
+	return eglMakeCurrent(_display, _surface, _surface, _context) == EGL_TRUE;
+}
+
+void Bench::OffscreenContext::release()
+{
+	eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+const char* Bench::OffscreenContext::getRenderer() const
+{
+	return reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+}
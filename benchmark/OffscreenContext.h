@@ -0,0 +1,49 @@
+/*
+* Created by Adam Gyenes
+* Windowless GL 4.5 context through EGL, renders into an FBO
+*/
+
+#pragma once
+
+#include <EGL/egl.h>
+
+#include <ew/external/glad.h>
+
+namespace Bench
+{
+	class OffscreenContext
+	{
+	public:
+		OffscreenContext() {};
+		~OffscreenContext();
+
+		OffscreenContext(const OffscreenContext&) = delete;
+		OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+		//Creates the context and a width x height RGBA8 + depth framebuffer, returns false on failure
+		bool create(int width, int height);
+		//Recreates the framebuffer attachments at a new size
+		void resize(int width, int height);
+
+		//A context is current on at most one thread, release it before making it current on another one
+		bool makeCurrent();
+		void release();
+
+		int getWidth() const { return _width; }
+		int getHeight() const { return _height; }
+		GLuint getFramebuffer() const { return _fbo; }
+
+		const char* getRenderer() const;
+
+	private:
+		EGLDisplay _display = EGL_NO_DISPLAY;
+		EGLContext _context = EGL_NO_CONTEXT;
+		EGLSurface _surface = EGL_NO_SURFACE;
+
+		GLuint _fbo = 0;
+		GLuint _colorBuffer = 0;
+		GLuint _depthBuffer = 0;
+		int _width = 0;
+		int _height = 0;
+	};
+}
@@ -0,0 +1,129 @@
+/*
+* Created by Adam Gyenes
+* Renders the scene on a Util::RenderThread at every pipeline depth, trading input latency for throughput
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <util/AllocationTracker.h>
+#include <util/FramePipeline.h>
+#include <util/Profiler.h>
+#include <util/RenderThread.h>
+
+//Stands in for the game logic the main thread would run, so the two threads have something to overlap
+static void simulate(double milliseconds)
+{
+	auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(milliseconds);
+	while (std::chrono::steady_clock::now() < end) {}
+}
+
+static Bench::BenchmarkResult runPipeline(int depth, const Bench::SceneParams& params, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report)
+{
+	Util::FramePipeline pipeline(depth);
+	//Each packet is a snapshot of the whole layout, copying it is the main thread's recording cost
+	Bench::SceneLayout layout(params);
+	std::vector<Bench::SceneLayout> packets(FRAME_PIPELINE_SLOTS, layout);
+
+	std::unique_ptr<Bench::Scene> scene;
+	int width = context->getWidth();
+	int height = context->getHeight();
+
+	context->release();
+	Util::RenderThread renderThread(pipeline);
+	renderThread.start(
+		[&]()
+		{
+			context->makeCurrent();
+			scene.reset(new Bench::Scene(params));
+		},
+		[&](int slot)
+		{
+			scene->render(packets[slot], width, height);
+			//No swap chain, a finished frame counts as presented
+			glFinish();
+		},
+		[&]()
+		{
+			scene.reset();
+			context->release();
+		});
+
+	std::vector<double> frameMs;
+	std::vector<uint64_t> frameAllocations;
+	std::vector<uint64_t> frameBytes;
+	frameMs.reserve(config.frames);
+	frameAllocations.reserve(config.frames);
+	frameBytes.reserve(config.frames);
+	auto runStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < config.warmupFrames + config.frames; frame++)
+	{
+		if (frame == config.warmupFrames) runStart = std::chrono::steady_clock::now();
+
+		//Covers the render thread too, it draws the previous frames meanwhile
+		Util::AllocationScope allocations;
+		Util::Profiler::get().beginFrame();
+		auto start = std::chrono::steady_clock::now();
+
+		int slot = pipeline.beginWrite();
+		uint64_t inputNs = Util::Profiler::nowNs();
+		layout.animate(frame);
+		simulate(config.simulationMs);
+		packets[slot] = layout;
+		pipeline.endWrite(inputNs);
+
+		auto end = std::chrono::steady_clock::now();
+		Util::Profiler::get().endFrame();
+		Util::AllocationCounts frameCounts = allocations.getCounts();
+
+		if (frame < config.warmupFrames) continue;
+		frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		frameAllocations.push_back(frameCounts.allocations);
+		frameBytes.push_back(frameCounts.bytes);
+	}
+
+	pipeline.waitIdle();
+	double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+	Util::FramePipelineStats stats = pipeline.getStats();
+
+	renderThread.stop();
+	context->makeCurrent();
+
+	Bench::BenchmarkResult result;
+	result.name = "pipeline/depth" + std::to_string(depth);
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", width);
+	result.addMetric("height", height);
+	result.addMetric("objects", params.objects);
+	result.addMetric("depth", depth);
+	result.addMetric("simulation_ms", config.simulationMs);
+	result.addSummary("frame_ms", Bench::summarize(frameMs));
+	result.addMetric("fps", config.frames / runSeconds);
+	//Averaged over the last FRAME_PIPELINE_HISTORY frames
+	result.addMetric("latency_ms_mean", stats.latencyMs);
+	result.addMetric("latency_ms_max", stats.maxLatencyMs);
+	result.addMetric("render_ms_mean", stats.renderMs);
+	result.addMetric("main_wait_ms_mean", stats.producerWaitMs);
+	result.addMetric("render_wait_ms_mean", stats.consumerWaitMs);
+	Bench::addAllocationMetrics(frameAllocations, frameBytes, config, result, report);
+	return result;
+}
+
+void Bench::runPipelineSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	SceneParams params;
+	params.objects = config.objects;
+
+	for (int depth = 0; depth <= FRAME_PIPELINE_MAX_DEPTH; depth++)
+	{
+		report.addResult(runPipeline(depth, params, config, context, report));
+	}
+
+	//Later suites render on this thread again
+	Util::Profiler::get().setSeparateGpuThread(false);
+}
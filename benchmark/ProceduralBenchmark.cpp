@@ -0,0 +1,252 @@
+/*
+* Created by Adam Gyenes
+* Shapes whose resolution changes every frame: regenerated and uploaded on the CPU against Util::ProceduralRenderer
+* generating them in the vertex shader. Also the tessellated path, detail set by screen size rather than a resolution
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <ew/mesh.h>
+#include <ew/shader.h>
+
+#include <util/AllocationTracker.h>
+#include <util/FrameSync.h>
+#include <util/GLStateCache.h>
+#include <util/GpuResources.h>
+#include <util/ProceduralRenderer.h>
+#include <util/ProcGen.h>
+#include <util/Profiler.h>
+
+constexpr int PROCEDURAL_SHAPES = 4;
+constexpr int PROCEDURAL_MIN_SEGMENTS = 8;
+constexpr int PROCEDURAL_MAX_SEGMENTS = 96;
+//Coarse grid the tessellated path refines
+constexpr int TESSELLATION_BASE_SEGMENTS = 8;
+
+enum class ProceduralPath
+{
+	CPU_MESHES,
+	VERTEX_SHADER,
+	TESSELLATED
+};
+
+//Sweeps the resolution up and down, a different one every frame like dragging a UI slider
+static int segmentsAt(int frame)
+{
+	int range = PROCEDURAL_MAX_SEGMENTS - PROCEDURAL_MIN_SEGMENTS;
+	int step = frame % (range * 2);
+	return PROCEDURAL_MIN_SEGMENTS + (step < range ? step : range * 2 - step);
+}
+
+//The CPU and GPU versions of each shape take the same arguments
+static ew::MeshData createShape(int shape, int segments)
+{
+	switch (shape)
+	{
+	case 0: return Util::createSphere(0.5f, segments);
+	case 1: return Util::createCylidner(1.f, 0.5f, segments);
+	case 2: return Util::createTorus(0.15f, 0.4f, segments, segments);
+	default: return Util::createPlane(1.f, 1.f, segments / 4 + 1);
+	}
+}
+
+static Util::ProceduralPrimitive createPrimitive(int shape, int segments)
+{
+	switch (shape)
+	{
+	case 0: return Util::ProceduralPrimitive::sphere(0.5f, segments);
+	case 1: return Util::ProceduralPrimitive::cylinder(1.f, 0.5f, segments);
+	case 2: return Util::ProceduralPrimitive::torus(0.15f, 0.4f, segments, segments);
+	default: return Util::ProceduralPrimitive::plane(1.f, 1.f, segments / 4 + 1);
+	}
+}
+
+//cameraDistance scales the scripted camera's distance from the scene
+static Bench::BenchmarkResult runProceduralPath(const char* name, ProceduralPath path, float cameraDistance, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report, std::vector<unsigned char>& lastFrame)
+{
+	bool gpu = path != ProceduralPath::CPU_MESHES;
+	bool tessellated = path == ProceduralPath::TESSELLATED;
+
+	Bench::SceneParams params;
+	params.objects = config.objects;
+	Bench::SceneLayout layout(params);
+
+	//Sorted by shape so the GPU path batches each shape into one instanced draw
+	std::vector<Bench::SceneLayout::Object> objects = layout.getObjects();
+	for (Bench::SceneLayout::Object& object : objects) object.mesh %= PROCEDURAL_SHAPES;
+	std::stable_sort(objects.begin(), objects.end(), [](const Bench::SceneLayout::Object& a, const Bench::SceneLayout::Object& b) { return a.mesh < b.mesh; });
+
+	ew::Shader shader = tessellated ?
+		ew::Shader("assets/benchmark/proceduralPatch.vert", "assets/benchmark/proceduralPatch.tesc", "assets/benchmark/proceduralPatch.tese", "assets/benchmark/shape.frag") :
+		ew::Shader(gpu ? "assets/benchmark/proceduralShape.vert" : "assets/benchmark/shape.vert", "assets/benchmark/shape.frag");
+	ew::Mesh meshes[PROCEDURAL_SHAPES];
+	Util::ProceduralRenderer procedural(int(objects.size()));
+	Util::GLStateCache stateCache;
+	//Instances go through a ring like the final project's transient data
+	Util::FrameSync frameSync;
+
+	int width = context->getWidth();
+	int height = context->getHeight();
+
+	GLuint primitivesQuery;
+	glGenQueries(1, &primitivesQuery);
+	GLuint primitivesPerFrame = 0;
+
+	std::vector<double> cpuFrameMs;
+	std::vector<double> buildMs;
+	std::vector<uint64_t> frameAllocations;
+	std::vector<uint64_t> frameBytes;
+	cpuFrameMs.reserve(config.frames);
+	buildMs.reserve(config.frames);
+	frameAllocations.reserve(config.frames);
+	frameBytes.reserve(config.frames);
+	double geometryBytes = 0.0;
+	double verticesPerFrame = 0.0;
+
+	for (int frame = 0; frame < config.warmupFrames + config.frames; frame++)
+	{
+		Util::AllocationScope allocations;
+		Util::Profiler::get().beginFrame();
+		auto start = std::chrono::steady_clock::now();
+
+		int segments = tessellated ? TESSELLATION_BASE_SEGMENTS : segmentsAt(frame);
+		geometryBytes = 0.0;
+		verticesPerFrame = 0.0;
+		if (gpu)
+		{
+			for (const Bench::SceneLayout::Object& object : objects) procedural.add(createPrimitive(object.mesh, segments), object.transform.getModelMatrix());
+		}
+		else
+		{
+			//What assignment6 does whenever a slider moves
+			for (int shape = 0; shape < PROCEDURAL_SHAPES; shape++)
+			{
+				ew::MeshData meshData = createShape(shape, segments);
+				meshes[shape].load(meshData);
+				geometryBytes += double(meshData.vertices.size() * sizeof(ew::Vertex) + meshData.indices.size() * sizeof(unsigned int));
+			}
+		}
+		auto built = std::chrono::steady_clock::now();
+
+		layout.animate(frame);
+		ew::Camera camera = layout.getCamera();
+		camera.aspectRatio = float(width) / height;
+		camera.position = camera.target + (camera.position - camera.target) * cameraDistance;
+
+		frameSync.beginFrame();
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_BACK);
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		glBeginQuery(GL_PRIMITIVES_GENERATED, primitivesQuery);
+		shader.use();
+		shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
+		if (gpu)
+		{
+			//ew::Shader::use bound the program behind the cache's back
+			stateCache.invalidate();
+			procedural.setTessellationTarget(camera, height);
+			procedural.draw(stateCache, shader.getId(), tessellated ? GL_PATCHES : GL_TRIANGLES, &frameSync);
+			verticesPerFrame = procedural.getStats().vertices;
+			procedural.clear();
+		}
+		else
+		{
+			for (const Bench::SceneLayout::Object& object : objects)
+			{
+				shader.setMat4("_Model", object.transform.getModelMatrix());
+				meshes[object.mesh].draw();
+				verticesPerFrame += meshes[object.mesh].getNumIndices();
+			}
+		}
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		frameSync.endFrame();
+
+		glFinish();
+		//Replaced meshes are released here, the GPU is done with them after the finish
+		Util::GpuResourceRegistry::get().endFrame();
+		auto end = std::chrono::steady_clock::now();
+		Util::Profiler::get().endFrame();
+		Util::AllocationCounts frameCounts = allocations.getCounts();
+
+		if (frame < config.warmupFrames) continue;
+
+		glGetQueryObjectuiv(primitivesQuery, GL_QUERY_RESULT, &primitivesPerFrame);
+		cpuFrameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		buildMs.push_back(std::chrono::duration<double, std::milli>(built - start).count());
+		frameAllocations.push_back(frameCounts.allocations);
+		frameBytes.push_back(frameCounts.bytes);
+	}
+
+	glDeleteQueries(1, &primitivesQuery);
+
+	Bench::readFrame(context, lastFrame);
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("procedural/") + name;
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", width);
+	result.addMetric("height", height);
+	result.addMetric("objects", double(objects.size()));
+	result.addMetric("camera_distance", cameraDistance);
+	if (tessellated)
+	{
+		result.addMetric("base_segments", TESSELLATION_BASE_SEGMENTS);
+		result.addMetric("patches_per_frame", procedural.getStats().patches);
+	}
+	else
+	{
+		result.addMetric("min_segments", PROCEDURAL_MIN_SEGMENTS);
+		result.addMetric("max_segments", PROCEDURAL_MAX_SEGMENTS);
+	}
+	result.addSummary("frame_ms", Bench::summarize(cpuFrameMs));
+	result.addSummary("build_ms", Bench::summarize(buildMs));
+	result.addMetric("vertices_per_frame", verticesPerFrame);
+	//Last measured frame
+	result.addMetric("triangles_per_frame", primitivesPerFrame);
+	result.addMetric("geometry_bytes", geometryBytes);
+	if (gpu)
+	{
+		result.addMetric("instance_bytes", double(objects.size() * sizeof(Util::ProceduralInstance)));
+		result.addMetric("draws", procedural.getStats().draws);
+	}
+
+	//Regenerating meshes on the CPU allocates by nature, that is part of what is measured. Software drivers (llvmpipe)
+	//allocate inside tessellated draws, the renderer itself doesn't, which the vertex shader path checks
+	Bench::BenchmarkConfig allocationConfig = config;
+	allocationConfig.allowAllocations = config.allowAllocations || !gpu || tessellated;
+	Bench::addAllocationMetrics(frameAllocations, frameBytes, allocationConfig, result, report);
+	return result;
+}
+
+void Bench::runProceduralSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	if (!Util::ProceduralRenderer::isSupported())
+	{
+		report.addInfo("procedural", "skipped, procedural shapes need GL 4.5");
+		return;
+	}
+
+	std::vector<unsigned char> cpuFrame;
+	std::vector<unsigned char> gpuFrame;
+	report.addResult(runProceduralPath("cpu_meshes", ProceduralPath::CPU_MESHES, 1.f, config, context, report, cpuFrame));
+	BenchmarkResult gpu = runProceduralPath("vertex_shader", ProceduralPath::VERTEX_SHADER, 1.f, config, context, report, gpuFrame);
+
+	//Both paths end on the same resolution, only trigonometry rounding should tell them apart
+	gpu.addMetric("mean_abs_pixel_difference", compareFrames(gpuFrame, cpuFrame).meanAbs);
+	report.addResult(gpu);
+
+	//Same coarse patches at every distance, the triangle count should fall as the camera backs off
+	std::vector<unsigned char> tessellatedFrame;
+	report.addResult(runProceduralPath("tessellated", ProceduralPath::TESSELLATED, 1.f, config, context, report, tessellatedFrame));
+	report.addResult(runProceduralPath("tessellated_far", ProceduralPath::TESSELLATED, 4.f, config, context, report, tessellatedFrame));
+}
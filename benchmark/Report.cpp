@@ -0,0 +1,250 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "Report.h"
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <util/AllocationTracker.h>
+#include <util/Profiler.h>
+
+//Nearest-rank percentile on sorted samples
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = size_t(std::ceil(p / 100.0 * sorted.size()));
+	rank = std::min(std::max(rank, size_t(1)), sorted.size());
+	return sorted[rank - 1];
+}
+
+Bench::FrameTimeSummary Bench::summarize(std::vector<double> samples)
+{
+	FrameTimeSummary summary;
+	if (samples.empty()) return summary;
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0.0;
+	for (double sample : samples) total += sample;
+
+	summary.mean = total / samples.size();
+	summary.min = samples.front();
+	summary.max = samples.back();
+	summary.p50 = percentile(samples, 50.0);
+	summary.p90 = percentile(samples, 90.0);
+	summary.p99 = percentile(samples, 99.0);
+	return summary;
+}
+
+void Bench::BenchmarkResult::addInfo(const std::string& key, const std::string& value)
+{
+	info.push_back(std::make_pair(key, value));
+}
+
+void Bench::BenchmarkResult::addMetric(const std::string& key, double value)
+{
+	metrics.push_back(std::make_pair(key, value));
+}
+
+void Bench::BenchmarkResult::addSummary(const std::string& prefix, const FrameTimeSummary& summary)
+{
+	addMetric(prefix + "_mean", summary.mean);
+	addMetric(prefix + "_min", summary.min);
+	addMetric(prefix + "_max", summary.max);
+	addMetric(prefix + "_p50", summary.p50);
+	addMetric(prefix + "_p90", summary.p90);
+	addMetric(prefix + "_p99", summary.p99);
+}
+
+void Bench::Report::addInfo(const std::string& key, const std::string& value)
+{
+	_info.push_back(std::make_pair(key, value));
+}
+
+void Bench::Report::addResult(const BenchmarkResult& result)
+{
+	_results.push_back(result);
+}
+
+void Bench::Report::addFailure(const std::string& message)
+{
+	_failures.push_back(message);
+}
+
+static void writeJsonString(FILE* file, const std::string& string)
+{
+	fputc('"', file);
+	for (char c : string)
+	{
+		if (c == '"' || c == '\\') fputc('\\', file);
+		if ((unsigned char)c < 0x20) continue;
+		fputc(c, file);
+	}
+	fputc('"', file);
+}
+
+static void writeInfo(FILE* file, const std::vector<std::pair<std::string, std::string>>& info, const char* indent)
+{
+	for (size_t i = 0; i < info.size(); i++)
+	{
+		fprintf(file, "%s", indent);
+		writeJsonString(file, info[i].first);
+		fprintf(file, ": ");
+		writeJsonString(file, info[i].second);
+		fprintf(file, ",\n");
+	}
+}
+
+bool Bench::Report::write(const char* filepath) const
+{
+	FILE* file = fopen(filepath, "w");
+	if (!file)
+	{
+		printf("Failed to open report file %s\n", filepath);
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	writeInfo(file, _info, "  ");
+	fprintf(file, "  \"results\": [\n");
+	for (size_t r = 0; r < _results.size(); r++)
+	{
+		const BenchmarkResult& result = _results[r];
+		fprintf(file, "    {\n      \"name\": ");
+		writeJsonString(file, result.name);
+		fprintf(file, ",\n");
+		writeInfo(file, result.info, "      ");
+		fprintf(file, "      \"metrics\": {");
+		for (size_t m = 0; m < result.metrics.size(); m++)
+		{
+			fprintf(file, "%s\n        ", m == 0 ? "" : ",");
+			writeJsonString(file, result.metrics[m].first);
+			//JSON has no NaN/Inf
+			double value = result.metrics[m].second;
+			if (std::isfinite(value)) fprintf(file, ": %.6g", value);
+			else fprintf(file, ": null");
+		}
+		fprintf(file, "\n      }\n    }%s\n", r + 1 < _results.size() ? "," : "");
+	}
+	fprintf(file, "  ],\n  \"failures\": [");
+	for (size_t f = 0; f < _failures.size(); f++)
+	{
+		fprintf(file, "%s\n    ", f == 0 ? "" : ",");
+		writeJsonString(file, _failures[f]);
+	}
+	fprintf(file, "%s]\n}\n", _failures.empty() ? "" : "\n  ");
+
+	fclose(file);
+	return true;
+}
+
+void Bench::Report::print() const
+{
+	for (const BenchmarkResult& result : _results)
+	{
+		printf("%s\n", result.name.c_str());
+		for (const std::pair<std::string, double>& metric : result.metrics)
+		{
+			printf("  %-28s %.4g\n", metric.first.c_str(), metric.second);
+		}
+	}
+	for (const std::string& failure : _failures)
+	{
+		printf("FAILED: %s\n", failure.c_str());
+	}
+}
+
+long Bench::currentRssKb()
+{
+	long pages = 0;
+	long residentPages = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file) return 0;
+	if (fscanf(file, "%ld %ld", &pages, &residentPages) != 2) residentPages = 0;
+	fclose(file);
+	return residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+long Bench::peakRssKb()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+Bench::TimedFrames Bench::runTimedFrames(const BenchmarkConfig& config, const std::function<void(int frame)>& render,
+	const std::function<void(int frame)>& measured)
+{
+	GLuint timerQuery;
+	glGenQueries(1, &timerQuery);
+
+	TimedFrames frames;
+	frames.cpuMs.reserve(config.frames);
+	frames.gpuMs.reserve(config.frames);
+	frames.allocations.reserve(config.frames);
+	frames.bytes.reserve(config.frames);
+
+	for (int frame = 0; frame < config.warmupFrames + config.frames; frame++)
+	{
+		Util::AllocationScope allocations;
+		Util::Profiler::get().beginFrame();
+		auto start = std::chrono::steady_clock::now();
+
+		glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+		render(frame);
+		glEndQuery(GL_TIME_ELAPSED);
+
+		//No swap chain to throttle us, so wait for the GPU to make each frame's time honest
+		glFinish();
+		auto end = std::chrono::steady_clock::now();
+		Util::Profiler::get().endFrame();
+		Util::AllocationCounts frameCounts = allocations.getCounts();
+
+		if (frame < config.warmupFrames) continue;
+
+		GLuint64 gpuNs = 0;
+		glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &gpuNs);
+		frames.cpuMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		frames.gpuMs.push_back(gpuNs / 1e6);
+		frames.allocations.push_back(frameCounts.allocations);
+		frames.bytes.push_back(frameCounts.bytes);
+		if (measured) measured(frame);
+	}
+
+	glDeleteQueries(1, &timerQuery);
+	return frames;
+}
+
+void Bench::readFrame(OffscreenContext* context, std::vector<unsigned char>& pixels)
+{
+	pixels.resize(size_t(context->getWidth()) * context->getHeight() * 4);
+	glReadPixels(0, 0, context->getWidth(), context->getHeight(), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+Bench::FrameDifference Bench::compareFrames(const std::vector<unsigned char>& frame, const std::vector<unsigned char>& reference)
+{
+	FrameDifference difference;
+	size_t pixels = std::min(frame.size(), reference.size()) / 4;
+	if (pixels == 0) return difference;
+
+	double total = 0.0;
+	size_t differentPixels = 0;
+	for (size_t i = 0; i < pixels * 4; i += 4)
+	{
+		int pixelDifference = 0;
+		for (int channel = 0; channel < 3; channel++) pixelDifference += std::abs(int(frame[i + channel]) - int(reference[i + channel]));
+		total += pixelDifference;
+		if (pixelDifference > FRAME_DIFFERENCE_THRESHOLD) differentPixels++;
+	}
+	difference.meanAbs = total / (pixels * 3);
+	difference.differentFraction = double(differentPixels) / pixels;
+	return difference;
+}
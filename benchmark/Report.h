@@ -0,0 +1,61 @@
+/*
+* Created by Adam Gyenes
+* Benchmark results and their JSON report
+*/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Bench
+{
+	struct FrameTimeSummary
+	{
+		double mean = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+	};
+
+	FrameTimeSummary summarize(std::vector<double> samples);
+
+	struct BenchmarkResult
+	{
+		std::string name;
+		std::vector<std::pair<std::string, std::string>> info;
+		std::vector<std::pair<std::string, double>> metrics;
+
+		void addInfo(const std::string& key, const std::string& value);
+		void addMetric(const std::string& key, double value);
+		//Adds <prefix>_mean, _min, _max, _p50, _p90, _p99
+		void addSummary(const std::string& prefix, const FrameTimeSummary& summary);
+	};
+
+	class Report
+	{
+	public:
+		void addInfo(const std::string& key, const std::string& value);
+		void addResult(const BenchmarkResult& result);
+		//A check that didn't hold, the runner exits with an error if there are any
+		void addFailure(const std::string& message);
+
+		const std::vector<BenchmarkResult>& getResults() const { return _results; }
+		const std::vector<std::string>& getFailures() const { return _failures; }
+
+		bool write(const char* filepath) const;
+		void print() const;
+
+	private:
+		std::vector<std::pair<std::string, std::string>> _info;
+		std::vector<BenchmarkResult> _results;
+		std::vector<std::string> _failures;
+	};
+
+	//Resident set size of this process in KiB, current and peak
+	long currentRssKb();
+	long peakRssKb();
+}
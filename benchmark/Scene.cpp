@@ -0,0 +1,208 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "Scene.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <ew/external/glad.h>
+#include <ew/procGen.h>
+#include <util/MeshStaging.h>
+#include <util/ProcGen.h>
+
+Bench::SceneLayout::SceneLayout(const SceneParams& params)
+	: _params(params)
+{
+	//Square grid on the XZ plane
+	int columns = int(ceilf(sqrtf(float(params.objects))));
+	float spacing = 1.5f;
+	_extent = columns * spacing * 0.5f;
+	for (int i = 0; i < params.objects; i++)
+	{
+		Object object;
+		object.mesh = i % MESH_COUNT;
+		object.transform.position = ew::Vec3((i % columns) * spacing - _extent, 0.f, (i / columns) * spacing - _extent);
+		object.transform.rotation = ew::Vec3(0.f, float((i * 37) % 360), 0.f);
+		_objects.push_back(object);
+	}
+
+	const ew::Vec3 lightColors[MAX_LIGHTS] = { ew::Vec3(1.f, 0.f, 0.f), ew::Vec3(0.f, 1.f, 0.f), ew::Vec3(0.f, 0.f, 1.f), ew::Vec3(1.f, 1.f, 0.f) };
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		_lights[i].color = lightColors[i];
+	}
+
+	_camera.fov = 60.f;
+	_camera.nearPlane = 0.1f;
+	_camera.farPlane = 100.f;
+}
+
+void Bench::SceneLayout::animate(int frame)
+{
+	//Fixed 60 Hz timeline so runs are comparable regardless of actual frame time
+	float time = frame / 60.f;
+
+	float orbitRadius = _extent * 1.2f + 3.f;
+	_camera.position = ew::Vec3(orbitRadius * cosf(time * 0.5f), 2.f + _extent * 0.3f, orbitRadius * sinf(time * 0.5f));
+	_camera.target = ew::Vec3(0.f);
+
+	int activeLights = getActiveLights();
+	float lightAngleDiff = ew::TAU / activeLights;
+	for (int i = 0; i < activeLights; i++)
+	{
+		float angle = time + i * lightAngleDiff;
+		_lights[i].position = ew::Vec3(_extent * cosf(angle), 3.f, _extent * sinf(angle));
+	}
+}
+
+std::vector<ew::MeshData> Bench::SceneLayout::createMeshes(std::pmr::memory_resource* resource) const
+{
+	int segments = _params.segments;
+	std::vector<ew::MeshData> meshes;
+	meshes.push_back(ew::createCube(1.f, resource));
+	meshes.push_back(ew::createSphere(0.5f, segments, resource));
+	meshes.push_back(ew::createCylinder(0.5f, 1.f, segments, resource));
+	meshes.push_back(Util::createTorus(0.15f, 0.4f, segments, segments, resource));
+	meshes.push_back(ew::createPlane(1.f, 1.f, segments / 4 + 1, resource));
+	return meshes;
+}
+
+//Checkerboard color and bumpy height map so the parallax path has something to march through
+void Bench::SceneLayout::createTexturePixels(std::vector<unsigned char>& color, std::vector<unsigned char>& height)
+{
+	color.resize(TEXTURE_SIZE * TEXTURE_SIZE * 3);
+	height.resize(TEXTURE_SIZE * TEXTURE_SIZE);
+	for (int y = 0; y < TEXTURE_SIZE; y++)
+	{
+		for (int x = 0; x < TEXTURE_SIZE; x++)
+		{
+			int i = y * TEXTURE_SIZE + x;
+			bool checker = ((x / 32) + (y / 32)) % 2 == 0;
+			color[i * 3 + 0] = checker ? 200 : 90;
+			color[i * 3 + 1] = checker ? 180 : 80;
+			color[i * 3 + 2] = checker ? 160 : 70;
+
+			float bump = 0.5f + 0.25f * sinf(x * 0.2f) + 0.25f * cosf(y * 0.15f);
+			height[i] = (unsigned char)(bump * 255.f);
+		}
+	}
+}
+
+static void createTextures(Util::GpuResource& colorTexture, Util::GpuResource& heightTexture)
+{
+	const int size = Bench::SceneLayout::TEXTURE_SIZE;
+	std::vector<unsigned char> color;
+	std::vector<unsigned char> height;
+	Bench::SceneLayout::createTexturePixels(color, height);
+
+	colorTexture = Util::GpuResource::create(Util::GpuResourceType::TEXTURE, "Bench::Scene color");
+	colorTexture.setBytes(Util::getTextureBytes(size, size, 3, true));
+	glBindTexture(GL_TEXTURE_2D, colorTexture.get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, color.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	//Rows of a single channel texture aren't 4 byte aligned in general
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	heightTexture = Util::GpuResource::create(Util::GpuResourceType::TEXTURE, "Bench::Scene height");
+	heightTexture.setBytes(Util::getTextureBytes(size, size, 1, true));
+	glBindTexture(GL_TEXTURE_2D, heightTexture.get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, height.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Bench::Scene::Scene(const SceneParams& params)
+	: _layout(params),
+	_shader("assets/benchmark/defaultLit.vert", "assets/benchmark/defaultLit.frag"),
+	_renderer("assets/benchmark/depthOnly.vert", "assets/benchmark/depthOnly.frag")
+{
+	_renderer.settings.depthPrePass = params.depthPrePass;
+	_renderer.settings.sortFrontToBack = params.sortFrontToBack;
+	_renderer.settings.occlusionQueries = params.occlusionQueries;
+
+	Util::MeshStaging staging;
+	std::vector<ew::MeshData> meshes = _layout.createMeshes(&staging);
+	_meshes.reserve(meshes.size());
+	for (const ew::MeshData& mesh : meshes)
+	{
+		_meshes.emplace_back(mesh, true);
+	}
+
+	createTextures(_colorTexture, _heightTexture);
+}
+
+void Bench::Scene::render(int width, int height)
+{
+	_layout.getCamera().aspectRatio = float(width) / height;
+	render(_layout, width, height);
+}
+
+void Bench::Scene::render(const SceneLayout& layout, int width, int height)
+{
+	ew::Camera camera = layout.getCamera();
+	camera.aspectRatio = float(width) / height;
+
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glEnable(GL_DEPTH_TEST);
+
+	glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	_stateCache.resetStats();
+	_stateCache.useProgram(_shader.getId());
+	_shader.setInt("_colorTexture", 0);
+	_shader.setInt("_heightTexture", 1);
+	_shader.setVec3("_cameraPosition", camera.position);
+
+	int activeLights = layout.getActiveLights();
+	const SceneLayout::Light* lights = layout.getLights();
+	_shader.setInt("_activeLights", activeLights);
+	char uniformName[32];
+	for (int i = 0; i < activeLights; i++)
+	{
+		snprintf(uniformName, sizeof(uniformName), "_lights[%d].position", i);
+		_shader.setVec3(uniformName, lights[i].position);
+		snprintf(uniformName, sizeof(uniformName), "_lights[%d].color", i);
+		_shader.setVec3(uniformName, lights[i].color);
+	}
+
+	_shader.setFloat("_material.ambientK", 0.2f);
+	_shader.setVec3("_ambientColor", ew::Vec3(0.341f, 0.365f, 0.51f));
+	_shader.setFloat("_material.diffuseK", 0.4f);
+	_shader.setFloat("_material.specularK", 0.5f);
+	_shader.setFloat("_material.shininess", 10.f);
+
+	//Discard has to stay off for the depth pre-pass to be valid
+	_shader.setInt("_parallaxMethod", getParams().parallaxMethod);
+	_shader.setInt("_discardOutOfBoundFrags", 0);
+	_shader.setFloat("_heightScale", 0.1f);
+	_shader.setFloat("_minLayers", 8.f);
+	_shader.setFloat("_maxLayers", 32.f);
+
+	Util::MaterialTextures textures;
+	textures.units[0] = _colorTexture.get();
+	textures.units[1] = _heightTexture.get();
+
+	_renderer.begin(camera);
+	//Mesh 0 is the cube
+	for (const ew::Mat4& model : _occluders) _renderer.submit(_meshes[0], model, textures);
+	const std::vector<SceneLayout::Object>& objects = layout.getObjects();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		_renderer.submit(_meshes[objects[i].mesh], objects[i].transform.getModelMatrix(), textures, int(i), getParams().conditionalRender);
+	}
+	_renderer.flush(_shader, width, height, _stateCache);
+}
@@ -0,0 +1,119 @@
+/*
+* Created by Adam Gyenes
+* Synthetic benchmark scene built from the ew/Util procedural meshes
+*/
+
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include <ew/camera.h>
+#include <ew/mesh.h>
+#include <ew/shader.h>
+#include <ew/transform.h>
+
+#include <util/GLStateCache.h>
+#include <util/GpuResources.h>
+#include <util/Mesh.h>
+#include <util/Renderer.h>
+
+namespace Bench
+{
+	struct SceneParams
+	{
+		int objects = 64;
+		int lights = 4;
+		//Segments/subdivisions used for every round shape
+		int segments = 32;
+		//Same numbering as the final project: off, simple, steep, occlusion
+		int parallaxMethod = 3;
+		bool depthPrePass = false;
+		bool sortFrontToBack = true;
+		//Each object is queried under its index, conditionally rendered while hidden rather than skipped
+		bool occlusionQueries = false;
+		bool conditionalRender = false;
+	};
+
+	//Everything about the scene that doesn't touch GL, shared by the GPU and software benchmarks
+	//so both render exactly the same frames
+	class SceneLayout
+	{
+	public:
+		static constexpr int MAX_LIGHTS = 4;
+		static constexpr int MESH_COUNT = 5;
+		static constexpr int TEXTURE_SIZE = 256;
+
+		struct Object
+		{
+			int mesh;
+			ew::Transform transform;
+		};
+
+		struct Light
+		{
+			ew::Vec3 position;
+			ew::Vec3 color;
+		};
+
+		SceneLayout(const SceneParams& params);
+
+		//Scripted camera orbit and light animation, fully determined by the frame index
+		void animate(int frame);
+
+		//One mesh per shape, objects cycle through them. Allocated from resource, e.g. a Util::MeshStaging
+		std::vector<ew::MeshData> createMeshes(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+		//Checkerboard RGB color and bumpy single channel height map, TEXTURE_SIZE squared
+		static void createTexturePixels(std::vector<unsigned char>& color, std::vector<unsigned char>& height);
+
+		const SceneParams& getParams() const { return _params; }
+		const std::vector<Object>& getObjects() const { return _objects; }
+		const Light* getLights() const { return _lights; }
+		int getActiveLights() const { return _params.lights < MAX_LIGHTS ? _params.lights : MAX_LIGHTS; }
+		ew::Camera& getCamera() { return _camera; }
+		const ew::Camera& getCamera() const { return _camera; }
+
+	private:
+		SceneParams _params;
+		std::vector<Object> _objects;
+		Light _lights[MAX_LIGHTS];
+		ew::Camera _camera;
+		float _extent = 1.f;
+	};
+
+	class Scene
+	{
+	public:
+		Scene(const SceneParams& params);
+
+		Scene(const Scene&) = delete;
+		Scene& operator=(const Scene&) = delete;
+
+		void animate(int frame) { _layout.animate(frame); }
+		void render(int width, int height);
+		//Renders another layout built from the same params, e.g. a snapshot handed over from another thread
+		void render(const SceneLayout& layout, int width, int height);
+		//Unit cube drawn before the objects on every render, never queried
+		void addOccluder(const ew::Mat4& model) { _occluders.push_back(model); }
+
+		const SceneParams& getParams() const { return _layout.getParams(); }
+		const Util::RenderStats& getStats() const { return _renderer.getStats(); }
+		const Util::OcclusionQueryStats& getOcclusionStats() const { return _renderer.getOcclusionStats(); }
+		//Binds of the last render() call
+		const Util::GLStateStats& getStateStats() const { return _stateCache.getStats(); }
+		const ew::Camera& getCamera() const { return _layout.getCamera(); }
+
+	private:
+		SceneLayout _layout;
+
+		ew::Shader _shader;
+		Util::Renderer _renderer;
+		Util::GLStateCache _stateCache;
+
+		std::vector<Util::Mesh> _meshes;
+		std::vector<ew::Mat4> _occluders;
+
+		Util::GpuResource _colorTexture;
+		Util::GpuResource _heightTexture;
+	};
+}
@@ -0,0 +1,63 @@
+/*
+* Created by Adam Gyenes
+* Renders the synthetic scene with each draw ordering strategy
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <string>
+
+static Bench::BenchmarkResult runScene(const char* name, const Bench::SceneParams& params, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report)
+{
+	Bench::Scene scene(params);
+
+	Bench::TimedFrames timed = Bench::runTimedFrames(config, [&](int frame)
+		{
+			scene.animate(frame);
+			scene.render(context->getWidth(), context->getHeight());
+		});
+
+	const Util::RenderStats& stats = scene.getStats();
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("scene/") + name;
+	result.addInfo("parallax_method", std::to_string(params.parallaxMethod));
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", context->getWidth());
+	result.addMetric("height", context->getHeight());
+	result.addMetric("objects", params.objects);
+	result.addSummary("frame_ms", Bench::summarize(timed.cpuMs));
+	result.addSummary("gpu_ms", Bench::summarize(timed.gpuMs));
+	result.addMetric("draw_calls", stats.drawCalls + stats.prePassDrawCalls);
+	result.addMetric("triangles", stats.triangles);
+
+	const Util::GLStateStats& binds = scene.getStateStats();
+	result.addMetric("binds_issued", binds.getIssued());
+	result.addMetric("binds_skipped", binds.getSkipped());
+	result.addMetric("program_binds", binds.issued[int(Util::BindType::PROGRAM)]);
+	result.addMetric("vertex_array_binds", binds.issued[int(Util::BindType::VERTEX_ARRAY)]);
+	result.addMetric("vertex_buffer_binds", binds.issued[int(Util::BindType::VERTEX_BUFFER)]);
+	result.addMetric("texture_binds", binds.issued[int(Util::BindType::TEXTURE)]);
+	result.addMetric("shaded_samples", double(stats.shadedSamples));
+	result.addMetric("overdraw", stats.overdraw);
+	result.addMetric("rss_kb", double(Bench::currentRssKb()));
+	result.addMetric("peak_rss_kb", double(Bench::peakRssKb()));
+	Bench::addAllocationMetrics(timed.allocations, timed.bytes, config, result, report);
+	return result;
+}
+
+void Bench::runSceneSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	SceneParams params;
+	params.objects = config.objects;
+
+	params.sortFrontToBack = false;
+	report.addResult(runScene("state_sorted", params, config, context, report));
+
+	params.sortFrontToBack = true;
+	report.addResult(runScene("front_to_back", params, config, context, report));
+
+	params.depthPrePass = true;
+	report.addResult(runScene("depth_prepass", params, config, context, report));
+}
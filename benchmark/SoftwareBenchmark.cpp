@@ -0,0 +1,161 @@
+/*
+* Created by Adam Gyenes
+* Renders the benchmark scene with Util::SoftwareRasterizer across resolutions and thread counts
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <util/JobSystem.h>
+#include <util/SoftwareRasterizer.h>
+
+//First frames grow the rasterizer's bins and vertex buffers
+constexpr int SOFTWARE_WARMUP_FRAMES = 2;
+
+struct Resolution
+{
+	int width;
+	int height;
+};
+
+static const Resolution RESOLUTIONS[] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+
+//Everything the rasterizer references until flush()
+struct SoftwareScene
+{
+	Bench::SceneLayout layout;
+	std::vector<Util::SoftwareMesh> meshes;
+	Util::SoftwareTexture colorTexture;
+	Util::SoftwareTexture heightTexture;
+	Util::SoftwareMaterial material;
+
+	SoftwareScene(const Bench::SceneParams& params)
+		: layout(params)
+	{
+		for (const ew::MeshData& mesh : layout.createMeshes())
+		{
+			meshes.emplace_back(mesh);
+		}
+
+		colorTexture.width = colorTexture.height = Bench::SceneLayout::TEXTURE_SIZE;
+		colorTexture.channels = 3;
+		heightTexture.width = heightTexture.height = Bench::SceneLayout::TEXTURE_SIZE;
+		heightTexture.channels = 1;
+		Bench::SceneLayout::createTexturePixels(colorTexture.pixels, heightTexture.pixels);
+
+		//Same values Bench::Scene uploads as uniforms
+		material.parallaxMethod = params.parallaxMethod;
+		material.colorTexture = &colorTexture;
+		material.heightTexture = &heightTexture;
+	}
+
+	void render(Util::SoftwareRasterizer& rasterizer)
+	{
+		ew::Camera& camera = layout.getCamera();
+		camera.aspectRatio = float(rasterizer.getWidth()) / rasterizer.getHeight();
+
+		Util::SoftwareLighting lighting;
+		lighting.activeLights = layout.getActiveLights();
+		for (int i = 0; i < lighting.activeLights; i++)
+		{
+			lighting.lights[i].position = layout.getLights()[i].position;
+			lighting.lights[i].color = layout.getLights()[i].color;
+		}
+
+		rasterizer.clearColor = ew::Vec3(0.1f);
+		rasterizer.begin(camera, lighting);
+		for (const Bench::SceneLayout::Object& object : layout.getObjects())
+		{
+			rasterizer.submit(meshes[object.mesh], object.transform, material);
+		}
+		rasterizer.flush();
+	}
+};
+
+void Bench::runSoftwareSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	SceneParams params;
+	params.objects = config.objects;
+	SoftwareScene scene(params);
+
+	int maxThreads = config.maxThreads > 0 ? config.maxThreads : int(std::thread::hardware_concurrency());
+	if (maxThreads < 1) maxThreads = 1;
+
+	//Powers of two plus the full count
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	for (const Resolution& resolution : RESOLUTIONS)
+	{
+		double singleThreadMs = 0.0;
+		std::vector<uint32_t> singleThreadImage;
+
+		for (int threads : threadCounts)
+		{
+			Util::JobSystem jobs(threads);
+			Util::SoftwareRasterizer rasterizer(resolution.width, resolution.height, jobs);
+
+			std::vector<double> frameMs;
+			double vertexMs = 0.0;
+			double binningMs = 0.0;
+			double rasterMs = 0.0;
+			for (int frame = 0; frame < SOFTWARE_WARMUP_FRAMES + config.softwareFrames; frame++)
+			{
+				scene.layout.animate(frame);
+
+				auto start = std::chrono::steady_clock::now();
+				scene.render(rasterizer);
+				auto end = std::chrono::steady_clock::now();
+
+				if (frame < SOFTWARE_WARMUP_FRAMES) continue;
+
+				frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+				vertexMs += rasterizer.getStats().vertexMs;
+				binningMs += rasterizer.getStats().binningMs;
+				rasterMs += rasterizer.getStats().rasterMs;
+			}
+
+			FrameTimeSummary summary = summarize(frameMs);
+			if (threads == 1)
+			{
+				singleThreadMs = summary.mean;
+				singleThreadImage = rasterizer.getColorBuffer();
+			}
+
+			std::string resolutionName = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+			const Util::SoftwareRasterStats& stats = rasterizer.getStats();
+
+			BenchmarkResult result;
+			result.name = "software/" + resolutionName + "/t" + std::to_string(threads);
+			result.addInfo("parallax_method", std::to_string(params.parallaxMethod));
+			result.addMetric("frames", config.softwareFrames);
+			result.addMetric("width", resolution.width);
+			result.addMetric("height", resolution.height);
+			result.addMetric("threads", threads);
+			result.addMetric("objects", params.objects);
+			result.addSummary("frame_ms", summary);
+			result.addMetric("vertex_ms_mean", vertexMs / config.softwareFrames);
+			result.addMetric("binning_ms_mean", binningMs / config.softwareFrames);
+			result.addMetric("raster_ms_mean", rasterMs / config.softwareFrames);
+			result.addMetric("speedup", singleThreadMs / summary.mean);
+			result.addMetric("efficiency", singleThreadMs / summary.mean / threads);
+			result.addMetric("triangles", stats.triangles);
+			result.addMetric("rasterized_triangles", stats.rasterizedTriangles);
+			result.addMetric("shaded_samples", double(stats.shadedSamples));
+			//Tiles are rasterized in a fixed order, so every thread count must produce the same image
+			result.addMetric("matches_single_thread", rasterizer.getColorBuffer() == singleThreadImage ? 1 : 0);
+			report.addResult(result);
+
+			if (config.imageDirectory && threads == threadCounts.back())
+			{
+				std::string path = std::string(config.imageDirectory) + "/software_" + resolutionName + ".ppm";
+				rasterizer.writePPM(path.c_str());
+			}
+		}
+	}
+}
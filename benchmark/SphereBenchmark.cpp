@@ -0,0 +1,143 @@
+/*
+* Created by Adam Gyenes
+* Triangle budget of every sphere generator against how far its triangles sag below the true surface
+*/
+
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <ew/procGen.h>
+
+#include <util/ProcGen.h>
+
+//Largest allowed distance between the mesh and the unit sphere
+static const double SPHERE_ERROR_TARGETS[] = { 1e-2, 1e-3, 1e-4 };
+constexpr int SPHERE_ERROR_TARGET_COUNT = sizeof(SPHERE_ERROR_TARGETS) / sizeof(SPHERE_ERROR_TARGETS[0]);
+//Resolution the sweep gives up at, far past what any generator needs for the smallest target
+constexpr int SPHERE_MAX_RESOLUTION = 1024;
+
+struct SphereGenerator
+{
+	const char* name;
+	int minResolution;
+	ew::MeshData (*create)(int resolution);
+};
+
+static const SphereGenerator SPHERE_GENERATORS[] = {
+	{ "uv_ew", 3, [](int resolution) { return ew::createSphere(1.f, resolution); } },
+	{ "uv_util", 3, [](int resolution) { return Util::createSphere(1.f, resolution); } },
+	{ "icosphere", 1, [](int resolution) { return Util::createIcosphere(1.f, resolution); } },
+	{ "cube_sphere", 1, [](int resolution) { return Util::createCubeSphere(1.f, resolution); } },
+};
+
+//Closest point of triangle abc to the origin, from Real-Time Collision Detection 5.1.5
+static ew::Vec3 closestToOrigin(const ew::Vec3& a, const ew::Vec3& b, const ew::Vec3& c)
+{
+	ew::Vec3 ab = b - a;
+	ew::Vec3 ac = c - a;
+	ew::Vec3 ap = a * -1.f;
+	float d1 = ew::Dot(ab, ap);
+	float d2 = ew::Dot(ac, ap);
+	if (d1 <= 0.f && d2 <= 0.f) return a;
+
+	ew::Vec3 bp = b * -1.f;
+	float d3 = ew::Dot(ab, bp);
+	float d4 = ew::Dot(ac, bp);
+	if (d3 >= 0.f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) return a + ab * (d1 / (d1 - d3));
+
+	ew::Vec3 cp = c * -1.f;
+	float d5 = ew::Dot(ab, cp);
+	float d6 = ew::Dot(ac, cp);
+	if (d6 >= 0.f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	float denominator = 1.f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+struct SphereMeasurement
+{
+	//Deepest point of any triangle below the unit sphere
+	double maxError = 0.0;
+	int degenerateTriangles = 0;
+	//Smallest over largest triangle area, 1 for perfectly even density
+	double areaRatio = 0.0;
+};
+
+static SphereMeasurement measure(const ew::MeshData& mesh)
+{
+	SphereMeasurement result;
+	double minArea = INFINITY;
+	double maxArea = 0.0;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const ew::Vec3& a = mesh.vertices[mesh.indices[i]].pos;
+		const ew::Vec3& b = mesh.vertices[mesh.indices[i + 1]].pos;
+		const ew::Vec3& c = mesh.vertices[mesh.indices[i + 2]].pos;
+
+		double area = 0.5 * ew::Magnitude(ew::Cross(b - a, c - a));
+		if (area < 1e-12)
+		{
+			result.degenerateTriangles++;
+			continue;
+		}
+		minArea = std::min(minArea, area);
+		maxArea = std::max(maxArea, area);
+		result.maxError = std::max(result.maxError, 1.0 - ew::Magnitude(closestToOrigin(a, b, c)));
+	}
+	result.areaRatio = maxArea > 0.0 ? minArea / maxArea : 0.0;
+	return result;
+}
+
+void Bench::runSphereSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	for (const SphereGenerator& generator : SPHERE_GENERATORS)
+	{
+		BenchmarkResult result;
+		result.name = std::string("spheres/") + generator.name;
+
+		//Error only shrinks with resolution, so one sweep finds the cheapest mesh for every target in turn
+		int target = 0;
+		int degenerateTriangles = 0;
+		for (int resolution = generator.minResolution; resolution <= SPHERE_MAX_RESOLUTION && target < SPHERE_ERROR_TARGET_COUNT; resolution++)
+		{
+			ew::MeshData mesh = generator.create(resolution);
+			SphereMeasurement measurement = measure(mesh);
+			degenerateTriangles = std::max(degenerateTriangles, measurement.degenerateTriangles);
+
+			for (; target < SPHERE_ERROR_TARGET_COUNT && measurement.maxError <= SPHERE_ERROR_TARGETS[target]; target++)
+			{
+				char suffix[32];
+				snprintf(suffix, sizeof(suffix), "_at_error_%g", SPHERE_ERROR_TARGETS[target]);
+				result.addMetric(std::string("resolution") + suffix, resolution);
+				result.addMetric(std::string("triangles") + suffix, double(mesh.indices.size() / 3));
+				result.addMetric(std::string("vertices") + suffix, double(mesh.vertices.size()));
+				result.addMetric(std::string("max_error") + suffix, measurement.maxError);
+				result.addMetric(std::string("area_ratio") + suffix, measurement.areaRatio);
+
+				auto start = std::chrono::steady_clock::now();
+				ew::MeshData timed = generator.create(resolution);
+				auto end = std::chrono::steady_clock::now();
+				result.addMetric(std::string("build_ms") + suffix, std::chrono::duration<double, std::milli>(end - start).count());
+			}
+		}
+
+		if (target < SPHERE_ERROR_TARGET_COUNT) report.addFailure(result.name + ": never got within " + std::to_string(SPHERE_ERROR_TARGETS[target]) + " of the sphere");
+		result.addMetric("degenerate_triangles_max", degenerateTriangles);
+		report.addResult(result);
+	}
+}
@@ -0,0 +1,266 @@
+/*
+* Created by Adam Gyenes
+* Streams animated vertices every frame through an orphaned buffer, a plain glBufferSubData and the Util::FrameSync ring
+*/
+
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ew/camera.h>
+#include <ew/shader.h>
+#include <ew/transform.h>
+
+#include <util/FrameSync.h>
+#include <util/GpuResources.h>
+#include <util/Profiler.h>
+
+//Vertices per patch side, every object is one patch regenerated each frame
+constexpr int STREAM_GRID = 33;
+constexpr int STREAM_PATCH_VERTICES = STREAM_GRID * STREAM_GRID;
+
+//Same attributes as Util::Mesh, so the scene's lit shader draws it
+struct StreamVertex
+{
+	ew::Vec3 pos;
+	ew::Vec3 normal;
+	ew::Vec3 tangent;
+	ew::Vec3 bitangent;
+	ew::Vec2 uv;
+};
+
+enum class StreamMode
+{
+	//glBufferData(nullptr) every frame, the driver hands out fresh storage
+	ORPHAN,
+	//glBufferSubData into storage the GPU may still be reading, the driver has to sync or copy
+	SUB_DATA,
+	//Persistently mapped FrameSync ring, written in place
+	RING
+};
+
+//Unit patch on the XZ plane with a travelling wave
+static void generatePatch(StreamVertex* vertices, float time, float phase)
+{
+	const float amplitude = 0.15f;
+	const float frequency = 6.f;
+	for (int z = 0; z < STREAM_GRID; z++)
+	{
+		for (int x = 0; x < STREAM_GRID; x++)
+		{
+			float u = float(x) / (STREAM_GRID - 1);
+			float v = float(z) / (STREAM_GRID - 1);
+			float angle = (u + v) * frequency + time * 3.f + phase;
+			float slope = amplitude * frequency * cosf(angle);
+
+			StreamVertex& vertex = vertices[z * STREAM_GRID + x];
+			vertex.pos = ew::Vec3(u - 0.5f, amplitude * sinf(angle), v - 0.5f);
+			vertex.tangent = ew::Normalize(ew::Vec3(1.f, slope, 0.f));
+			vertex.bitangent = ew::Normalize(ew::Vec3(0.f, slope, 1.f));
+			vertex.normal = ew::Normalize(ew::Cross(vertex.bitangent, vertex.tangent));
+			vertex.uv = ew::Vec2(u, v);
+		}
+	}
+}
+
+static std::vector<GLuint> createPatchIndices()
+{
+	std::vector<GLuint> indices;
+	indices.reserve((STREAM_GRID - 1) * (STREAM_GRID - 1) * 6);
+	for (int z = 0; z < STREAM_GRID - 1; z++)
+	{
+		for (int x = 0; x < STREAM_GRID - 1; x++)
+		{
+			GLuint start = z * STREAM_GRID + x;
+			indices.push_back(start);
+			indices.push_back(start + STREAM_GRID);
+			indices.push_back(start + 1);
+			indices.push_back(start + 1);
+			indices.push_back(start + STREAM_GRID);
+			indices.push_back(start + STREAM_GRID + 1);
+		}
+	}
+	return indices;
+}
+
+//Attributes at offset 0 of whatever buffer, patches are selected with the base vertex
+static Util::GpuResource createVertexArray(GLuint vertexBuffer, GLuint indexBuffer)
+{
+	Util::GpuResource vao = Util::GpuResource::create(Util::GpuResourceType::VERTEX_ARRAY, "streaming");
+	glBindVertexArray(vao.get());
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StreamVertex), reinterpret_cast<void*>(offsetof(StreamVertex, pos)));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(StreamVertex), reinterpret_cast<void*>(offsetof(StreamVertex, normal)));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(StreamVertex), reinterpret_cast<void*>(offsetof(StreamVertex, tangent)));
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(StreamVertex), reinterpret_cast<void*>(offsetof(StreamVertex, bitangent)));
+	glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(StreamVertex), reinterpret_cast<void*>(offsetof(StreamVertex, uv)));
+	for (int i = 0; i <= 4; i++) glEnableVertexAttribArray(i);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return vao;
+}
+
+static Bench::BenchmarkResult runStreaming(const char* name, StreamMode mode, int framesInFlight, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context)
+{
+	int objects = config.objects > 0 ? config.objects : 1;
+	GLsizeiptr patchBytes = sizeof(StreamVertex) * STREAM_PATCH_VERTICES;
+	GLsizeiptr frameBytes = patchBytes * objects;
+
+	ew::Shader shader("assets/benchmark/defaultLit.vert", "assets/benchmark/defaultLit.frag");
+
+	std::vector<GLuint> indices = createPatchIndices();
+	Util::GpuResource indexBuffer = Util::GpuResource::create(Util::GpuResourceType::BUFFER, "streaming indices");
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	indexBuffer.setBytes(sizeof(GLuint) * indices.size());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	//Room for every patch plus the alignment padding in front of each
+	std::unique_ptr<Util::FrameSync> frameSync;
+	Util::GpuResource streamBuffer;
+	GLuint vertexBuffer = 0;
+	if (mode == StreamMode::RING)
+	{
+		frameSync.reset(new Util::FrameSync(framesInFlight, frameBytes + sizeof(StreamVertex) * objects));
+		vertexBuffer = frameSync->getBuffer();
+	}
+	else
+	{
+		streamBuffer = Util::GpuResource::create(Util::GpuResourceType::BUFFER, "streaming vertices");
+		streamBuffer.setBytes(size_t(frameBytes));
+		vertexBuffer = streamBuffer.get();
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, frameBytes, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	Util::GpuResource vao = createVertexArray(vertexBuffer, indexBuffer.get());
+	std::vector<StreamVertex> staging(size_t(STREAM_PATCH_VERTICES) * objects);
+
+	int columns = int(ceilf(sqrtf(float(objects))));
+	ew::Camera camera;
+	camera.aspectRatio = float(context->getWidth()) / context->getHeight();
+	camera.position = ew::Vec3(0.f, columns * 0.8f, columns * 0.9f);
+	camera.target = ew::Vec3(0.f);
+
+	glViewport(0, 0, context->getWidth(), context->getHeight());
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	shader.use();
+	shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
+	shader.setVec3("_cameraPosition", camera.position);
+	shader.setInt("_activeLights", 0);
+	shader.setFloat("_material.ambientK", 1.f);
+	shader.setVec3("_ambientColor", ew::Vec3(1.f));
+	shader.setInt("_parallaxMethod", 0);
+	shader.setInt("_discardOutOfBoundFrags", 0);
+
+	std::vector<double> frameMs;
+	frameMs.reserve(config.frames);
+	auto runStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < config.warmupFrames + config.frames; frame++)
+	{
+		if (frame == config.warmupFrames)
+		{
+			glFinish();
+			runStart = std::chrono::steady_clock::now();
+		}
+
+		Util::Profiler::get().beginFrame();
+		auto start = std::chrono::steady_clock::now();
+		float time = frame / 60.f;
+
+		if (frameSync) frameSync->beginFrame();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glBindVertexArray(vao.get());
+
+		if (mode != StreamMode::RING) glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		if (mode == StreamMode::ORPHAN) glBufferData(GL_ARRAY_BUFFER, frameBytes, nullptr, GL_STREAM_DRAW);
+
+		for (int i = 0; i < objects; i++)
+		{
+			GLint baseVertex = i * STREAM_PATCH_VERTICES;
+			if (mode == StreamMode::RING)
+			{
+				//Aligned to the vertex size, so the offset is a whole number of vertices
+				Util::TransientBuffer patch;
+				if (frameSync->isPersistent())
+				{
+					patch = frameSync->allocate(patchBytes, sizeof(StreamVertex));
+					generatePatch(static_cast<StreamVertex*>(patch.data), time, float(i));
+				}
+				else
+				{
+					StreamVertex* vertices = &staging[size_t(baseVertex)];
+					generatePatch(vertices, time, float(i));
+					patch = frameSync->upload(vertices, patchBytes, sizeof(StreamVertex));
+				}
+				baseVertex = GLint(patch.offset / GLintptr(sizeof(StreamVertex)));
+			}
+			else
+			{
+				StreamVertex* vertices = &staging[size_t(baseVertex)];
+				generatePatch(vertices, time, float(i));
+				glBufferSubData(GL_ARRAY_BUFFER, GLintptr(baseVertex) * sizeof(StreamVertex), patchBytes, vertices);
+			}
+
+			ew::Transform transform;
+			transform.position = ew::Vec3((i % columns) - columns * 0.5f, 0.f, (i / columns) - columns * 0.5f);
+			shader.setMat4("_Model", transform.getModelMatrix());
+			glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(indices.size()), GL_UNSIGNED_INT, nullptr, baseVertex);
+		}
+
+		if (frameSync) frameSync->endFrame();
+		//No swap chain, flush so the GPU starts on the frame like a swap would
+		glFlush();
+
+		auto end = std::chrono::steady_clock::now();
+		Util::Profiler::get().endFrame();
+
+		if (frame >= config.warmupFrames) frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	glFinish();
+	double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("streaming/") + name;
+	result.addMetric("frames", config.frames);
+	result.addMetric("objects", objects);
+	result.addMetric("bytes_per_frame", double(frameBytes));
+	result.addSummary("frame_ms", Bench::summarize(frameMs));
+	result.addMetric("fps", config.frames / runSeconds);
+	if (frameSync)
+	{
+		Util::FrameSyncStats stats = frameSync->getStats();
+		result.addInfo("persistent", frameSync->isPersistent() ? "true" : "false");
+		result.addMetric("frames_in_flight", framesInFlight);
+		//Over the last FRAME_SYNC_HISTORY frames
+		result.addMetric("stall_ms_mean", stats.stallMs);
+		result.addMetric("stall_ms_max", stats.maxStallMs);
+		result.addMetric("stalled_frame_ratio", stats.stalledFrameRatio);
+		result.addMetric("fence_waits", double(stats.fenceWaits));
+		result.addMetric("fence_hits", double(stats.fenceHits));
+		result.addMetric("overflows", double(stats.overflows));
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return result;
+}
+
+void Bench::runStreamingSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	report.addResult(runStreaming("orphan", StreamMode::ORPHAN, 0, config, context));
+	report.addResult(runStreaming("sub_data", StreamMode::SUB_DATA, 0, config, context));
+	for (int framesInFlight = 1; framesInFlight <= 3; framesInFlight++)
+	{
+		report.addResult(runStreaming(("ring" + std::to_string(framesInFlight)).c_str(), StreamMode::RING, framesInFlight, config, context));
+	}
+}
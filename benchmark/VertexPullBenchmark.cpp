@@ -0,0 +1,143 @@
+/*
+* Created by Adam Gyenes
+* Attribute fetch through shared vertex arrays against vertex pulling from one Util::VertexPool, same scene and shading
+*/
+
+#include "Benchmarks.h"
+#include "Scene.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ew/shader.h>
+
+#include <util/GLStateCache.h>
+#include <util/Mesh.h>
+#include <util/VertexPool.h>
+
+//Round shapes this finely tessellated leave the cheap fragment shader with little to do, vertex work dominates
+constexpr int VERTEX_PULL_SEGMENTS = 128;
+
+static Bench::BenchmarkResult runVertexPath(const char* name, bool pulled, const Bench::BenchmarkConfig& config, Bench::OffscreenContext* context, Bench::Report& report, std::vector<unsigned char>& lastFrame)
+{
+	Bench::SceneParams params;
+	params.objects = config.objects;
+	params.segments = VERTEX_PULL_SEGMENTS;
+	Bench::SceneLayout layout(params);
+	std::vector<ew::MeshData> meshData = layout.createMeshes();
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (const ew::MeshData& mesh : meshData)
+	{
+		vertexCount += mesh.vertices.size();
+		indexCount += mesh.indices.size();
+	}
+
+	std::vector<Util::Mesh> meshes;
+	std::unique_ptr<Util::VertexPool> pool;
+	std::vector<Util::PooledMesh> pooledMeshes;
+	if (pulled)
+	{
+		pool.reset(new Util::VertexPool(GLsizei(vertexCount), GLsizei(indexCount)));
+		for (const ew::MeshData& mesh : meshData) pooledMeshes.push_back(pool->add(mesh));
+	}
+	else
+	{
+		meshes.reserve(meshData.size());
+		for (const ew::MeshData& mesh : meshData) meshes.emplace_back(mesh);
+	}
+
+	ew::Shader shader(pulled ? "assets/benchmark/defaultLitPulled.vert" : "assets/benchmark/defaultLit.vert", "assets/benchmark/surface.frag");
+	GLint modelLocation = glGetUniformLocation(shader.getId(), "_Model");
+	Util::GLStateCache stateCache;
+
+	int width = context->getWidth();
+	int height = context->getHeight();
+
+	double indicesPerFrame = 0.0;
+	Bench::TimedFrames timed = Bench::runTimedFrames(config, [&](int frame)
+		{
+			layout.animate(frame);
+			ew::Camera camera = layout.getCamera();
+			camera.aspectRatio = float(width) / height;
+
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_BACK);
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			stateCache.resetStats();
+			stateCache.useProgram(shader.getId());
+			shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
+			//Bound once, every mesh in the pool draws from the same buffers
+			if (pulled) pool->bind(stateCache);
+
+			indicesPerFrame = 0.0;
+			for (const Bench::SceneLayout::Object& object : layout.getObjects())
+			{
+				ew::Mat4 model = object.transform.getModelMatrix();
+				glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
+				if (pulled)
+				{
+					const Util::PooledMesh& mesh = pooledMeshes[object.mesh];
+					pool->draw(mesh);
+					indicesPerFrame += mesh.indexCount;
+				}
+				else
+				{
+					const Util::Mesh& mesh = meshes[object.mesh];
+					stateCache.bindVertexBindings(mesh.getVertexBindings());
+					glDrawElements(GL_TRIANGLES, mesh.getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					indicesPerFrame += mesh.getIndexCount();
+				}
+			}
+		});
+
+	Bench::readFrame(context, lastFrame);
+
+	Bench::FrameTimeSummary frameSummary = Bench::summarize(timed.cpuMs);
+	const Util::GLStateStats& binds = stateCache.getStats();
+	//Attribute path: the vertex plus its (tangent, bitangent) stream
+	double bytesPerVertex = pulled ? sizeof(Util::PackedVertex) : sizeof(ew::Vertex) + sizeof(Util::Mesh::TBArray::value_type);
+
+	Bench::BenchmarkResult result;
+	result.name = std::string("vertexpull/") + name;
+	result.addMetric("frames", config.frames);
+	result.addMetric("width", width);
+	result.addMetric("height", height);
+	result.addMetric("objects", params.objects);
+	result.addMetric("segments", params.segments);
+	result.addSummary("frame_ms", frameSummary);
+	result.addSummary("gpu_ms", Bench::summarize(timed.gpuMs));
+	result.addMetric("indices_per_frame", indicesPerFrame);
+	//Vertex shader invocations are at most one per index. Frame time includes the glFinish, software drivers report
+	//next to nothing through timer queries
+	result.addMetric("mindices_per_s", frameSummary.mean > 0.0 ? indicesPerFrame / frameSummary.mean / 1000.0 : 0.0);
+	result.addMetric("bytes_per_vertex", bytesPerVertex);
+	result.addMetric("vertex_bytes", bytesPerVertex * double(vertexCount));
+	result.addMetric("binds_issued", binds.getIssued());
+	result.addMetric("vertex_buffer_binds", binds.issued[int(Util::BindType::VERTEX_BUFFER)]);
+	Bench::addAllocationMetrics(timed.allocations, timed.bytes, config, result, report);
+	return result;
+}
+
+void Bench::runVertexPullSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	if (!Util::VertexPool::isSupported())
+	{
+		report.addInfo("vertexpull", "skipped, vertex pulling needs GL 4.5");
+		return;
+	}
+
+	std::vector<unsigned char> attributeFrame;
+	std::vector<unsigned char> pulledFrame;
+	report.addResult(runVertexPath("attributes", false, config, context, report, attributeFrame));
+	BenchmarkResult pulled = runVertexPath("pulled", true, config, context, report, pulledFrame);
+
+	//Packing quantizes normals, tangents and UVs, the frames should still only differ by rounding
+	pulled.addMetric("mean_abs_pixel_difference", compareFrames(pulledFrame, attributeFrame).meanAbs);
+	report.addResult(pulled);
+}
@@ -0,0 +1,133 @@
+/*
+* Created by Adam Gyenes
+* Util::weldVertices: how many duplicates each generator leaves behind, and the hash grid's speed on triangle soup
+* from 1 to N threads
+*/
+
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ew/procGen.h>
+
+#include <util/JobSystem.h>
+#include <util/MeshWeld.h>
+#include <util/ProcGen.h>
+
+constexpr int WELD_BENCH_SEGMENTS = 64;
+//Soup of a 20 * 128^2 triangle icosphere, one vertex per corner like an unindexed import: about a million vertices
+constexpr int WELD_BENCH_SOUP_SUBDIVISIONS = 128;
+//Noise added to the soup's positions, below the tolerance so welding has to look across cell edges to undo it
+constexpr float WELD_BENCH_JITTER = 2e-6f;
+constexpr int WELD_BENCH_RUNS = 5;
+
+struct WeldMesh
+{
+	const char* name;
+	ew::MeshData (*create)();
+};
+
+static const WeldMesh WELD_MESHES[] = {
+	{ "ew_sphere", []() { return ew::createSphere(1.f, WELD_BENCH_SEGMENTS); } },
+	{ "ew_cylinder", []() { return ew::createCylinder(0.5f, 1.f, WELD_BENCH_SEGMENTS); } },
+	{ "ew_cube", []() { return ew::createCube(1.f); } },
+	{ "ew_plane", []() { return ew::createPlane(1.f, 1.f, WELD_BENCH_SEGMENTS); } },
+	{ "util_sphere", []() { return Util::createSphere(1.f, WELD_BENCH_SEGMENTS); } },
+	{ "util_cylinder", []() { return Util::createCylidner(1.f, 0.5f, WELD_BENCH_SEGMENTS); } },
+	{ "util_torus", []() { return Util::createTorus(0.25f, 0.5f, WELD_BENCH_SEGMENTS, WELD_BENCH_SEGMENTS); } },
+};
+
+static ew::MeshData createSoup()
+{
+	ew::MeshData indexed = Util::createIcosphere(1.f, WELD_BENCH_SOUP_SUBDIVISIONS, false);
+	ew::MeshData soup;
+	soup.vertices.reserve(indexed.indices.size());
+	soup.indices.reserve(indexed.indices.size());
+
+	unsigned int seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / float(1 << 24) * 2.f - 1.f; };
+	for (unsigned int index : indexed.indices)
+	{
+		ew::Vertex vertex = indexed.vertices[index];
+		vertex.pos += ew::Vec3(random(), random(), random()) * WELD_BENCH_JITTER;
+		soup.indices.push_back(static_cast<unsigned int>(soup.vertices.size()));
+		soup.vertices.push_back(vertex);
+	}
+	return soup;
+}
+
+void Bench::runWeldSuite(const BenchmarkConfig& config, OffscreenContext* context, Report& report)
+{
+	//Defaults keep hard edges and UV seams, positions only is what a depth or shadow stream could share
+	Util::WeldTolerances positionsOnly;
+	positionsOnly.normal = -1.f;
+	positionsOnly.uv = -1.f;
+
+	for (const WeldMesh& mesh : WELD_MESHES)
+	{
+		ew::MeshData data = mesh.create();
+		ew::MeshData welded = data;
+		Util::WeldStats stats = Util::weldVertices(welded);
+		ew::MeshData positions = data;
+		Util::WeldStats positionStats = Util::weldVertices(positions, positionsOnly);
+
+		BenchmarkResult result;
+		result.name = std::string("weld/") + mesh.name;
+		result.addMetric("vertices", stats.verticesBefore);
+		result.addMetric("vertices_welded", stats.verticesAfter);
+		result.addMetric("vertices_welded_positions_only", positionStats.verticesAfter);
+		result.addMetric("vertex_reduction", 1.0 - double(stats.verticesAfter) / stats.verticesBefore);
+		report.addResult(result);
+	}
+
+	int maxThreads = config.maxThreads > 0 ? config.maxThreads : int(std::thread::hardware_concurrency());
+	if (maxThreads < 1) maxThreads = 1;
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	const ew::MeshData soup = createSoup();
+	int expectedVertices = int(Util::createIcosphere(1.f, WELD_BENCH_SOUP_SUBDIVISIONS, false).vertices.size());
+	//The welded icosphere has smooth normals and no UV seams, so the default tolerances give all of it back
+	Util::WeldTolerances tolerances;
+	double singleThreadMs = 0.0;
+	for (int threads : threadCounts)
+	{
+		Util::JobSystem jobs(threads);
+
+		std::vector<double> runMs;
+		Util::WeldStats stats;
+		for (int run = 0; run <= WELD_BENCH_RUNS; run++)
+		{
+			ew::MeshData mesh = soup;
+			auto start = std::chrono::steady_clock::now();
+			stats = Util::weldVertices(mesh, tolerances, &jobs);
+			auto end = std::chrono::steady_clock::now();
+
+			if (run > 0) runMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		FrameTimeSummary summary = summarize(runMs);
+		if (threads == 1) singleThreadMs = summary.mean;
+
+		BenchmarkResult result;
+		result.name = "weld/soup/t" + std::to_string(threads);
+		result.addMetric("runs", WELD_BENCH_RUNS);
+		result.addMetric("threads", threads);
+		result.addMetric("vertices", stats.verticesBefore);
+		result.addMetric("vertices_welded", stats.verticesAfter);
+		result.addMetric("buckets", stats.buckets);
+		result.addMetric("chain_breaks", stats.chainBreaks);
+		result.addSummary("run_ms", summary);
+		result.addMetric("mvertices_per_s", stats.verticesBefore / summary.mean / 1000.0);
+		result.addMetric("speedup", singleThreadMs / summary.mean);
+		if (stats.verticesAfter != expectedVertices)
+		{
+			report.addFailure(result.name + ": welded to " + std::to_string(stats.verticesAfter) + " vertices, the icosphere has " + std::to_string(expectedVertices));
+		}
+		report.addResult(result);
+	}
+}
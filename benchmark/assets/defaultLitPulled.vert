@@ -0,0 +1,72 @@
+/*
+* Created by Adam Gyenes
+* defaultLit.vert fetching its vertex from a Util::VertexPool instead of attributes
+*/
+
+#version 450
+
+//Util::PackedVertex, 24 bytes with std430
+struct PackedVertex
+{
+	float px, py, pz;
+	uint normal;
+	uint tangent;
+	uint uv;
+};
+
+//VERTEX_POOL_STORAGE_BINDING
+layout(std430, binding = 0) readonly buffer Vertices
+{
+	PackedVertex _vertices[];
+};
+
+out Surface
+{
+	vec3 position;
+	vec3 normal;
+	vec3 tangent;
+	vec3 bitangent;
+	vec2 UV;
+	mat3 tbn;
+} vs_out;
+
+uniform mat4 _Model;
+uniform mat4 _ViewProjection;
+
+invariant gl_Position;
+
+vec3 decodeOctahedral(uint encoded)
+{
+	vec2 e = unpackSnorm2x16(encoded);
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+	{
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(v);
+}
+
+void main()
+{
+	//gl_VertexID already includes the draw's base vertex
+	PackedVertex vertex = _vertices[gl_VertexID];
+	vec3 vPos = vec3(vertex.px, vertex.py, vertex.pz);
+	vec3 vNormal = decodeOctahedral(vertex.normal);
+	vec3 vTangent = decodeOctahedral(vertex.tangent);
+	vec3 vBitangent = normalize(cross(vNormal, vTangent));
+	vec2 vUV = unpackHalf2x16(vertex.uv);
+
+	vec3 t = normalize(mat3(_Model) * vTangent);
+	vec3 b = normalize(mat3(_Model) * vBitangent);
+	vec3 n = normalize(mat3(_Model) * vNormal);
+	mat3 tbn = transpose(mat3(t, b, n));
+
+	vs_out.position = mat3(_Model) * vPos;
+	vs_out.normal = n;
+	vs_out.tangent = t;
+	vs_out.bitangent = b;
+	vs_out.UV = vUV;
+	vs_out.tbn = tbn;
+
+	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+}
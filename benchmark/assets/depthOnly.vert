@@ -0,0 +1,18 @@
+/*
+* Created by Adam Gyenes
+* Position-only depth pre-pass, must transform exactly like defaultLit.vert
+*/
+
+#version 450
+
+layout(location = 0) in vec3 vPos;
+
+uniform mat4 _Model;
+uniform mat4 _ViewProjection;
+
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+}
@@ -0,0 +1,80 @@
+#version 450
+//Util::ProceduralRenderer drawn as GL_PATCHES: one quad patch per cell of the shape's coarse grid. Corners only,
+//proceduralPatch.tese builds the actual surface
+
+//Util::ProceduralShape
+const int PLANE = 0;
+const int CYLINDER = 1;
+const int SPHERE = 2;
+const int TORUS = 3;
+
+const float PI = 3.14159265359;
+const float TAU = 6.28318530718;
+
+struct Instance
+{
+	mat4 model;
+	vec4 size;
+};
+
+//PROCEDURAL_INSTANCE_STORAGE_BINDING
+layout(std430, binding = 1) readonly buffer Instances
+{
+	Instance _Instances[];
+};
+
+uniform int _Shape;
+uniform ivec2 _Segments;
+uniform int _FirstInstance;
+
+out Patch
+{
+	//Grid coordinate of the corner, the tessellator interpolates between them
+	vec2 grid;
+	//World space, for the tessellation control shader's edge lengths
+	vec3 worldPosition;
+	flat int instance;
+} vs_out;
+
+//Patch corners in the order the quad domain expects: (0,0) (1,0) (1,1) (0,1)
+const vec2 PATCH_CORNERS[4] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+//Same surface as proceduralPatch.tese, position only
+vec3 evaluatePosition(vec2 grid, vec4 size)
+{
+	vec2 t = grid / vec2(_Segments);
+	if (_Shape == PLANE)
+	{
+		return vec3(size.xy * t, 0.0);
+	}
+	if (_Shape == SPHERE)
+	{
+		float yaw = t.x * TAU;
+		float pitch = t.y * PI;
+		return vec3(sin(pitch) * sin(yaw), -cos(pitch), sin(pitch) * cos(yaw)) * size.x;
+	}
+	if (_Shape == TORUS)
+	{
+		float outerAngle = t.x * TAU;
+		float innerAngle = t.y * TAU;
+		vec3 ring = vec3(cos(outerAngle), sin(outerAngle), 0.0);
+		return ring * (size.y + cos(innerAngle) * size.x) + vec3(0.0, 0.0, sin(innerAngle) * size.x);
+	}
+	//Cylinder rows: top cap center to rim, side top to bottom, bottom cap rim to center
+	float angle = t.x * TAU;
+	vec2 ring = vec2(cos(angle), sin(angle)) * size.y;
+	float band = clamp(grid.y, 0.0, 3.0);
+	if (band <= 1.0) return vec3(ring.x * band, size.x * 0.5, ring.y * band);
+	if (band <= 2.0) return vec3(ring.x, size.x * (1.5 - band), ring.y);
+	return vec3(ring.x * (3.0 - band), -size.x * 0.5, ring.y * (3.0 - band));
+}
+
+void main(){
+	int instance = _FirstInstance + gl_InstanceID;
+	int cell = gl_VertexID / 4;
+	vec2 grid = vec2(cell % _Segments.x, cell / _Segments.x) + PATCH_CORNERS[gl_VertexID % 4];
+
+	vs_out.grid = grid;
+	vs_out.worldPosition = (_Instances[instance].model * vec4(evaluatePosition(grid, _Instances[instance].size), 1.0)).xyz;
+	vs_out.instance = instance;
+}
@@ -0,0 +1,12 @@
+#version 450
+//Normal and UV as color, enough to tell two ways of generating the same shape apart
+
+in vec3 Normal;
+in vec2 UV;
+
+out vec4 FragColor;
+
+void main(){
+	vec3 normal = normalize(Normal);
+	FragColor = vec4(abs(normal) * 0.75 + vec3(fract(UV), 0.0) * 0.25, 1.0);
+}
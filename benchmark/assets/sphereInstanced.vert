@@ -0,0 +1,33 @@
+#version 450
+//Sphere mesh drawn for each instance of the buffer Util::SphereImpostorRenderer reads, the mesh path the impostors
+//are measured against. The mesh is a unit sphere, scaled by the instance's radius
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+
+//Util::SphereImpostor
+struct Sphere
+{
+	vec4 centerRadius;
+	vec4 color;
+};
+
+//SPHERE_IMPOSTOR_STORAGE_BINDING
+layout(std430, binding = 2) readonly buffer Spheres
+{
+	Sphere _Spheres[];
+};
+
+uniform mat4 _ViewProjection;
+//One draw per sphere picks its instance here, gl_InstanceID doesn't include a base instance before GL 4.6
+uniform int _FirstInstance;
+
+out vec3 Normal;
+flat out vec3 Color;
+
+void main()
+{
+	Sphere sphere = _Spheres[_FirstInstance + gl_InstanceID];
+	Normal = vNormal;
+	Color = sphere.color.rgb;
+	gl_Position = _ViewProjection * vec4(sphere.centerRadius.xyz + vPos * sphere.centerRadius.w, 1.0);
+}
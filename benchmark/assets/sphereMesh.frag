@@ -0,0 +1,17 @@
+#version 450
+//Same shading as sphereImpostor.frag from the interpolated mesh normal
+
+in vec3 Normal;
+flat in vec3 Color;
+
+uniform int _Lit;
+uniform vec3 _LightDirection;
+
+out vec4 FragColor;
+
+void main()
+{
+	vec3 normal = normalize(Normal);
+	float light = _Lit != 0 ? 0.3 + 0.7 * max(dot(normal, -normalize(_LightDirection)), 0.0) : 1.0;
+	FragColor = vec4(Color * light, 1.0);
+}
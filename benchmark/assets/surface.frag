@@ -0,0 +1,27 @@
+/*
+* Created by Adam Gyenes
+* Cheapest shading that still reads every output of defaultLit.vert, so vertex work dominates the frame
+*/
+
+#version 450
+
+in Surface
+{
+	vec3 position;
+	vec3 normal;
+	vec3 tangent;
+	vec3 bitangent;
+	vec2 UV;
+	mat3 tbn;
+} fs_in;
+
+out vec4 FragColor;
+
+void main()
+{
+	vec3 tangentNormal = fs_in.tbn * normalize(fs_in.normal);
+	float checker = mod(floor(fs_in.UV.x * 8.0) + floor(fs_in.UV.y * 8.0), 2.0);
+	vec3 color = normalize(fs_in.normal) * 0.5 + 0.5;
+	color += (fs_in.tangent + fs_in.bitangent + tangentNormal) * 0.05 + fs_in.position * 0.01;
+	FragColor = vec4(color * (0.75 + 0.25 * checker), 1.0);
+}
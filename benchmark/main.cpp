@@ -0,0 +1,171 @@
+/*
+* Created by Adam Gyenes
+* Headless benchmark runner, writes a JSON report for regression tracking
+*
+* Usage: benchmark [--suite name]... [--frames N] [--warmup N] [--width W] [--height H]
+*                  [--objects N] [--software-frames N] [--threads N] [--images dir]
+*                  [--simulation-ms N] [--allow-allocations] [--out report.json] [--list]
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "Benchmarks.h"
+
+#include <util/GpuResources.h>
+#include <util/VertexFormat.h>
+
+static const Bench::Suite SUITES[] = {
+	{ "scene", "Synthetic lit/parallax scene: state sorted, front-to-back and depth pre-pass", true, Bench::runSceneSuite },
+	{ "software", "Same scene on the CPU rasterizer at several resolutions and thread counts", false, Bench::runSoftwareSuite },
+	{ "jobs", "Job system scaling on mesh generation, transform updates, culling and empty jobs", false, Bench::runJobSuite },
+	{ "streaming", "Per-frame vertex streaming: orphaning, glBufferSubData and the fenced ring at 1-3 frames in flight", true, Bench::runStreamingSuite },
+	{ "meshgen", "Bulk mesh and tangent generation on the default heap vs monotonic, pool and frame arena resources", false, Bench::runMeshGenSuite },
+	{ "pipeline", "Scene on a render thread at each frame pipeline depth: throughput vs input latency", true, Bench::runPipelineSuite },
+	{ "vertexpull", "Attribute fetch from shared vertex arrays vs vertex pulling packed vertices from one storage buffer", true, Bench::runVertexPullSuite },
+	{ "procedural", "Shapes changing resolution every frame: CPU regeneration and upload vs generation in the vertex shader", true, Bench::runProceduralSuite },
+	{ "spheres", "UV, icosphere and cube-sphere generators: triangles and vertices needed for each maximum geometric error", false, Bench::runSphereSuite },
+	{ "weld", "Util::weldVertices: duplicates left by each generator, and hash grid welding of triangle soup from 1 to N threads", false, Bench::runWeldSuite },
+	{ "meshlets", "Whole meshes vs meshlets frustum and normal cone culled on the CPU and drawn as multi-draw ranges", true, Bench::runMeshletSuite },
+	{ "occlusion", "CPU masked depth occlusion culling of a walled grid: share culled vs buffer cost per resolution and thread count", false, Bench::runOcclusionSuite },
+	{ "queries", "Renderer occlusion queries on a walled parallax grid: draw all vs skip on last frame's result vs conditional rendering", true, Bench::runOcclusionQuerySuite },
+	{ "impostors", "16k light gizmo spheres: mesh per draw and instanced vs ray cast sphere impostors vs a screen size LOD of both", true, Bench::runImpostorSuite },
+};
+
+//Peak GL memory per resource type while a suite ran, and what it left behind
+static Bench::BenchmarkResult getGpuResourceResult(const char* suite, const Util::GpuResourceStats& before, const Util::GpuResourceStats& after, Bench::Report& report)
+{
+	Bench::BenchmarkResult result;
+	result.name = std::string(suite) + "/gpu_resources";
+	size_t peakBytes = 0;
+	for (int i = 0; i < int(Util::GpuResourceType::COUNT); i++)
+	{
+		std::string type = Util::getGpuResourceTypeName(Util::GpuResourceType(i));
+		for (char& c : type) c = c == ' ' ? '_' : char(tolower(c));
+		result.addMetric("peak_bytes_" + type, double(after.peakBytes[i]));
+		peakBytes += after.peakBytes[i];
+	}
+	result.addMetric("peak_bytes_total", double(peakBytes));
+	result.addMetric("created", double(after.created - before.created));
+	result.addMetric("deleted", double(after.deleted - before.deleted));
+
+	int leakedObjects = after.getCount() - before.getCount();
+	double leakedBytes = double(after.getBytes()) - double(before.getBytes());
+	result.addMetric("leaked_objects", leakedObjects);
+	result.addMetric("leaked_bytes", leakedBytes);
+	if (leakedObjects > 0)
+	{
+		report.addFailure(std::string(suite) + " leaked " + std::to_string(leakedObjects) + " GL objects (" + std::to_string(int64_t(leakedBytes)) + " bytes)");
+		Util::GpuResourceRegistry::get().printLive();
+	}
+	return result;
+}
+
+static void printUsage()
+{
+	printf("Usage: benchmark [--suite name]... [--frames N] [--warmup N] [--width W] [--height H] [--objects N]\n"
+		"                 [--software-frames N] [--threads N] [--images dir] [--simulation-ms N]\n"
+		"                 [--allow-allocations] [--out report.json] [--list]\n");
+}
+
+int main(int argc, char** argv)
+{
+	Bench::BenchmarkConfig config;
+	std::vector<std::string> suiteNames;
+	const char* outputPath = "benchmark_report.json";
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(arg, "--list"))
+		{
+			for (const Bench::Suite& suite : SUITES) printf("%-16s %s\n", suite.name, suite.description);
+			return 0;
+		}
+		else if (!strcmp(arg, "--suite") && hasValue) suiteNames.push_back(argv[++i]);
+		else if (!strcmp(arg, "--frames") && hasValue) config.frames = atoi(argv[++i]);
+		else if (!strcmp(arg, "--warmup") && hasValue) config.warmupFrames = atoi(argv[++i]);
+		else if (!strcmp(arg, "--width") && hasValue) config.width = atoi(argv[++i]);
+		else if (!strcmp(arg, "--height") && hasValue) config.height = atoi(argv[++i]);
+		else if (!strcmp(arg, "--objects") && hasValue) config.objects = atoi(argv[++i]);
+		else if (!strcmp(arg, "--software-frames") && hasValue) config.softwareFrames = atoi(argv[++i]);
+		else if (!strcmp(arg, "--threads") && hasValue) config.maxThreads = atoi(argv[++i]);
+		else if (!strcmp(arg, "--images") && hasValue) config.imageDirectory = argv[++i];
+		else if (!strcmp(arg, "--simulation-ms") && hasValue) config.simulationMs = atof(argv[++i]);
+		else if (!strcmp(arg, "--allow-allocations")) config.allowAllocations = true;
+		else if (!strcmp(arg, "--out") && hasValue) outputPath = argv[++i];
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (config.frames <= 0 || config.width <= 0 || config.height <= 0 || config.objects < 0 || config.softwareFrames <= 0 || config.maxThreads < 0 || config.simulationMs < 0.0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	//Run everything by default
+	std::vector<const Bench::Suite*> suites;
+	for (const Bench::Suite& suite : SUITES)
+	{
+		bool selected = suiteNames.empty();
+		for (const std::string& name : suiteNames) selected |= name == suite.name;
+		if (selected) suites.push_back(&suite);
+	}
+	if (suites.size() < suiteNames.size() || suites.empty())
+	{
+		printf("Unknown suite, use --list to see the available ones\n");
+		return 1;
+	}
+
+	Bench::Report report;
+	report.addInfo("frames", std::to_string(config.frames));
+	report.addInfo("resolution", std::to_string(config.width) + "x" + std::to_string(config.height));
+
+	Bench::OffscreenContext context;
+	bool contextCreated = false;
+	for (const Bench::Suite* suite : suites)
+	{
+		if (suite->needsGL && !contextCreated)
+		{
+			if (!context.create(config.width, config.height))
+			{
+				printf("Failed to create offscreen GL context\n");
+				return 1;
+			}
+			contextCreated = true;
+			report.addInfo("renderer", context.getRenderer());
+		}
+
+		printf("Running %s...\n", suite->name);
+		if (!suite->needsGL)
+		{
+			suite->run(config, nullptr, report);
+			continue;
+		}
+
+		Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+		registry.resetPeaks();
+		Util::GpuResourceStats before = registry.getStats();
+		suite->run(config, &context, report);
+		//The shared vertex arrays outlive the meshes, the next suite creates them again
+		Util::VertexFormatRegistry::get().clear();
+		//Everything a suite releases is gone after this, whatever is still live was leaked
+		registry.flush();
+		report.addResult(getGpuResourceResult(suite->name, before, registry.getStats(), report));
+	}
+
+	report.print();
+	if (!report.write(outputPath)) return 1;
+	printf("Wrote %s\n", outputPath);
+	return report.getFailures().empty() ? 0 : 1;
+}
@@ -5,22 +5,108 @@
 #include "mesh.h"
 #include "ewMath/ewMath.h"
 #include "external/glad.h"
+#include "../util/GpuResources.h"
+#include "../util/Profiler.h"
+#include "../util/VertexFormat.h"
 
 namespace ew {
 	Mesh::Mesh(const MeshData& meshData)
 	{
 		load(meshData);
 	}
+	Mesh::Mesh(Mesh&& other) noexcept
+		: m_vao(other.m_vao), m_ownsVao(other.m_ownsVao), m_vbo(other.m_vbo), m_ebo(other.m_ebo), m_numVertices(other.m_numVertices), m_numIndices(other.m_numIndices)
+	{
+		other.m_vao = 0;
+		other.m_ownsVao = false;
+		other.m_vbo = 0;
+		other.m_ebo = 0;
+	}
+	Mesh& Mesh::operator=(Mesh&& other) noexcept
+	{
+		if (this != &other) {
+			release();
+			m_vao = other.m_vao;
+			m_ownsVao = other.m_ownsVao;
+			m_vbo = other.m_vbo;
+			m_ebo = other.m_ebo;
+			m_numVertices = other.m_numVertices;
+			m_numIndices = other.m_numIndices;
+			other.m_vao = 0;
+			other.m_ownsVao = false;
+			other.m_vbo = 0;
+			other.m_ebo = 0;
+		}
+		return *this;
+	}
+	Mesh::~Mesh()
+	{
+		release();
+	}
+	//The registry deletes the objects once the GPU is done drawing them
+	void Mesh::release()
+	{
+		Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+		if (m_ownsVao) {
+			registry.release(registry.find(Util::GpuResourceType::VERTEX_ARRAY, m_vao));
+		}
+		registry.release(registry.find(Util::GpuResourceType::BUFFER, m_vbo));
+		registry.release(registry.find(Util::GpuResourceType::BUFFER, m_ebo));
+		m_vao = 0;
+		m_ownsVao = false;
+		m_vbo = 0;
+		m_ebo = 0;
+	}
+	static const Util::VertexFormat& getVertexFormat() {
+		//Position, normal and UV from one interleaved buffer in binding 0
+		static const Util::VertexFormat format = Util::VertexFormat()
+			.add(0, 3, GL_FLOAT, offsetof(Vertex, pos))
+			.add(1, 3, GL_FLOAT, offsetof(Vertex, normal))
+			.add(2, 2, GL_FLOAT, offsetof(Vertex, uv));
+		return format;
+	}
+	//GL 4.5 path: nothing is bound, the vertex array is shared with every other ew::Mesh and every load gets new
+	//immutable buffers. The old ones are deleted by the registry once the GPU is done drawing them
+	void Mesh::loadDirect(const MeshData& meshData)
+	{
+		release();
+		Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+		m_vao = Util::VertexFormatRegistry::get().getVertexArray(getVertexFormat());
+		if (meshData.vertices.size() > 0) {
+			GLsizeiptr vertexBytes = sizeof(Vertex) * meshData.vertices.size();
+			glCreateBuffers(1, &m_vbo);
+			glNamedBufferStorage(m_vbo, vertexBytes, meshData.vertices.data(), 0);
+			registry.setBytes(registry.add(Util::GpuResourceType::BUFFER, m_vbo, "ew::Mesh vertices"), vertexBytes);
+		}
+		if (meshData.indices.size() > 0) {
+			GLsizeiptr indexBytes = sizeof(unsigned int) * meshData.indices.size();
+			glCreateBuffers(1, &m_ebo);
+			glNamedBufferStorage(m_ebo, indexBytes, meshData.indices.data(), 0);
+			registry.setBytes(registry.add(Util::GpuResourceType::BUFFER, m_ebo, "ew::Mesh indices"), indexBytes);
+		}
+		m_numVertices = meshData.vertices.size();
+		m_numIndices = meshData.indices.size();
+	}
 	void Mesh::load(const MeshData& meshData)
 	{
-		if (!m_initialized) {
+		PROFILE_SCOPE("ew::Mesh::load");
+		if (Util::VertexFormatRegistry::isSupported()) {
+			loadDirect(meshData);
+			return;
+		}
+		Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+		if (!m_ownsVao) {
 			glGenVertexArrays(1, &m_vao);
+			registry.add(Util::GpuResourceType::VERTEX_ARRAY, m_vao, "ew::Mesh");
+			m_ownsVao = true;
 			glBindVertexArray(m_vao);
 
 			glGenBuffers(1, &m_vbo);
+			registry.add(Util::GpuResourceType::BUFFER, m_vbo, "ew::Mesh vertices");
 			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 
 			glGenBuffers(1, &m_ebo);
+			registry.add(Util::GpuResourceType::BUFFER, m_ebo, "ew::Mesh indices");
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 			//Position attribute
 			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
@@ -33,8 +119,6 @@ namespace ew {
 			//UV attribute
 			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
 			glEnableVertexAttribArray(2);
-
-			m_initialized = true;
 		}
 
 		glBindVertexArray(m_vao);
@@ -43,9 +127,11 @@ namespace ew {
 
 		if (meshData.vertices.size() > 0) {
 			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+			registry.setBytes(registry.find(Util::GpuResourceType::BUFFER, m_vbo), sizeof(Vertex) * meshData.vertices.size());
 		}
 		if (meshData.indices.size() > 0) {
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+			registry.setBytes(registry.find(Util::GpuResourceType::BUFFER, m_ebo), sizeof(unsigned int) * meshData.indices.size());
 		}
 		m_numVertices = meshData.vertices.size();
 		m_numIndices = meshData.indices.size();
@@ -56,7 +142,14 @@ namespace ew {
 	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
-		glBindVertexArray(m_vao);
+		//The shared vertex array only has the format, this mesh's buffers go in at draw time
+		Util::VertexBindings bindings;
+		bindings.vertexArray = m_vao;
+		if (!m_ownsVao) {
+			bindings.buffers[0] = Util::VertexBufferBinding{ m_vbo, 0, sizeof(Vertex) };
+			bindings.indexBuffer = m_ebo;
+		}
+		bindings.bind();
 		if (drawMode == DrawMode::TRIANGLES) {
 			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
 		}
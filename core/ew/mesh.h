@@ -3,6 +3,8 @@
 */
 
 #pragma once
+#include <memory_resource>
+#include <vector>
 #include "ewMath/ewMath.h"
 
 namespace ew {
@@ -12,9 +14,14 @@ namespace ew {
 		ew::Vec2 uv;
 	};
 
+	//Both arrays allocate from one memory resource, the default one unless given. Moves keep the resource,
+	//copies go to the default resource, so a copy can outlive a scratch arena the original lived in
 	struct MeshData {
-		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
+		MeshData() {};
+		explicit MeshData(std::pmr::memory_resource* resource) : vertices(resource), indices(resource) {};
+
+		std::pmr::vector<Vertex> vertices;
+		std::pmr::vector<unsigned int> indices;
 	};
 
 	enum class DrawMode {
@@ -22,17 +29,27 @@ namespace ew {
 		POINTS = 1
 	};
 
+	//Owns its GL objects, so it can be moved but not copied. Reassigning a mesh releases the old objects
 	class Mesh {
 	public:
 		Mesh() {};
 		Mesh(const MeshData& meshData);
+		Mesh(Mesh&& other) noexcept;
+		Mesh& operator=(Mesh&& other) noexcept;
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+		~Mesh();
 		void load(const MeshData& meshData);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
 	private:
-		bool m_initialized = false;
+		void loadDirect(const MeshData& meshData);
+		void release();
+		//Registered with Util::GpuResourceRegistry and released with the mesh. The vertex array is only the mesh's own
+		//without shared vertex formats
 		unsigned int m_vao = 0;
+		bool m_ownsVao = false;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
 		int m_numVertices = 0;
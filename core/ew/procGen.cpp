@@ -45,9 +45,9 @@ namespace ew {
 	/// Creates a cube of uniform size
 	/// </summary>
 	/// <param name="size">Total width, height, depth</param>
-	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
-	MeshData createCube(float size) {
-		MeshData mesh;
+	/// <param name="resource">Memory resource the mesh allocates from</param>
+	MeshData createCube(float size, std::pmr::memory_resource* resource) {
+		MeshData mesh(resource);
 		mesh.vertices.reserve(24); //6 x 4 vertices
 		mesh.indices.reserve(36); //6 x 6 indices
 		createCubeFace(ew::Vec3{ +0.0f,+0.0f,+1.0f }, size, &mesh); //Front
@@ -58,11 +58,13 @@ namespace ew {
 		createCubeFace(ew::Vec3{ +0.0f,+0.0f,-1.0f }, size, &mesh); //Back
 		return mesh;
 	}
-	MeshData createPlane(float width, float height, int subdivisions)
+	MeshData createPlane(float width, float height, int subdivisions, std::pmr::memory_resource* resource)
 	{
 		//VERTICES
-		MeshData mesh;
+		MeshData mesh(resource);
 		int columns = subdivisions + 1;
+		mesh.vertices.reserve(columns * columns);
+		mesh.indices.reserve(subdivisions * subdivisions * 6);
 		for (size_t row = 0; row <= subdivisions; row++)
 		{
 			for (size_t col = 0; col <= subdivisions; col++)
@@ -93,9 +95,12 @@ namespace ew {
 		}
 		return mesh;
 	}
-	MeshData createSphere(float radius, int subdivisions)
+	MeshData createSphere(float radius, int subdivisions, std::pmr::memory_resource* resource)
 	{
-		MeshData mesh;
+		MeshData mesh(resource);
+		//Both caps plus the rows of quads in between
+		mesh.vertices.reserve((subdivisions + 1) * (subdivisions + 1));
+		mesh.indices.reserve(subdivisions * 6 + (subdivisions > 2 ? (subdivisions - 2) * subdivisions * 6 : 0));
 		//VERTICES
 		float thetaStep = ew::TAU / subdivisions;
 		float phiStep = ew::PI / subdivisions;
@@ -173,9 +178,12 @@ namespace ew {
 			meshData->vertices.push_back(v);
 		}
 	}
-	MeshData createCylinder(float radius, float height, int subdivisions)
+	MeshData createCylinder(float radius, float height, int subdivisions, std::pmr::memory_resource* resource)
 	{
-		MeshData mesh;
+		MeshData mesh(resource);
+		//Two centers and four rings, a fan for each cap and a quad per side segment
+		mesh.vertices.reserve(2 + (subdivisions + 1) * 4);
+		mesh.indices.reserve(subdivisions * 12);
 
 		//VERTICES
 		{
@@ -204,16 +212,16 @@ namespace ew {
 		//INDICES
 		{
 			int columns = subdivisions + 1;
-			//Top cap
-			for (size_t i = 0; i < columns; i++)
+			//Top cap, ring starts after the center vertex
+			for (size_t i = 0; i < subdivisions; i++)
 			{
 				mesh.indices.push_back(0);
+				mesh.indices.push_back(i + 2);
 				mesh.indices.push_back(i + 1);
-				mesh.indices.push_back(i);
 			}
-			int sideStart = columns;
+			int sideStart = columns + 1;
 			//Sides
-			for (size_t i = 0; i < columns; i++)
+			for (size_t i = 0; i < subdivisions; i++)
 			{
 				int start = sideStart + i;
 				mesh.indices.push_back(start);
@@ -226,7 +234,7 @@ namespace ew {
 			//Bottom cap
 			int bottomIndex = mesh.vertices.size() - 1;
 			sideStart = bottomIndex - columns;
-			for (size_t i = 0; i < columns; i++)
+			for (size_t i = 0; i < subdivisions; i++)
 			{
 				mesh.indices.push_back(bottomIndex);
 				mesh.indices.push_back(sideStart + i);
@@ -7,8 +7,9 @@
 #include "mesh.h"
 
 namespace ew {
-	MeshData createCube(float size);
-	MeshData createPlane(float width, float height, int subdivisions);
-	MeshData createSphere(float radius, int subdivisions);
-	MeshData createCylinder(float radius, float height, int subdivisions);
+	//resource: where the mesh's arrays allocate from, e.g. a std::pmr::monotonic_buffer_resource for bulk generation
+	MeshData createCube(float size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	MeshData createPlane(float width, float height, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	MeshData createSphere(float radius, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	MeshData createCylinder(float radius, float height, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 }
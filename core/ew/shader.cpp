@@ -2,6 +2,8 @@
 #include <fstream>
 #include <sstream>
 #include "external/glad.h"
+#include "../util/GpuResources.h"
+#include "../util/Profiler.h"
 
 namespace ew {
 	/// <summary>
@@ -51,6 +53,7 @@ namespace ew {
 	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
 	/// <returns></returns>
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+		PROFILE_SCOPE("ew::createShaderProgram");
 		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
 		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
 
@@ -73,55 +76,163 @@ namespace ew {
 		return shaderProgram;
 	}
 	/// <summary>
+	/// Creates a shader program with vertex, tessellation control, tessellation evaluation and fragment shaders
+	/// </summary>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* tessControlShaderSource, const char* tessEvaluationShaderSource, const char* fragmentShaderSource) {
+		PROFILE_SCOPE("ew::createShaderProgram");
+		unsigned int shaders[4] = {
+			createShader(GL_VERTEX_SHADER, vertexShaderSource),
+			createShader(GL_TESS_CONTROL_SHADER, tessControlShaderSource),
+			createShader(GL_TESS_EVALUATION_SHADER, tessEvaluationShaderSource),
+			createShader(GL_FRAGMENT_SHADER, fragmentShaderSource)
+		};
+
+		unsigned int shaderProgram = glCreateProgram();
+		for (unsigned int shader : shaders) {
+			glAttachShader(shaderProgram, shader);
+		}
+		glLinkProgram(shaderProgram);
+		int success;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+		if (!success) {
+			char infoLog[512];
+			glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+			printf("Failed to link shader program: %s", infoLog);
+		}
+		for (unsigned int shader : shaders) {
+			glDeleteShader(shader);
+		}
+		return shaderProgram;
+	}
+	/// <summary>
 	/// Creates a shader instance with vertex + fragment stages
 	/// </summary>
 	/// <param name="vertexShader">File path to vertex shader</param>
 	/// <param name="fragmentShader">File path to fragment shader</param>
 	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader)
 	{
+		PROFILE_SCOPE("ew::Shader::Shader");
 		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
 		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
 		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		Util::GpuResourceRegistry::get().add(Util::GpuResourceType::PROGRAM, m_id, vertexShader.c_str());
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + tessellation + fragment stages
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="tessControlShader">File path to tessellation control shader</param>
+	/// <param name="tessEvaluationShader">File path to tessellation evaluation shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& tessControlShader, const std::string& tessEvaluationShader, const std::string& fragmentShader)
+	{
+		PROFILE_SCOPE("ew::Shader::Shader");
+		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
+		std::string tessControlShaderSource = ew::loadShaderSourceFromFile(tessControlShader.c_str());
+		std::string tessEvaluationShaderSource = ew::loadShaderSourceFromFile(tessEvaluationShader.c_str());
+		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), tessControlShaderSource.c_str(), tessEvaluationShaderSource.c_str(), fragmentShaderSource.c_str());
+		Util::GpuResourceRegistry::get().add(Util::GpuResourceType::PROGRAM, m_id, vertexShader.c_str());
+	}
+	Shader::Shader(Shader&& other) noexcept
+		: m_id(other.m_id)
+	{
+		other.m_id = 0;
+	}
+	Shader& Shader::operator=(Shader&& other) noexcept
+	{
+		if (this != &other) {
+			Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+			registry.release(registry.find(Util::GpuResourceType::PROGRAM, m_id));
+			m_id = other.m_id;
+			other.m_id = 0;
+		}
+		return *this;
+	}
+	/// <summary>
+	/// Releases the program, the registry deletes it once the GPU is done with it
+	/// </summary>
+	Shader::~Shader()
+	{
+		Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+		registry.release(registry.find(Util::GpuResourceType::PROGRAM, m_id));
 	}
 	void Shader::use()const
 	{
 		glUseProgram(m_id);
 	}
-	void Shader::setInt(const std::string& name, int v) const
+	void Shader::setInt(const char* name, int v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		int location = glGetUniformLocation(m_id, name);
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramUniform1i(m_id, location, v);
+		}
+		else {
+			glUniform1i(location, v);
+		}
 	}
-	void Shader::setFloat(const std::string& name, float v) const
+	void Shader::setFloat(const char* name, float v) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		int location = glGetUniformLocation(m_id, name);
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramUniform1f(m_id, location, v);
+		}
+		else {
+			glUniform1f(location, v);
+		}
 	}
-	void Shader::setVec2(const std::string& name, float x, float y) const
+	void Shader::setVec2(const char* name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		int location = glGetUniformLocation(m_id, name);
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramUniform2f(m_id, location, x, y);
+		}
+		else {
+			glUniform2f(location, x, y);
+		}
 	}
-	void Shader::setVec2(const std::string& name, const ew::Vec2& v) const
+	void Shader::setVec2(const char* name, const ew::Vec2& v) const
 	{
 		setVec2(name, v.x, v.y);
 	}
-	void Shader::setVec3(const std::string& name, float x, float y, float z) const
+	void Shader::setVec3(const char* name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		int location = glGetUniformLocation(m_id, name);
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramUniform3f(m_id, location, x, y, z);
+		}
+		else {
+			glUniform3f(location, x, y, z);
+		}
 	}
-	void Shader::setVec3(const std::string& name, const ew::Vec3& v) const
+	void Shader::setVec3(const char* name, const ew::Vec3& v) const
 	{
 		setVec3(name, v.x, v.y, v.z);
 	}
-	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
+	void Shader::setVec4(const char* name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		int location = glGetUniformLocation(m_id, name);
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramUniform4f(m_id, location, x, y, z, w);
+		}
+		else {
+			glUniform4f(location, x, y, z, w);
+		}
 	}
-	void Shader::setVec4(const std::string& name, const ew::Vec4& v) const
+	void Shader::setVec4(const char* name, const ew::Vec4& v) const
 	{
 		setVec4(name, v.x, v.y, v.z, v.w);
 	}
-	void Shader::setMat4(const std::string& name, const ew::Mat4& m) const
+	void Shader::setMat4(const char* name, const ew::Mat4& m) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &m[0][0]);
+		int location = glGetUniformLocation(m_id, name);
+		if (GLAD_GL_VERSION_4_1) {
+			glProgramUniformMatrix4fv(m_id, location, 1, GL_FALSE, &m[0][0]);
+		}
+		else {
+			glUniformMatrix4fv(location, 1, GL_FALSE, &m[0][0]);
+		}
 	}
 }
 
@@ -5,20 +5,41 @@
 namespace ew {
 	std::string loadShaderSourceFromFile(const std::string& filePath);
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* tessControlShaderSource, const char* tessEvaluationShaderSource, const char* fragmentShaderSource);
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		//Tessellated program, needs GL 4.0. Drawn with GL_PATCHES
+		Shader(const std::string& vertexShader, const std::string& tessControlShader, const std::string& tessEvaluationShader, const std::string& fragmentShader);
+		//Owns its program, so it can be moved but not copied
+		Shader(Shader&& other) noexcept;
+		Shader& operator=(Shader&& other) noexcept;
+		Shader(const Shader&) = delete;
+		Shader& operator=(const Shader&) = delete;
+		~Shader();
 		void use()const;
-		void setInt(const std::string& name, int v) const;
-		void setFloat(const std::string& name, float v) const;
-		void setVec2(const std::string& name, float x, float y) const;
-		void setVec2(const std::string& name, const ew::Vec2& v) const;
-		void setVec3(const std::string& name, float x, float y, float z) const;
-		void setVec3(const std::string& name, const ew::Vec3& v) const;
-		void setVec4(const std::string& name, float x, float y, float z, float w) const;
-		void setVec4(const std::string& name, const ew::Vec4& v) const;
-		void setMat4(const std::string& name, const ew::Mat4& m) const;
+		//Literal names go straight to GL, no std::string temporary is built. With GL 4.1 the values are set through
+		//glProgramUniform, so the shader doesn't have to be in use and the bound program is left alone
+		void setInt(const char* name, int v) const;
+		void setFloat(const char* name, float v) const;
+		void setVec2(const char* name, float x, float y) const;
+		void setVec2(const char* name, const ew::Vec2& v) const;
+		void setVec3(const char* name, float x, float y, float z) const;
+		void setVec3(const char* name, const ew::Vec3& v) const;
+		void setVec4(const char* name, float x, float y, float z, float w) const;
+		void setVec4(const char* name, const ew::Vec4& v) const;
+		void setMat4(const char* name, const ew::Mat4& m) const;
+		inline void setInt(const std::string& name, int v) const { setInt(name.c_str(), v); }
+		inline void setFloat(const std::string& name, float v) const { setFloat(name.c_str(), v); }
+		inline void setVec2(const std::string& name, float x, float y) const { setVec2(name.c_str(), x, y); }
+		inline void setVec2(const std::string& name, const ew::Vec2& v) const { setVec2(name.c_str(), v); }
+		inline void setVec3(const std::string& name, float x, float y, float z) const { setVec3(name.c_str(), x, y, z); }
+		inline void setVec3(const std::string& name, const ew::Vec3& v) const { setVec3(name.c_str(), v); }
+		inline void setVec4(const std::string& name, float x, float y, float z, float w) const { setVec4(name.c_str(), x, y, z, w); }
+		inline void setVec4(const std::string& name, const ew::Vec4& v) const { setVec4(name.c_str(), v); }
+		inline void setMat4(const std::string& name, const ew::Mat4& m) const { setMat4(name.c_str(), m); }
+		inline unsigned int getId() const { return m_id; }
 	private:
-		unsigned int m_id; //Shader program handle
+		unsigned int m_id = 0; //Shader program handle, registered with Util::GpuResourceRegistry and released with the shader
 	};
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "texture.h"
 #include "external/glad.h"
 #include "external/stb_image.h"
+#include "../util/GpuResources.h"
+#include "../util/Profiler.h"
 
 static int getTextureFormat(int numComponents) {
 	switch (numComponents) {
@@ -12,33 +14,76 @@ static int getTextureFormat(int numComponents) {
 		return GL_RG;
 	}
 }
+static int getTextureSizedFormat(int numComponents) {
+	switch (numComponents) {
+	default:
+		return GL_RGBA8;
+	case 3:
+		return GL_RGB8;
+	case 2:
+		return GL_RG8;
+	}
+}
+static void registerTexture(unsigned int texture, const char* filePath, int width, int height, int numComponents) {
+	Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+	registry.setBytes(registry.add(Util::GpuResourceType::TEXTURE, texture, filePath), Util::getTextureBytes(width, height, numComponents, true));
+}
 namespace ew {
 	unsigned int loadTexture(const char* filePath, int wrapMode, int filterMode) {
+		PROFILE_SCOPE("ew::loadTexture");
 		int width, height, numComponents;
-		unsigned char* data = stbi_load(filePath, &width, &height, &numComponents, 0);
+		unsigned char* data;
+		{
+			PROFILE_SCOPE("stbi_load");
+			data = stbi_load(filePath, &width, &height, &numComponents, 0);
+		}
 		if (data == NULL) {
 			printf("Failed to load image %s", filePath);
 			stbi_image_free(data);
 			return 0;
 		}
 		unsigned int texture;
+		int format = getTextureFormat(numComponents);
+		float borderColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		if (GLAD_GL_VERSION_4_5) {
+			//Immutable storage for the full mip chain, nothing gets bound
+			int levels = 1;
+			while (((width > height ? width : height) >> levels) > 0) {
+				levels++;
+			}
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+			glTextureStorage2D(texture, levels, getTextureSizedFormat(numComponents), width, height);
+			glTextureSubImage2D(texture, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+			glTextureParameteri(texture, GL_TEXTURE_WRAP_S, wrapMode);
+			glTextureParameteri(texture, GL_TEXTURE_WRAP_T, wrapMode);
+			glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filterMode);
+			glTextureParameterfv(texture, GL_TEXTURE_BORDER_COLOR, borderColor);
+			glGenerateTextureMipmap(texture);
+			stbi_image_free(data);
+			registerTexture(texture, filePath, width, height, numComponents);
+			return texture;
+		}
 		glGenTextures(1, &texture);
 		glBindTexture(GL_TEXTURE_2D, texture);
-		int format = getTextureFormat(numComponents);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterMode);
 
-		float borderColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
 		glGenerateMipmap(GL_TEXTURE_2D);
 
 		glBindTexture(GL_TEXTURE_2D, NULL);
 		stbi_image_free(data);
+		registerTexture(texture, filePath, width, height, numComponents);
 		return texture;
 	}
+	void deleteTexture(unsigned int texture) {
+		Util::GpuResourceRegistry& registry = Util::GpuResourceRegistry::get();
+		registry.release(registry.find(Util::GpuResourceType::TEXTURE, texture));
+	}
 }
 
@@ -1,5 +1,9 @@
 #pragma once
 
 namespace ew {
+	//Registered with Util::GpuResourceRegistry under filePath, so it is counted like every other texture. The caller
+	//owns it and gives it back with deleteTexture
 	unsigned int loadTexture(const char* filePath, int wrapMode, int filterMode);
+	//Deleted by the registry once the GPU is done with it
+	void deleteTexture(unsigned int texture);
 }
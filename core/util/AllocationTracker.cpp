@@ -0,0 +1,62 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "AllocationTracker.h"
+
+#include <atomic>
+
+//Plain globals and a trivial thread_local, they have to work before main and while threads are torn down
+static std::atomic<bool> installed{ false };
+static std::atomic<uint64_t> totalAllocations{ 0 };
+static std::atomic<uint64_t> totalFrees{ 0 };
+static std::atomic<uint64_t> totalBytes{ 0 };
+static thread_local Util::AllocationCounts threadCounts;
+
+bool Util::AllocationTracker::isInstalled()
+{
+	return installed.load(std::memory_order_relaxed);
+}
+
+Util::AllocationCounts Util::AllocationTracker::getTotal()
+{
+	AllocationCounts counts;
+	counts.allocations = totalAllocations.load(std::memory_order_relaxed);
+	counts.frees = totalFrees.load(std::memory_order_relaxed);
+	counts.bytes = totalBytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+Util::AllocationCounts Util::AllocationTracker::getThread()
+{
+	return threadCounts;
+}
+
+void Util::AllocationTracker::install()
+{
+	installed.store(true, std::memory_order_relaxed);
+}
+
+void Util::AllocationTracker::onAllocate(size_t size)
+{
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	threadCounts.allocations++;
+	threadCounts.bytes += size;
+}
+
+void Util::AllocationTracker::onFree()
+{
+	totalFrees.fetch_add(1, std::memory_order_relaxed);
+	threadCounts.frees++;
+}
+
+Util::AllocationCounts Util::AllocationScope::getCounts() const
+{
+	AllocationCounts now = AllocationTracker::getTotal();
+	AllocationCounts counts;
+	counts.allocations = now.allocations - _start.allocations;
+	counts.frees = now.frees - _start.frees;
+	counts.bytes = now.bytes - _start.bytes;
+	return counts;
+}
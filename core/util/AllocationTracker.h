@@ -0,0 +1,186 @@
+/*
+* Created by Adam Gyenes
+* Heap allocation counters fed by replacement global operator new/delete. The replacements are opt-in: define
+* UTIL_ALLOCATION_TRACKER_HOOKS before including this header in exactly one source file of the executable
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Util
+{
+	struct AllocationCounts
+	{
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t bytes = 0;
+	};
+
+	class AllocationTracker
+	{
+	public:
+		//False unless the executable compiled the hooks in, every count stays zero then
+		static bool isInstalled();
+
+		//Every thread since startup
+		static AllocationCounts getTotal();
+		//Calling thread since it started
+		static AllocationCounts getThread();
+
+		//Called by the hooks
+		static void install();
+		static void onAllocate(size_t size);
+		static void onFree();
+	};
+
+	//Allocations made on any thread since the scope began, e.g. around a frame
+	class AllocationScope
+	{
+	public:
+		AllocationScope() : _start(AllocationTracker::getTotal()) {}
+
+		AllocationCounts getCounts() const;
+
+	private:
+		AllocationCounts _start;
+	};
+}
+
+#ifdef UTIL_ALLOCATION_TRACKER_HOOKS
+
+#include <cstdlib>
+#include <new>
+
+void* operator new(size_t size)
+{
+	Util::AllocationTracker::onAllocate(size);
+	if (void* memory = malloc(size ? size : 1)) return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	Util::AllocationTracker::onAllocate(size);
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (!memory) return;
+	Util::AllocationTracker::onFree();
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+//Over-aligned versions, std::pmr::new_delete_resource() allocates through these
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	Util::AllocationTracker::onAllocate(size);
+	size_t align = size_t(alignment);
+#ifdef _MSC_VER
+	if (void* memory = _aligned_malloc(size ? size : 1, align)) return memory;
+#else
+	//aligned_alloc wants the size to be a multiple of the alignment
+	size_t rounded = size ? (size + align - 1) / align * align : align;
+	if (void* memory = aligned_alloc(align, rounded)) return memory;
+#endif
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return operator new(size, alignment);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, alignment, tag);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	if (!memory) return;
+	Util::AllocationTracker::onFree();
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+static const bool UTIL_ALLOCATION_TRACKER_INSTALLED = (Util::AllocationTracker::install(), true);
+
+#endif
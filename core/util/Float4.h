@@ -0,0 +1,56 @@
+/*
+* Created by Adam Gyenes
+* 4 wide float for the CPU culling and rasterizing loops, SSE2 where available and plain arrays elsewhere
+*/
+
+#pragma once
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTIL_FLOAT4_SSE
+#endif
+
+namespace Util
+{
+	//Comparisons return one bit per lane
+#ifdef UTIL_FLOAT4_SSE
+	struct Float4
+	{
+		__m128 v;
+	};
+
+	inline Float4 load4(const float* p) { return { _mm_loadu_ps(p) }; }
+	inline void store4(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+	inline Float4 splat4(float f) { return { _mm_set1_ps(f) }; }
+	inline Float4 set4(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+	inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline Float4 sqrt4(Float4 a) { return { _mm_sqrt_ps(a.v) }; }
+	inline int lessMask4(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+#else
+	struct Float4
+	{
+		float v[4];
+	};
+
+	inline Float4 load4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+	inline void store4(float* p, Float4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+	inline Float4 splat4(float f) { return { { f, f, f, f } }; }
+	inline Float4 set4(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+	inline Float4 operator+(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+	inline Float4 operator-(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+	inline Float4 operator*(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+	inline Float4 operator/(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a; }
+	inline Float4 sqrt4(Float4 a) { for (int i = 0; i < 4; i++) a.v[i] = sqrtf(a.v[i]); return a; }
+	inline int lessMask4(Float4 a, Float4 b)
+	{
+		int mask = 0;
+		for (int i = 0; i < 4; i++) mask |= (a.v[i] < b.v[i]) << i;
+		return mask;
+	}
+#endif
+}
@@ -0,0 +1,86 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "FrameArena.h"
+
+#include <algorithm>
+
+Util::FrameArena::FrameArena(size_t capacity)
+{
+	addBlock(std::max<size_t>(capacity, 1));
+}
+
+void Util::FrameArena::addBlock(size_t minSize)
+{
+	//Grow geometrically so a steadily growing frame needs few extra blocks
+	size_t size = std::max(minSize, _blocks.empty() ? size_t(0) : _blocks.back().size * 2);
+	_blocks.push_back(Block{ std::unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+}
+
+void* Util::FrameArena::allocate(size_t size, size_t alignment)
+{
+	for (;;)
+	{
+		const Block& block = _blocks[_block];
+		uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+		//Aligned relative to the real address, heap blocks only guarantee max_align_t
+		uintptr_t start = (base + _offset + alignment - 1) & ~uintptr_t(alignment - 1);
+		size_t end = size_t(start - base) + size;
+		if (end <= block.size)
+		{
+			_offset = end;
+			_peak = std::max(_peak, _usedBefore + _offset);
+			return reinterpret_cast<void*>(start);
+		}
+
+		//Blocks past the current one survive a rewind, reuse them before asking the heap
+		if (_block + 1 == _blocks.size())
+		{
+			addBlock(size + alignment);
+			_overflows++;
+		}
+		_usedBefore += _offset;
+		_block++;
+		_offset = 0;
+	}
+}
+
+void Util::FrameArena::reset()
+{
+	//Replace the chain with one block big enough for all of it
+	if (_blocks.size() > 1)
+	{
+		size_t total = 0;
+		for (const Block& block : _blocks) total += block.size;
+		_blocks.clear();
+		addBlock(total);
+	}
+
+	_block = 0;
+	_offset = 0;
+	_usedBefore = 0;
+}
+
+void Util::FrameArena::rewind(const Marker& marker)
+{
+	_block = marker.block;
+	_offset = marker.offset;
+	_usedBefore = marker.usedBefore;
+}
+
+Util::FrameArenaStats Util::FrameArena::getStats() const
+{
+	FrameArenaStats stats;
+	stats.used = _usedBefore + _offset;
+	stats.peak = _peak;
+	stats.overflows = _overflows;
+	for (const Block& block : _blocks) stats.capacity += block.size;
+	return stats;
+}
+
+Util::FrameArena& Util::FrameArena::getThreadLocal()
+{
+	static thread_local FrameArena arena(FRAME_ARENA_THREAD_CAPACITY);
+	return arena;
+}
@@ -0,0 +1,157 @@
+/*
+* Created by Adam Gyenes
+* Linear (bump) allocator for data that only lives for a frame or a scope. Allocating is a pointer bump, freeing is a
+* reset of the whole arena, so nothing is ever returned to the heap in steady state
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+//Default size of an arena's first block
+constexpr size_t FRAME_ARENA_DEFAULT_CAPACITY = 1 << 20;
+//Size of each thread's scratch arena
+constexpr size_t FRAME_ARENA_THREAD_CAPACITY = 256 << 10;
+
+namespace Util
+{
+	struct FrameArenaStats
+	{
+		//Bytes handed out since the last reset, including alignment padding
+		size_t used = 0;
+		size_t peak = 0;
+		size_t capacity = 0;
+		//Allocations that didn't fit and needed a new block from the heap
+		uint64_t overflows = 0;
+	};
+
+	class FrameArena
+	{
+	public:
+		//Position to rewind to, see ArenaScope
+		struct Marker
+		{
+			size_t block;
+			size_t offset;
+			size_t usedBefore;
+		};
+
+		FrameArena(size_t capacity = FRAME_ARENA_DEFAULT_CAPACITY);
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		//alignment must be a power of two. Never returns nullptr: a full arena chains another heap block,
+		//reset() merges them so the next frame fits in one
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		//Uninitialized storage for count Ts. No destructors ever run, so only for trivially destructible types
+		template<typename T>
+		T* allocateArray(size_t count);
+
+		//Invalidates everything allocated so far. Call once per frame by the arena's owner
+		void reset();
+
+		Marker getMarker() const { return Marker{ _block, _offset, _usedBefore }; }
+		//Frees everything allocated after the marker was taken
+		void rewind(const Marker& marker);
+
+		FrameArenaStats getStats() const;
+
+		//Scratch arena of the calling thread, created on first use. Not reset per frame: wrap its use in an ArenaScope
+		//so the memory is returned when the scope (e.g. the job) ends
+		static FrameArena& getThreadLocal();
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<unsigned char[]> memory;
+			size_t size;
+		};
+
+		void addBlock(size_t minSize);
+
+		std::vector<Block> _blocks;
+		//Current block and the offset of its first free byte
+		size_t _block = 0;
+		size_t _offset = 0;
+		//Bytes in the blocks before _block, so usage survives a block change
+		size_t _usedBefore = 0;
+
+		size_t _peak = 0;
+		uint64_t _overflows = 0;
+	};
+
+	//Rewinds an arena to where it was when the scope began
+	class ArenaScope
+	{
+	public:
+		ArenaScope(FrameArena& arena)
+			: _arena(arena), _marker(arena.getMarker())
+		{
+		}
+		~ArenaScope() { _arena.rewind(_marker); }
+
+		ArenaScope(const ArenaScope&) = delete;
+		ArenaScope& operator=(const ArenaScope&) = delete;
+
+	private:
+		FrameArena& _arena;
+		FrameArena::Marker _marker;
+	};
+
+	//Standard allocator over a FrameArena, e.g. std::vector<int, ArenaAllocator<int>>. Deallocation does nothing,
+	//the memory comes back with the arena's reset or rewind, so containers must not outlive either
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		typedef T value_type;
+
+		ArenaAllocator(FrameArena& arena) : _arena(&arena) {}
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.getArena()) {}
+
+		T* allocate(size_t count) { return static_cast<T*>(_arena->allocate(sizeof(T) * count, alignof(T))); }
+		void deallocate(T*, size_t) {}
+
+		FrameArena* getArena() const { return _arena; }
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return _arena == other.getArena(); }
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const { return _arena != other.getArena(); }
+
+	private:
+		FrameArena* _arena;
+	};
+
+	//std::pmr adapter over a FrameArena, for pmr containers and ew::MeshData generators. Same rules as ArenaAllocator:
+	//deallocation does nothing and nothing allocated from it may outlive the arena's reset or rewind
+	class ArenaResource : public std::pmr::memory_resource
+	{
+	public:
+		ArenaResource(FrameArena& arena) : _arena(arena) {}
+
+		FrameArena& getArena() const { return _arena; }
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override { return _arena.allocate(bytes, alignment); }
+		void do_deallocate(void*, size_t, size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		FrameArena& _arena;
+	};
+}
+
+template<typename T>
+T* Util::FrameArena::allocateArray(size_t count)
+{
+	static_assert(std::is_trivially_destructible<T>::value, "Arena memory is never destroyed");
+	return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+}
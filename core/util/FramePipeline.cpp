@@ -0,0 +1,114 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "FramePipeline.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+static float average(const float* values, uint64_t count)
+{
+	int n = int(std::min<uint64_t>(count, FRAME_PIPELINE_HISTORY));
+	if (n == 0) return 0.f;
+
+	float sum = 0.f;
+	for (int i = 0; i < n; i++) sum += values[i];
+	return sum / n;
+}
+
+Util::FramePipeline::FramePipeline(int depth)
+{
+	setDepth(depth);
+}
+
+void Util::FramePipeline::setDepth(int depth)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_depth = std::max(0, std::min(depth, FRAME_PIPELINE_MAX_DEPTH));
+}
+
+int Util::FramePipeline::getDepth() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _depth;
+}
+
+int Util::FramePipeline::beginWrite()
+{
+	PROFILE_SCOPE("Util::FramePipeline::beginWrite");
+
+	uint64_t startNs = Profiler::nowNs();
+	std::unique_lock<std::mutex> lock(_mutex);
+	//With depth <= FRAME_PIPELINE_MAX_DEPTH this also guarantees the slot's previous packet was presented
+	_presented.wait(lock, [this] { return _stopped || _writeCount - _presentCount <= uint64_t(_depth); });
+
+	_producerWaitMs[_writeCount % FRAME_PIPELINE_HISTORY] = (Profiler::nowNs() - startNs) / 1e6f;
+	return int(_writeCount % FRAME_PIPELINE_SLOTS);
+}
+
+void Util::FramePipeline::endWrite(uint64_t inputNs)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_inputNs[_writeCount % FRAME_PIPELINE_SLOTS] = inputNs;
+		_writeCount++;
+	}
+	_written.notify_one();
+}
+
+int Util::FramePipeline::beginRead()
+{
+	uint64_t startNs = Profiler::nowNs();
+	std::unique_lock<std::mutex> lock(_mutex);
+	_written.wait(lock, [this] { return _stopped || _presentCount < _writeCount; });
+	if (_presentCount == _writeCount) return -1;
+
+	_readStartNs = Profiler::nowNs();
+	_consumerWaitMs[_presentCount % FRAME_PIPELINE_HISTORY] = (_readStartNs - startNs) / 1e6f;
+	return int(_presentCount % FRAME_PIPELINE_SLOTS);
+}
+
+void Util::FramePipeline::endRead()
+{
+	uint64_t nowNs = Profiler::nowNs();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		int history = int(_presentCount % FRAME_PIPELINE_HISTORY);
+		_latencyMs[history] = (nowNs - _inputNs[_presentCount % FRAME_PIPELINE_SLOTS]) / 1e6f;
+		_renderMs[history] = (nowNs - _readStartNs) / 1e6f;
+		_presentCount++;
+	}
+	_presented.notify_all();
+}
+
+void Util::FramePipeline::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopped = true;
+	}
+	_written.notify_all();
+	_presented.notify_all();
+}
+
+void Util::FramePipeline::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_presented.wait(lock, [this] { return _presentCount == _writeCount; });
+}
+
+Util::FramePipelineStats Util::FramePipeline::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	FramePipelineStats stats;
+	stats.presentedFrames = _presentCount;
+	stats.latencyMs = average(_latencyMs, _presentCount);
+	stats.producerWaitMs = average(_producerWaitMs, _writeCount);
+	stats.consumerWaitMs = average(_consumerWaitMs, _presentCount);
+	stats.renderMs = average(_renderMs, _presentCount);
+	int n = int(std::min<uint64_t>(_presentCount, FRAME_PIPELINE_HISTORY));
+	for (int i = 0; i < n; i++) stats.maxLatencyMs = std::max(stats.maxLatencyMs, _latencyMs[i]);
+	return stats;
+}
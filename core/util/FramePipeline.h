@@ -0,0 +1,86 @@
+/*
+* Created by Adam Gyenes
+* Hands frame packets from the simulation thread to the render thread, the render thread may lag up to a set number of frames
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+//Frames the render thread can lag behind the simulation thread
+constexpr int FRAME_PIPELINE_MAX_DEPTH = 2;
+//One slot being written plus one per frame in flight
+constexpr int FRAME_PIPELINE_SLOTS = FRAME_PIPELINE_MAX_DEPTH + 1;
+constexpr int FRAME_PIPELINE_HISTORY = 120;
+
+namespace Util
+{
+	struct FramePipelineStats
+	{
+		//Input sampled to buffers swapped, averaged over the last FRAME_PIPELINE_HISTORY frames
+		float latencyMs = 0.f;
+		float maxLatencyMs = 0.f;
+		//Time the simulation thread blocked waiting for a free slot
+		float producerWaitMs = 0.f;
+		//Time the render thread blocked waiting for a packet
+		float consumerWaitMs = 0.f;
+		//Render thread time per packet, including the swap
+		float renderMs = 0.f;
+		uint64_t presentedFrames = 0;
+	};
+
+	//Only schedules slot indices, the packets themselves live in an array of FRAME_PIPELINE_SLOTS owned by the caller.
+	//Single producer, single consumer
+	class FramePipeline
+	{
+	public:
+		//0 runs both threads in lockstep, 1 lets the simulation work on frame N+1 while frame N renders
+		FramePipeline(int depth = 1);
+
+		FramePipeline(const FramePipeline&) = delete;
+		FramePipeline& operator=(const FramePipeline&) = delete;
+
+		//Takes effect with the next beginWrite()
+		void setDepth(int depth);
+		int getDepth() const;
+
+		//Producer. Blocks until the render thread is at most depth frames behind, returns the slot to fill
+		int beginWrite();
+		//Publishes the slot, the packet must not be touched again until beginWrite() hands it out again.
+		//inputNs is the Util::Profiler::nowNs() timestamp the packet's input was sampled at
+		void endWrite(uint64_t inputNs);
+
+		//Consumer. Blocks until a packet was published, returns its slot or -1 once stopped and drained
+		int beginRead();
+		//Call after the packet was presented
+		void endRead();
+
+		//Wakes both sides, beginRead() returns -1 once the remaining packets are consumed
+		void stop();
+
+		//Blocks until every published packet was presented
+		void waitIdle();
+
+		FramePipelineStats getStats() const;
+
+	private:
+		mutable std::mutex _mutex;
+		std::condition_variable _written;
+		std::condition_variable _presented;
+
+		int _depth;
+		uint64_t _writeCount = 0;
+		uint64_t _presentCount = 0;
+		bool _stopped = false;
+
+		uint64_t _inputNs[FRAME_PIPELINE_SLOTS] = {};
+		uint64_t _readStartNs = 0;
+
+		float _latencyMs[FRAME_PIPELINE_HISTORY] = {};
+		float _producerWaitMs[FRAME_PIPELINE_HISTORY] = {};
+		float _consumerWaitMs[FRAME_PIPELINE_HISTORY] = {};
+		float _renderMs[FRAME_PIPELINE_HISTORY] = {};
+	};
+}
@@ -0,0 +1,199 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "FrameSync.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+//Upper bound for a single glClientWaitSync, the wait loops until the fence is signalled anyway
+constexpr GLuint64 FENCE_WAIT_TIMEOUT_NS = 1000000;
+
+static bool isSignalled(GLenum result)
+{
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+Util::FrameSync::FrameSync(int framesInFlight, GLsizeiptr regionSize)
+	: _framesInFlight(std::max(1, std::min(framesInFlight, FRAME_SYNC_MAX_FRAMES))),
+	_regionSize(regionSize)
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_defaultAlignment = std::max<GLsizeiptr>(_defaultAlignment, alignment);
+	if (GLAD_GL_VERSION_4_3)
+	{
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		_defaultAlignment = std::max<GLsizeiptr>(_defaultAlignment, alignment);
+	}
+
+	GLsizeiptr totalSize = _regionSize * _framesInFlight;
+	_buffer = GpuResource::create(GpuResourceType::BUFFER, "Util::FrameSync");
+	_buffer.setBytes(size_t(totalSize));
+	//Coherent, so writes are visible to every command issued after them without explicit flushes
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	if (GLAD_GL_VERSION_4_5)
+	{
+		//Direct state access, no binding is touched at all
+		glNamedBufferStorage(_buffer.get(), totalSize, nullptr, flags);
+		_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(_buffer.get(), 0, totalSize, flags));
+		return;
+	}
+
+	//Copy write target so no binding the state cache tracks is disturbed
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer.get());
+	if (GLAD_GL_VERSION_4_4)
+	{
+		glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+		_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags));
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+Util::FrameSync::~FrameSync()
+{
+	for (GLsync fence : _fences)
+	{
+		if (fence) glDeleteSync(fence);
+	}
+	//The buffer is released with _buffer, deleting a mapped buffer unmaps it
+}
+
+void Util::FrameSync::beginFrame()
+{
+	assert(!_inFrame);
+	int region = int(_frame % _framesInFlight);
+	float stallMs = 0.f;
+
+	GLsync& fence = _fences[region];
+	if (fence)
+	{
+		//Poll first, a fence that already passed costs no flush and no wait
+		if (isSignalled(glClientWaitSync(fence, 0, 0)))
+		{
+			_fenceHits++;
+		}
+		else
+		{
+			PROFILE_SCOPE("Util::FrameSync::wait");
+
+			_fenceWaits++;
+			uint64_t startNs = Profiler::nowNs();
+			GLenum result;
+			do
+			{
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT_NS);
+			} while (result == GL_TIMEOUT_EXPIRED);
+			stallMs = (Profiler::nowNs() - startNs) / 1e6f;
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	//The other regions' fences show how far behind the GPU is, querying the status never flushes
+	_framesBehind = 0;
+	for (int i = 0; i < _framesInFlight; i++)
+	{
+		if (!_fences[i]) continue;
+
+		GLint status = GL_SIGNALED;
+		glGetSynciv(_fences[i], GL_SYNC_STATUS, 1, nullptr, &status);
+		if (status != GL_SIGNALED) _framesBehind++;
+	}
+
+	_stallMs[_frame % FRAME_SYNC_HISTORY] = stallMs;
+	_cursor = 0;
+	_inFrame = true;
+}
+
+void Util::FrameSync::endFrame()
+{
+	assert(_inFrame);
+	_fences[_frame % _framesInFlight] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	_bytesUsed = _cursor;
+	_peakBytesUsed = std::max(_peakBytesUsed, _cursor);
+	_frame++;
+	_inFrame = false;
+}
+
+Util::TransientBuffer Util::FrameSync::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	assert(_inFrame);
+	if (alignment <= 0) alignment = _defaultAlignment;
+
+	//Align the absolute offset, a region doesn't have to start at a multiple of alignment
+	GLintptr regionStart = GLintptr(_frame % _framesInFlight) * _regionSize;
+	GLintptr offset = (regionStart + _cursor + alignment - 1) / alignment * alignment;
+	if (size <= 0 || offset + size > regionStart + _regionSize)
+	{
+		_overflows++;
+		return TransientBuffer();
+	}
+	_cursor = offset + size - regionStart;
+
+	TransientBuffer allocation;
+	allocation.buffer = _buffer.get();
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.data = _mapped ? _mapped + offset : nullptr;
+	return allocation;
+}
+
+Util::TransientBuffer Util::FrameSync::upload(const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+	TransientBuffer allocation = allocate(size, alignment);
+	if (!allocation.isValid()) return allocation;
+
+	if (allocation.data)
+	{
+		memcpy(allocation.data, data, size_t(size));
+		return allocation;
+	}
+
+	//The fence already guarantees the GPU is done with this range, so the driver must not synchronize either
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer.get());
+	void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, allocation.offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (mapped)
+	{
+		memcpy(mapped, data, size_t(size));
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return allocation;
+}
+
+Util::FrameSyncStats Util::FrameSync::getStats() const
+{
+	FrameSyncStats stats;
+	stats.frames = _frame;
+	stats.framesInFlight = _framesBehind;
+	stats.fenceHits = _fenceHits;
+	stats.fenceWaits = _fenceWaits;
+	stats.bytesUsed = _bytesUsed;
+	stats.peakBytesUsed = _peakBytesUsed;
+	stats.overflows = _overflows;
+
+	//The current frame's entry is written by beginFrame(), so it counts as soon as the frame began
+	uint64_t recorded = _frame + (_inFrame ? 1 : 0);
+	int n = int(std::min<uint64_t>(recorded, FRAME_SYNC_HISTORY));
+	if (n == 0) return stats;
+
+	int stalled = 0;
+	for (int i = 0; i < n; i++)
+	{
+		stats.stallMs += _stallMs[i];
+		stats.maxStallMs = std::max(stats.maxStallMs, _stallMs[i]);
+		if (_stallMs[i] > 0.f) stalled++;
+	}
+	stats.stallMs /= n;
+	stats.stalledFrameRatio = float(stalled) / n;
+	return stats;
+}
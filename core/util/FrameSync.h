@@ -0,0 +1,106 @@
+/*
+* Created by Adam Gyenes
+* Keeps a fixed number of frames in flight on the GPU with one fence per frame. Every frame owns a region of a ring buffer
+* for transient data, a region is only reused once the GPU signalled the fence of the frame that last wrote it
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "../ew/external/glad.h"
+#include "GpuResources.h"
+
+constexpr int FRAME_SYNC_MAX_FRAMES = 4;
+constexpr int FRAME_SYNC_HISTORY = 120;
+//Bytes of transient data each frame can allocate
+constexpr GLsizeiptr FRAME_SYNC_DEFAULT_REGION_SIZE = 4 << 20;
+
+namespace Util
+{
+	//Slice of the ring buffer, valid until the end of the frame it was allocated in
+	struct TransientBuffer
+	{
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+		//Write-only, persistently mapped memory. nullptr without GL 4.4, use FrameSync::upload() there
+		void* data = nullptr;
+
+		//False when the frame's region ran out of space
+		bool isValid() const { return buffer != 0; }
+	};
+
+	struct FrameSyncStats
+	{
+		//Time beginFrame() blocked on a fence, averaged over the last FRAME_SYNC_HISTORY frames
+		float stallMs = 0.f;
+		float maxStallMs = 0.f;
+		//Fraction of those frames that had to wait at all
+		float stalledFrameRatio = 0.f;
+		//Submitted frames the GPU had not finished when the last frame began
+		int framesInFlight = 0;
+
+		uint64_t frames = 0;
+		//Fences that were already signalled when checked vs ones that had to be waited on, since creation
+		uint64_t fenceHits = 0;
+		uint64_t fenceWaits = 0;
+
+		//Transient bytes allocated by the last finished frame and the most any frame used
+		GLsizeiptr bytesUsed = 0;
+		GLsizeiptr peakBytesUsed = 0;
+		//Allocations refused because the region was full
+		uint64_t overflows = 0;
+	};
+
+	//GL thread only. Call beginFrame() before recording anything that writes transient data and endFrame() after the
+	//frame's last draw (before the swap, so the fence isn't stuck behind it)
+	class FrameSync
+	{
+	public:
+		FrameSync(int framesInFlight = 2, GLsizeiptr regionSize = FRAME_SYNC_DEFAULT_REGION_SIZE);
+		~FrameSync();
+
+		FrameSync(const FrameSync&) = delete;
+		FrameSync& operator=(const FrameSync&) = delete;
+
+		//Blocks only if the GPU is still working on the frame framesInFlight frames ago
+		void beginFrame();
+		void endFrame();
+
+		//size bytes in this frame's region, offset rounded up to a multiple of alignment (0 = uniform/storage buffer
+		//offset alignment). Not a power of two is fine, e.g. a vertex stride for use as a base vertex
+		TransientBuffer allocate(GLsizeiptr size, GLsizeiptr alignment = 0);
+		//allocate() and copy data in, works with and without persistent mapping
+		TransientBuffer upload(const void* data, GLsizeiptr size, GLsizeiptr alignment = 0);
+
+		GLuint getBuffer() const { return _buffer.get(); }
+		bool isPersistent() const { return _mapped != nullptr; }
+		int getFramesInFlight() const { return _framesInFlight; }
+		GLsizeiptr getRegionSize() const { return _regionSize; }
+
+		FrameSyncStats getStats() const;
+
+	private:
+		int _framesInFlight;
+		GLsizeiptr _regionSize;
+		GLsizeiptr _defaultAlignment = 16;
+
+		GpuResource _buffer;
+		unsigned char* _mapped = nullptr;
+		GLsync _fences[FRAME_SYNC_MAX_FRAMES] = {};
+
+		uint64_t _frame = 0;
+		bool _inFrame = false;
+		//Start of the free space in the current frame's region, relative to the region
+		GLsizeiptr _cursor = 0;
+
+		float _stallMs[FRAME_SYNC_HISTORY] = {};
+		int _framesBehind = 0;
+		uint64_t _fenceHits = 0;
+		uint64_t _fenceWaits = 0;
+		GLsizeiptr _bytesUsed = 0;
+		GLsizeiptr _peakBytesUsed = 0;
+		uint64_t _overflows = 0;
+	};
+}
@@ -0,0 +1,229 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "GLStateCache.h"
+#include "GpuResources.h"
+
+constexpr GLuint UNKNOWN_BINDING = ~0u;
+
+int Util::GLStateStats::getIssued() const
+{
+	int total = 0;
+	for (int count : issued) total += count;
+	return total;
+}
+
+int Util::GLStateStats::getSkipped() const
+{
+	int total = 0;
+	for (int count : skipped) total += count;
+	return total;
+}
+
+bool Util::GLStateCache::record(BindType type, bool redundant)
+{
+	if (redundant) _stats.skipped[int(type)]++;
+	else _stats.issued[int(type)]++;
+	return !redundant;
+}
+
+void Util::GLStateCache::useProgram(GLuint program)
+{
+	if (!record(BindType::PROGRAM, _program == program)) return;
+
+	glUseProgram(program);
+	_program = program;
+}
+
+void Util::GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+	if (!record(BindType::VERTEX_ARRAY, _vertexArray == vertexArray)) return;
+
+	glBindVertexArray(vertexArray);
+	_vertexArray = vertexArray;
+	forgetVertexBuffers();
+}
+
+void Util::GLStateCache::bindVertexBindings(const VertexBindings& bindings)
+{
+	bindVertexArray(bindings.vertexArray);
+
+	for (int i = 0; i < VERTEX_FORMAT_MAX_BINDINGS; i++)
+	{
+		const VertexBufferBinding& binding = bindings.buffers[i];
+		if (!binding.buffer) continue;
+
+		VertexBufferBinding& bound = _vertexBuffers[i];
+		if (!record(BindType::VERTEX_BUFFER, bound.buffer == binding.buffer && bound.offset == binding.offset && bound.stride == binding.stride)) continue;
+
+		glBindVertexBuffer(i, binding.buffer, binding.offset, binding.stride);
+		bound = binding;
+	}
+
+	if (bindings.indexBuffer && record(BindType::VERTEX_BUFFER, _indexBuffer == bindings.indexBuffer))
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bindings.indexBuffer);
+		_indexBuffer = bindings.indexBuffer;
+	}
+}
+
+void Util::GLStateCache::bindTexture(int unit, GLenum target, GLuint texture)
+{
+	if (unit < 0 || unit >= STATE_CACHE_TEXTURE_UNITS)
+	{
+		_stats.issued[int(BindType::TEXTURE)]++;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		_activeUnit = unit;
+		return;
+	}
+
+	if (!record(BindType::TEXTURE, _textures[unit] == texture && _textureTargets[unit] == target)) return;
+
+	if (_activeUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		_activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+	_textureTargets[unit] = target;
+	_textures[unit] = texture;
+}
+
+int Util::GLStateCache::bufferTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_UNIFORM_BUFFER: return 1;
+	case GL_SHADER_STORAGE_BUFFER: return 2;
+	case GL_DRAW_INDIRECT_BUFFER: return 3;
+	default: return -1;
+	}
+}
+
+int Util::GLStateCache::indexedTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_UNIFORM_BUFFER: return 0;
+	case GL_SHADER_STORAGE_BUFFER: return 1;
+	default: return -1;
+	}
+}
+
+void Util::GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+	int index = bufferTargetIndex(target);
+	if (!record(BindType::BUFFER, index >= 0 && _buffers[index] == buffer)) return;
+
+	glBindBuffer(target, buffer);
+	if (index >= 0) _buffers[index] = buffer;
+}
+
+void Util::GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	int targetIndex = indexedTargetIndex(target);
+	bool tracked = targetIndex >= 0 && index < GLuint(STATE_CACHE_BUFFER_BINDINGS);
+	BufferRange* range = tracked ? &_bufferRanges[targetIndex][index] : nullptr;
+
+	if (!record(BindType::BUFFER, range && range->buffer == buffer && range->offset == offset && range->size == size)) return;
+
+	if (size > 0) glBindBufferRange(target, index, buffer, offset, size);
+	else glBindBufferBase(target, index, buffer);
+
+	if (range) *range = BufferRange{ buffer, offset, size };
+	//Indexed binds also replace the generic binding point
+	int genericIndex = bufferTargetIndex(target);
+	if (genericIndex >= 0) _buffers[genericIndex] = buffer;
+}
+
+static void forgetDeleted(Util::GpuResourceType type, GLuint name, void* userData)
+{
+	Util::GLStateCache* cache = static_cast<Util::GLStateCache*>(userData);
+	switch (type)
+	{
+	case Util::GpuResourceType::BUFFER: cache->forgetBuffer(name); break;
+	case Util::GpuResourceType::TEXTURE: cache->forgetTexture(name); break;
+	case Util::GpuResourceType::PROGRAM: cache->forgetProgram(name); break;
+	case Util::GpuResourceType::VERTEX_ARRAY: cache->forgetVertexArray(name); break;
+	default: break;
+	}
+}
+
+Util::GLStateCache::GLStateCache()
+{
+	invalidate();
+	GpuResourceRegistry::get().addDeleteCallback(forgetDeleted, this);
+}
+
+Util::GLStateCache::~GLStateCache()
+{
+	GpuResourceRegistry::get().removeDeleteCallback(forgetDeleted, this);
+}
+
+void Util::GLStateCache::invalidate()
+{
+	_program = UNKNOWN_BINDING;
+	_vertexArray = UNKNOWN_BINDING;
+	forgetVertexBuffers();
+	_activeUnit = -1;
+	for (int i = 0; i < STATE_CACHE_TEXTURE_UNITS; i++)
+	{
+		_textureTargets[i] = 0;
+		_textures[i] = UNKNOWN_BINDING;
+	}
+	for (GLuint& buffer : _buffers) buffer = UNKNOWN_BINDING;
+	for (int t = 0; t < 2; t++)
+	{
+		for (int i = 0; i < STATE_CACHE_BUFFER_BINDINGS; i++) _bufferRanges[t][i] = BufferRange{ UNKNOWN_BINDING, 0, 0 };
+	}
+}
+
+void Util::GLStateCache::forgetVertexBuffers()
+{
+	for (VertexBufferBinding& binding : _vertexBuffers) binding.buffer = UNKNOWN_BINDING;
+	_indexBuffer = UNKNOWN_BINDING;
+}
+
+void Util::GLStateCache::forgetProgram(GLuint program)
+{
+	if (_program == program) _program = UNKNOWN_BINDING;
+}
+
+void Util::GLStateCache::forgetVertexArray(GLuint vertexArray)
+{
+	if (_vertexArray != vertexArray) return;
+
+	_vertexArray = UNKNOWN_BINDING;
+	forgetVertexBuffers();
+}
+
+void Util::GLStateCache::forgetTexture(GLuint texture)
+{
+	for (GLuint& bound : _textures)
+	{
+		if (bound == texture) bound = UNKNOWN_BINDING;
+	}
+}
+
+void Util::GLStateCache::forgetBuffer(GLuint buffer)
+{
+	for (GLuint& bound : _buffers)
+	{
+		if (bound == buffer) bound = UNKNOWN_BINDING;
+	}
+	for (VertexBufferBinding& binding : _vertexBuffers)
+	{
+		if (binding.buffer == buffer) binding.buffer = UNKNOWN_BINDING;
+	}
+	if (_indexBuffer == buffer) _indexBuffer = UNKNOWN_BINDING;
+	for (int t = 0; t < 2; t++)
+	{
+		for (BufferRange& range : _bufferRanges[t])
+		{
+			if (range.buffer == buffer) range.buffer = UNKNOWN_BINDING;
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/*
+* Created by Adam Gyenes
+* Shadow copy of the GL binding state so redundant binds never reach the driver
+*/
+
+#pragma once
+
+#include "../ew/external/glad.h"
+#include "VertexFormat.h"
+
+constexpr int STATE_CACHE_TEXTURE_UNITS = 16;
+constexpr int STATE_CACHE_BUFFER_BINDINGS = 16;
+
+namespace Util
+{
+	enum class BindType
+	{
+		PROGRAM = 0,
+		VERTEX_ARRAY,
+		TEXTURE,
+		BUFFER,
+		//glBindVertexBuffer and the index buffer of a shared vertex array
+		VERTEX_BUFFER,
+		COUNT
+	};
+
+	struct GLStateStats
+	{
+		int issued[int(BindType::COUNT)] = {};
+		int skipped[int(BindType::COUNT)] = {};
+
+		int getIssued() const;
+		int getSkipped() const;
+	};
+
+	class GLStateCache
+	{
+	public:
+		//Registers with Util::GpuResourceRegistry, so objects it deletes are forgotten automatically
+		GLStateCache();
+		~GLStateCache();
+
+		GLStateCache(const GLStateCache&) = delete;
+		GLStateCache& operator=(const GLStateCache&) = delete;
+
+		void useProgram(GLuint program);
+		void bindVertexArray(GLuint vertexArray);
+		//The vertex array, then whichever of the buffers behind it differ. Those are tracked until another vertex
+		//array is bound
+		void bindVertexBindings(const VertexBindings& bindings);
+		//Switches the active unit only when the texture actually changes
+		void bindTexture(int unit, GLenum target, GLuint texture);
+		//GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER or GL_DRAW_INDIRECT_BUFFER.
+		//The element array buffer belongs to the VAO and is not tracked
+		void bindBuffer(GLenum target, GLuint buffer);
+		//Indexed GL_UNIFORM_BUFFER/GL_SHADER_STORAGE_BUFFER binding, size 0 binds the whole buffer
+		void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset = 0, GLsizeiptr size = 0);
+
+		//Forget everything, call after code that binds behind the cache's back (ImGui, ew::Mesh::draw, ...)
+		void invalidate();
+		//Drop a deleted object so a recycled name isn't mistaken for a bound one. Only needed for objects deleted
+		//outside the registry
+		void forgetProgram(GLuint program);
+		void forgetVertexArray(GLuint vertexArray);
+		void forgetTexture(GLuint texture);
+		void forgetBuffer(GLuint buffer);
+
+		const GLStateStats& getStats() const { return _stats; }
+		void resetStats() { _stats = GLStateStats(); }
+
+	private:
+		//Index into the generic binding arrays, -1 for untracked targets
+		static int bufferTargetIndex(GLenum target);
+		static int indexedTargetIndex(GLenum target);
+
+		bool record(BindType type, bool redundant);
+		void forgetVertexBuffers();
+
+		struct BufferRange
+		{
+			GLuint buffer;
+			GLintptr offset;
+			GLsizeiptr size;
+		};
+
+		//~0u marks unknown state, it can never match a real name
+		GLuint _program;
+		GLuint _vertexArray;
+		VertexBufferBinding _vertexBuffers[VERTEX_FORMAT_MAX_BINDINGS];
+		GLuint _indexBuffer;
+		int _activeUnit;
+		GLenum _textureTargets[STATE_CACHE_TEXTURE_UNITS];
+		GLuint _textures[STATE_CACHE_TEXTURE_UNITS];
+		GLuint _buffers[4];
+		BufferRange _bufferRanges[2][STATE_CACHE_BUFFER_BINDINGS];
+
+		GLStateStats _stats;
+	};
+}
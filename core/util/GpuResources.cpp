@@ -0,0 +1,311 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "GpuResources.h"
+#include "Profiler.h"
+
+#include <cstdio>
+
+//Upper bound for a single glClientWaitSync in flush(), the wait loops until the fence is signalled anyway
+constexpr GLuint64 GPU_RESOURCE_WAIT_TIMEOUT_NS = 1000000;
+
+const char* Util::getGpuResourceTypeName(GpuResourceType type)
+{
+	switch (type)
+	{
+	case GpuResourceType::BUFFER: return "Buffers";
+	case GpuResourceType::TEXTURE: return "Textures";
+	case GpuResourceType::PROGRAM: return "Programs";
+	case GpuResourceType::VERTEX_ARRAY: return "Vertex arrays";
+	default: return "Unknown";
+	}
+}
+
+size_t Util::getTextureBytes(int width, int height, int bytesPerPixel, bool mipmaps)
+{
+	size_t bytes = size_t(width) * size_t(height) * size_t(bytesPerPixel);
+	return mipmaps ? bytes + bytes / 3 : bytes;
+}
+
+int Util::GpuResourceStats::getCount() const
+{
+	int total = 0;
+	for (int value : count) total += value;
+	return total;
+}
+
+size_t Util::GpuResourceStats::getBytes() const
+{
+	size_t total = 0;
+	for (size_t value : bytes) total += value;
+	return total;
+}
+
+Util::GpuResourceRegistry& Util::GpuResourceRegistry::get()
+{
+	static GpuResourceRegistry registry;
+	return registry;
+}
+
+Util::GpuHandle Util::GpuResourceRegistry::add(GpuResourceType type, GLuint name, const char* label)
+{
+	if (name == 0) return GpuHandle();
+
+	uint32_t index;
+	if (_freeSlots.empty())
+	{
+		index = uint32_t(_slots.size());
+		_slots.emplace_back();
+	}
+	else
+	{
+		index = _freeSlots.back();
+		_freeSlots.pop_back();
+	}
+
+	Slot& slot = _slots[index];
+	slot.name = name;
+	slot.type = type;
+	slot.generation++;
+	slot.live = true;
+	slot.bytes = 0;
+	snprintf(slot.label, sizeof(slot.label), "%s", label ? label : "");
+
+	_count[int(type)]++;
+	_created++;
+
+	GpuHandle handle{ index, slot.generation };
+	//The driver's copy of the linked program is the only size GL reports for one
+	if (type == GpuResourceType::PROGRAM && GLAD_GL_VERSION_4_1)
+	{
+		GLint binaryLength = 0;
+		glGetProgramiv(name, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+		setBytes(handle, size_t(binaryLength));
+	}
+	return handle;
+}
+
+void Util::GpuResourceRegistry::release(GpuHandle handle)
+{
+	if (handle.index >= _slots.size()) return;
+
+	Slot& slot = _slots[handle.index];
+	if (!slot.live || slot.generation != handle.generation) return;
+
+	//Stale from here on, the slot is only recycled once the object is actually deleted
+	slot.live = false;
+	slot.generation++;
+	_count[int(slot.type)]--;
+	_bytes[int(slot.type)] -= slot.bytes;
+	_pendingBytes += slot.bytes;
+	_released.push_back(handle.index);
+}
+
+GLuint Util::GpuResourceRegistry::resolve(GpuHandle handle) const
+{
+	if (handle.index >= _slots.size()) return 0;
+
+	const Slot& slot = _slots[handle.index];
+	return slot.live && slot.generation == handle.generation ? slot.name : 0;
+}
+
+Util::GpuHandle Util::GpuResourceRegistry::find(GpuResourceType type, GLuint name) const
+{
+	if (name == 0) return GpuHandle();
+
+	for (uint32_t index = 0; index < _slots.size(); index++)
+	{
+		const Slot& slot = _slots[index];
+		if (slot.live && slot.type == type && slot.name == name) return GpuHandle{ index, slot.generation };
+	}
+	return GpuHandle();
+}
+
+void Util::GpuResourceRegistry::setBytes(GpuHandle handle, size_t bytes)
+{
+	if (!resolve(handle)) return;
+
+	Slot& slot = _slots[handle.index];
+	int type = int(slot.type);
+	_bytes[type] += bytes - slot.bytes;
+	if (_bytes[type] > _peakBytes[type]) _peakBytes[type] = _bytes[type];
+	slot.bytes = bytes;
+}
+
+void Util::GpuResourceRegistry::endFrame()
+{
+	//Fences signal in order, so the first unsignalled batch ends the scan
+	size_t finished = 0;
+	while (finished < _batches.size())
+	{
+		GLenum result = glClientWaitSync(_batches[finished].fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+
+		glDeleteSync(_batches[finished].fence);
+		for (uint32_t index : _batches[finished].slots) deleteSlot(index);
+		finished++;
+	}
+	if (finished > 0) _batches.erase(_batches.begin(), _batches.begin() + finished);
+
+	if (_released.empty()) return;
+
+	Batch batch;
+	batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	batch.slots.swap(_released);
+	_batches.push_back(std::move(batch));
+}
+
+void Util::GpuResourceRegistry::flush()
+{
+	PROFILE_SCOPE("Util::GpuResourceRegistry::flush");
+
+	for (Batch& batch : _batches)
+	{
+		while (glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GPU_RESOURCE_WAIT_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(batch.fence);
+		for (uint32_t index : batch.slots) deleteSlot(index);
+	}
+	_batches.clear();
+
+	//Released this frame, nothing queued after them is left to wait for
+	glFinish();
+	for (uint32_t index : _released) deleteSlot(index);
+	_released.clear();
+}
+
+void Util::GpuResourceRegistry::addDeleteCallback(GpuDeleteCallback callback, void* userData)
+{
+	_callbacks.push_back(Callback{ callback, userData });
+}
+
+void Util::GpuResourceRegistry::removeDeleteCallback(GpuDeleteCallback callback, void* userData)
+{
+	for (size_t i = 0; i < _callbacks.size(); i++)
+	{
+		if (_callbacks[i].function == callback && _callbacks[i].userData == userData)
+		{
+			_callbacks.erase(_callbacks.begin() + i);
+			return;
+		}
+	}
+}
+
+Util::GpuResourceStats Util::GpuResourceRegistry::getStats() const
+{
+	GpuResourceStats stats;
+	for (int i = 0; i < int(GpuResourceType::COUNT); i++)
+	{
+		stats.count[i] = _count[i];
+		stats.bytes[i] = _bytes[i];
+		stats.peakBytes[i] = _peakBytes[i];
+	}
+	stats.pendingCount = 0;
+	for (const Batch& batch : _batches) stats.pendingCount += int(batch.slots.size());
+	stats.pendingCount += int(_released.size());
+	stats.pendingBytes = _pendingBytes;
+	stats.created = _created;
+	stats.deleted = _deleted;
+	return stats;
+}
+
+void Util::GpuResourceRegistry::resetPeaks()
+{
+	for (int i = 0; i < int(GpuResourceType::COUNT); i++) _peakBytes[i] = _bytes[i];
+}
+
+int Util::GpuResourceRegistry::printLive() const
+{
+	int live = 0;
+	for (const Slot& slot : _slots)
+	{
+		if (!slot.live) continue;
+
+		printf("Live %s %u (%s): %zu bytes\n", getGpuResourceTypeName(slot.type), slot.name, slot.label, slot.bytes);
+		live++;
+	}
+	return live;
+}
+
+void Util::GpuResourceRegistry::deleteSlot(uint32_t index)
+{
+	Slot& slot = _slots[index];
+	switch (slot.type)
+	{
+	case GpuResourceType::BUFFER: glDeleteBuffers(1, &slot.name); break;
+	case GpuResourceType::TEXTURE: glDeleteTextures(1, &slot.name); break;
+	case GpuResourceType::PROGRAM: glDeleteProgram(slot.name); break;
+	case GpuResourceType::VERTEX_ARRAY: glDeleteVertexArrays(1, &slot.name); break;
+	default: break;
+	}
+	for (const Callback& callback : _callbacks) callback.function(slot.type, slot.name, callback.userData);
+
+	_pendingBytes -= slot.bytes;
+	_deleted++;
+	slot.name = 0;
+	slot.bytes = 0;
+	_freeSlots.push_back(index);
+}
+
+Util::GpuResource::GpuResource(GpuResourceType type, GLuint name, const char* label)
+	: _handle(GpuResourceRegistry::get().add(type, name, label)), _name(name)
+{
+}
+
+Util::GpuResource::GpuResource(GpuResource&& other) noexcept
+	: _handle(other._handle), _name(other._name)
+{
+	other._handle = GpuHandle();
+	other._name = 0;
+}
+
+Util::GpuResource& Util::GpuResource::operator=(GpuResource&& other) noexcept
+{
+	if (this == &other) return *this;
+
+	reset();
+	_handle = other._handle;
+	_name = other._name;
+	other._handle = GpuHandle();
+	other._name = 0;
+	return *this;
+}
+
+Util::GpuResource Util::GpuResource::create(GpuResourceType type, const char* label, GLenum textureTarget)
+{
+	GLuint name = 0;
+	if (GLAD_GL_VERSION_4_5)
+	{
+		switch (type)
+		{
+		case GpuResourceType::BUFFER: glCreateBuffers(1, &name); break;
+		case GpuResourceType::TEXTURE: glCreateTextures(textureTarget, 1, &name); break;
+		case GpuResourceType::VERTEX_ARRAY: glCreateVertexArrays(1, &name); break;
+		default: break;
+		}
+		return GpuResource(type, name, label);
+	}
+
+	switch (type)
+	{
+	case GpuResourceType::BUFFER: glGenBuffers(1, &name); break;
+	case GpuResourceType::TEXTURE: glGenTextures(1, &name); break;
+	case GpuResourceType::VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+	default: break;
+	}
+	return GpuResource(type, name, label);
+}
+
+void Util::GpuResource::reset()
+{
+	if (!_name) return;
+
+	GpuResourceRegistry::get().release(_handle);
+	_handle = GpuHandle();
+	_name = 0;
+}
+
+void Util::GpuResource::setBytes(size_t bytes)
+{
+	GpuResourceRegistry::get().setBytes(_handle, bytes);
+}
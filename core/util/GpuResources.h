@@ -0,0 +1,177 @@
+/*
+* Created by Adam Gyenes
+* Ownership and accounting of GL objects. Buffers, textures, programs and vertex arrays are registered under
+* generational handles and owned by a move-only Util::GpuResource. Releasing one only queues it, the object is deleted
+* once the GPU finished the frame that released it
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../ew/external/glad.h"
+
+//Longer labels are truncated
+constexpr int GPU_RESOURCE_LABEL_SIZE = 48;
+
+namespace Util
+{
+	enum class GpuResourceType
+	{
+		BUFFER = 0,
+		TEXTURE,
+		PROGRAM,
+		VERTEX_ARRAY,
+		COUNT
+	};
+
+	const char* getGpuResourceTypeName(GpuResourceType type);
+
+	//Bytes of a texture with bytesPerPixel, a full mip chain adds a third
+	size_t getTextureBytes(int width, int height, int bytesPerPixel, bool mipmaps);
+
+	//Refers to a registered object without owning it, goes stale as soon as the object is released
+	struct GpuHandle
+	{
+		uint32_t index = 0;
+		//Live generations start at 1, so a default handle is always stale
+		uint32_t generation = 0;
+
+		bool operator==(const GpuHandle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const GpuHandle& other) const { return !(*this == other); }
+	};
+
+	struct GpuResourceStats
+	{
+		//Live objects and the memory behind them, per GpuResourceType
+		int count[int(GpuResourceType::COUNT)] = {};
+		size_t bytes[int(GpuResourceType::COUNT)] = {};
+		//Highest bytes since the last resetPeaks()
+		size_t peakBytes[int(GpuResourceType::COUNT)] = {};
+
+		//Released, waiting for the GPU to finish the frame that released them
+		int pendingCount = 0;
+		size_t pendingBytes = 0;
+
+		uint64_t created = 0;
+		uint64_t deleted = 0;
+
+		int getCount() const;
+		size_t getBytes() const;
+	};
+
+	//Called right after an object is deleted, so caches can drop a name GL may hand out again
+	typedef void (*GpuDeleteCallback)(GpuResourceType type, GLuint name, void* userData);
+
+	//GL thread only, except release() which never touches GL and is safe after the context is gone
+	class GpuResourceRegistry
+	{
+	public:
+		static GpuResourceRegistry& get();
+
+		GpuResourceRegistry(const GpuResourceRegistry&) = delete;
+		GpuResourceRegistry& operator=(const GpuResourceRegistry&) = delete;
+
+		//Takes ownership of name. Programs are sized from their binary length, everything else through setBytes()
+		GpuHandle add(GpuResourceType type, GLuint name, const char* label);
+		void release(GpuHandle handle);
+		//0 if the handle is stale
+		GLuint resolve(GpuHandle handle) const;
+		//Handle of the live object named name, for the ew layer which keeps plain GL names. A linear search, only for
+		//creation and deletion
+		GpuHandle find(GpuResourceType type, GLuint name) const;
+		//Call whenever the object's storage is (re)specified
+		void setBytes(GpuHandle handle, size_t bytes);
+
+		//Deletes what the GPU is done with and fences what was released since the last call. Once per frame, after the
+		//frame's last command
+		void endFrame();
+		//Waits for the GPU and deletes everything released so far, e.g. before the context is destroyed
+		void flush();
+
+		void addDeleteCallback(GpuDeleteCallback callback, void* userData);
+		void removeDeleteCallback(GpuDeleteCallback callback, void* userData);
+
+		GpuResourceStats getStats() const;
+		void resetPeaks();
+		//Prints every live object with its label and size, returns how many there are
+		int printLive() const;
+
+	private:
+		GpuResourceRegistry() {};
+
+		struct Slot
+		{
+			GLuint name = 0;
+			GpuResourceType type = GpuResourceType::BUFFER;
+			uint32_t generation = 0;
+			bool live = false;
+			size_t bytes = 0;
+			char label[GPU_RESOURCE_LABEL_SIZE] = {};
+		};
+
+		//Objects released during one frame, deleted together once its fence signals
+		struct Batch
+		{
+			GLsync fence;
+			std::vector<uint32_t> slots;
+		};
+
+		struct Callback
+		{
+			GpuDeleteCallback function;
+			void* userData;
+		};
+
+		void deleteSlot(uint32_t index);
+
+		std::vector<Slot> _slots;
+		std::vector<uint32_t> _freeSlots;
+		//Released since the last endFrame()
+		std::vector<uint32_t> _released;
+		std::vector<Batch> _batches;
+		std::vector<Callback> _callbacks;
+
+		size_t _bytes[int(GpuResourceType::COUNT)] = {};
+		size_t _peakBytes[int(GpuResourceType::COUNT)] = {};
+		int _count[int(GpuResourceType::COUNT)] = {};
+		size_t _pendingBytes = 0;
+		uint64_t _created = 0;
+		uint64_t _deleted = 0;
+	};
+
+	//Owns one registered GL object, releasing it when destroyed or reassigned. Move-only
+	class GpuResource
+	{
+	public:
+		GpuResource() {};
+		//Takes ownership of an existing object
+		GpuResource(GpuResourceType type, GLuint name, const char* label);
+		~GpuResource() { reset(); }
+
+		GpuResource(GpuResource&& other) noexcept;
+		GpuResource& operator=(GpuResource&& other) noexcept;
+		GpuResource(const GpuResource&) = delete;
+		GpuResource& operator=(const GpuResource&) = delete;
+
+		//Creates a new buffer, texture or vertex array. Programs come from glCreateProgram and the constructor.
+		//With GL 4.5 the object exists right away (glCreate*), so DSA calls work on it before it was ever bound.
+		//textureTarget is the only target the texture may be bound to then
+		static GpuResource create(GpuResourceType type, const char* label, GLenum textureTarget = GL_TEXTURE_2D);
+
+		void reset();
+
+		//Valid as long as this owns the object, non-owners should hold the handle instead
+		GLuint get() const { return _name; }
+		GpuHandle getHandle() const { return _handle; }
+		bool isValid() const { return _name != 0; }
+
+		void setBytes(size_t bytes);
+
+	private:
+		GpuHandle _handle;
+		GLuint _name = 0;
+	};
+}
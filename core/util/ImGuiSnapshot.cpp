@@ -0,0 +1,50 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "ImGuiSnapshot.h"
+
+#include <cstring>
+
+template<typename T>
+static void copyVector(ImVector<T>& dst, const ImVector<T>& src)
+{
+	dst.resize(src.Size);
+	if (src.Size > 0) memcpy(dst.Data, src.Data, src.size_in_bytes());
+}
+
+Util::ImGuiSnapshot::~ImGuiSnapshot()
+{
+	for (ImDrawList* list : _lists)
+	{
+		IM_DELETE(list);
+	}
+}
+
+void Util::ImGuiSnapshot::capture(const ImDrawData* drawData)
+{
+	if (!drawData || !drawData->Valid)
+	{
+		_drawData.Clear();
+		return;
+	}
+
+	while (int(_lists.size()) < drawData->CmdListsCount)
+	{
+		_lists.push_back(IM_NEW(ImDrawList)(drawData->CmdLists[0]->_Data));
+	}
+
+	//Only the output buffers are needed to render, the rest of ImDrawList is recording state
+	for (int i = 0; i < drawData->CmdListsCount; i++)
+	{
+		const ImDrawList* src = drawData->CmdLists[i];
+		ImDrawList* dst = _lists[i];
+		copyVector(dst->CmdBuffer, src->CmdBuffer);
+		copyVector(dst->IdxBuffer, src->IdxBuffer);
+		copyVector(dst->VtxBuffer, src->VtxBuffer);
+		dst->Flags = src->Flags;
+	}
+
+	_drawData = *drawData;
+	_drawData.CmdLists = _lists.data();
+}
@@ -0,0 +1,33 @@
+/*
+* Created by Adam Gyenes
+* Deep copy of a frame's ImGui draw data, so the UI thread can start the next frame while another thread renders this one
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <imgui.h>
+
+namespace Util
+{
+	class ImGuiSnapshot
+	{
+	public:
+		ImGuiSnapshot() {};
+		~ImGuiSnapshot();
+
+		ImGuiSnapshot(const ImGuiSnapshot&) = delete;
+		ImGuiSnapshot& operator=(const ImGuiSnapshot&) = delete;
+
+		//Call right after ImGui::Render(), the copied lists keep their buffers so steady state UI doesn't allocate
+		void capture(const ImDrawData* drawData);
+		//For ImGui_ImplOpenGL3_RenderDrawData, nullptr if nothing was captured.
+		//Backends take a non-const pointer but only read from it
+		ImDrawData* getDrawData() const { return _drawData.Valid ? const_cast<ImDrawData*>(&_drawData) : nullptr; }
+
+	private:
+		ImDrawData _drawData;
+		std::vector<ImDrawList*> _lists;
+	};
+}
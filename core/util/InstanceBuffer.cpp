@@ -0,0 +1,70 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "InstanceBuffer.h"
+
+#include <algorithm>
+#include <string>
+
+Util::InstanceBuffer::InstanceBuffer(size_t instanceSize, int capacity, GLuint binding, const char* label) :
+	_instanceSize(instanceSize),
+	_capacity(std::max(capacity, 1)),
+	_binding(binding)
+{
+	GpuResourceRegistry::get().addDeleteCallback(forgetDeleted, this);
+
+	if (!isSupported()) return;
+
+	//Rewritten with glNamedBufferSubData by frames without a FrameSync ring, read by the GPU only
+	_buffer = GpuResource::create(GpuResourceType::BUFFER, (std::string(label) + " instances").c_str());
+	glNamedBufferStorage(_buffer.get(), _instanceSize * _capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	_buffer.setBytes(_instanceSize * _capacity);
+
+	//Nothing attached, vertices come from gl_VertexID but core profiles can't draw without a vertex array bound
+	_vertexArray = GpuResource::create(GpuResourceType::VERTEX_ARRAY, label);
+	_bindings.vertexArray = _vertexArray.get();
+}
+
+Util::InstanceBuffer::~InstanceBuffer()
+{
+	GpuResourceRegistry::get().removeDeleteCallback(forgetDeleted, this);
+}
+
+bool Util::InstanceBuffer::hasRoom(size_t queued)
+{
+	if (queued < size_t(_capacity)) return true;
+	_overflows++;
+	return false;
+}
+
+bool Util::InstanceBuffer::changeProgram(GLuint program)
+{
+	if (program == _program) return false;
+	_program = program;
+	return true;
+}
+
+void Util::InstanceBuffer::bind(GLStateCache& stateCache, GLuint program, const void* instances, int count, FrameSync* frameSync)
+{
+	GLsizeiptr bytes = GLsizeiptr(_instanceSize) * std::min(count, _capacity);
+
+	//Offset aligned for storage buffers by default
+	TransientBuffer range;
+	if (frameSync && bytes > 0) range = frameSync->upload(instances, bytes);
+	if (!range.isValid())
+	{
+		glNamedBufferSubData(_buffer.get(), 0, bytes, instances);
+		range.buffer = _buffer.get();
+	}
+
+	stateCache.useProgram(program);
+	stateCache.bindVertexBindings(_bindings);
+	stateCache.bindBufferRange(GL_SHADER_STORAGE_BUFFER, _binding, range.buffer, range.offset, range.size);
+}
+
+void Util::InstanceBuffer::forgetDeleted(GpuResourceType type, GLuint name, void* userData)
+{
+	InstanceBuffer* buffer = static_cast<InstanceBuffer*>(userData);
+	if (type == GpuResourceType::PROGRAM && buffer->_program == name) buffer->_program = 0;
+}
@@ -0,0 +1,68 @@
+/*
+* Created by Adam Gyenes
+* The GPU side shared by the attribute-less instanced renderers (Util::ProceduralRenderer, Util::SphereImpostorRenderer):
+* a fixed capacity shader storage array filled every frame, the empty vertex array they draw with, and which program
+* their uniform locations belong to
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "../ew/external/glad.h"
+
+#include "FrameSync.h"
+#include "GLStateCache.h"
+#include "GpuResources.h"
+#include "VertexFormat.h"
+
+namespace Util
+{
+	//GL thread only. Registers with Util::GpuResourceRegistry, so a deleted program whose name GL hands out again is
+	//still seen as a new program
+	class InstanceBuffer
+	{
+	public:
+		//Room for capacity instances of instanceSize bytes, bound at binding for the vertex shader. No GL objects are
+		//created without isSupported()
+		InstanceBuffer(size_t instanceSize, int capacity, GLuint binding, const char* label);
+		~InstanceBuffer();
+
+		InstanceBuffer(const InstanceBuffer&) = delete;
+		InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+		//Storage buffers need GL 4.3, the buffer is created with direct state access
+		static bool isSupported() { return GLAD_GL_VERSION_4_5 != 0; }
+
+		int getCapacity() const { return _capacity; }
+
+		//False once queued instances fill the buffer, the instance that didn't fit is counted as an overflow
+		bool hasRoom(size_t queued);
+		int getOverflows() const { return _overflows; }
+		void resetOverflows() { _overflows = 0; }
+
+		//True if program isn't the one passed last time, or that one was deleted since: its uniform locations have to
+		//be looked up again
+		bool changeProgram(GLuint program);
+
+		//Uploads the first count instances, then binds program, the vertex array and the instances for drawing. With
+		//frameSync (between its beginFrame and endFrame) they go into the frame's ring region and are bound at that
+		//offset. Without one, or once the region is full, they overwrite this buffer's own storage, which waits for any
+		//draw still reading the last frame's
+		void bind(GLStateCache& stateCache, GLuint program, const void* instances, int count, FrameSync* frameSync = nullptr);
+
+	private:
+		static void forgetDeleted(GpuResourceType type, GLuint name, void* userData);
+
+		size_t _instanceSize;
+		int _capacity;
+		GLuint _binding;
+		int _overflows = 0;
+
+		GpuResource _buffer;
+		GpuResource _vertexArray;
+		VertexBindings _bindings;
+
+		GLuint _program = 0;
+	};
+}
@@ -0,0 +1,329 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+
+constexpr int64_t JOB_DEQUE_MASK = JOB_DEQUE_SIZE - 1;
+static_assert((JOB_DEQUE_SIZE & JOB_DEQUE_MASK) == 0, "JOB_DEQUE_SIZE must be a power of two");
+static_assert((JOB_POOL_SIZE & (JOB_POOL_SIZE - 1)) == 0, "JOB_POOL_SIZE must be a power of two");
+
+//Which system and worker the calling thread belongs to
+struct CurrentWorker
+{
+	const Util::JobSystem* system = nullptr;
+	int worker = -1;
+};
+
+static thread_local CurrentWorker currentWorker;
+
+//Seq_cst on the indices instead of the paper's standalone fences, same cost on x86 and visible to thread sanitizers
+bool Util::JobSystem::Deque::push(Job* job)
+{
+	int64_t bottom = _bottom.load(std::memory_order_relaxed);
+	int64_t top = _top.load(std::memory_order_acquire);
+	if (bottom - top >= JOB_DEQUE_SIZE) return false;
+
+	_jobs[bottom & JOB_DEQUE_MASK].store(job, std::memory_order_relaxed);
+	_bottom.store(bottom + 1, std::memory_order_seq_cst);
+	return true;
+}
+
+Util::Job* Util::JobSystem::Deque::pop()
+{
+	int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+	_bottom.store(bottom, std::memory_order_seq_cst);
+	int64_t top = _top.load(std::memory_order_seq_cst);
+
+	if (top > bottom)
+	{
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = _jobs[bottom & JOB_DEQUE_MASK].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		//Last job, race the thieves for it
+		if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Util::Job* Util::JobSystem::Deque::steal()
+{
+	int64_t top = _top.load(std::memory_order_seq_cst);
+	int64_t bottom = _bottom.load(std::memory_order_seq_cst);
+	if (top >= bottom) return nullptr;
+
+	Job* job = _jobs[top & JOB_DEQUE_MASK].load(std::memory_order_relaxed);
+	if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+	return job;
+}
+
+bool Util::JobSystem::Deque::empty() const
+{
+	return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+}
+
+Util::JobSystem::JobSystem(int threadCount)
+{
+	if (threadCount <= 0) threadCount = int(std::thread::hardware_concurrency());
+	_threadCount = threadCount > 0 ? threadCount : 1;
+
+	_workers.reset(new Worker[_threadCount]);
+	for (int i = 0; i < _threadCount; i++)
+	{
+		_workers[i].pool.reset(new Job[JOB_POOL_SIZE]);
+	}
+
+	_outerSystem = currentWorker.system;
+	_outerWorker = currentWorker.worker;
+	currentWorker = CurrentWorker{ this, 0 };
+	for (int i = 1; i < _threadCount; i++)
+	{
+		_threads.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+Util::JobSystem::~JobSystem()
+{
+	while (_queued.load() > 0)
+	{
+		if (!runOne(0)) std::this_thread::yield();
+	}
+	runMainThreadJobs();
+
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread& thread : _threads)
+	{
+		thread.join();
+	}
+
+	if (currentWorker.system == this) currentWorker = CurrentWorker{ _outerSystem, _outerWorker };
+}
+
+int Util::JobSystem::getCurrentWorker() const
+{
+	return currentWorker.system == this ? currentWorker.worker : -1;
+}
+
+Util::Job* Util::JobSystem::allocateJob()
+{
+	int worker = getCurrentWorker();
+	if (worker >= 0)
+	{
+		//Only the owner allocates from its pool, any thread may release a job back into it
+		Worker& owner = _workers[worker];
+		Job& job = owner.pool[owner.poolIndex++ & (JOB_POOL_SIZE - 1)];
+		if (!job.active.load(std::memory_order_acquire))
+		{
+			job.active.store(true, std::memory_order_relaxed);
+			job.heap = false;
+			return &job;
+		}
+	}
+
+	//Pool slot still in use (a long running or parked job) or not called from a worker
+	Job* job = new Job();
+	job->heap = true;
+	return job;
+}
+
+void Util::JobSystem::submit(Job* job, JobCounter* dependency)
+{
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->_mutex);
+		if (dependency->_pending.load(std::memory_order_acquire) > 0)
+		{
+			dependency->_continuations.push_back(job);
+			return;
+		}
+	}
+	schedule(job);
+}
+
+void Util::JobSystem::schedule(Job* job)
+{
+	if (job->mainThread)
+	{
+		std::lock_guard<std::mutex> lock(_mainMutex);
+		_mainQueue.push_back(job);
+		return;
+	}
+
+	int worker = getCurrentWorker();
+	if (worker >= 0)
+	{
+		if (!_workers[worker].deque.push(job))
+		{
+			execute(job, worker);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(_injectMutex);
+		_injected.push_back(job);
+		_injectedCount.fetch_add(1);
+	}
+
+	//Pairs with the sleeping check in workerLoop, one of the two sides always sees the other
+	_queued.fetch_add(1);
+	if (_sleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_wake.notify_one();
+	}
+}
+
+void Util::JobSystem::execute(Job* job, int worker)
+{
+	job->invoke(*job, worker);
+	job->destroy(*job);
+
+	JobCounter* counter = job->counter;
+	if (job->heap) delete job;
+	else job->active.store(false, std::memory_order_release);
+
+	if (counter) finish(*counter);
+}
+
+void Util::JobSystem::finish(JobCounter& counter)
+{
+	int pending = counter._pending.load(std::memory_order_relaxed);
+	while (pending > 1)
+	{
+		if (counter._pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) return;
+	}
+
+	std::vector<Job*> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter._mutex);
+		if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+		ready.swap(counter._continuations);
+		if (counter._sleepers > 0) counter._zero.notify_all();
+	}
+
+	for (Job* job : ready)
+	{
+		schedule(job);
+	}
+}
+
+Util::Job* Util::JobSystem::findJob(int worker)
+{
+	if (Job* job = _workers[worker].deque.pop()) return job;
+
+	if (_injectedCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(_injectMutex);
+		if (!_injected.empty())
+		{
+			Job* job = _injected.back();
+			_injected.pop_back();
+			_injectedCount.fetch_sub(1);
+			return job;
+		}
+	}
+
+	for (int i = 1; i < _threadCount; i++)
+	{
+		if (Job* job = _workers[(worker + i) % _threadCount].deque.steal()) return job;
+	}
+	return nullptr;
+}
+
+bool Util::JobSystem::runOne(int worker)
+{
+	if (worker == 0 && runMainThreadJobs() > 0) return true;
+
+	Job* job = findJob(worker);
+	if (!job) return false;
+
+	_queued.fetch_sub(1);
+	execute(job, worker);
+	return true;
+}
+
+int Util::JobSystem::runMainThreadJobs()
+{
+	//Swapped out so main thread jobs can themselves wait and run newer ones
+	std::vector<Job*> jobs;
+	{
+		std::lock_guard<std::mutex> lock(_mainMutex);
+		if (_mainQueue.empty()) return 0;
+		jobs.swap(_mainQueue);
+	}
+
+	for (Job* job : jobs)
+	{
+		execute(job, 0);
+	}
+	return int(jobs.size());
+}
+
+void Util::JobSystem::wait(JobCounter& counter)
+{
+	int worker = getCurrentWorker();
+	if (worker >= 0)
+	{
+		while (counter._pending.load(std::memory_order_acquire) > 0)
+		{
+			if (!runOne(worker)) std::this_thread::yield();
+		}
+	}
+	else
+	{
+		std::unique_lock<std::mutex> lock(counter._mutex);
+		counter._sleepers++;
+		counter._zero.wait(lock, [&counter]() { return counter._pending.load(std::memory_order_acquire) == 0; });
+		counter._sleepers--;
+		return;
+	}
+
+	//The thread that brought the counter to zero may still be inside finish()
+	std::lock_guard<std::mutex> lock(counter._mutex);
+}
+
+void Util::JobSystem::workerLoop(int worker)
+{
+	currentWorker = CurrentWorker{ this, worker };
+	std::string name = "Worker " + std::to_string(worker);
+	Util::Profiler::get().setThreadName(name.c_str());
+
+	int idleSpins = 0;
+	while (true)
+	{
+		if (runOne(worker))
+		{
+			idleSpins = 0;
+			continue;
+		}
+		if (++idleSpins < JOB_IDLE_SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		idleSpins = 0;
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		if (_quit) return;
+
+		_sleeping.fetch_add(1);
+		_wake.wait(lock, [this]() { return _quit || _queued.load() > 0; });
+		_sleeping.fetch_sub(1);
+		if (_quit) return;
+	}
+}
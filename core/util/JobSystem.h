@@ -0,0 +1,293 @@
+/*
+* Created by Adam Gyenes
+* Work-stealing job scheduler. Every worker owns a Chase-Lev deque, pushes and pops its own end and steals
+* from the others'. Counters track completion and double as dependencies, GL work can be pinned to the main thread.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//Jobs a worker's deque can hold, pushing to a full deque runs the job immediately instead
+constexpr int JOB_DEQUE_SIZE = 4096;
+//Jobs each worker allocates from before falling back to the heap
+constexpr int JOB_POOL_SIZE = 4096;
+//Bytes of captured state stored inside the job, bigger lambdas don't compile
+constexpr int JOB_STORAGE_SIZE = 64;
+//parallelFor picks a grain that gives every worker roughly this many pieces
+constexpr int JOB_PARALLEL_FOR_SPLITS = 16;
+//Failed attempts to find a job before an idle worker goes to sleep
+constexpr int JOB_IDLE_SPINS = 64;
+
+namespace Util
+{
+	class JobCounter;
+
+	struct Job
+	{
+		void (*invoke)(Job& job, int worker);
+		void (*destroy)(Job& job);
+		alignas(std::max_align_t) unsigned char storage[JOB_STORAGE_SIZE];
+
+		//Decremented once the job finished
+		JobCounter* counter;
+		bool mainThread;
+		bool heap;
+		//Pool jobs are reused once this is cleared
+		std::atomic<bool> active{ false };
+	};
+
+	//Number of unfinished jobs. Wait for it with JobSystem::wait or pass it as another job's dependency.
+	//Add every job a dependency covers before the counter can reach zero, continuations run as soon as it does
+	class JobCounter
+	{
+	public:
+		JobCounter() {};
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> _pending{ 0 };
+
+		//The last decrement happens under this lock, so a waiter that locked it after seeing zero can destroy the counter
+		std::mutex _mutex;
+		std::condition_variable _zero;
+		int _sleepers = 0;
+		std::vector<Job*> _continuations;
+	};
+
+	//Jobs may take the worker index or nothing
+	template<typename F>
+	auto callJobFunction(F& function, int worker, int) -> decltype(function(worker), void())
+	{
+		function(worker);
+	}
+
+	template<typename F>
+	void callJobFunction(F& function, int, long)
+	{
+		function();
+	}
+
+	class JobSystem
+	{
+	public:
+		//threadCount includes the calling thread, which becomes the main thread (worker 0). 0 uses every hardware thread.
+		//With a single thread, jobs queued from other threads only run while the main thread is inside wait()
+		JobSystem(int threadCount = 0);
+		//Runs the jobs that are still queued, then joins the workers
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		//Queues function(), or function(worker). counter is incremented now and decremented once it returned,
+		//a dependency holds the job back until that counter reaches zero
+		template<typename F>
+		void run(F&& function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+		//Same as run(), but only ever executes on the main thread inside runMainThreadJobs() or wait(). For GL calls
+		template<typename F>
+		void runOnMainThread(F&& function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+		//Calls function(begin, end, worker) on disjoint ranges covering [0, count) and blocks until all returned.
+		//Ranges are split lazily, only when the worker's deque ran dry, so idle workers always find something to steal.
+		//Pieces are never smaller than minGrain
+		template<typename F>
+		void parallelFor(int count, F&& function, int minGrain = 1);
+
+		//Workers and the main thread run other jobs while waiting, any other thread sleeps
+		void wait(JobCounter& counter);
+
+		//Call from the main thread once per frame, returns the number of jobs it ran
+		int runMainThreadJobs();
+
+		int getThreadCount() const { return _threadCount; }
+		//Worker index of the calling thread in this system, -1 for threads that don't belong to it
+		int getCurrentWorker() const;
+
+	private:
+		//Fixed size Chase-Lev deque, "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+		class Deque
+		{
+		public:
+			//Owner only
+			bool push(Job* job);
+			Job* pop();
+			//Any thread
+			Job* steal();
+			bool empty() const;
+
+		private:
+			//Thieves hammer _top, keep it off the owner's cache line
+			std::atomic<int64_t> _top{ 0 };
+			char _padding[64 - sizeof(std::atomic<int64_t>)];
+			std::atomic<int64_t> _bottom{ 0 };
+			std::atomic<Job*> _jobs[JOB_DEQUE_SIZE] = {};
+		};
+
+		struct Worker
+		{
+			Deque deque;
+			std::unique_ptr<Job[]> pool;
+			int poolIndex = 0;
+		};
+
+		template<typename F>
+		static void invokeJob(Job& job, int worker);
+		template<typename F>
+		static void destroyJob(Job& job);
+
+		template<typename F>
+		Job* createJob(F&& function, JobCounter* counter, bool mainThread);
+		Job* allocateJob();
+
+		//Runs the job now if its dependency is done, otherwise parks it on the dependency
+		void submit(Job* job, JobCounter* dependency);
+		void schedule(Job* job);
+		void execute(Job* job, int worker);
+		void finish(JobCounter& counter);
+		//Main thread jobs (worker 0 only), then one job from our deque, the injection queue or a victim's deque
+		bool runOne(int worker);
+		Job* findJob(int worker);
+		void workerLoop(int worker);
+
+		template<typename F>
+		void runRange(F& function, int begin, int end, int grain, JobCounter& counter, int worker);
+
+		int _threadCount = 1;
+		//The constructing thread's previous system and worker, restored on destruction so systems can nest
+		const JobSystem* _outerSystem = nullptr;
+		int _outerWorker = -1;
+		std::unique_ptr<Worker[]> _workers;
+		std::vector<std::thread> _threads;
+
+		//Jobs queued from threads outside the system
+		std::mutex _injectMutex;
+		std::vector<Job*> _injected;
+		std::atomic<int> _injectedCount{ 0 };
+
+		std::mutex _mainMutex;
+		std::vector<Job*> _mainQueue;
+
+		//Idle workers sleep here, _queued is only a hint of how many jobs are up for grabs
+		std::mutex _sleepMutex;
+		std::condition_variable _wake;
+		std::atomic<int> _queued{ 0 };
+		std::atomic<int> _sleeping{ 0 };
+		bool _quit = false;
+	};
+}
+
+template<typename F>
+void Util::JobSystem::invokeJob(Job& job, int worker)
+{
+	callJobFunction(*reinterpret_cast<F*>(job.storage), worker, 0);
+}
+
+template<typename F>
+void Util::JobSystem::destroyJob(Job& job)
+{
+	reinterpret_cast<F*>(job.storage)->~F();
+}
+
+template<typename F>
+Util::Job* Util::JobSystem::createJob(F&& function, JobCounter* counter, bool mainThread)
+{
+	typedef std::decay_t<F> Function;
+	static_assert(sizeof(Function) <= JOB_STORAGE_SIZE, "Job captures too much state, capture a pointer to it instead");
+	static_assert(alignof(Function) <= alignof(std::max_align_t), "Over-aligned job");
+
+	Job* job = allocateJob();
+	new (job->storage) Function(std::forward<F>(function));
+	job->invoke = &invokeJob<Function>;
+	job->destroy = &destroyJob<Function>;
+	job->counter = counter;
+	job->mainThread = mainThread;
+	if (counter) counter->_pending.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+template<typename F>
+void Util::JobSystem::run(F&& function, JobCounter* counter, JobCounter* dependency)
+{
+	submit(createJob(std::forward<F>(function), counter, false), dependency);
+}
+
+template<typename F>
+void Util::JobSystem::runOnMainThread(F&& function, JobCounter* counter, JobCounter* dependency)
+{
+	submit(createJob(std::forward<F>(function), counter, true), dependency);
+}
+
+template<typename F>
+void Util::JobSystem::runRange(F& function, int begin, int end, int grain, JobCounter& counter, int worker)
+{
+	while (begin < end)
+	{
+		//Lazy binary splitting: hand out the upper half only while nothing of ours is left to steal
+		if (end - begin > grain && _workers[worker].deque.empty())
+		{
+			int middle = begin + (end - begin) / 2;
+			F* functionPtr = &function;
+			JobCounter* counterPtr = &counter;
+			run([this, functionPtr, middle, end, grain, counterPtr](int worker)
+				{
+					runRange(*functionPtr, middle, end, grain, *counterPtr, worker);
+				}, &counter);
+			end = middle;
+			continue;
+		}
+
+		int pieceEnd = end - begin > grain ? begin + grain : end;
+		function(begin, pieceEnd, worker);
+		begin = pieceEnd;
+	}
+}
+
+template<typename F>
+void Util::JobSystem::parallelFor(int count, F&& function, int minGrain)
+{
+	if (count <= 0) return;
+
+	int grain = count / (_threadCount * JOB_PARALLEL_FOR_SPLITS);
+	if (grain < minGrain) grain = minGrain;
+	if (grain < 1) grain = 1;
+
+	int worker = getCurrentWorker();
+	if (_threadCount == 1 && worker == 0)
+	{
+		function(0, count, 0);
+		return;
+	}
+
+	JobCounter counter;
+	if (worker >= 0)
+	{
+		runRange(function, 0, count, grain, counter, worker);
+	}
+	else
+	{
+		//Threads outside the system can't split on their own deque, a worker starts the range instead
+		std::remove_reference_t<F>* functionPtr = &function;
+		run([this, functionPtr, count, grain, &counter](int worker)
+			{
+				runRange(*functionPtr, 0, count, grain, counter, worker);
+			}, &counter);
+	}
+	wait(counter);
+}
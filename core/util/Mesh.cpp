@@ -3,6 +3,14 @@
 */
 
 #include "Mesh.h"
+#include "MeshStaging.h"
+#include "Profiler.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <unordered_map>
 
 constexpr GLuint POSITION_ATTRIBUTE_INDEX = 0;
 constexpr GLuint NORMAL_ATTRIBUTE_INDEX = 1;
@@ -10,82 +18,300 @@ constexpr GLuint TANGENT_ATTRIBUTE_INDEX = 2;
 constexpr GLuint BITANGENT_ATTRIBUTE_INDEX = 3;
 constexpr GLuint UV_ATTRIBUTE_INDEX = 4;
 
-bool operator==(const ew::Vec3& lhs, const ew::Vec3& rhs)
+//Vertex buffer bindings of the shared vertex formats, the vertices and the tangent stream behind them
+constexpr GLuint VERTEX_BUFFER_BINDING = 0;
+constexpr GLuint TANGENT_BUFFER_BINDING = 1;
+
+//calculateTB's accumulation without a caller's scratch stays on the stack up to this, about 1300 vertices
+constexpr size_t MESH_TB_SCRATCH_BYTES = 16 * 1024;
+
+//Written once right after creation: copied from staging, mapped, or with glNamedBufferSubData for data that overflowed
+//staging or couldn't be mapped
+constexpr GLbitfield MESH_BUFFER_STORAGE_FLAGS = GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT;
+
+//Bitwise position key for deduplicating the depth stream
+struct PositionKey
+{
+	uint32_t bits[3];
+
+	bool operator==(const PositionKey& other) const
+	{
+		return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+	}
+};
+
+struct PositionKeyHash
 {
-	return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+	size_t operator()(const PositionKey& key) const
+	{
+		return (size_t(key.bits[0]) * 73856093u) ^ (size_t(key.bits[1]) * 19349663u) ^ (size_t(key.bits[2]) * 83492791u);
+	}
+};
+
+//Layout of every mesh, tangent and bitangent come from their own binding
+static const Util::VertexFormat& getMeshFormat()
+{
+	static const Util::VertexFormat format = Util::VertexFormat()
+		.add(POSITION_ATTRIBUTE_INDEX, 3, GL_FLOAT, offsetof(ew::Vertex, pos), VERTEX_BUFFER_BINDING)
+		.add(NORMAL_ATTRIBUTE_INDEX, 3, GL_FLOAT, offsetof(ew::Vertex, normal), VERTEX_BUFFER_BINDING)
+		.add(UV_ATTRIBUTE_INDEX, 2, GL_FLOAT, offsetof(ew::Vertex, uv), VERTEX_BUFFER_BINDING)
+		.add(TANGENT_ATTRIBUTE_INDEX, 3, GL_FLOAT, 0, TANGENT_BUFFER_BINDING)
+		.add(BITANGENT_ATTRIBUTE_INDEX, 3, GL_FLOAT, sizeof(ew::Vec3), TANGENT_BUFFER_BINDING);
+	return format;
+}
+
+static const Util::VertexFormat& getDepthFormat()
+{
+	static const Util::VertexFormat format = Util::VertexFormat().add(POSITION_ATTRIBUTE_INDEX, 3, GL_FLOAT, 0, VERTEX_BUFFER_BINDING);
+	return format;
 }
 
-Util::Mesh::Mesh(const ew::MeshData& meshData)
+Util::Mesh::Mesh(const ew::MeshData& meshData, bool createDepthStream, bool retainData)
 {
-	load(meshData);
+	load(meshData, createDepthStream, retainData);
 }
 
-void Util::Mesh::load(const ew::MeshData& meshData)
+//Replaces the buffer's storage. With direct state access that means a new immutable buffer, the registry deletes the
+//old one once the GPU is done drawing it. Otherwise the buffer is bound to target and respecified
+static void allocateStorage(Util::GpuResource& buffer, const char* label, GLenum target, GLsizeiptr size, const void* data)
 {
+	if (GLAD_GL_VERSION_4_5)
+	{
+		buffer = Util::GpuResource::create(Util::GpuResourceType::BUFFER, label);
+		if (size > 0) glNamedBufferStorage(buffer.get(), size, data, MESH_BUFFER_STORAGE_FLAGS);
+	}
+	else
+	{
+		if (!buffer.isValid()) buffer = Util::GpuResource::create(Util::GpuResourceType::BUFFER, label);
+		glBindBuffer(target, buffer.get());
+		glBufferData(target, size, data, GL_STATIC_DRAW);
+	}
+	buffer.setBytes(size);
+}
+
+//Without direct state access buffer has to be bound to target
+static void writeRange(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	if (GLAD_GL_VERSION_4_5) glNamedBufferSubData(buffer, offset, size, data);
+	else glBufferSubData(target, offset, size, data);
+}
+
+//GPU side copy out of staging memory, or a regular upload for data that overflowed into the heap
+static void uploadRange(GLuint buffer, GLenum target, GLintptr offset, const void* data, GLsizeiptr size, const Util::MeshStaging& staging)
+{
+	GLintptr stagingOffset = staging.getOffset(data);
+	if (stagingOffset < 0)
+	{
+		writeRange(buffer, target, offset, size, data);
+		return;
+	}
+
+	if (GLAD_GL_VERSION_4_5)
+	{
+		glCopyNamedBufferSubData(staging.getBuffer(), buffer, stagingOffset, offset, size);
+		return;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, staging.getBuffer());
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, target, stagingOffset, offset, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void Util::Mesh::load(const ew::MeshData& meshData, bool createDepthStream, bool retainData)
+{
+	upload(meshData, nullptr, createDepthStream, retainData);
+}
+
+void Util::Mesh::load(const ew::MeshData& meshData, const TBArray& tangents, bool createDepthStream, bool retainData)
+{
+	upload(meshData, &tangents, createDepthStream, retainData);
+}
+
+void Util::Mesh::upload(const ew::MeshData& meshData, const TBArray* tangents, bool createDepthStream, bool retainData)
+{
+	PROFILE_SCOPE("Util::Mesh::load");
+
 	if (meshData.vertices.empty()) return;
 
-	//Construct extended vertex data
-	_exVertexData.reserve(meshData.vertices.size());
-	
-	TBArray tbData = calculateTB(meshData);
-	for (size_t i = 0; i < meshData.vertices.size(); i++)
+	//Tangents of another mesh would be copied from past their end, release builds calculate the right ones instead
+	assert(!tangents || tangents->size() == meshData.vertices.size());
+	if (tangents && tangents->size() != meshData.vertices.size()) tangents = nullptr;
+
+	_boundsMin = meshData.vertices[0].pos;
+	_boundsMax = meshData.vertices[0].pos;
+	for (const ew::Vertex& vertex : meshData.vertices)
 	{
-		ExVertex newVertex;
+		_boundsMin = ew::Vec3(fminf(_boundsMin.x, vertex.pos.x), fminf(_boundsMin.y, vertex.pos.y), fminf(_boundsMin.z, vertex.pos.z));
+		_boundsMax = ew::Vec3(fmaxf(_boundsMax.x, vertex.pos.x), fmaxf(_boundsMax.y, vertex.pos.y), fmaxf(_boundsMax.z, vertex.pos.z));
+	}
+
+	//Direct state access leaves every binding alone, the bind-to-edit path restores them to 0 at the end. Both
+	//need GL 4.5, so the shared vertex formats and direct state access come and go together
+	bool direct = VertexFormatRegistry::isSupported();
 
-		newVertex.pos = meshData.vertices[i].pos;
-		newVertex.normal = meshData.vertices[i].normal;
-		newVertex.uv = meshData.vertices[i].uv;
+	if (!direct && !_vao.isValid())
+	{
+		_vao = GpuResource::create(GpuResourceType::VERTEX_ARRAY, "Util::Mesh");
+		glBindVertexArray(_vao.get());
+		glEnableVertexAttribArray(POSITION_ATTRIBUTE_INDEX);
+		glEnableVertexAttribArray(NORMAL_ATTRIBUTE_INDEX);
+		glEnableVertexAttribArray(TANGENT_ATTRIBUTE_INDEX);
+		glEnableVertexAttribArray(BITANGENT_ATTRIBUTE_INDEX);
+		glEnableVertexAttribArray(UV_ATTRIBUTE_INDEX);
+	}
 
-		if (tbData.size() - 1 < i) continue;
+	//The vertices as generated, followed by their (tangent, bitangent) pairs
+	GLsizeiptr vertexBytes = sizeof(ew::Vertex) * meshData.vertices.size();
+	GLsizeiptr tangentBytes = sizeof(TBArray::value_type) * meshData.vertices.size();
+	GLsizeiptr indexBytes = sizeof(GLuint) * meshData.indices.size();
 
-		newVertex.tangent = tbData[i].first;
-		newVertex.bitangent = tbData[i].second;
+	//The element array binding belongs to the VAO, so it has to be bound before the index buffer
+	if (!direct) glBindVertexArray(_vao.get());
+	allocateStorage(_vbo, "Util::Mesh vertices", GL_ARRAY_BUFFER, vertexBytes + tangentBytes, nullptr);
 
-		_exVertexData.push_back(newVertex);
+	MeshStaging* staging = dynamic_cast<MeshStaging*>(meshData.vertices.get_allocator().resource());
+	if (staging)
+	{
+		//Generated into staging memory, the tangents go there too and the GPU copies everything over. Tangents
+		//calculated elsewhere aren't staging memory, uploadRange() writes them directly
+		TBArray tbData = tangents ? TBArray(staging) : calculateTB(meshData, staging);
+		uploadRange(_vbo.get(), GL_ARRAY_BUFFER, 0, meshData.vertices.data(), vertexBytes, *staging);
+		uploadRange(_vbo.get(), GL_ARRAY_BUFFER, vertexBytes, tangents ? tangents->data() : tbData.data(), tangentBytes, *staging);
+
+		allocateStorage(_ebo, "Util::Mesh indices", GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr);
+		if (indexBytes > 0) uploadRange(_ebo.get(), GL_ELEMENT_ARRAY_BUFFER, 0, meshData.indices.data(), indexBytes, *staging);
+	}
+	else
+	{
+		//The vertices are copied straight into the buffer and the tangents written behind them, nothing is staged
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+		unsigned char* mapped = static_cast<unsigned char*>(direct
+			? glMapNamedBufferRange(_vbo.get(), 0, vertexBytes + tangentBytes, access)
+			: glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes + tangentBytes, access));
+		if (mapped)
+		{
+			memcpy(mapped, meshData.vertices.data(), vertexBytes);
+			if (tangents)
+			{
+				memcpy(mapped + vertexBytes, tangents->data(), tangentBytes);
+			}
+			else
+			{
+				std::pmr::monotonic_buffer_resource tangentRange(mapped + vertexBytes, tangentBytes, std::pmr::null_memory_resource());
+				calculateTB(meshData, &tangentRange);
+			}
+			if (direct) glUnmapNamedBuffer(_vbo.get());
+			else glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		else
+		{
+			writeRange(_vbo.get(), GL_ARRAY_BUFFER, 0, vertexBytes, meshData.vertices.data());
+			TBArray tbData = tangents ? TBArray() : calculateTB(meshData);
+			writeRange(_vbo.get(), GL_ARRAY_BUFFER, vertexBytes, tangentBytes, tangents ? tangents->data() : tbData.data());
+		}
+
+		allocateStorage(_ebo, "Util::Mesh indices", GL_ELEMENT_ARRAY_BUFFER, indexBytes, meshData.indices.data());
 	}
 
-	if (!_initialized)
+	_bindings = VertexBindings();
+	if (direct)
+	{
+		_bindings.vertexArray = VertexFormatRegistry::get().getVertexArray(getMeshFormat());
+		_bindings.buffers[VERTEX_BUFFER_BINDING] = VertexBufferBinding{ _vbo.get(), 0, sizeof(ew::Vertex) };
+		_bindings.buffers[TANGENT_BUFFER_BINDING] = VertexBufferBinding{ _vbo.get(), vertexBytes, sizeof(TBArray::value_type) };
+		_bindings.indexBuffer = _ebo.get();
+	}
+	else
 	{
-		glGenVertexArrays(1, &_vao);
-		glBindVertexArray(_vao);
+		//The tangent stream starts behind the vertices, so the offsets change with the vertex count
+		glVertexAttribPointer(POSITION_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ew::Vertex), reinterpret_cast<void*>(offsetof(ew::Vertex, pos)));
+		glVertexAttribPointer(NORMAL_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ew::Vertex), reinterpret_cast<void*>(offsetof(ew::Vertex, normal)));
+		glVertexAttribPointer(UV_ATTRIBUTE_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(ew::Vertex), reinterpret_cast<void*>(offsetof(ew::Vertex, uv)));
+		glVertexAttribPointer(TANGENT_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(TBArray::value_type), reinterpret_cast<void*>(vertexBytes));
+		glVertexAttribPointer(BITANGENT_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(TBArray::value_type), reinterpret_cast<void*>(vertexBytes + sizeof(ew::Vec3)));
+		_bindings.vertexArray = _vao.get();
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
 
-		glGenBuffers(1, &_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+	_vertexCount = int(meshData.vertices.size());
+	_indexCount = int(meshData.indices.size());
 
-		glGenBuffers(1, &_ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+	if (createDepthStream) loadDepthStream(meshData);
+	else
+	{
+		//Drawing depth with the full VAO again, a stream from an earlier load would be stale
+		_depthBindings = VertexBindings();
+		_depthVao.reset();
+		_depthVbo.reset();
+		_depthEbo.reset();
+		_depthVertexCount = 0;
+	}
 
-		glVertexAttribPointer(POSITION_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ExVertex), reinterpret_cast<void*>(offsetof(ExVertex, pos)));
-		glEnableVertexAttribArray(POSITION_ATTRIBUTE_INDEX);
+	//Copies go to the default resource, so the retained data doesn't depend on staging memory or an arena
+	if (retainData) _retainedData = meshData;
+	else _retainedData = ew::MeshData();
+}
 
-		glVertexAttribPointer(NORMAL_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ExVertex), reinterpret_cast<void*>(offsetof(ExVertex, normal)));
-		glEnableVertexAttribArray(NORMAL_ATTRIBUTE_INDEX);
+void Util::Mesh::loadDepthStream(const ew::MeshData& meshData)
+{
+	PROFILE_SCOPE("Util::Mesh::loadDepthStream");
 
-		glVertexAttribPointer(TANGENT_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ExVertex), reinterpret_cast<void*>(offsetof(ExVertex, tangent)));
-		glEnableVertexAttribArray(TANGENT_ATTRIBUTE_INDEX);
+	//All of the dedup state is scratch, freed in one go when the resource goes out of scope
+	std::pmr::monotonic_buffer_resource scratch;
 
-		glVertexAttribPointer(BITANGENT_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ExVertex), reinterpret_cast<void*>(offsetof(ExVertex, bitangent)));
-		glEnableVertexAttribArray(BITANGENT_ATTRIBUTE_INDEX);
+	//Vertices that only differ in normal/UV (seams, hard edges) collapse into one position
+	std::pmr::vector<ew::Vec3> positions(&scratch);
+	positions.reserve(meshData.vertices.size());
+	std::pmr::vector<GLuint> remap(meshData.vertices.size(), &scratch);
+	std::pmr::unordered_map<PositionKey, GLuint, PositionKeyHash> uniquePositions(&scratch);
+	uniquePositions.reserve(meshData.vertices.size());
 
-		glVertexAttribPointer(UV_ATTRIBUTE_INDEX, 2, GL_FLOAT, GL_FALSE, sizeof(ExVertex), reinterpret_cast<void*>(offsetof(ExVertex, uv)));
-		glEnableVertexAttribArray(UV_ATTRIBUTE_INDEX);
+	for (size_t i = 0; i < meshData.vertices.size(); i++)
+	{
+		PositionKey key;
+		std::memcpy(key.bits, &meshData.vertices[i].pos, sizeof(key.bits));
+
+		auto inserted = uniquePositions.emplace(key, GLuint(positions.size()));
+		if (inserted.second) positions.push_back(meshData.vertices[i].pos);
+		remap[i] = inserted.first->second;
 	}
 
-	_initialized = true;
+	std::pmr::vector<GLuint> depthIndices(meshData.indices.size(), &scratch);
+	for (size_t i = 0; i < meshData.indices.size(); i++)
+	{
+		depthIndices[i] = remap[meshData.indices[i]];
+	}
+
+	bool direct = VertexFormatRegistry::isSupported();
+
+	if (!direct && !_depthVao.isValid())
+	{
+		_depthVao = GpuResource::create(GpuResourceType::VERTEX_ARRAY, "Util::Mesh depth");
+		glBindVertexArray(_depthVao.get());
+		glEnableVertexAttribArray(POSITION_ATTRIBUTE_INDEX);
+	}
 
-	glBindVertexArray(_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+	if (!direct) glBindVertexArray(_depthVao.get());
+	allocateStorage(_depthVbo, "Util::Mesh depth positions", GL_ARRAY_BUFFER, sizeof(ew::Vec3) * positions.size(), positions.data());
+	allocateStorage(_depthEbo, "Util::Mesh depth indices", GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * depthIndices.size(), depthIndices.data());
 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(ExVertex) * _exVertexData.size(), _exVertexData.data(), GL_STATIC_DRAW);
+	_depthVertexCount = positions.size();
 
-	if (!meshData.indices.empty())
+	_depthBindings = VertexBindings();
+	if (direct)
 	{
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		_depthBindings.vertexArray = VertexFormatRegistry::get().getVertexArray(getDepthFormat());
+		_depthBindings.buffers[VERTEX_BUFFER_BINDING] = VertexBufferBinding{ _depthVbo.get(), 0, sizeof(ew::Vec3) };
+		_depthBindings.indexBuffer = _depthEbo.get();
+		return;
 	}
 
-	_vertexCount = _exVertexData.size();
-	_indexCount = meshData.indices.size();
+	//allocateStorage() left the position buffer bound
+	glVertexAttribPointer(POSITION_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, sizeof(ew::Vec3), nullptr);
+	_depthBindings.vertexArray = _depthVao.get();
 
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -94,9 +320,15 @@ void Util::Mesh::load(const ew::MeshData& meshData)
 
 //Referencing https://stackoverflow.com/questions/17000255/calculate-tangent-space-in-c
 //and https://gamedev.stackexchange.com/questions/68612/how-to-compute-tangent-and-bitangent-vectors
-Util::Mesh::TBArray Util::Mesh::calculateTB(const ew::MeshData& completedMeshData)
+Util::Mesh::TBArray Util::Mesh::calculateTB(const ew::MeshData& completedMeshData, std::pmr::memory_resource* resource, std::pmr::memory_resource* scratch)
 {
-	Util::Mesh::TBArray result(completedMeshData.vertices.size());
+	PROFILE_SCOPE("Util::Mesh::calculateTB");
+
+	//Accumulated in scratch, the result is only ever written: it may be mapped GPU memory
+	alignas(std::max_align_t) unsigned char stackScratch[MESH_TB_SCRATCH_BYTES];
+	std::pmr::monotonic_buffer_resource localScratch(stackScratch, sizeof(stackScratch));
+	if (!scratch) scratch = &localScratch;
+	std::pmr::vector<ew::Vec3> rawTangents(completedMeshData.vertices.size(), scratch);
 
 	//Traverse each triangle in the completed mesh
 	for (unsigned int i = 0; i < completedMeshData.indices.size(); i += 3)
@@ -127,20 +359,22 @@ Util::Mesh::TBArray Util::Mesh::calculateTB(const ew::MeshData& completedMeshDat
 			(deltaUV2.y * deltaPos1.y - deltaUV1.y * deltaPos2.y) * r,
 			(deltaUV2.y * deltaPos1.z - deltaUV1.y * deltaPos2.z) * r);
 
-		result[i0] = std::make_pair(-xDir, -xDir);
-		result[i1] = std::make_pair(-xDir, -xDir);
-		result[i2] = std::make_pair(-xDir, -xDir);
+		rawTangents[i0] = -xDir;
+		rawTangents[i1] = -xDir;
+		rawTangents[i2] = -xDir;
 	}
 
+	Util::Mesh::TBArray result(resource);
+	result.reserve(completedMeshData.vertices.size());
 	for (size_t i = 0; i < completedMeshData.vertices.size(); i++)
 	{
-		ew::Vec3 oldTangent = result[i].first;
+		ew::Vec3 oldTangent = rawTangents[i];
 		ew::Vec3 normal = completedMeshData.vertices[i].normal;
 
 		ew::Vec3 tangent = ew::Normalize(oldTangent - normal * ew::Dot(normal, oldTangent));
 		ew::Vec3 bitangent = ew::Normalize(ew::Cross(normal, tangent));
 
-		result[i] = std::make_pair(tangent, bitangent);
+		result.emplace_back(tangent, bitangent);
 	}
 
 	return result;
@@ -148,7 +382,7 @@ Util::Mesh::TBArray Util::Mesh::calculateTB(const ew::MeshData& completedMeshDat
 
 void Util::Mesh::draw(ew::DrawMode drawMode) const
 {
-	glBindVertexArray(_vao);
+	_bindings.bind();
 	if (drawMode == ew::DrawMode::TRIANGLES)
 	{
 		glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, nullptr);
@@ -157,4 +391,16 @@ void Util::Mesh::draw(ew::DrawMode drawMode) const
 	{
 		glDrawArrays(GL_POINTS, 0, _vertexCount);
 	}
-}
\ No newline at end of file
+}
+
+void Util::Mesh::drawDepth() const
+{
+	if (!hasDepthStream())
+	{
+		draw();
+		return;
+	}
+
+	_depthBindings.bind();
+	glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, nullptr);
+}
@@ -3,49 +3,92 @@
 * Extension of ew::mesh to calculate TBN
 */
 
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
 #include "../ew/mesh.h"
 /*
 * Created by Adam Gyenes
 */
 
 #include "../ew/external/glad.h"
+#include "GpuResources.h"
+#include "VertexFormat.h"
 
 namespace Util
 {
+	//Owns its GL objects, so it can be moved but not copied. Reassigning a mesh releases the old objects
 	class Mesh
 	{
 	//Based on ew::Mesh
 	public:
+		typedef std::pmr::vector<std::pair<ew::Vec3, ew::Vec3>> TBArray;
+
 		Mesh() {};
-		Mesh(const ew::MeshData& meshData);
+		Mesh(const ew::MeshData& meshData, bool createDepthStream = false, bool retainData = false);
 
-		void load(const ew::MeshData& meshData);
+		//createDepthStream: also upload a tightly packed position-only stream for depth/shadow passes.
+		//retainData: keep a CPU copy of meshData, see getRetainedData(). Data allocated from a Util::MeshStaging is
+		//copied into the mesh by the GPU, anything else is written into the mapped vertex buffer directly
+		void load(const ew::MeshData& meshData, bool createDepthStream = false, bool retainData = false);
+		//Same with the tangents already calculated by calculateTB(), which can then happen off the GL thread. They must
+		//be meshData's, one per vertex, or they are calculated again
+		void load(const ew::MeshData& meshData, const TBArray& tangents, bool createDepthStream = false, bool retainData = false);
 		void draw(ew::DrawMode drawMode = ew::DrawMode::TRIANGLES) const;
+		//Draws with the position-only VAO (attribute 0 only), falls back to draw() if there is no depth stream
+		void drawDepth() const;
 
-	private:
-		typedef std::vector<std::pair<ew::Vec3, ew::Vec3>> TBArray;
+		int getVertexCount() const { return _vertexCount; }
+		int getIndexCount() const { return _indexCount; }
+		bool hasDepthStream() const { return _depthVbo.isValid(); }
+		int getDepthVertexCount() const { return _depthVertexCount; }
 
-		struct ExVertex
-		{
-			ew::Vec3 pos;
-			ew::Vec3 normal;
-			ew::Vec3 tangent;
-			ew::Vec3 bitangent;
-			ew::Vec2 uv;
-		};
+		//For callers that issue their own draws (Util::RenderQueue). With GL 4.5 the vertex array is shared by every
+		//mesh and the buffers have to be bound with it, before that each mesh has a vertex array of its own
+		const VertexBindings& getVertexBindings() const { return _bindings; }
+		//Position-only stream, or the full one without a depth stream
+		const VertexBindings& getDepthVertexBindings() const { return hasDepthStream() ? _depthBindings : _bindings; }
 
-		std::vector<ExVertex> _exVertexData;
+		//Local space AABB, used for depth sorting
+		const ew::Vec3& getBoundsMin() const { return _boundsMin; }
+		const ew::Vec3& getBoundsMax() const { return _boundsMax; }
+		ew::Vec3 getBoundsCenter() const { return (_boundsMin + _boundsMax) * 0.5f; }
 
-		//bool operator==(const ew::Vec3& lhs, const ew::Vec3& rhs);
+		//Copy of the last loaded data if load() was asked to retain it, empty otherwise
+		const ew::MeshData& getRetainedData() const { return _retainedData; }
 
-		TBArray calculateTB(const ew::MeshData& completedMeshData);
+		//Per vertex (tangent, bitangent), shared with the software rasterizer so both backends shade the same.
+		//The result allocates from resource, the per vertex accumulation from scratch. Without one it goes on the stack,
+		//spilling to the heap only for large meshes
+		static TBArray calculateTB(const ew::MeshData& completedMeshData, std::pmr::memory_resource* resource = std::pmr::get_default_resource(), std::pmr::memory_resource* scratch = nullptr);
 
-		bool _initialized = false;
+	private:
 
-		GLuint _vao = 0;
-		GLuint _vbo = 0;
-		GLuint _ebo = 0;
+		ew::MeshData _retainedData;
+
+		//tangents is calculated here when null or not one per vertex
+		void upload(const ew::MeshData& meshData, const TBArray* tangents, bool createDepthStream, bool retainData);
+		void loadDepthStream(const ew::MeshData& meshData);
+
+		VertexBindings _bindings;
+		//Only without shared vertex formats
+		GpuResource _vao;
+		GpuResource _vbo;
+		GpuResource _ebo;
 		int _vertexCount = 0;
 		int _indexCount = 0;
+
+		//Position-only stream, indices are deduplicated on position alone
+		VertexBindings _depthBindings;
+		//Only without shared vertex formats
+		GpuResource _depthVao;
+		GpuResource _depthVbo;
+		GpuResource _depthEbo;
+		int _depthVertexCount = 0;
+
+		ew::Vec3 _boundsMin;
+		ew::Vec3 _boundsMax;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "MeshRebuilder.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <utility>
+
+Util::MeshRebuilder::MeshRebuilder(JobSystem& jobs) :
+	_jobs(jobs)
+{
+}
+
+Util::MeshRebuilder::~MeshRebuilder()
+{
+	//From the main thread this also runs the upload jobs, so no job is left holding a slot
+	_jobs.wait(_counter);
+}
+
+Util::MeshRebuilder::Slot& Util::MeshRebuilder::getSlot(Mesh& mesh)
+{
+	for (const std::unique_ptr<Slot>& slot : _slots)
+	{
+		if (slot->mesh == &mesh) return *slot;
+	}
+	_slots.emplace_back(new Slot());
+	_slots.back()->mesh = &mesh;
+	return *_slots.back();
+}
+
+void Util::MeshRebuilder::request(Mesh& mesh, MeshGenerator generator)
+{
+	Slot& slot = getSlot(mesh);
+	bool replaced;
+	bool start;
+	{
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		replaced = static_cast<bool>(slot.waiting);
+		slot.waiting = std::move(generator);
+		slot.waitingGeneration = slot.requested.fetch_add(1, std::memory_order_acq_rel) + 1;
+		//A running build picks the request up once it is done
+		start = !slot.building;
+		slot.building = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_statsMutex);
+		_stats.requests++;
+		if (replaced) _stats.coalesced++;
+	}
+
+	if (start) schedule(&slot);
+}
+
+void Util::MeshRebuilder::schedule(Slot* slot)
+{
+	//The main thread only takes worker jobs while waiting, without workers the build has to be a main thread job
+	if (_jobs.getThreadCount() > 1) _jobs.run([this, slot]() { build(*slot); }, &_counter);
+	else _jobs.runOnMainThread([this, slot]() { build(*slot); }, &_counter);
+}
+
+void Util::MeshRebuilder::build(Slot& slot)
+{
+	PROFILE_SCOPE("Util::MeshRebuilder::build");
+
+	while (true)
+	{
+		MeshGenerator generator;
+		uint64_t generation;
+		{
+			std::lock_guard<std::mutex> lock(slot.mutex);
+			if (!slot.waiting)
+			{
+				slot.building = false;
+				return;
+			}
+			generator = std::move(slot.waiting);
+			slot.waiting = nullptr;
+			generation = slot.waitingGeneration;
+		}
+
+		//Checked between the steps, a generator can't be interrupted
+		auto isStale = [&slot, generation]() { return slot.requested.load(std::memory_order_acquire) != generation; };
+
+		auto start = std::chrono::steady_clock::now();
+		ew::MeshData meshData = generator();
+		Mesh::TBArray tangents;
+		if (!isStale()) tangents = Mesh::calculateTB(meshData);
+		if (isStale())
+		{
+			std::lock_guard<std::mutex> lock(_statsMutex);
+			_stats.cancelled++;
+			continue;
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		bool uploadQueued;
+		{
+			std::lock_guard<std::mutex> lock(slot.mutex);
+			//An upload that hasn't run yet takes the newer mesh instead
+			uploadQueued = slot.builtGeneration > slot.shown;
+			slot.built = std::move(meshData);
+			slot.tangents = std::move(tangents);
+			slot.builtGeneration = generation;
+			slot.buildMs = std::chrono::duration<double, std::milli>(end - start).count();
+		}
+		if (!uploadQueued) _jobs.runOnMainThread([this, &slot]() { upload(slot); }, &_counter);
+	}
+}
+
+void Util::MeshRebuilder::upload(Slot& slot)
+{
+	PROFILE_SCOPE("Util::MeshRebuilder::upload");
+
+	ew::MeshData meshData;
+	Mesh::TBArray tangents;
+	uint64_t generation;
+	double buildMs;
+	{
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		meshData = std::move(slot.built);
+		tangents = std::move(slot.tangents);
+		generation = slot.builtGeneration;
+		buildMs = slot.buildMs;
+		//Marks the upload as taken before the lock is released, the next finished build queues its own
+		slot.shown = generation;
+	}
+
+	//Between two frames, the old GL objects go to the registry and are deleted once the GPU is done with them
+	auto start = std::chrono::steady_clock::now();
+	if (!meshData.vertices.empty()) slot.mesh->load(meshData, tangents);
+	auto end = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	_stats.swapped++;
+	_stats.buildMs = buildMs;
+	_stats.uploadMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool Util::MeshRebuilder::isPending(const Mesh& mesh) const
+{
+	for (const std::unique_ptr<Slot>& slot : _slots)
+	{
+		if (slot->mesh == &mesh) return slot->requested.load(std::memory_order_acquire) != slot->shown;
+	}
+	return false;
+}
+
+Util::MeshRebuildStats Util::MeshRebuilder::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_statsMutex);
+	return _stats;
+}
@@ -0,0 +1,104 @@
+/*
+* Created by Adam Gyenes
+* Rebuilds Util::Meshes in the background while they keep drawing. Generation and tangents run on a Util::JobSystem
+* worker, the upload runs on the main thread as a main thread job and replaces the mesh between two frames
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../ew/mesh.h"
+
+#include "JobSystem.h"
+#include "Mesh.h"
+
+namespace Util
+{
+	//Runs on a worker, so it must not touch GL or anything the main thread changes meanwhile. Capture parameters
+	//by value
+	typedef std::function<ew::MeshData()> MeshGenerator;
+
+	struct MeshRebuildStats
+	{
+		int requests = 0;
+		//Requests replaced by a newer one before their build started
+		int coalesced = 0;
+		//Builds dropped part way because a newer request came in
+		int cancelled = 0;
+		int swapped = 0;
+		//Of the last swapped mesh: generation and tangents on the worker, upload on the main thread
+		double buildMs = 0.0;
+		double uploadMs = 0.0;
+	};
+
+	//Main thread only, the one that owns the GL context and calls jobs.runMainThreadJobs() every frame:
+	//  Util::MeshRebuilder rebuilder(jobs);
+	//  if (ImGui::SliderInt("Segments", &segments, 3, 64))
+	//      rebuilder.request(sphereMesh, [radius, segments]() { return Util::createSphere(radius, segments); });
+	//  ...
+	//  jobs.runMainThreadJobs();
+	//A mesh has at most one build running and one request waiting. Requesting again replaces the waiting one, and a
+	//running build is dropped at its next step once it is stale, so a slider dragged faster than builds finish only
+	//ever builds the latest value. Meshes must outlive the rebuilder, declare it after them
+	class MeshRebuilder
+	{
+	public:
+		explicit MeshRebuilder(JobSystem& jobs);
+		//Waits for running builds and runs their uploads
+		~MeshRebuilder();
+
+		MeshRebuilder(const MeshRebuilder&) = delete;
+		MeshRebuilder& operator=(const MeshRebuilder&) = delete;
+
+		void request(Mesh& mesh, MeshGenerator generator);
+		//A request for mesh hasn't been swapped in yet
+		bool isPending(const Mesh& mesh) const;
+
+		MeshRebuildStats getStats() const;
+
+	private:
+		struct Slot
+		{
+			Mesh* mesh = nullptr;
+
+			//Bumped by every request, builds of an older one are stale
+			std::atomic<uint64_t> requested{ 0 };
+
+			//Guards everything below
+			std::mutex mutex;
+			//Last generation an upload took, only the main thread writes it
+			uint64_t shown = 0;
+			MeshGenerator waiting;
+			uint64_t waitingGeneration = 0;
+			bool building = false;
+
+			//Finished build the upload job picks up, a newer one replaces it
+			ew::MeshData built;
+			Mesh::TBArray tangents;
+			uint64_t builtGeneration = 0;
+			double buildMs = 0.0;
+		};
+
+		Slot& getSlot(Mesh& mesh);
+		void schedule(Slot* slot);
+		//Worker: builds waiting requests until there are none left
+		void build(Slot& slot);
+		//Main thread
+		void upload(Slot& slot);
+
+		JobSystem& _jobs;
+		//Every build and upload job, waited for on destruction
+		JobCounter _counter;
+		//Slots never move, jobs hold pointers to them
+		std::vector<std::unique_ptr<Slot>> _slots;
+
+		mutable std::mutex _statsMutex;
+		MeshRebuildStats _stats;
+	};
+}
@@ -0,0 +1,97 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "MeshStaging.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+//Upper bound for a single glClientWaitSync, the wait loops until the fence is signalled anyway
+constexpr GLuint64 STAGING_WAIT_TIMEOUT_NS = 1000000;
+
+Util::MeshStaging::MeshStaging(GLsizeiptr capacity, std::pmr::memory_resource* upstream)
+	: _upstream(upstream), _capacity(capacity)
+{
+	if (!GLAD_GL_VERSION_4_4 || capacity <= 0) return;
+
+	//Readable as well, the tangent pass and the depth stream read the generated vertices back. Client storage keeps
+	//it in cached system memory, the GPU only ever copies out of it
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	_buffer = GpuResource::create(GpuResourceType::BUFFER, "Util::MeshStaging");
+	_buffer.setBytes(size_t(_capacity));
+	if (GLAD_GL_VERSION_4_5)
+	{
+		glNamedBufferStorage(_buffer.get(), _capacity, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+		_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(_buffer.get(), 0, _capacity, flags));
+		return;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, _buffer.get());
+	glBufferStorage(GL_COPY_READ_BUFFER, _capacity, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+	_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, _capacity, flags));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+Util::MeshStaging::~MeshStaging()
+{
+	if (_fence) glDeleteSync(_fence);
+	//The buffer is released with _buffer, after the copies still in flight. Deleting it also unmaps it
+}
+
+void Util::MeshStaging::reset()
+{
+	if (_cursor == 0) return;
+
+	if (_fence) glDeleteSync(_fence);
+	_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_cursor = 0;
+}
+
+GLintptr Util::MeshStaging::getOffset(const void* pointer) const
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(pointer);
+	if (!_mapped || bytes < _mapped || bytes >= _mapped + _capacity) return -1;
+	return GLintptr(bytes - _mapped);
+}
+
+Util::MeshStagingStats Util::MeshStaging::getStats() const
+{
+	MeshStagingStats stats;
+	stats.used = _cursor;
+	stats.peak = _peak;
+	stats.capacity = _mapped ? _capacity : 0;
+	stats.overflows = _overflows;
+	return stats;
+}
+
+void* Util::MeshStaging::do_allocate(size_t bytes, size_t alignment)
+{
+	if (_mapped)
+	{
+		GLsizeiptr offset = (_cursor + GLsizeiptr(alignment) - 1) / GLsizeiptr(alignment) * GLsizeiptr(alignment);
+		if (offset + GLsizeiptr(bytes) <= _capacity)
+		{
+			if (_fence)
+			{
+				PROFILE_SCOPE("Util::MeshStaging::wait");
+
+				while (glClientWaitSync(_fence, GL_SYNC_FLUSH_COMMANDS_BIT, STAGING_WAIT_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {}
+				glDeleteSync(_fence);
+				_fence = nullptr;
+			}
+
+			_cursor = offset + GLsizeiptr(bytes);
+			_peak = std::max(_peak, _cursor);
+			return _mapped + offset;
+		}
+		_overflows++;
+	}
+	return _upstream->allocate(bytes, alignment);
+}
+
+void Util::MeshStaging::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+	//Staging memory only comes back with reset()
+	if (getOffset(pointer) < 0) _upstream->deallocate(pointer, bytes, alignment);
+}
@@ -0,0 +1,74 @@
+/*
+* Created by Adam Gyenes
+* Persistently mapped upload buffer that generators allocate ew::MeshData from. Util::Mesh::load() recognizes data
+* living here, writes the tangents next to it and has the GPU copy everything into the mesh, so the only CPU write
+* of a vertex is the generator's
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+
+#include "../ew/external/glad.h"
+#include "GpuResources.h"
+
+//Enough for a few hundred thousand vertices with their tangents and indices
+constexpr GLsizeiptr MESH_STAGING_DEFAULT_CAPACITY = 8 << 20;
+
+namespace Util
+{
+	struct MeshStagingStats
+	{
+		//Bytes handed out since the last reset and the most that were ever in use at once
+		GLsizeiptr used = 0;
+		GLsizeiptr peak = 0;
+		GLsizeiptr capacity = 0;
+		//Allocations that didn't fit and came from the upstream resource instead, load() uploads those normally
+		uint64_t overflows = 0;
+	};
+
+	//GL thread only. Usage:
+	//  Util::MeshStaging staging;
+	//  mesh.load(Util::createTorus(0.25f, 0.5f, 64, 32, &staging));
+	//  staging.reset();
+	//Without GL 4.4 there is nothing to map and every allocation goes upstream, load() then takes its regular path
+	class MeshStaging : public std::pmr::memory_resource
+	{
+	public:
+		MeshStaging(GLsizeiptr capacity = MESH_STAGING_DEFAULT_CAPACITY, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+		~MeshStaging();
+
+		MeshStaging(const MeshStaging&) = delete;
+		MeshStaging& operator=(const MeshStaging&) = delete;
+
+		//Makes the whole buffer reusable. Mesh data allocated before must not be used anymore, the next allocation
+		//waits for the GPU to finish copying out of it
+		void reset();
+
+		//Offset of pointer in the staging buffer, -1 if it isn't staging memory
+		GLintptr getOffset(const void* pointer) const;
+
+		GLuint getBuffer() const { return _buffer.get(); }
+		bool isMapped() const { return _mapped != nullptr; }
+
+		MeshStagingStats getStats() const;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		std::pmr::memory_resource* _upstream;
+		GLsizeiptr _capacity;
+
+		GpuResource _buffer;
+		unsigned char* _mapped = nullptr;
+		//Signalled once the copies issued before the last reset are done
+		GLsync _fence = nullptr;
+
+		GLsizeiptr _cursor = 0;
+		GLsizeiptr _peak = 0;
+		uint64_t _overflows = 0;
+	};
+}
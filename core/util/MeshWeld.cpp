@@ -0,0 +1,214 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "MeshWeld.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//Bits per axis of a cell coordinate, three of them pack into one 64 bit key
+constexpr int WELD_CELL_BITS = 21;
+//Cells per axis across the mesh bounds at most, keeps coordinates within their bits however small the tolerance
+constexpr float WELD_MAX_CELLS = float(1 << (WELD_CELL_BITS - 1));
+//Cell size in tolerances. Only vertices within the tolerance of a cell edge search across it, wider cells make that
+//rare, at 4 most vertices search 3 or 4 cells instead of all 27
+constexpr float WELD_CELL_TOLERANCES = 4.f;
+//Vertices per job of the parallel passes
+constexpr int WELD_GRAIN = 1024;
+
+static uint64_t packCell(uint32_t x, uint32_t y, uint32_t z)
+{
+	return uint64_t(x) | (uint64_t(y) << WELD_CELL_BITS) | (uint64_t(z) << (WELD_CELL_BITS * 2));
+}
+
+//Fibonacci hashing, the high bits of the product are the well mixed ones
+static uint32_t bucketOf(uint64_t cell, int bucketBits)
+{
+	return uint32_t((cell * 0x9E3779B97F4A7C15ull) >> (64 - bucketBits));
+}
+
+static float distanceSquared(const ew::Vec3& a, const ew::Vec3& b)
+{
+	ew::Vec3 d = a - b;
+	return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+static float distanceSquared(const ew::Vec2& a, const ew::Vec2& b)
+{
+	float dx = a.x - b.x;
+	float dy = a.y - b.y;
+	return dx * dx + dy * dy;
+}
+
+static bool isWithin(const ew::Vertex& a, const ew::Vertex& b, const Util::WeldTolerances& tolerances)
+{
+	if (distanceSquared(a.pos, b.pos) > tolerances.position * tolerances.position) return false;
+	if (tolerances.normal >= 0.f && distanceSquared(a.normal, b.normal) > tolerances.normal * tolerances.normal) return false;
+	if (tolerances.uv >= 0.f && distanceSquared(a.uv, b.uv) > tolerances.uv * tolerances.uv) return false;
+	return true;
+}
+
+//Runs function(begin, end) over [0, count), on the job system if there is one
+template<typename F>
+static void forRange(Util::JobSystem* jobs, int count, F&& function)
+{
+	if (!jobs)
+	{
+		function(0, count);
+		return;
+	}
+	jobs->parallelFor(count, [&function](int begin, int end, int) { function(begin, end); }, WELD_GRAIN);
+}
+
+Util::WeldStats Util::weldVertices(ew::MeshData& mesh, const WeldTolerances& tolerances, JobSystem* jobs)
+{
+	PROFILE_SCOPE("Util::weldVertices");
+
+	WeldStats stats;
+	int vertexCount = int(mesh.vertices.size());
+	stats.verticesBefore = vertexCount;
+	stats.verticesAfter = vertexCount;
+	if (vertexCount == 0) return stats;
+
+	ew::Vec3 boundsMin = mesh.vertices[0].pos;
+	ew::Vec3 boundsMax = boundsMin;
+	for (const ew::Vertex& vertex : mesh.vertices)
+	{
+		boundsMin = ew::Vec3(std::min(boundsMin.x, vertex.pos.x), std::min(boundsMin.y, vertex.pos.y), std::min(boundsMin.z, vertex.pos.z));
+		boundsMax = ew::Vec3(std::max(boundsMax.x, vertex.pos.x), std::max(boundsMax.y, vertex.pos.y), std::max(boundsMax.z, vertex.pos.z));
+	}
+	float extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+	//Vertices within the tolerance are at most one cell apart as long as cells are no smaller than it
+	float cellSize = std::max(std::max(tolerances.position, 0.f) * WELD_CELL_TOLERANCES, extent / WELD_MAX_CELLS);
+	if (cellSize <= 0.f) cellSize = 1.f;
+	float inverseCellSize = 1.f / cellSize;
+	uint32_t maxCell = (1u << WELD_CELL_BITS) - 1;
+
+	//Cell of every vertex, and the cell edges it is close enough to for a vertex across them to match
+	std::vector<uint64_t> cells(vertexCount);
+	std::vector<unsigned char> nearEdges(vertexCount);
+	forRange(jobs, vertexCount, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				const ew::Vec3& pos = mesh.vertices[i].pos;
+				float local[3] = { (pos.x - boundsMin.x) * inverseCellSize, (pos.y - boundsMin.y) * inverseCellSize, (pos.z - boundsMin.z) * inverseCellSize };
+				uint32_t cell[3];
+				unsigned char edges = 0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					cell[axis] = std::min(uint32_t(std::max(local[axis], 0.f)), maxCell);
+					float fraction = (local[axis] - float(cell[axis])) * cellSize;
+					//Bit 2 * axis: the lower neighbour, bit 2 * axis + 1: the upper one
+					if (fraction <= tolerances.position && cell[axis] > 0) edges |= 1 << (axis * 2);
+					if (fraction >= cellSize - tolerances.position && cell[axis] < maxCell) edges |= 2 << (axis * 2);
+				}
+				cells[i] = packCell(cell[0], cell[1], cell[2]);
+				nearEdges[i] = edges;
+			}
+		});
+
+	//Counting sort into the buckets, stable so each bucket lists its vertices in index order
+	int bucketBits = 1;
+	while ((1 << bucketBits) < vertexCount) bucketBits++;
+	int bucketCount = 1 << bucketBits;
+	stats.buckets = bucketCount;
+
+	std::vector<int> bucketStart(bucketCount + 1, 0);
+	for (int i = 0; i < vertexCount; i++) bucketStart[bucketOf(cells[i], bucketBits) + 1]++;
+	for (int bucket = 0; bucket < bucketCount; bucket++) bucketStart[bucket + 1] += bucketStart[bucket];
+	//Vertices are copied along with their cells so searching a bucket reads one contiguous run instead of jumping all
+	//over the mesh, duplicates in triangle soup are usually far apart in index
+	std::vector<int> sorted(vertexCount);
+	std::vector<uint64_t> sortedCells(vertexCount);
+	std::vector<ew::Vertex> sortedVertices(vertexCount);
+	std::vector<unsigned char> sortedEdges(vertexCount);
+	{
+		std::vector<int> cursor(bucketStart.begin(), bucketStart.end() - 1);
+		for (int i = 0; i < vertexCount; i++)
+		{
+			int entry = cursor[bucketOf(cells[i], bucketBits)]++;
+			sorted[entry] = i;
+			sortedCells[entry] = cells[i];
+			sortedVertices[entry] = mesh.vertices[i];
+			sortedEdges[entry] = nearEdges[i];
+		}
+	}
+
+	//Lowest index each vertex matches, itself if nothing before it does. Only reads shared state, so buckets can be
+	//searched in any order on any thread
+	std::vector<int> match(vertexCount);
+	forRange(jobs, bucketCount, [&](int begin, int end)
+		{
+			for (int bucket = begin; bucket < end; bucket++)
+			{
+				for (int entry = bucketStart[bucket]; entry < bucketStart[bucket + 1]; entry++)
+				{
+					int i = sorted[entry];
+					int best = i;
+					const ew::Vertex& vertex = sortedVertices[entry];
+					unsigned char edges = sortedEdges[entry];
+					uint64_t cell = sortedCells[entry];
+
+					for (int dz = -1; dz <= 1; dz++)
+					{
+						if ((dz < 0 && !(edges & 0x10)) || (dz > 0 && !(edges & 0x20))) continue;
+						for (int dy = -1; dy <= 1; dy++)
+						{
+							if ((dy < 0 && !(edges & 0x04)) || (dy > 0 && !(edges & 0x08))) continue;
+							for (int dx = -1; dx <= 1; dx++)
+							{
+								if ((dx < 0 && !(edges & 0x01)) || (dx > 0 && !(edges & 0x02))) continue;
+
+								//The edge bits make sure no coordinate wraps
+								uint64_t neighbour = cell + int64_t(dx) + (int64_t(dy) << WELD_CELL_BITS) + (int64_t(dz) << (WELD_CELL_BITS * 2));
+								uint32_t neighbourBucket = bucketOf(neighbour, bucketBits);
+								for (int other = bucketStart[neighbourBucket]; other < bucketStart[neighbourBucket + 1]; other++)
+								{
+									int j = sorted[other];
+									//Index order, nothing further on can beat what we have
+									if (j >= best) break;
+									if (sortedCells[other] == neighbour && isWithin(vertex, sortedVertices[other], tolerances)) best = j;
+								}
+							}
+						}
+					}
+					match[i] = best;
+				}
+			}
+		});
+
+	//Resolved in index order: a vertex joins whatever its match was welded to, unless that is out of its reach
+	std::vector<int> remap(vertexCount);
+	int kept = 0;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		int target = match[i];
+		if (target != i)
+		{
+			//Where target ended up, kept vertices before i have already moved down to their new index
+			const ew::Vertex& rootVertex = mesh.vertices[remap[target]];
+			if (match[target] == target || isWithin(mesh.vertices[i], rootVertex, tolerances))
+			{
+				remap[i] = remap[target];
+				continue;
+			}
+			stats.chainBreaks++;
+		}
+		//Kept vertices only ever move down, so everything still to be read is untouched
+		mesh.vertices[kept] = mesh.vertices[i];
+		remap[i] = kept++;
+	}
+	mesh.vertices.resize(kept);
+	stats.verticesAfter = kept;
+
+	forRange(jobs, int(mesh.indices.size()), [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++) mesh.indices[i] = static_cast<unsigned int>(remap[mesh.indices[i]]);
+		});
+	return stats;
+}
@@ -0,0 +1,43 @@
+/*
+* Created by Adam Gyenes
+* Welds vertices of any ew::MeshData that are within a tolerance of each other. Positions go into a hash grid of cells
+* a few tolerances wide, so every vertex only compares against the few vertices in its own cell and, near a cell edge,
+* the neighbouring ones
+*/
+
+#pragma once
+
+#include "../ew/mesh.h"
+
+#include "JobSystem.h"
+
+namespace Util
+{
+	//Largest difference of each attribute for two vertices to become one
+	struct WeldTolerances
+	{
+		//Distance between positions. 0 only welds exact duplicates. The hash grid's cells are 4 of these wide, or
+		//1/2^20 of the mesh's largest extent if that is more
+		float position = 1e-5f;
+		//Distance between normals (about the angle in radians) and between UVs. Negative ignores the attribute,
+		//the welded vertex keeps the one of the first vertex. Keeping them is what preserves hard edges and UV seams
+		float normal = 1e-3f;
+		float uv = 1e-5f;
+	};
+
+	struct WeldStats
+	{
+		int verticesBefore = 0;
+		int verticesAfter = 0;
+		//Of the hash table, each one searched as a unit
+		int buckets = 0;
+		//Vertices that matched a vertex which had itself been welded to one out of their reach. They stay separate so
+		//no vertex ever moves further than the tolerance
+		int chainBreaks = 0;
+	};
+
+	//Rewrites mesh in place: vertices that match an earlier vertex are dropped and the indices point to that one
+	//instead. Kept vertices stay in their original order.
+	//With jobs, the neighbour search runs in parallel over the hash buckets and the result is the same as without
+	WeldStats weldVertices(ew::MeshData& mesh, const WeldTolerances& tolerances = WeldTolerances(), JobSystem* jobs = nullptr);
+}
@@ -0,0 +1,325 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "Meshlets.h"
+#include "Float4.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+static ew::Vec3 triangleCentroid(const ew::MeshData& mesh, const unsigned int* triangle)
+{
+	return (mesh.vertices[triangle[0]].pos + mesh.vertices[triangle[1]].pos + mesh.vertices[triangle[2]].pos) * (1.f / 3.f);
+}
+
+//Sphere around the vertices' average and the cone around the average face normal
+static void computeBounds(const ew::MeshData& mesh, const unsigned int* indices, int triangleCount, const ew::Vec3& center, Util::Meshlet& meshlet)
+{
+	meshlet.center = center;
+	float radiusSquared = 0.f;
+	ew::Vec3 normalSum;
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		ew::Vec3 offset = mesh.vertices[indices[i]].pos - center;
+		radiusSquared = std::max(radiusSquared, ew::Dot(offset, offset));
+	}
+	meshlet.radius = sqrtf(radiusSquared);
+
+	//Every normal counts the same however big its triangle, a sliver pointing sideways still limits the cone
+	std::vector<ew::Vec3> normals;
+	normals.reserve(triangleCount);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* triangle = indices + t * 3;
+		ew::Vec3 a = mesh.vertices[triangle[0]].pos;
+		ew::Vec3 normal = ew::Cross(mesh.vertices[triangle[1]].pos - a, mesh.vertices[triangle[2]].pos - a);
+		float length = ew::Magnitude(normal);
+		//Degenerate triangles are never rasterized, they don't face anywhere
+		if (length <= 0.f) continue;
+		normals.push_back(normal / length);
+		normalSum += normals.back();
+	}
+
+	meshlet.coneAxis = ew::Vec3(0.f, 0.f, 1.f);
+	meshlet.coneCutoff = 1.f;
+	float sumLength = ew::Magnitude(normalSum);
+	if (normals.empty() || sumLength <= 1e-6f) return;
+
+	meshlet.coneAxis = normalSum / sumLength;
+	float minDot = 1.f;
+	for (const ew::Vec3& normal : normals) minDot = std::min(minDot, ew::Dot(normal, meshlet.coneAxis));
+	//Half angle of 90 degrees or more, some triangle always faces the camera
+	if (minDot <= 0.f) return;
+	meshlet.coneCutoff = sqrtf(std::max(1.f - minDot * minDot, 0.f));
+}
+
+std::vector<Util::Meshlet> Util::buildMeshlets(ew::MeshData& mesh)
+{
+	PROFILE_SCOPE("Util::buildMeshlets");
+
+	std::vector<Meshlet> meshlets;
+	int triangleCount = int(mesh.indices.size() / 3);
+	int vertexCount = int(mesh.vertices.size());
+	if (triangleCount == 0) return meshlets;
+
+	//Triangles around every vertex, compressed rows
+	std::vector<int> adjacencyStart(vertexCount + 1, 0);
+	for (int i = 0; i < triangleCount * 3; i++) adjacencyStart[mesh.indices[i] + 1]++;
+	for (int v = 0; v < vertexCount; v++) adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<int> adjacency(triangleCount * 3);
+	{
+		std::vector<int> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (int i = 0; i < triangleCount * 3; i++) adjacency[cursor[mesh.indices[i]]++] = i / 3;
+	}
+
+	std::vector<unsigned char> used(triangleCount, 0);
+	//Meshlet number + 1 of the meshlet a vertex / candidate triangle was last added to, so nothing needs clearing
+	std::vector<int> vertexMeshlet(vertexCount, 0);
+	std::vector<int> candidateMeshlet(triangleCount, 0);
+	std::vector<int> candidates;
+	std::vector<unsigned int> reordered;
+	reordered.reserve(mesh.indices.size());
+
+	int seed = 0;
+	int emitted = 0;
+	while (emitted < triangleCount)
+	{
+		Meshlet meshlet;
+		meshlet.firstIndex = static_cast<unsigned int>(reordered.size());
+		int stamp = int(meshlets.size()) + 1;
+		int meshletTriangles = 0;
+		ew::Vec3 positionSum;
+		candidates.clear();
+
+		while (used[seed]) seed++;
+		int next = seed;
+		while (next >= 0)
+		{
+			const unsigned int* triangle = &mesh.indices[next * 3];
+			used[next] = 1;
+			emitted++;
+			meshletTriangles++;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = triangle[corner];
+				reordered.push_back(vertex);
+				if (vertexMeshlet[vertex] == stamp) continue;
+
+				vertexMeshlet[vertex] = stamp;
+				meshlet.vertexCount++;
+				positionSum += mesh.vertices[vertex].pos;
+				for (int a = adjacencyStart[vertex]; a < adjacencyStart[vertex + 1]; a++)
+				{
+					int neighbour = adjacency[a];
+					if (used[neighbour] || candidateMeshlet[neighbour] == stamp) continue;
+					candidateMeshlet[neighbour] = stamp;
+					candidates.push_back(neighbour);
+				}
+			}
+			if (meshletTriangles == MESHLET_MAX_TRIANGLES) break;
+
+			//Most vertices already in the meshlet first, the fewer new ones the more triangles fit. Then the one
+			//closest to the middle, which keeps the meshlet round and its bounds tight
+			ew::Vec3 center = positionSum / float(meshlet.vertexCount);
+			next = -1;
+			int bestShared = -1;
+			float bestDistance = 0.f;
+			for (size_t c = 0; c < candidates.size();)
+			{
+				int candidate = candidates[c];
+				if (used[candidate])
+				{
+					candidates[c] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				c++;
+
+				const unsigned int* candidateTriangle = &mesh.indices[candidate * 3];
+				int shared = (vertexMeshlet[candidateTriangle[0]] == stamp) + (vertexMeshlet[candidateTriangle[1]] == stamp) + (vertexMeshlet[candidateTriangle[2]] == stamp);
+				if (meshlet.vertexCount + 3 - shared > static_cast<unsigned int>(MESHLET_MAX_VERTICES)) continue;
+
+				ew::Vec3 offset = triangleCentroid(mesh, candidateTriangle) - center;
+				float distance = ew::Dot(offset, offset);
+				if (shared > bestShared || (shared == bestShared && distance < bestDistance))
+				{
+					next = candidate;
+					bestShared = shared;
+					bestDistance = distance;
+				}
+			}
+
+			//Nothing connected is left (separate pieces, triangle soup), carry on in index order while there's room
+			if (candidates.empty() && emitted < triangleCount && meshlet.vertexCount + 3 <= static_cast<unsigned int>(MESHLET_MAX_VERTICES))
+			{
+				while (used[seed]) seed++;
+				next = seed;
+			}
+		}
+
+		meshlet.indexCount = static_cast<unsigned int>(reordered.size()) - meshlet.firstIndex;
+		computeBounds(mesh, &reordered[meshlet.firstIndex], meshletTriangles, positionSum / float(meshlet.vertexCount), meshlet);
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), mesh.indices.begin());
+	return meshlets;
+}
+
+void Util::MeshletDrawRanges::clear()
+{
+	counts.clear();
+	offsets.clear();
+}
+
+void Util::MeshletDrawRanges::reserve(size_t ranges)
+{
+	counts.reserve(ranges);
+	offsets.reserve(ranges);
+}
+
+Util::MeshletCuller::MeshletCuller(const std::vector<Meshlet>& meshlets) :
+	_count(int(meshlets.size()))
+{
+	size_t padded = (meshlets.size() + 3) & ~size_t(3);
+	_centerX.resize(padded, 0.f);
+	_centerY.resize(padded, 0.f);
+	_centerZ.resize(padded, 0.f);
+	_radius.resize(padded, 0.f);
+	_axisX.resize(padded, 0.f);
+	_axisY.resize(padded, 0.f);
+	_axisZ.resize(padded, 1.f);
+	_cutoff.resize(padded, 1.f);
+	_firstIndex.resize(padded, 0);
+	_indexCount.resize(padded, 0);
+
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		_centerX[i] = meshlet.center.x;
+		_centerY[i] = meshlet.center.y;
+		_centerZ[i] = meshlet.center.z;
+		_radius[i] = meshlet.radius;
+		_axisX[i] = meshlet.coneAxis.x;
+		_axisY[i] = meshlet.coneAxis.y;
+		_axisZ[i] = meshlet.coneAxis.z;
+		_cutoff[i] = meshlet.coneCutoff;
+		_firstIndex[i] = meshlet.firstIndex;
+		_indexCount[i] = meshlet.indexCount;
+	}
+}
+
+void Util::MeshletCuller::cull(const ew::Mat4& viewProjection, const ew::Mat4& model, const ew::Vec3& cameraPosition, MeshletDrawRanges& ranges)
+{
+	PROFILE_SCOPE("Util::MeshletCuller::cull");
+
+	//Gribb/Hartmann planes of the whole transform are the frustum in object space
+	ew::Mat4 objectToClip = viewProjection * model;
+	ew::Vec4 rows[4];
+	for (int r = 0; r < 4; r++) rows[r] = ew::Vec4(objectToClip[0][r], objectToClip[1][r], objectToClip[2][r], objectToClip[3][r]);
+	ew::Vec4 planes[6];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		planes[axis * 2] = rows[3] + rows[axis];
+		planes[axis * 2 + 1] = rows[3] - rows[axis];
+	}
+	for (ew::Vec4& plane : planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.f) plane = ew::Vec4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+
+	//Camera in object space through the inverse of the model's 3x3 part. Which side of a triangle the camera is on
+	//survives any affine transform, so the object space cones answer exactly
+	ew::Vec3 relative = cameraPosition - ew::Vec3(model[3][0], model[3][1], model[3][2]);
+	ew::Vec3 column0(model[0][0], model[0][1], model[0][2]);
+	ew::Vec3 column1(model[1][0], model[1][1], model[1][2]);
+	ew::Vec3 column2(model[2][0], model[2][1], model[2][2]);
+	ew::Vec3 cross12 = ew::Cross(column1, column2);
+	float determinant = ew::Dot(column0, cross12);
+	bool coneTest = determinant != 0.f;
+	ew::Vec3 camera;
+	if (coneTest)
+	{
+		//Rows of the inverse are the cross products of the columns over the determinant
+		ew::Vec3 cross20 = ew::Cross(column2, column0);
+		ew::Vec3 cross01 = ew::Cross(column0, column1);
+		camera = ew::Vec3(ew::Dot(cross12, relative), ew::Dot(cross20, relative), ew::Dot(cross01, relative)) / determinant;
+	}
+	//Mirrored, the triangles' winding on screen flips and so does the side the rasterizer keeps
+	float facing = determinant < 0.f ? -1.f : 1.f;
+
+	Float4 cameraX = splat4(camera.x);
+	Float4 cameraY = splat4(camera.y);
+	Float4 cameraZ = splat4(camera.z);
+	Float4 one = splat4(1.f);
+	Float4 zero = splat4(0.f);
+	Float4 facing4 = splat4(facing);
+
+	//Index the last range ended at, only ranges of this call may grow
+	long long rangeEnd = -1;
+	for (int base = 0; base < _count; base += 4)
+	{
+		Float4 x = load4(&_centerX[base]);
+		Float4 y = load4(&_centerY[base]);
+		Float4 z = load4(&_centerZ[base]);
+		Float4 radius = load4(&_radius[base]);
+		Float4 negativeRadius = zero - radius;
+
+		int outside = 0;
+		for (const ew::Vec4& plane : planes)
+		{
+			Float4 distance = splat4(plane.x) * x + splat4(plane.y) * y + splat4(plane.z) * z + splat4(plane.w);
+			outside |= lessMask4(distance, negativeRadius);
+		}
+
+		//Back facing as a whole if the direction to every point of the sphere is within 90 degrees minus the cone's
+		//half angle of its axis: dot(d, axis) > cutoff * |d| + radius * (1 + cutoff), d from the camera to the center
+		int backFacing = 0;
+		if (coneTest)
+		{
+			Float4 dx = x - cameraX;
+			Float4 dy = y - cameraY;
+			Float4 dz = z - cameraZ;
+			Float4 cutoff = load4(&_cutoff[base]);
+			Float4 along = (dx * load4(&_axisX[base]) + dy * load4(&_axisY[base]) + dz * load4(&_axisZ[base])) * facing4;
+			Float4 distance = sqrt4(dx * dx + dy * dy + dz * dz);
+			backFacing = lessMask4(cutoff * distance + radius * (one + cutoff), along);
+		}
+
+		for (int lane = 0; lane < 4 && base + lane < _count; lane++)
+		{
+			int i = base + lane;
+			int triangles = int(_indexCount[i] / 3);
+			_stats.meshlets++;
+			if (outside & (1 << lane))
+			{
+				_stats.frustumCulled++;
+				_stats.trianglesCulled += triangles;
+				continue;
+			}
+			if (backFacing & (1 << lane))
+			{
+				_stats.coneCulled++;
+				_stats.trianglesCulled += triangles;
+				continue;
+			}
+
+			_stats.trianglesSubmitted += triangles;
+			if (rangeEnd == _firstIndex[i])
+			{
+				ranges.counts.back() += GLsizei(_indexCount[i]);
+			}
+			else
+			{
+				ranges.counts.push_back(GLsizei(_indexCount[i]));
+				ranges.offsets.push_back(reinterpret_cast<const void*>(size_t(_firstIndex[i]) * sizeof(GLuint)));
+				_stats.ranges++;
+			}
+			rangeEnd = _firstIndex[i] + _indexCount[i];
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/*
+* Created by Adam Gyenes
+* Splits a mesh into small clusters of neighbouring triangles with a bounding sphere and normal cone each, so parts
+* of an object that are off screen or facing away can be skipped instead of drawing all of it or nothing
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "../ew/external/glad.h"
+#include "../ew/ewMath/mat4.h"
+#include "../ew/mesh.h"
+
+//Limits of one meshlet, the sizes mesh shader pipelines favour. 124 triangles leave room for a 4 byte header in a
+//128 entry primitive block
+constexpr int MESHLET_MAX_VERTICES = 64;
+constexpr int MESHLET_MAX_TRIANGLES = 124;
+
+namespace Util
+{
+	struct Meshlet
+	{
+		//Range of the mesh's reordered index buffer, every meshlet's triangles are contiguous
+		unsigned int firstIndex = 0;
+		unsigned int indexCount = 0;
+		//Distinct vertices the triangles use
+		unsigned int vertexCount = 0;
+
+		//Bounding sphere in object space
+		ew::Vec3 center;
+		float radius = 0.f;
+		//Every triangle normal is within the cone around coneAxis. coneCutoff is the sine of its half angle, 1 when it is
+		//90 degrees or wider and the meshlet can't ever be entirely back facing
+		ew::Vec3 coneAxis;
+		float coneCutoff = 1.f;
+	};
+
+	//Builds meshlets greedily: each one grows from a seed triangle into the neighbours that share the most vertices
+	//with it, closest first, until either limit is reached. Reorders mesh.indices so every meshlet is one range, the
+	//vertices are left as they are. Load the mesh after this, the ranges index its index buffer
+	std::vector<Meshlet> buildMeshlets(ew::MeshData& mesh);
+
+	//Index ranges for glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, size())
+	struct MeshletDrawRanges
+	{
+		std::vector<GLsizei> counts;
+		//Byte offsets into the index buffer
+		std::vector<const void*> offsets;
+
+		GLsizei size() const { return GLsizei(counts.size()); }
+		//Keeps the capacity, reserve once for the most meshlets a frame can have and culling never allocates
+		void clear();
+		void reserve(size_t ranges);
+	};
+
+	struct MeshletCullStats
+	{
+		int meshlets = 0;
+		int frustumCulled = 0;
+		//Inside the frustum but facing away entirely
+		int coneCulled = 0;
+		int trianglesSubmitted = 0;
+		int trianglesCulled = 0;
+		//Visible meshlets that are neighbours in the index buffer share a range
+		int ranges = 0;
+	};
+
+	//Culls the meshlets of one mesh, however many objects draw it. Bounds are kept as structure of arrays and tested
+	//4 meshlets at a time (SSE2 where available)
+	class MeshletCuller
+	{
+	public:
+		explicit MeshletCuller(const std::vector<Meshlet>& meshlets);
+
+		//Appends the ranges of one object's meshlets that are inside the view frustum and not entirely back facing as
+		//seen from cameraPosition (world space). Both tests run in object space, so they are exact for any affine model
+		//matrix. A model that mirrors (negative determinant) also flips which side is the front, as it does for the
+		//rasterizer's culling
+		void cull(const ew::Mat4& viewProjection, const ew::Mat4& model, const ew::Vec3& cameraPosition, MeshletDrawRanges& ranges);
+
+		int getMeshletCount() const { return _count; }
+		//Summed over every cull() since the last reset
+		const MeshletCullStats& getStats() const { return _stats; }
+		void resetStats() { _stats = MeshletCullStats(); }
+
+	private:
+		int _count = 0;
+		//Padded to a multiple of 4, padding meshlets have no triangles
+		std::vector<float> _centerX;
+		std::vector<float> _centerY;
+		std::vector<float> _centerZ;
+		std::vector<float> _radius;
+		std::vector<float> _axisX;
+		std::vector<float> _axisY;
+		std::vector<float> _axisZ;
+		std::vector<float> _cutoff;
+		std::vector<unsigned int> _firstIndex;
+		std::vector<unsigned int> _indexCount;
+
+		MeshletCullStats _stats;
+	};
+}
@@ -0,0 +1,513 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "OcclusionCuller.h"
+#include "Float4.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+constexpr uint32_t OCCLUSION_FULL_MASK = 0xFFFFFFFFu;
+//Occluders are clipped to 4 times the screen, keeps the float edge functions precise
+constexpr float OCCLUSION_GUARD_BAND = 4.f;
+constexpr int OCCLUSION_CLIP_PLANES = 5;
+//Float rounding must never make an occluder cover more or nearer than it does: edges are pulled in by a fraction of
+//a pixel and depth planes pushed back, the far clamp to the vertices stays exact
+constexpr float OCCLUSION_EDGE_BIAS = 1.f / 256.f;
+constexpr float OCCLUSION_DEPTH_BIAS = 1e-5f;
+
+//Clip space positions of 4 points, rows of a column major matrix as splatted lanes
+static inline void transform4(const ew::Mat4& m, Util::Float4 x, Util::Float4 y, Util::Float4 z, Util::Float4* out)
+{
+	for (int r = 0; r < 4; r++)
+	{
+		out[r] = Util::splat4(m[0][r]) * x + Util::splat4(m[1][r]) * y + Util::splat4(m[2][r]) * z + Util::splat4(m[3][r]);
+	}
+}
+
+Util::OccluderMesh::OccluderMesh(const ew::MeshData& meshData)
+{
+	load(meshData);
+}
+
+void Util::OccluderMesh::load(const ew::MeshData& meshData)
+{
+	_vertexCount = int(meshData.vertices.size());
+	size_t padded = (meshData.vertices.size() + 3) & ~size_t(3);
+	_x.assign(padded, 0.f);
+	_y.assign(padded, 0.f);
+	_z.assign(padded, 0.f);
+	for (size_t i = 0; i < meshData.vertices.size(); i++)
+	{
+		_x[i] = meshData.vertices[i].pos.x;
+		_y[i] = meshData.vertices[i].pos.y;
+		_z[i] = meshData.vertices[i].pos.z;
+	}
+	_indices.assign(meshData.indices.begin(), meshData.indices.end());
+}
+
+Util::OcclusionCuller::OcclusionCuller(int width, int height, JobSystem& jobs)
+	: _jobs(jobs)
+{
+	resize(width, height);
+}
+
+void Util::OcclusionCuller::resize(int width, int height)
+{
+	_width = width;
+	_height = height;
+	//Rows padded to a multiple of 4 so the tests can always load full SIMD lanes
+	_subtilesX = ((width + OCCLUSION_SUBTILE_WIDTH - 1) / OCCLUSION_SUBTILE_WIDTH + 3) & ~3;
+	_subtilesY = (height + OCCLUSION_SUBTILE_HEIGHT - 1) / OCCLUSION_SUBTILE_HEIGHT;
+	_binsX = (width + OCCLUSION_BIN_WIDTH - 1) / OCCLUSION_BIN_WIDTH;
+	_binsY = (height + OCCLUSION_BIN_HEIGHT - 1) / OCCLUSION_BIN_HEIGHT;
+
+	_bins.resize(size_t(_binsX) * _binsY);
+	_binDepth.assign(size_t(_binsX) * _binsY, 1.f);
+	_coveredDepth.assign(size_t(_subtilesX) * _subtilesY, 1.f);
+	_partialDepth.assign(size_t(_subtilesX) * _subtilesY, 0.f);
+	_partialMask.assign(size_t(_subtilesX) * _subtilesY, 0);
+}
+
+void Util::OcclusionCuller::begin(const ew::Mat4& viewProjection)
+{
+	_viewProjection = viewProjection;
+	_draws.clear();
+}
+
+void Util::OcclusionCuller::addOccluder(const OccluderMesh& mesh, const ew::Mat4& model)
+{
+	_draws.push_back({ &mesh, _viewProjection * model });
+}
+
+void Util::OcclusionCuller::flush()
+{
+	PROFILE_SCOPE("Util::OcclusionCuller::flush");
+
+	typedef std::chrono::steady_clock Clock;
+	auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	_stats = OcclusionStats();
+	_stats.occluders = int(_draws.size());
+
+	Clock::time_point start = Clock::now();
+	{
+		PROFILE_SCOPE("Setup and binning");
+		if (_drawScratch.size() < _draws.size()) _drawScratch.resize(_draws.size());
+		_jobs.parallelFor(int(_draws.size()), [this](int begin, int end, int)
+			{
+				for (int draw = begin; draw < end; draw++) setupDraw(draw);
+			});
+
+		for (size_t draw = 0; draw < _draws.size(); draw++) _stats.rasterizedTriangles += int(_drawScratch[draw].triangles.size());
+
+		//Any bin may get every triangle, reserving that once the camera moves never allocates again for the same occluders
+		for (std::vector<const Triangle*>& bin : _bins)
+		{
+			bin.clear();
+			bin.reserve(_stats.rasterizedTriangles);
+		}
+		//In submission order, every bin then merges its triangles in the same order however the jobs ran
+		for (size_t draw = 0; draw < _draws.size(); draw++)
+		{
+			_stats.occluderTriangles += _draws[draw].mesh->getTriangleCount();
+			for (const Triangle& triangle : _drawScratch[draw].triangles)
+			{
+				for (int by = triangle.minY / OCCLUSION_BIN_HEIGHT; by <= triangle.maxY / OCCLUSION_BIN_HEIGHT; by++)
+				{
+					for (int bx = triangle.minX / OCCLUSION_BIN_WIDTH; bx <= triangle.maxX / OCCLUSION_BIN_WIDTH; bx++)
+					{
+						_bins[by * _binsX + bx].push_back(&triangle);
+					}
+				}
+			}
+		}
+	}
+	_stats.setupMs = elapsedMs(start);
+
+	start = Clock::now();
+	{
+		PROFILE_SCOPE("Raster");
+		_jobs.parallelFor(int(_bins.size()), [this](int begin, int end, int)
+			{
+				for (int bin = begin; bin < end; bin++) rasterizeBin(bin);
+			});
+	}
+	_stats.rasterMs = elapsedMs(start);
+}
+
+void Util::OcclusionCuller::setupDraw(int drawIndex)
+{
+	const Draw& draw = _draws[drawIndex];
+	const OccluderMesh& mesh = *draw.mesh;
+	DrawScratch& scratch = _drawScratch[drawIndex];
+
+	//x, y, z, w per vertex
+	scratch.clip.resize(mesh._x.size() * 4);
+	for (size_t i = 0; i < mesh._x.size(); i += 4)
+	{
+		Float4 clip[4];
+		transform4(draw.modelViewProjection, load4(&mesh._x[i]), load4(&mesh._y[i]), load4(&mesh._z[i]), clip);
+
+		float lanes[4][4];
+		for (int r = 0; r < 4; r++) store4(lanes[r], clip[r]);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			for (int r = 0; r < 4; r++) scratch.clip[(i + lane) * 4 + r] = lanes[r][lane];
+		}
+	}
+
+	//Trivial reject against the frustum, x/y/z within +-w
+	auto outcode = [](const float* v)
+	{
+		float w = v[3];
+		return (v[0] < -w ? 1 : 0) | (v[0] > w ? 2 : 0) | (v[1] < -w ? 4 : 0) | (v[1] > w ? 8 : 0) | (v[2] < -w ? 16 : 0) | (v[2] > w ? 32 : 0);
+	};
+	//Near plane and the guard band as dot(plane, clip position) >= 0
+	const float planes[OCCLUSION_CLIP_PLANES][4] = {
+		{ 0.f, 0.f, 1.f, 1.f },
+		{ 1.f, 0.f, 0.f, OCCLUSION_GUARD_BAND },
+		{ -1.f, 0.f, 0.f, OCCLUSION_GUARD_BAND },
+		{ 0.f, 1.f, 0.f, OCCLUSION_GUARD_BAND },
+		{ 0.f, -1.f, 0.f, OCCLUSION_GUARD_BAND },
+	};
+	auto distance = [&planes](const float* v, int plane)
+	{
+		return planes[plane][0] * v[0] + planes[plane][1] * v[1] + planes[plane][2] * v[2] + planes[plane][3] * v[3];
+	};
+
+	//Clipping leaves at most 6 triangles of each, reserved up front so moving the camera never allocates
+	scratch.triangles.clear();
+	scratch.triangles.reserve(mesh._indices.size() / 3 * (OCCLUSION_CLIP_PLANES + 1));
+	for (size_t t = 0; t + 2 < mesh._indices.size(); t += 3)
+	{
+		const float* v[3];
+		for (int i = 0; i < 3; i++) v[i] = &scratch.clip[size_t(mesh._indices[t + i]) * 4];
+
+		if (outcode(v[0]) & outcode(v[1]) & outcode(v[2])) continue;
+
+		int clipMask = 0;
+		for (int plane = 0; plane < OCCLUSION_CLIP_PLANES; plane++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (distance(v[i], plane) < 0.f) clipMask |= 1 << plane;
+			}
+		}
+		if (!clipMask)
+		{
+			emitTriangle(scratch.triangles, v[0], v[1], v[2]);
+			continue;
+		}
+
+		//Sutherland-Hodgman on positions only
+		float polygons[2][3 + OCCLUSION_CLIP_PLANES][4];
+		int count = 3;
+		for (int i = 0; i < 3; i++) std::copy(v[i], v[i] + 4, polygons[0][i]);
+
+		int current = 0;
+		for (int plane = 0; plane < OCCLUSION_CLIP_PLANES && count >= 3; plane++)
+		{
+			if (!(clipMask & (1 << plane))) continue;
+
+			float (*out)[4] = polygons[current ^ 1];
+			int outCount = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const float* a = polygons[current][i];
+				const float* b = polygons[current][(i + 1) % count];
+				float da = distance(a, plane);
+				float db = distance(b, plane);
+
+				if (da >= 0.f) std::copy(a, a + 4, out[outCount++]);
+				if ((da >= 0.f) != (db >= 0.f))
+				{
+					float s = da / (da - db);
+					float* lerped = out[outCount++];
+					for (int c = 0; c < 4; c++) lerped[c] = a[c] + (b[c] - a[c]) * s;
+				}
+			}
+			count = outCount;
+			current ^= 1;
+		}
+		for (int i = 1; i + 1 < count; i++) emitTriangle(scratch.triangles, polygons[current][0], polygons[current][i], polygons[current][i + 1]);
+	}
+}
+
+void Util::OcclusionCuller::emitTriangle(std::vector<Triangle>& triangles, const float* v0, const float* v1, const float* v2)
+{
+	const float* v[3] = { v0, v1, v2 };
+	float x[3];
+	float y[3];
+	float z[3];
+	for (int i = 0; i < 3; i++)
+	{
+		//Clipped to the near plane, so w is positive
+		float invW = 1.f / v[i][3];
+		x[i] = (v[i][0] * invW * 0.5f + 0.5f) * _width;
+		y[i] = (v[i][1] * invW * 0.5f + 0.5f) * _height;
+		z[i] = v[i][2] * invW * 0.5f + 0.5f;
+	}
+
+	//Counter clockwise is front facing, back faces and degenerates are culled
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.f)) return;
+
+	//Pixels whose centers can be covered, the guard band keeps the casts in range
+	Triangle triangle;
+	triangle.minX = std::max(int(ceilf(std::min({ x[0], x[1], x[2] }) - 0.5f)), 0);
+	triangle.minY = std::max(int(ceilf(std::min({ y[0], y[1], y[2] }) - 0.5f)), 0);
+	triangle.maxX = std::min(int(floorf(std::max({ x[0], x[1], x[2] }) - 0.5f)), _width - 1);
+	triangle.maxY = std::min(int(floorf(std::max({ y[0], y[1], y[2] }) - 0.5f)), _height - 1);
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+	//Edge i is opposite vertex i
+	for (int e = 0; e < 3; e++)
+	{
+		int a = (e + 1) % 3;
+		int b = (e + 2) % 3;
+		triangle.edge[e][0] = y[a] - y[b];
+		triangle.edge[e][1] = x[b] - x[a];
+		triangle.edge[e][2] = -(triangle.edge[e][0] * x[a] + triangle.edge[e][1] * y[a]) - (fabsf(triangle.edge[e][0]) + fabsf(triangle.edge[e][1])) * OCCLUSION_EDGE_BIAS;
+	}
+
+	float dz1 = z[1] - z[0];
+	float dz2 = z[2] - z[0];
+	triangle.depth[0] = (dz1 * (y[2] - y[0]) - dz2 * (y[1] - y[0])) / area;
+	triangle.depth[1] = (dz2 * (x[1] - x[0]) - dz1 * (x[2] - x[0])) / area;
+	triangle.depth[2] = z[0] - triangle.depth[0] * x[0] - triangle.depth[1] * y[0];
+	//Beyond the far plane nothing is drawn anyway
+	triangle.maxDepth = std::min(std::max({ z[0], z[1], z[2] }), 1.f);
+
+	triangles.push_back(triangle);
+}
+
+void Util::OcclusionCuller::rasterizeBin(int bin)
+{
+	int binX = bin % _binsX;
+	int binY = bin / _binsX;
+	int subtileMinX = binX * (OCCLUSION_BIN_WIDTH / OCCLUSION_SUBTILE_WIDTH);
+	int subtileMinY = binY * (OCCLUSION_BIN_HEIGHT / OCCLUSION_SUBTILE_HEIGHT);
+	int subtileMaxX = std::min(subtileMinX + OCCLUSION_BIN_WIDTH / OCCLUSION_SUBTILE_WIDTH, (_width + OCCLUSION_SUBTILE_WIDTH - 1) / OCCLUSION_SUBTILE_WIDTH) - 1;
+	int subtileMaxY = std::min(subtileMinY + OCCLUSION_BIN_HEIGHT / OCCLUSION_SUBTILE_HEIGHT, _subtilesY) - 1;
+
+	for (int y = subtileMinY; y <= subtileMaxY; y++)
+	{
+		size_t row = size_t(y) * _subtilesX;
+		std::fill(&_coveredDepth[row + subtileMinX], &_coveredDepth[row + subtileMaxX] + 1, 1.f);
+		std::fill(&_partialDepth[row + subtileMinX], &_partialDepth[row + subtileMaxX] + 1, 0.f);
+		std::fill(&_partialMask[row + subtileMinX], &_partialMask[row + subtileMaxX] + 1, 0u);
+	}
+
+	for (const Triangle* triangle : _bins[bin])
+	{
+		int minX = std::max(triangle->minX / OCCLUSION_SUBTILE_WIDTH, subtileMinX);
+		int maxX = std::min(triangle->maxX / OCCLUSION_SUBTILE_WIDTH, subtileMaxX);
+		int minY = std::max(triangle->minY / OCCLUSION_SUBTILE_HEIGHT, subtileMinY);
+		int maxY = std::min(triangle->maxY / OCCLUSION_SUBTILE_HEIGHT, subtileMaxY);
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++) rasterizeSubtile(*triangle, x, y);
+		}
+	}
+
+	//Coarse level: the farthest covered depth in the bin, most hidden boxes stop there
+	float binDepth = 0.f;
+	for (int y = subtileMinY; y <= subtileMaxY; y++)
+	{
+		size_t row = size_t(y) * _subtilesX;
+		for (int x = subtileMinX; x <= subtileMaxX; x++) binDepth = std::max(binDepth, _coveredDepth[row + x]);
+	}
+	_binDepth[bin] = binDepth;
+}
+
+void Util::OcclusionCuller::rasterizeSubtile(const Triangle& triangle, int subtileX, int subtileY)
+{
+	size_t index = size_t(subtileY) * _subtilesX + subtileX;
+	float& coveredDepth = _coveredDepth[index];
+	float& partialDepth = _partialDepth[index];
+	uint32_t& partialMask = _partialMask[index];
+
+	//Pixel centers at the subtile's corners
+	float minX = subtileX * OCCLUSION_SUBTILE_WIDTH + 0.5f;
+	float minY = subtileY * OCCLUSION_SUBTILE_HEIGHT + 0.5f;
+	float maxX = minX + OCCLUSION_SUBTILE_WIDTH - 1;
+	float maxY = minY + OCCLUSION_SUBTILE_HEIGHT - 1;
+
+	//Farthest the plane gets over the subtile, nothing to add if that's behind what already covers it
+	float depth = triangle.depth[0] * (triangle.depth[0] > 0.f ? maxX : minX) + triangle.depth[1] * (triangle.depth[1] > 0.f ? maxY : minY) + triangle.depth[2];
+	depth = std::max(std::min(depth + OCCLUSION_DEPTH_BIAS, triangle.maxDepth), 0.f);
+	if (depth >= coveredDepth) return;
+
+	//Corners where each edge function is smallest and largest: all outside of one edge or all inside of every edge
+	bool inside = true;
+	for (int e = 0; e < 3; e++)
+	{
+		const float* edge = triangle.edge[e];
+		float nearX = edge[0] > 0.f ? minX : maxX;
+		float nearY = edge[1] > 0.f ? minY : maxY;
+		float farX = edge[0] > 0.f ? maxX : minX;
+		float farY = edge[1] > 0.f ? maxY : minY;
+		if (edge[0] * farX + edge[1] * farY + edge[2] < 0.f) return;
+		inside &= edge[0] * nearX + edge[1] * nearY + edge[2] >= 0.f;
+	}
+
+	uint32_t coverage = OCCLUSION_FULL_MASK;
+	if (!inside)
+	{
+		//4 pixels of a row at a time, bit row * 8 + column
+		coverage = 0;
+		Float4 columns[2] = { set4(minX, minX + 1.f, minX + 2.f, minX + 3.f), set4(minX + 4.f, minX + 5.f, minX + 6.f, minX + 7.f) };
+		Float4 zero = splat4(0.f);
+		Float4 stepX[3];
+		for (int e = 0; e < 3; e++) stepX[e] = splat4(triangle.edge[e][0]);
+		for (int row = 0; row < OCCLUSION_SUBTILE_HEIGHT; row++)
+		{
+			float y = minY + row;
+			for (int half = 0; half < 2; half++)
+			{
+				int outside = 0;
+				for (int e = 0; e < 3; e++)
+				{
+					Float4 value = stepX[e] * columns[half] + splat4(triangle.edge[e][1] * y + triangle.edge[e][2]);
+					outside |= lessMask4(value, zero);
+				}
+				coverage |= uint32_t(~outside & 0xF) << (row * OCCLUSION_SUBTILE_WIDTH + half * 4);
+			}
+		}
+		if (!coverage) return;
+	}
+
+	//A triangle much nearer than the partial layer starts a new one rather than pulling it towards the back
+	if (partialMask && partialDepth - depth > coveredDepth - partialDepth)
+	{
+		partialDepth = 0.f;
+		partialMask = 0;
+	}
+
+	partialMask |= coverage;
+	partialDepth = std::max(partialDepth, depth);
+	if (partialMask == OCCLUSION_FULL_MASK)
+	{
+		//Only triangles in front of the covering layer merge, so the full partial layer is nearer
+		coveredDepth = partialDepth;
+		partialDepth = 0.f;
+		partialMask = 0;
+	}
+}
+
+bool Util::OcclusionCuller::isVisible(const ew::Vec3& boundsMin, const ew::Vec3& boundsMax, const ew::Mat4& model) const
+{
+	ew::Mat4 modelViewProjection = _viewProjection * model;
+
+	//Corners 0-3 at min z, 4-7 at max z
+	Float4 x = set4(boundsMin.x, boundsMax.x, boundsMin.x, boundsMax.x);
+	Float4 y = set4(boundsMin.y, boundsMin.y, boundsMax.y, boundsMax.y);
+	Float4 clip[2][4];
+	transform4(modelViewProjection, x, y, splat4(boundsMin.z), clip[0]);
+	transform4(modelViewProjection, x, y, splat4(boundsMax.z), clip[1]);
+
+	float minX = 1e30f;
+	float minY = 1e30f;
+	float maxX = -1e30f;
+	float maxY = -1e30f;
+	float minDepth = 1.f;
+	for (int half = 0; half < 2; half++)
+	{
+		float lanes[4][4];
+		for (int r = 0; r < 4; r++) store4(lanes[r], clip[half][r]);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			float w = lanes[3][lane];
+			//Crossing the near plane, the camera may be inside the box
+			if (lanes[2][lane] < -w || w <= 0.f) return true;
+
+			float invW = 1.f / w;
+			float sx = (lanes[0][lane] * invW * 0.5f + 0.5f) * _width;
+			float sy = (lanes[1][lane] * invW * 0.5f + 0.5f) * _height;
+			minX = std::min(minX, sx);
+			maxX = std::max(maxX, sx);
+			minY = std::min(minY, sy);
+			maxY = std::max(maxY, sy);
+			minDepth = std::min(minDepth, lanes[2][lane] * invW * 0.5f + 0.5f);
+		}
+	}
+
+	//Every pixel the box touches at all, off screen boxes are left to frustum culling. Clamped before the casts, a
+	//corner close to the camera's plane projects arbitrarily far
+	int pixelMinX = int(floorf(std::max(minX, 0.f)));
+	int pixelMinY = int(floorf(std::max(minY, 0.f)));
+	int pixelMaxX = int(ceilf(std::min(maxX, float(_width)))) - 1;
+	int pixelMaxY = int(ceilf(std::min(maxY, float(_height)))) - 1;
+	if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY) return true;
+
+	return testRect(pixelMinX, pixelMinY, pixelMaxX, pixelMaxY, minDepth);
+}
+
+bool Util::OcclusionCuller::testRect(int minX, int minY, int maxX, int maxY, float minDepth) const
+{
+	//Hidden behind the farthest depth of every bin it overlaps
+	bool hidden = true;
+	for (int by = minY / OCCLUSION_BIN_HEIGHT; by <= maxY / OCCLUSION_BIN_HEIGHT && hidden; by++)
+	{
+		for (int bx = minX / OCCLUSION_BIN_WIDTH; bx <= maxX / OCCLUSION_BIN_WIDTH && hidden; bx++)
+		{
+			hidden = _binDepth[by * _binsX + bx] < minDepth;
+		}
+	}
+	if (hidden) return false;
+
+	//4 subtiles at a time, rows are padded so the last load stays inside
+	int subtileMinX = minX / OCCLUSION_SUBTILE_WIDTH;
+	int subtileMaxX = maxX / OCCLUSION_SUBTILE_WIDTH;
+	Float4 boxDepth = splat4(minDepth);
+	for (int y = minY / OCCLUSION_SUBTILE_HEIGHT; y <= maxY / OCCLUSION_SUBTILE_HEIGHT; y++)
+	{
+		const float* row = &_coveredDepth[size_t(y) * _subtilesX];
+		for (int x = subtileMinX & ~3; x <= subtileMaxX; x += 4)
+		{
+			int lanes = 0xF;
+			if (x < subtileMinX) lanes &= 0xF << (subtileMinX - x);
+			if (subtileMaxX - x < 3) lanes &= 0xF >> (3 - (subtileMaxX - x));
+			int covered = lessMask4(load4(&row[x]), boxDepth);
+			if (lanes & ~covered) return true;
+		}
+	}
+	return false;
+}
+
+void Util::OcclusionCuller::test(const std::vector<OcclusionBounds>& bounds, std::vector<unsigned char>& visible)
+{
+	PROFILE_SCOPE("Util::OcclusionCuller::test");
+
+	auto start = std::chrono::steady_clock::now();
+	visible.resize(bounds.size());
+	//Tests are cheap, fewer bigger pieces
+	_jobs.parallelFor(int(bounds.size()), [this, &bounds, &visible](int begin, int end, int)
+		{
+			for (int i = begin; i < end; i++) visible[i] = isVisible(bounds[i].min, bounds[i].max, bounds[i].model);
+		}, 64);
+
+	_stats.tested += int(bounds.size());
+	for (unsigned char v : visible) _stats.occluded += !v;
+	_stats.testMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Util::OcclusionCuller::resolveDepth(std::vector<float>& depth) const
+{
+	depth.resize(size_t(_width) * _height);
+	for (int y = 0; y < _height; y++)
+	{
+		for (int x = 0; x < _width; x++)
+		{
+			size_t index = size_t(y / OCCLUSION_SUBTILE_HEIGHT) * _subtilesX + x / OCCLUSION_SUBTILE_WIDTH;
+			int bit = (y % OCCLUSION_SUBTILE_HEIGHT) * OCCLUSION_SUBTILE_WIDTH + x % OCCLUSION_SUBTILE_WIDTH;
+			float pixelDepth = _coveredDepth[index];
+			if (_partialMask[index] & (1u << bit)) pixelDepth = std::min(pixelDepth, _partialDepth[index]);
+			depth[size_t(y) * _width + x] = pixelDepth;
+		}
+	}
+}
@@ -0,0 +1,158 @@
+/*
+* Created by Adam Gyenes
+* CPU occlusion culling: a few big occluders are rasterized into a small masked depth buffer, then object bounds are
+* tested against it before they are submitted. Needs no GL, the buffer is built and tested on a Util::JobSystem
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../ew/ewMath/mat4.h"
+#include "../ew/mesh.h"
+
+#include "JobSystem.h"
+
+namespace Util
+{
+	//Coverage and depth are kept per 8x4 pixel subtile, one bit per pixel in a 32 bit mask
+	constexpr int OCCLUSION_SUBTILE_WIDTH = 8;
+	constexpr int OCCLUSION_SUBTILE_HEIGHT = 4;
+	//Screen bins rasterized as one job each, a whole number of subtiles
+	constexpr int OCCLUSION_BIN_WIDTH = 64;
+	constexpr int OCCLUSION_BIN_HEIGHT = 32;
+
+	//Positions and indices of an occluder, built once like Util::SoftwareMesh. A few hundred triangles at most, the
+	//buffer is coarse enough that a box stands in for most shapes
+	class OccluderMesh
+	{
+	public:
+		OccluderMesh() {};
+		OccluderMesh(const ew::MeshData& meshData);
+
+		void load(const ew::MeshData& meshData);
+
+		int getVertexCount() const { return _vertexCount; }
+		int getTriangleCount() const { return int(_indices.size() / 3); }
+
+	private:
+		friend class OcclusionCuller;
+
+		int _vertexCount = 0;
+		//Structure of arrays padded to a multiple of 4
+		std::vector<float> _x;
+		std::vector<float> _y;
+		std::vector<float> _z;
+		std::vector<unsigned int> _indices;
+	};
+
+	//Local space AABB of an object and where it is this frame
+	struct OcclusionBounds
+	{
+		ew::Vec3 min;
+		ew::Vec3 max;
+		ew::Mat4 model;
+	};
+
+	struct OcclusionStats
+	{
+		int occluders = 0;
+		int occluderTriangles = 0;
+		//After back face culling and near clipping
+		int rasterizedTriangles = 0;
+		int tested = 0;
+		int occluded = 0;
+
+		double setupMs = 0.0;
+		double rasterMs = 0.0;
+		double testMs = 0.0;
+	};
+
+	//  culler.begin(viewProjection);
+	//  culler.addOccluder(cubeOccluder, cubeModel);
+	//  culler.flush();
+	//  culler.test(bounds, visible);
+	//Every pixel's depth is bounded by its subtile's two layers: the farthest depth of a layer covering the whole
+	//subtile, and the farthest depth of the triangles covering the pixels in a partial mask on top of it. A new triangle
+	//merges into the partial layer, and once the mask is full that layer becomes the covering one. The buffer only
+	//ever overestimates depth, so a box it reports as hidden is hidden
+	class OcclusionCuller
+	{
+	public:
+		//Setup, rasterization and tests run as parallelFor jobs on jobs, which must outlive the culler
+		OcclusionCuller(int width, int height, JobSystem& jobs);
+
+		void resize(int width, int height);
+
+		//Occluder meshes are referenced until flush(). Counter clockwise triangles are front facing like GL, the back
+		//faces of an open mesh such as a plane don't occlude. Nearer occluders first merge best
+		void begin(const ew::Mat4& viewProjection);
+		void addOccluder(const OccluderMesh& mesh, const ew::Mat4& model);
+		void flush();
+
+		//Safe from any thread after flush(). A box crossing the near plane is always visible
+		bool isVisible(const ew::Vec3& boundsMin, const ew::Vec3& boundsMax, const ew::Mat4& model) const;
+		//Tests every bounds in parallel, visible[i] is 0 for a hidden box and 1 otherwise. Updates the stats
+		void test(const std::vector<OcclusionBounds>& bounds, std::vector<unsigned char>& visible);
+
+		int getWidth() const { return _width; }
+		int getHeight() const { return _height; }
+		//Conservative depth of every pixel in [0, 1], bottom row first like Util::SoftwareRasterizer
+		void resolveDepth(std::vector<float>& depth) const;
+		const OcclusionStats& getStats() const { return _stats; }
+
+	private:
+		struct Triangle
+		{
+			//Edge functions a * x + b * y + c in pixels, >= 0 inside
+			float edge[3][3];
+			//Depth plane z = a * x + b * y + c and the farthest vertex, the plane is clamped to it
+			float depth[3];
+			float maxDepth;
+			int minX, minY, maxX, maxY;
+		};
+
+		struct Draw
+		{
+			const OccluderMesh* mesh;
+			ew::Mat4 modelViewProjection;
+		};
+
+		//Kept between frames so the vectors keep their capacity
+		struct DrawScratch
+		{
+			std::vector<float> clip;
+			std::vector<Triangle> triangles;
+		};
+
+		void setupDraw(int draw);
+		void emitTriangle(std::vector<Triangle>& triangles, const float* v0, const float* v1, const float* v2);
+		void rasterizeBin(int bin);
+		void rasterizeSubtile(const Triangle& triangle, int subtileX, int subtileY);
+		bool testRect(int minX, int minY, int maxX, int maxY, float minDepth) const;
+
+		JobSystem& _jobs;
+
+		int _width = 0;
+		int _height = 0;
+		int _subtilesX = 0;
+		int _subtilesY = 0;
+		int _binsX = 0;
+		int _binsY = 0;
+
+		ew::Mat4 _viewProjection;
+		std::vector<Draw> _draws;
+		std::vector<DrawScratch> _drawScratch;
+		std::vector<std::vector<const Triangle*>> _bins;
+		//Farthest covered depth of each bin, the coarse level boxes are tested against first
+		std::vector<float> _binDepth;
+
+		//Per subtile, row major
+		std::vector<float> _coveredDepth;
+		std::vector<float> _partialDepth;
+		std::vector<uint32_t> _partialMask;
+
+		OcclusionStats _stats;
+	};
+}
@@ -0,0 +1,219 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "OcclusionQueries.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../ew/ewMath/transformations.h"
+#include "../ew/procGen.h"
+
+#include "Profiler.h"
+
+//Boxes grow by this share of their largest side, a box must never fail the depth test against its own object
+constexpr float OCCLUSION_QUERY_BOX_PADDING = 0.01f;
+
+Util::OcclusionQueryPool::OcclusionQueryPool()
+{
+	//Unit cube around the origin, scaled onto each object's bounds
+	_box.load(ew::createCube(1.f), true);
+}
+
+Util::OcclusionQueryPool::~OcclusionQueryPool()
+{
+	if (!_queries.empty()) glDeleteQueries(GLsizei(_queries.size()), _queries.data());
+}
+
+void Util::OcclusionQueryPool::begin(const ew::Mat4& viewProjection)
+{
+	PROFILE_SCOPE("Util::OcclusionQueryPool::begin");
+
+	_viewProjection = viewProjection;
+	_frame++;
+	_queued.clear();
+
+	int queries = _stats.poolSize;
+	_stats = OcclusionQueryStats();
+	_stats.poolSize = queries;
+
+	size_t kept = 0;
+	for (int id : _pending)
+	{
+		Object& object = _objects[id];
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			_pending[kept++] = id;
+			continue;
+		}
+
+		GLuint samples = 0;
+		glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &samples);
+		object.pending = false;
+		object.visible = samples != 0;
+
+		//Issued before a frame the object sat out, classify() starts it over anyway
+		if (object.lastFrame != _frame - 1) continue;
+
+		if (!object.visible)
+		{
+			object.visibleFrames = 0;
+			object.interval = 0;
+			continue;
+		}
+
+		//Visible long enough to stop asking every frame, each passed re-test doubles the wait
+		object.visibleFrames++;
+		if (object.visibleFrames >= OCCLUSION_QUERY_VISIBLE_FRAMES)
+		{
+			object.interval = object.interval > 0 ? std::min(object.interval * 2, OCCLUSION_QUERY_MAX_INTERVAL) : OCCLUSION_QUERY_VISIBLE_FRAMES;
+			object.nextQueryFrame = _frame + object.interval;
+			releaseQuery(object);
+		}
+	}
+	_pending.resize(kept);
+	_stats.pending = int(kept);
+}
+
+Util::OcclusionDecision Util::OcclusionQueryPool::classify(int id, const ew::Vec3& boundsMin, const ew::Vec3& boundsMax, const ew::Mat4& model, bool expensive)
+{
+	//Every object queues and has in flight at most one query, sized here so later frames never reallocate
+	if (id >= int(_objects.size()))
+	{
+		_objects.resize(id + 1);
+		_queued.reserve(_objects.size());
+		_pending.reserve(_objects.size());
+	}
+	Object& object = _objects[id];
+	_stats.objects++;
+
+	//Skipped a frame, whatever it last saw is stale
+	if (object.lastFrame != _frame - 1)
+	{
+		object.visible = true;
+		object.visibleFrames = 0;
+		object.interval = 0;
+	}
+	object.lastFrame = _frame;
+
+	//A box the camera is in or close to is clipped by the near plane, its query would say nothing
+	ew::Mat4 modelViewProjection = _viewProjection * model;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		ew::Vec3 position((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+		ew::Vec4 clip = modelViewProjection * ew::Vec4(position, 1.f);
+		if (clip.w <= 0.f || clip.z < -clip.w)
+		{
+			object.visible = true;
+			_stats.unqueried++;
+			return OcclusionDecision::DRAW;
+		}
+	}
+
+	//The last query is still in flight, go on with the result before it
+	if (object.pending)
+	{
+		if (object.visible) return OcclusionDecision::DRAW;
+		_stats.skipped++;
+		return OcclusionDecision::SKIP;
+	}
+
+	if (object.interval > 0 && _frame < object.nextQueryFrame)
+	{
+		_stats.unqueried++;
+		return OcclusionDecision::DRAW;
+	}
+
+	ew::Vec3 size = boundsMax - boundsMin;
+	float padding = std::max(std::max(size.x, size.y), size.z) * OCCLUSION_QUERY_BOX_PADDING;
+	ew::Vec3 center = (boundsMin + boundsMax) * 0.5f;
+	ew::Vec3 boxSize(size.x + padding * 2.f, size.y + padding * 2.f, size.z + padding * 2.f);
+	_queued.push_back(QueuedQuery{ id, model * ew::Translate(center) * ew::Scale(boxSize) });
+	if (!object.query) object.query = acquireQuery();
+
+	if (object.visible) return OcclusionDecision::DRAW;
+	if (expensive)
+	{
+		_stats.conditional++;
+		return OcclusionDecision::DRAW_CONDITIONAL;
+	}
+	_stats.skipped++;
+	return OcclusionDecision::SKIP;
+}
+
+void Util::OcclusionQueryPool::issueQueries(const ew::Shader& boundsShader, GLStateCache& stateCache)
+{
+	PROFILE_SCOPE("Util::OcclusionQueryPool::issueQueries");
+	PROFILE_GPU_SCOPE("Occlusion queries");
+
+	if (_queued.empty()) return;
+
+	stateCache.useProgram(boundsShader.getId());
+	boundsShader.setMat4("_ViewProjection", _viewProjection);
+	GLint modelLocation = glGetUniformLocation(boundsShader.getId(), "_Model");
+	stateCache.bindVertexBindings(_box.getDepthVertexBindings());
+
+	//Back faces count too, a box is only ever occluded by what's in front of all of it
+	GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	if (cullFace) glDisable(GL_CULL_FACE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glDepthFunc(GL_LEQUAL);
+
+	GLsizei indexCount = _box.getIndexCount();
+	for (const QueuedQuery& queued : _queued)
+	{
+		Object& object = _objects[queued.id];
+		glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &queued.boxModel[0][0]);
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, object.query);
+		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		object.pending = true;
+		_pending.push_back(queued.id);
+	}
+	_stats.queries = int(_queued.size());
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	if (cullFace) glEnable(GL_CULL_FACE);
+}
+
+void Util::OcclusionQueryPool::beginConditional(int id) const
+{
+	//The GPU waits for the box it just drew, the CPU doesn't
+	glBeginConditionalRender(_objects[id].query, GL_QUERY_WAIT);
+}
+
+void Util::OcclusionQueryPool::endConditional() const
+{
+	glEndConditionalRender();
+}
+
+GLuint Util::OcclusionQueryPool::acquireQuery()
+{
+	if (_freeQueries.empty())
+	{
+		GLuint queries[OCCLUSION_QUERY_POOL_GROWTH];
+		glGenQueries(OCCLUSION_QUERY_POOL_GROWTH, queries);
+		_queries.insert(_queries.end(), queries, queries + OCCLUSION_QUERY_POOL_GROWTH);
+		//Every query can be released back at once
+		_freeQueries.reserve(_queries.size());
+		_freeQueries.insert(_freeQueries.end(), queries, queries + OCCLUSION_QUERY_POOL_GROWTH);
+		_stats.poolSize = int(_queries.size());
+	}
+
+	GLuint query = _freeQueries.back();
+	_freeQueries.pop_back();
+	return query;
+}
+
+void Util::OcclusionQueryPool::releaseQuery(Object& object)
+{
+	if (!object.query) return;
+	_freeQueries.push_back(object.query);
+	object.query = 0;
+}
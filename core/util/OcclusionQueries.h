@@ -0,0 +1,120 @@
+/*
+* Created by Adam Gyenes
+* GPU occlusion queries: an object's bounding box is drawn against the depth buffer after the opaque pass and the
+* result decides the next frame's draw, so the CPU never waits on it. Queries are pooled and objects that keep passing
+* them are only re-tested every now and then
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "../ew/ewMath/mat4.h"
+#include "../ew/external/glad.h"
+#include "../ew/shader.h"
+
+#include "GLStateCache.h"
+#include "Mesh.h"
+
+namespace Util
+{
+	//Visible results in a row before an object stops being queried every frame
+	constexpr int OCCLUSION_QUERY_VISIBLE_FRAMES = 8;
+	//Longest wait between re-tests of an object that is always visible, the wait doubles up to it
+	constexpr int OCCLUSION_QUERY_MAX_INTERVAL = 64;
+	//Query objects generated at once when the pool runs dry
+	constexpr int OCCLUSION_QUERY_POOL_GROWTH = 64;
+
+	enum class OcclusionDecision
+	{
+		DRAW = 0,
+		//Hidden at the last result
+		SKIP,
+		//Hidden at the last result, but drawn under conditional rendering on this frame's query
+		DRAW_CONDITIONAL
+	};
+
+	struct OcclusionQueryStats
+	{
+		int objects = 0;
+		//Boxes drawn this frame
+		int queries = 0;
+		//Draws trusted to be visible without a query
+		int unqueried = 0;
+		int skipped = 0;
+		int conditional = 0;
+		//Issued on an earlier frame, result not back yet
+		int pending = 0;
+		//Query objects the pool owns
+		int poolSize = 0;
+	};
+
+	//  pool.begin(viewProjection);
+	//  OcclusionDecision decision = pool.classify(id, boundsMin, boundsMax, model, expensive);
+	//  ...draw everything decided DRAW...
+	//  pool.issueQueries(depthShader, stateCache);
+	//  pool.beginConditional(id); ...draw... pool.endConditional();
+	//Ids are small, stable indices picked by the caller. An object that wasn't classified on the previous frame starts
+	//over as visible, its old result says nothing about where it is now. GL thread only
+	class OcclusionQueryPool
+	{
+	public:
+		OcclusionQueryPool();
+		~OcclusionQueryPool();
+
+		OcclusionQueryPool(const OcclusionQueryPool&) = delete;
+		OcclusionQueryPool& operator=(const OcclusionQueryPool&) = delete;
+
+		//Collects the results that are back, never waits for one
+		void begin(const ew::Mat4& viewProjection);
+		//Once per object per frame. Expensive objects hidden at the last result are drawn conditionally instead of
+		//skipped, so they cost the GPU nothing while hidden and don't pop in a frame late
+		OcclusionDecision classify(int id, const ew::Vec3& boundsMin, const ew::Vec3& boundsMax, const ew::Mat4& model, bool expensive);
+
+		//Draws the boxes classify() asked for against the current depth buffer, with color and depth writes off.
+		//boundsShader transforms position only with _Model and _ViewProjection. Leaves the program bound and depth at
+		//GL_LESS with writes on
+		void issueQueries(const ew::Shader& boundsShader, GLStateCache& stateCache);
+
+		//Around the draw of an object classify() decided DRAW_CONDITIONAL, after issueQueries()
+		void beginConditional(int id) const;
+		void endConditional() const;
+
+		const OcclusionQueryStats& getStats() const { return _stats; }
+
+	private:
+		struct Object
+		{
+			GLuint query = 0;
+			bool pending = false;
+			bool visible = true;
+			int visibleFrames = 0;
+			//Frames between queries once the object is trusted, 0 queries every frame
+			int interval = 0;
+			int nextQueryFrame = 0;
+			int lastFrame = -1;
+		};
+
+		struct QueuedQuery
+		{
+			int id;
+			ew::Mat4 boxModel;
+		};
+
+		GLuint acquireQuery();
+		void releaseQuery(Object& object);
+
+		Util::Mesh _box;
+
+		std::vector<Object> _objects;
+		std::vector<GLuint> _queries;
+		std::vector<GLuint> _freeQueries;
+		std::vector<int> _pending;
+		std::vector<QueuedQuery> _queued;
+
+		ew::Mat4 _viewProjection;
+		int _frame = 0;
+
+		OcclusionQueryStats _stats;
+	};
+}
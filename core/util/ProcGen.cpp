@@ -1,10 +1,15 @@
 #include "ProcGen.h"
 
-ew::MeshData Util::createPlane(float width, float height, int subdivisions)
+#include <cstdint>
+#include <unordered_map>
+
+ew::MeshData Util::createPlane(float width, float height, int subdivisions, std::pmr::memory_resource* resource)
 {
-	ew::MeshData result;
+	ew::MeshData result(resource);
 
 	int totalCols = subdivisions + 1;
+	result.vertices.reserve(totalCols * totalCols);
+	result.indices.reserve(subdivisions * subdivisions * 6);
 	for (int row = 0; row <= subdivisions; row++)
 	{
 		for (int col = 0; col <= subdivisions; col++)
@@ -41,9 +46,12 @@ ew::MeshData Util::createPlane(float width, float height, int subdivisions)
 	return result;
 }
 
-ew::MeshData Util::createCylidner(float height, float radius, int segments)
+ew::MeshData Util::createCylidner(float height, float radius, int segments, std::pmr::memory_resource* resource)
 {
-	ew::MeshData result;
+	ew::MeshData result(resource);
+	//Two centers and four rings, a fan per cap and a quad per side segment
+	result.vertices.reserve(2 + (segments + 1) * 4);
+	result.indices.reserve((segments + 1) * 6 + segments * 6);
 
 	//Top center
 	float topY = height / 2.f;
@@ -133,9 +141,11 @@ ew::MeshData Util::createCylidner(float height, float radius, int segments)
 	return result;
 }
 
-ew::MeshData Util::createSphere(float radius, int segments)
+ew::MeshData Util::createSphere(float radius, int segments, std::pmr::memory_resource* resource)
 {
-	ew::MeshData result;
+	ew::MeshData result(resource);
+	result.vertices.reserve((segments + 1) * (segments + 1));
+	result.indices.reserve(segments * 6 + (segments > 2 ? (segments - 2) * segments * 6 : 0));
 
 	float yawStep = 2.f * M_PI / segments; //Theta (pls use descriptive names instead of random letters)
 	float pitchStep = M_PI / segments; //Phi
@@ -197,9 +207,12 @@ ew::MeshData Util::createSphere(float radius, int segments)
 }
 
 //From https://lindenreidblog.com/2017/11/06/procedural-torus-tutorial/
-ew::MeshData Util::createTorus(float innerRadius, float outerRadius, int innerSegments, int outerSegments)
+ew::MeshData Util::createTorus(float innerRadius, float outerRadius, int innerSegments, int outerSegments, std::pmr::memory_resource* resource)
 {
-	ew::MeshData result;
+	ew::MeshData result(resource);
+	//Every stack has a seam vertex, plus the seam stack and its closing vertex
+	result.vertices.reserve(outerSegments * (innerSegments + 1) + innerSegments + 1);
+	result.indices.reserve(outerSegments * innerSegments * 6);
 
 	float innerAngleStep = 2.f * M_PI / innerSegments; //phi
 	float outerAngleStep = 2.f * M_PI / outerSegments; //theta
@@ -260,7 +273,7 @@ ew::MeshData Util::createTorus(float innerRadius, float outerRadius, int innerSe
 	//Generate indicies
 	for (int stack = 0; stack < outerSegments; stack++)
 	{
-		for (int slice = 0; slice <= innerSegments; slice++)
+		for (int slice = 0; slice < innerSegments; slice++)
 		{
 			int innerStart = stack * (innerSegments + 1);
 
@@ -276,3 +289,247 @@ ew::MeshData Util::createTorus(float innerRadius, float outerRadius, int innerSe
 
 	return result;
 }
+
+//Longitude/latitude UVs like ew::createSphere, u = 0 where +x meets the sphere, v = 1 at the north pole
+static ew::Vec2 sphericalUV(const ew::Vec3& direction)
+{
+	float u = atan2f(direction.z, direction.x) / ew::TAU;
+	if (u < 0.f) u += 1.f;
+	float v = 1.f - acosf(fminf(fmaxf(direction.y, -1.f), 1.f)) / ew::PI;
+	return ew::Vec2(u, v);
+}
+
+//Sets every vertex's UV from its normal. With seams, triangles wrapping around u = 1 get copies of their low u
+//vertices shifted by one, and every triangle touching a pole gets its own pole vertex under the middle of its edge
+static void applySphericalUVs(ew::MeshData& mesh, bool seams)
+{
+	for (ew::Vertex& vertex : mesh.vertices) vertex.uv = sphericalUV(vertex.normal);
+	if (!seams) return;
+
+	const float POLE_EPSILON = 1e-6f;
+	size_t originalCount = mesh.vertices.size();
+	//Index of each vertex's u + 1 copy, made once and shared by every triangle on the seam
+	std::pmr::vector<unsigned int> wrapped(originalCount, ~0u, mesh.vertices.get_allocator().resource());
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		unsigned int* triangle = &mesh.indices[i];
+		bool pole[3];
+		float minU = 1.f;
+		float maxU = 0.f;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const ew::Vertex& vertex = mesh.vertices[triangle[corner]];
+			pole[corner] = fabsf(vertex.normal.x) < POLE_EPSILON && fabsf(vertex.normal.z) < POLE_EPSILON;
+			if (pole[corner]) continue;
+			minU = fminf(minU, vertex.uv.x);
+			maxU = fmaxf(maxU, vertex.uv.x);
+		}
+
+		if (maxU - minU > 0.5f)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int index = triangle[corner];
+				if (pole[corner] || mesh.vertices[index].uv.x >= 0.5f) continue;
+				if (wrapped[index] == ~0u)
+				{
+					ew::Vertex copy = mesh.vertices[index];
+					copy.uv.x += 1.f;
+					wrapped[index] = static_cast<unsigned int>(mesh.vertices.size());
+					mesh.vertices.push_back(copy);
+				}
+				triangle[corner] = wrapped[index];
+			}
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			if (!pole[corner]) continue;
+			float u = 0.f;
+			for (int other = 0; other < 3; other++)
+			{
+				if (other != corner) u += mesh.vertices[triangle[other]].uv.x * 0.5f;
+			}
+			ew::Vertex copy = mesh.vertices[triangle[corner]];
+			copy.uv.x = u;
+			triangle[corner] = static_cast<unsigned int>(mesh.vertices.size());
+			mesh.vertices.push_back(copy);
+		}
+	}
+}
+
+ew::MeshData Util::createIcosphere(float radius, int subdivisions, bool uvSeams, std::pmr::memory_resource* resource)
+{
+	//Corners (0, +-1, +-phi) and their cyclic permutations, faces wound counterclockwise seen from outside
+	const float phi = (1.f + sqrtf(5.f)) * 0.5f;
+	const ew::Vec3 corners[12] = {
+		ew::Vec3(-1.f, phi, 0.f), ew::Vec3(1.f, phi, 0.f), ew::Vec3(-1.f, -phi, 0.f), ew::Vec3(1.f, -phi, 0.f),
+		ew::Vec3(0.f, -1.f, phi), ew::Vec3(0.f, 1.f, phi), ew::Vec3(0.f, -1.f, -phi), ew::Vec3(0.f, 1.f, -phi),
+		ew::Vec3(phi, 0.f, -1.f), ew::Vec3(phi, 0.f, 1.f), ew::Vec3(-phi, 0.f, -1.f), ew::Vec3(-phi, 0.f, 1.f)
+	};
+	const int faces[20][3] = {
+		{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+		{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+		{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+		{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+	};
+
+	int n = subdivisions < 1 ? 1 : subdivisions;
+	ew::MeshData result(resource);
+	result.vertices.reserve(10 * n * n + 2);
+	result.indices.reserve(20 * n * n * 3);
+
+	auto addVertex = [&](const ew::Vec3& position)
+	{
+		ew::Vertex vertex;
+		vertex.normal = ew::Normalize(position);
+		vertex.pos = vertex.normal * radius;
+		result.vertices.push_back(vertex);
+		return static_cast<unsigned int>(result.vertices.size() - 1);
+	};
+
+	for (const ew::Vec3& corner : corners) addVertex(corner);
+
+	//The n - 1 vertices inside each of the 30 edges, stored from the lower corner index to the higher one and shared
+	//by the two faces on either side
+	struct Edge
+	{
+		int a;
+		int b;
+		unsigned int first;
+	};
+	Edge edges[30];
+	int edgeCount = 0;
+	auto edgeVertex = [&](int from, int to, int step)
+	{
+		int a = from < to ? from : to;
+		int b = from < to ? to : from;
+		Edge* edge = nullptr;
+		for (int i = 0; i < edgeCount && !edge; i++)
+		{
+			if (edges[i].a == a && edges[i].b == b) edge = &edges[i];
+		}
+		if (!edge)
+		{
+			edge = &edges[edgeCount++];
+			edge->a = a;
+			edge->b = b;
+			edge->first = static_cast<unsigned int>(result.vertices.size());
+			for (int i = 1; i < n; i++) addVertex(corners[a] + (corners[b] - corners[a]) * (float(i) / n));
+		}
+		return edge->first + static_cast<unsigned int>(from == a ? step - 1 : n - step - 1);
+	};
+
+	std::pmr::vector<unsigned int> grid(resource);
+	grid.resize((n + 1) * (n + 1));
+	for (const int* face : faces)
+	{
+		const ew::Vec3& a = corners[face[0]];
+		const ew::Vec3& b = corners[face[1]];
+		const ew::Vec3& c = corners[face[2]];
+
+		//grid[j * (n + 1) + i] is the vertex i steps from a towards b and j steps towards c
+		for (int j = 0; j <= n; j++)
+		{
+			for (int i = 0; i + j <= n; i++)
+			{
+				unsigned int index;
+				if (i == 0 && j == 0) index = face[0];
+				else if (i == n) index = face[1];
+				else if (j == n) index = face[2];
+				else if (j == 0) index = edgeVertex(face[0], face[1], i);
+				else if (i == 0) index = edgeVertex(face[0], face[2], j);
+				else if (i + j == n) index = edgeVertex(face[1], face[2], j);
+				else index = addVertex(a + (b - a) * (float(i) / n) + (c - a) * (float(j) / n));
+				grid[j * (n + 1) + i] = index;
+			}
+		}
+
+		for (int j = 0; j < n; j++)
+		{
+			for (int i = 0; i + j < n; i++)
+			{
+				result.indices.push_back(grid[j * (n + 1) + i]);
+				result.indices.push_back(grid[j * (n + 1) + i + 1]);
+				result.indices.push_back(grid[(j + 1) * (n + 1) + i]);
+				if (i + j == n - 1) continue;
+
+				result.indices.push_back(grid[j * (n + 1) + i + 1]);
+				result.indices.push_back(grid[(j + 1) * (n + 1) + i + 1]);
+				result.indices.push_back(grid[(j + 1) * (n + 1) + i]);
+			}
+		}
+	}
+
+	applySphericalUVs(result, uvSeams);
+	return result;
+}
+
+ew::MeshData Util::createCubeSphere(float radius, int subdivisions, bool uvSeams, std::pmr::memory_resource* resource)
+{
+	//Face normal, then its u and v axes like ew::createCubeFace, so every face winds counterclockwise from outside
+	const ew::Vec3 normals[6] = {
+		ew::Vec3(0.f, 0.f, 1.f), ew::Vec3(1.f, 0.f, 0.f), ew::Vec3(0.f, 1.f, 0.f),
+		ew::Vec3(-1.f, 0.f, 0.f), ew::Vec3(0.f, -1.f, 0.f), ew::Vec3(0.f, 0.f, -1.f)
+	};
+
+	int n = subdivisions < 1 ? 1 : subdivisions;
+	int side = 2 * n + 1;
+	ew::MeshData result(resource);
+	result.vertices.reserve(6 * n * n + 2);
+	result.indices.reserve(6 * n * n * 6);
+
+	//Points on the cube's surface have integer coordinates in [-n, n], edges and corners are where faces share them
+	std::pmr::unordered_map<uint64_t, unsigned int> lattice(resource);
+	lattice.reserve(6 * n * n + 2);
+	auto latticeVertex = [&](int x, int y, int z)
+	{
+		uint64_t key = (uint64_t(x + n) * side + uint64_t(y + n)) * side + uint64_t(z + n);
+		auto found = lattice.find(key);
+		if (found != lattice.end()) return found->second;
+
+		//Equal angles instead of equal steps along the face, cells stay close to the same size after normalizing
+		ew::Vec3 position(tanf(ew::PI * 0.25f * x / n), tanf(ew::PI * 0.25f * y / n), tanf(ew::PI * 0.25f * z / n));
+		ew::Vertex vertex;
+		vertex.normal = ew::Normalize(position);
+		vertex.pos = vertex.normal * radius;
+		result.vertices.push_back(vertex);
+
+		unsigned int index = static_cast<unsigned int>(result.vertices.size() - 1);
+		lattice.emplace(key, index);
+		return index;
+	};
+
+	std::pmr::vector<unsigned int> grid(resource);
+	grid.resize((n + 1) * (n + 1));
+	for (const ew::Vec3& normal : normals)
+	{
+		ew::Vec3 a(normal.z, normal.x, normal.y);
+		ew::Vec3 b = ew::Cross(normal, a);
+		for (int row = 0; row <= n; row++)
+		{
+			for (int col = 0; col <= n; col++)
+			{
+				ew::Vec3 point = normal * float(n) + a * float(2 * col - n) + b * float(2 * row - n);
+				grid[row * (n + 1) + col] = latticeVertex(int(lroundf(point.x)), int(lroundf(point.y)), int(lroundf(point.z)));
+			}
+		}
+
+		for (int row = 0; row < n; row++)
+		{
+			for (int col = 0; col < n; col++)
+			{
+				unsigned int start = row * (n + 1) + col;
+				result.indices.push_back(grid[start]);
+				result.indices.push_back(grid[start + 1]);
+				result.indices.push_back(grid[start + n + 2]);
+				result.indices.push_back(grid[start + n + 2]);
+				result.indices.push_back(grid[start + n + 1]);
+				result.indices.push_back(grid[start]);
+			}
+		}
+	}
+
+	applySphericalUVs(result, uvSeams);
+	return result;
+}
@@ -3,13 +3,25 @@
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <memory_resource>
 
 #include "../ew/mesh.h"
 
 namespace Util
 {
-	ew::MeshData createPlane(float width, float height, int subdivisions);
-	ew::MeshData createCylidner(float height, float radius, int segments);
-	ew::MeshData createSphere(float radius, int segments);
-	ew::MeshData createTorus(float innerRadius, float outerRadius, int innerSegments, int outerSegments);
+	//resource: where the mesh's arrays allocate from, the arrays are sized up front so each is a single allocation
+	ew::MeshData createPlane(float width, float height, int subdivisions, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	ew::MeshData createCylidner(float height, float radius, int segments, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	ew::MeshData createSphere(float radius, int segments, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	ew::MeshData createTorus(float innerRadius, float outerRadius, int innerSegments, int outerSegments, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	//Spheres with evenly sized triangles, every vertex shared by all the triangles around it. UVs are the same
+	//longitude/latitude mapping as ew::createSphere. uvSeams duplicates the vertices along the u = 0/1 seam and at the
+	//poles so textures wrap cleanly; without it the mesh is fully welded and the triangles crossing the seam get
+	//stretched UVs, fine for untextured use
+	//Icosahedron with every face split into a subdivisions x subdivisions triangle grid: 20 * subdivisions^2 triangles
+	ew::MeshData createIcosphere(float radius, int subdivisions, bool uvSeams = true, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	//Cube with every face a subdivisions x subdivisions grid, spaced by angle rather than distance so cells near the
+	//face corners don't shrink: 12 * subdivisions^2 triangles
+	ew::MeshData createCubeSphere(float radius, int subdivisions, bool uvSeams = true, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 }
\ No newline at end of file
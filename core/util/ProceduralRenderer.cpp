@@ -0,0 +1,160 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "ProceduralRenderer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+Util::ProceduralPrimitive Util::ProceduralPrimitive::plane(float width, float height, int subdivisions)
+{
+	ProceduralPrimitive primitive;
+	primitive.shape = ProceduralShape::PLANE;
+	primitive.columns = std::max(subdivisions, 1);
+	primitive.rows = primitive.columns;
+	primitive.size[0] = width;
+	primitive.size[1] = height;
+	return primitive;
+}
+
+Util::ProceduralPrimitive Util::ProceduralPrimitive::cylinder(float height, float radius, int segments)
+{
+	ProceduralPrimitive primitive;
+	primitive.shape = ProceduralShape::CYLINDER;
+	primitive.columns = std::max(segments, 1);
+	//Top cap, side, bottom cap
+	primitive.rows = 3;
+	primitive.size[0] = height;
+	primitive.size[1] = radius;
+	return primitive;
+}
+
+Util::ProceduralPrimitive Util::ProceduralPrimitive::sphere(float radius, int segments)
+{
+	ProceduralPrimitive primitive;
+	primitive.shape = ProceduralShape::SPHERE;
+	//Caps are the first and last row, there have to be two of them
+	primitive.columns = std::max(segments, 2);
+	primitive.rows = primitive.columns;
+	primitive.size[0] = radius;
+	return primitive;
+}
+
+Util::ProceduralPrimitive Util::ProceduralPrimitive::torus(float innerRadius, float outerRadius, int innerSegments, int outerSegments)
+{
+	ProceduralPrimitive primitive;
+	primitive.shape = ProceduralShape::TORUS;
+	//Columns go around the ring, rows around the tube
+	primitive.columns = std::max(outerSegments, 1);
+	primitive.rows = std::max(innerSegments, 1);
+	primitive.size[0] = innerRadius;
+	primitive.size[1] = outerRadius;
+	return primitive;
+}
+
+Util::ProceduralRenderer::ProceduralRenderer(int maxInstances) :
+	_instanceBuffer(sizeof(ProceduralInstance), maxInstances, PROCEDURAL_INSTANCE_STORAGE_BINDING, "Util::ProceduralRenderer")
+{
+	//Reserved once, queuing never allocates. Every instance can start a batch of its own
+	_instances.reserve(_instanceBuffer.getCapacity());
+	_batches.reserve(_instanceBuffer.getCapacity());
+
+	if (!isSupported()) return;
+
+	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &_maxLevel);
+}
+
+bool Util::ProceduralRenderer::add(const ProceduralPrimitive& primitive, const ew::Mat4& model)
+{
+	if (!_instanceBuffer.hasRoom(_instances.size())) return false;
+
+	ProceduralInstance instance;
+	instance.model = model;
+	instance.size[0] = primitive.size[0];
+	instance.size[1] = primitive.size[1];
+	instance.size[2] = 0.f;
+	instance.size[3] = 0.f;
+	_instances.push_back(instance);
+
+	if (!_batches.empty() && _batches.back().primitive.isBatchableWith(primitive))
+	{
+		_batches.back().instanceCount++;
+	}
+	else
+	{
+		Batch batch;
+		batch.primitive = primitive;
+		batch.firstInstance = int(_instances.size()) - 1;
+		batch.instanceCount = 1;
+		_batches.push_back(batch);
+	}
+	return true;
+}
+
+void Util::ProceduralRenderer::draw(GLStateCache& stateCache, GLuint program, GLenum mode, FrameSync* frameSync)
+{
+	PROFILE_SCOPE("Util::ProceduralRenderer::draw");
+
+	_stats = ProceduralStats();
+	_stats.overflows = _instanceBuffer.getOverflows();
+	if (!isSupported() || _instances.empty()) return;
+
+	if (_instanceBuffer.changeProgram(program))
+	{
+		_shapeLocation = glGetUniformLocation(program, "_Shape");
+		_segmentsLocation = glGetUniformLocation(program, "_Segments");
+		_firstInstanceLocation = glGetUniformLocation(program, "_FirstInstance");
+		_cameraPositionLocation = glGetUniformLocation(program, "_CameraPosition");
+		_projectionScaleLocation = glGetUniformLocation(program, "_ProjectionScale");
+		_segmentPixelsLocation = glGetUniformLocation(program, "_SegmentPixels");
+		_maxLevelLocation = glGetUniformLocation(program, "_MaxLevel");
+	}
+
+	//One upload for every batch, each draw picks its instances out with _FirstInstance
+	_instanceBuffer.bind(stateCache, program, _instances.data(), int(_instances.size()), frameSync);
+
+	bool patches = mode == GL_PATCHES;
+	if (patches)
+	{
+		glPatchParameteri(GL_PATCH_VERTICES, 4);
+		glUniform3f(_cameraPositionLocation, _cameraPosition.x, _cameraPosition.y, _cameraPosition.z);
+		//Negative marks an orthographic projection, the shader skips the divide by distance
+		glUniform1f(_projectionScaleLocation, _orthographic ? -_projectionScale : _projectionScale);
+		glUniform1f(_segmentPixelsLocation, _pixelsPerSegment);
+		glUniform1f(_maxLevelLocation, float(_maxLevel));
+	}
+
+	for (const Batch& batch : _batches)
+	{
+		const ProceduralPrimitive& primitive = batch.primitive;
+		glUniform1i(_shapeLocation, int(primitive.shape));
+		glUniform2i(_segmentsLocation, primitive.columns, primitive.rows);
+		//gl_InstanceID doesn't include a base instance before GL 4.6
+		glUniform1i(_firstInstanceLocation, batch.firstInstance);
+		GLsizei vertexCount = patches ? primitive.getPatchVertexCount() : primitive.getVertexCount();
+		glDrawArraysInstanced(mode, 0, vertexCount, batch.instanceCount);
+
+		_stats.draws++;
+		_stats.vertices += vertexCount * batch.instanceCount;
+		if (patches) _stats.patches += primitive.columns * primitive.rows * batch.instanceCount;
+	}
+	_stats.instances = int(_instances.size());
+}
+
+void Util::ProceduralRenderer::setTessellationTarget(const ew::Camera& camera, int viewportHeight, float pixelsPerSegment)
+{
+	_cameraPosition = camera.position;
+	_orthographic = camera.orthographic;
+	if (camera.orthographic) _projectionScale = viewportHeight / camera.orthoHeight;
+	else _projectionScale = viewportHeight / (2.f * tanf(ew::Radians(camera.fov) * 0.5f));
+	_pixelsPerSegment = std::max(pixelsPerSegment, 1.f);
+}
+
+void Util::ProceduralRenderer::clear()
+{
+	_instances.clear();
+	_batches.clear();
+	_instanceBuffer.resetOverflows();
+}
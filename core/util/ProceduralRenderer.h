@@ -0,0 +1,139 @@
+/*
+* Created by Adam Gyenes
+* Attribute-less versions of the Util::ProcGen shapes. The vertex shader (proceduralShape.vert) builds every vertex
+* from gl_VertexID and the instance's parameters from gl_InstanceID, so there are no vertex or index buffers at all
+* and changing a shape's resolution is just a different vertex count. Drawn as GL_PATCHES (proceduralPatch.*) every
+* grid cell is a quad patch instead, tessellated on the GPU until its edges are short on screen
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "../ew/camera.h"
+#include "../ew/external/glad.h"
+#include "../ew/ewMath/mat4.h"
+
+#include "GLStateCache.h"
+#include "InstanceBuffer.h"
+
+//Shader storage binding proceduralShape.vert reads its instances from
+constexpr GLuint PROCEDURAL_INSTANCE_STORAGE_BINDING = 1;
+
+namespace Util
+{
+	//Same values as the shape constants in proceduralShape.vert
+	enum class ProceduralShape
+	{
+		PLANE = 0,
+		CYLINDER,
+		SPHERE,
+		TORUS
+	};
+
+	//A shape as a grid of quads, two triangles each. The constructors take the arguments of their Util::ProcGen
+	//counterpart and generate the same vertices, UVs and winding
+	struct ProceduralPrimitive
+	{
+		ProceduralShape shape = ProceduralShape::PLANE;
+		int columns = 1;
+		int rows = 1;
+		//Shape dimensions, in the order the Util::ProcGen function takes them
+		float size[2] = {};
+
+		static ProceduralPrimitive plane(float width, float height, int subdivisions);
+		static ProceduralPrimitive cylinder(float height, float radius, int segments);
+		static ProceduralPrimitive sphere(float radius, int segments);
+		static ProceduralPrimitive torus(float innerRadius, float outerRadius, int innerSegments, int outerSegments);
+
+		//Includes the collapsed second triangle of cap quads, those are zero area and never rasterize
+		GLsizei getVertexCount() const { return GLsizei(columns) * rows * 6; }
+		//One four vertex patch per grid cell, the grid is only the coarse base the tessellator refines
+		GLsizei getPatchVertexCount() const { return GLsizei(columns) * rows * 4; }
+		//Instances sharing shape and resolution draw together, their sizes can differ
+		bool isBatchableWith(const ProceduralPrimitive& other) const { return shape == other.shape && columns == other.columns && rows == other.rows; }
+	};
+
+	//std430 layout of the shader's instance array
+	struct ProceduralInstance
+	{
+		ew::Mat4 model;
+		float size[4];
+	};
+
+	struct ProceduralStats
+	{
+		int instances = 0;
+		int draws = 0;
+		//Generated by the vertex shader, none of them stored anywhere. Patch corners for GL_PATCHES
+		GLsizei vertices = 0;
+		int patches = 0;
+		//add() calls refused since the last clear(), their instances are missing from the draw
+		int overflows = 0;
+	};
+
+	//GL thread only. Queue instances every frame, then draw them with a program built from proceduralShape.vert:
+	//  Util::ProceduralRenderer procedural(64);
+	//  procedural.add(Util::ProceduralPrimitive::sphere(1.f, sphereSegments), sphereTransform.getModelMatrix());
+	//  procedural.draw(stateCache, shader.getId());
+	//  procedural.clear();
+	//The same instances tessellate with a program built from proceduralPatch.vert/.tesc/.tese:
+	//  procedural.setTessellationTarget(camera, screenHeight);
+	//  procedural.draw(stateCache, tessellatedShader.getId(), GL_PATCHES);
+	class ProceduralRenderer
+	{
+	public:
+		explicit ProceduralRenderer(int maxInstances);
+
+		ProceduralRenderer(const ProceduralRenderer&) = delete;
+		ProceduralRenderer& operator=(const ProceduralRenderer&) = delete;
+
+		static bool isSupported() { return InstanceBuffer::isSupported(); }
+
+		//Consecutive instances that are batchable become one instanced draw. False if the renderer is full
+		bool add(const ProceduralPrimitive& primitive, const ew::Mat4& model);
+		//Uploads the queued instances, through frameSync's ring when given (see InstanceBuffer::bind), and draws them.
+		//mode GL_POINTS shows the generated vertices, GL_PATCHES draws the grid as quad patches for a tessellation program
+		void draw(GLStateCache& stateCache, GLuint program, GLenum mode = GL_TRIANGLES, FrameSync* frameSync = nullptr);
+		//Detail of GL_PATCHES draws: patch edges are split until each piece covers about pixelsPerSegment pixels at
+		//camera's distance, up to the GPU's maximum level. Set again whenever the camera or viewport changes
+		void setTessellationTarget(const ew::Camera& camera, int viewportHeight, float pixelsPerSegment = 8.f);
+		//Drops the queued instances and their batches, the tessellation target is kept
+		void clear();
+
+		//Of the last draw()
+		const ProceduralStats& getStats() const { return _stats; }
+
+	private:
+		struct Batch
+		{
+			ProceduralPrimitive primitive;
+			int firstInstance;
+			int instanceCount;
+		};
+
+		InstanceBuffer _instanceBuffer;
+		std::vector<ProceduralInstance> _instances;
+		std::vector<Batch> _batches;
+
+		//Per batch shape uniforms, then the tessellation target's. Looked up again whenever _instanceBuffer sees a new
+		//program
+		GLint _shapeLocation = -1;
+		GLint _segmentsLocation = -1;
+		GLint _firstInstanceLocation = -1;
+		GLint _cameraPositionLocation = -1;
+		GLint _projectionScaleLocation = -1;
+		GLint _segmentPixelsLocation = -1;
+		GLint _maxLevelLocation = -1;
+
+		//Tessellation target, projectionScale is pixels per world unit at distance 1, or at any distance when
+		//orthographic
+		ew::Vec3 _cameraPosition;
+		float _projectionScale = 1.f;
+		bool _orthographic = false;
+		float _pixelsPerSegment = 8.f;
+		GLint _maxLevel = 64;
+
+		ProceduralStats _stats;
+	};
+}
@@ -0,0 +1,434 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "Profiler.h"
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <imgui.h>
+
+Util::Profiler& Util::Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Util::Profiler::Profiler()
+{
+	_frameStartNs = nowNs();
+}
+
+uint64_t Util::Profiler::nowNs()
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Util::Profiler::ThreadBuffer& Util::Profiler::threadBuffer()
+{
+	//Hands the buffer back when the thread exits
+	struct Lease
+	{
+		ThreadBuffer* buffer = nullptr;
+		~Lease()
+		{
+			if (buffer) buffer->retired.store(true, std::memory_order_release);
+		}
+	};
+
+	//Registered once per thread, after that recording never takes the lock
+	thread_local Lease lease;
+	if (!lease.buffer)
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		for (std::unique_ptr<ThreadBuffer>& buffer : _threads)
+		{
+			bool drained = buffer->head.load(std::memory_order_acquire) == buffer->tail.load(std::memory_order_relaxed);
+			if (buffer->retired.load(std::memory_order_acquire) && drained)
+			{
+				lease.buffer = buffer.get();
+				break;
+			}
+		}
+		if (!lease.buffer)
+		{
+			_threads.push_back(std::make_unique<ThreadBuffer>());
+			lease.buffer = _threads.back().get();
+		}
+
+		lease.buffer->threadId = _nextThreadId++;
+		_threadNames.push_back(std::string());
+		lease.buffer->depth = 0;
+		lease.buffer->retired.store(false, std::memory_order_relaxed);
+	}
+	return *lease.buffer;
+}
+
+void Util::Profiler::setThreadName(const char* name)
+{
+	uint32_t threadId = threadBuffer().threadId;
+
+	std::lock_guard<std::mutex> lock(_threadsMutex);
+	_threadNames[threadId] = name;
+}
+
+uint32_t Util::Profiler::beginCpuScope()
+{
+	return threadBuffer().depth++;
+}
+
+void Util::Profiler::endCpuScope(const char* name, uint64_t startNs, uint32_t depth)
+{
+	uint64_t endNs = nowNs();
+	ThreadBuffer& buffer = threadBuffer();
+	buffer.depth = depth;
+
+	uint32_t head = buffer.head.load(std::memory_order_relaxed);
+	uint32_t tail = buffer.tail.load(std::memory_order_acquire);
+	if (head - tail >= PROFILER_THREAD_BUFFER_SIZE)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.events[head % PROFILER_THREAD_BUFFER_SIZE] = ProfileEvent{ name, startNs, endNs, buffer.threadId, depth };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+int Util::Profiler::beginGpuScope(const char* name)
+{
+	if (!_gpuClockSynced)
+	{
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		_gpuToCpuOffsetNs = int64_t(nowNs()) - gpuNow;
+		_gpuClockSynced = true;
+	}
+
+	GpuFrame& frame = _gpuFrames[_gpuFrame];
+	if (frame.scopes.size() >= PROFILER_MAX_GPU_SCOPES) return -1;
+
+	int queryIndex = int(frame.scopes.size()) * 2;
+	if (frame.queries.size() < size_t(queryIndex + 2))
+	{
+		frame.queries.resize(queryIndex + 2);
+		glGenQueries(2, &frame.queries[queryIndex]);
+	}
+
+	glQueryCounter(frame.queries[queryIndex], GL_TIMESTAMP);
+	frame.scopes.push_back(GpuScope{ name, _gpuDepth++, queryIndex });
+	return int(frame.scopes.size()) - 1;
+}
+
+void Util::Profiler::endGpuScope(int scope)
+{
+	if (scope < 0) return;
+
+	GpuFrame& frame = _gpuFrames[_gpuFrame];
+	glQueryCounter(frame.queries[frame.scopes[scope].queryIndex + 1], GL_TIMESTAMP);
+	_gpuDepth = frame.scopes[scope].depth;
+}
+
+void Util::Profiler::collectGpuFrame(GpuFrame& frame)
+{
+	if (frame.scopes.empty()) return;
+
+	std::lock_guard<std::mutex> lock(_gpuMutex);
+	_gpuLatestFrame = int(_gpuCollected.size());
+
+	//Never wait on the GPU, if the newest query of the frame isn't done yet the frame is dropped
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.scopes.size() * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		_gpuDropped += frame.scopes.size();
+		frame.scopes.clear();
+		return;
+	}
+
+	for (const GpuScope& scope : frame.scopes)
+	{
+		GLuint64 start = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(frame.queries[scope.queryIndex], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.queries[scope.queryIndex + 1], GL_QUERY_RESULT, &end);
+
+		_gpuCollected.push_back(ProfileEvent{ scope.name, uint64_t(int64_t(start) + _gpuToCpuOffsetNs), uint64_t(int64_t(end) + _gpuToCpuOffsetNs), PROFILER_GPU_THREAD_ID, scope.depth });
+	}
+
+	frame.scopes.clear();
+}
+
+void Util::Profiler::endGpuFrame()
+{
+	//Oldest GPU frame in the ring gets reused next
+	_gpuFrame = (_gpuFrame + 1) % PROFILER_GPU_FRAMES;
+	collectGpuFrame(_gpuFrames[_gpuFrame]);
+}
+
+void Util::Profiler::beginFrame()
+{
+	_frameStartNs = nowNs();
+}
+
+void Util::Profiler::endFrame()
+{
+	uint64_t frameEndNs = nowNs();
+
+	//Drain every thread's buffer
+	_frameEvents.clear();
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		for (std::unique_ptr<ThreadBuffer>& buffer : _threads)
+		{
+			uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+			uint32_t head = buffer->head.load(std::memory_order_acquire);
+			for (; tail != head; tail++)
+			{
+				_frameEvents.push_back(buffer->events[tail % PROFILER_THREAD_BUFFER_SIZE]);
+			}
+			buffer->tail.store(tail, std::memory_order_release);
+			_droppedEvents += buffer->dropped.exchange(0, std::memory_order_relaxed);
+		}
+	}
+
+	if (_capturing) _captureEvents.insert(_captureEvents.end(), _frameEvents.begin(), _frameEvents.end());
+
+	if (!_separateGpuThread) endGpuFrame();
+
+	{
+		std::lock_guard<std::mutex> lock(_gpuMutex);
+		if (_gpuLatestFrame >= 0)
+		{
+			if (_capturing) _captureEvents.insert(_captureEvents.end(), _gpuCollected.begin(), _gpuCollected.end());
+			_gpuFrameEvents.assign(_gpuCollected.begin() + _gpuLatestFrame, _gpuCollected.end());
+		}
+		_gpuCollected.clear();
+		_gpuLatestFrame = -1;
+		_droppedEvents += _gpuDropped;
+		_gpuDropped = 0;
+	}
+
+	float gpuMs = 0.f;
+	for (const ProfileEvent& event : _gpuFrameEvents)
+	{
+		if (event.depth == 0) gpuMs += (event.endNs - event.startNs) / 1e6f;
+	}
+
+	AllocationCounts allocations = AllocationTracker::getTotal();
+	_frameAllocations.allocations = allocations.allocations - _allocationsAtFrameEnd.allocations;
+	_frameAllocations.frees = allocations.frees - _allocationsAtFrameEnd.frees;
+	_frameAllocations.bytes = allocations.bytes - _allocationsAtFrameEnd.bytes;
+	_allocationsAtFrameEnd = allocations;
+
+	_frameTimesMs[_historyIndex] = (frameEndNs - _frameStartNs) / 1e6f;
+	_gpuTimesMs[_historyIndex] = gpuMs;
+	_historyIndex = (_historyIndex + 1) % PROFILER_HISTORY_SIZE;
+}
+
+float Util::Profiler::getLastFrameMs() const
+{
+	return _frameTimesMs[(_historyIndex + PROFILER_HISTORY_SIZE - 1) % PROFILER_HISTORY_SIZE];
+}
+
+void Util::Profiler::startCapture()
+{
+	_captureEvents.clear();
+	_capturing = true;
+}
+
+void Util::Profiler::stopCapture()
+{
+	_capturing = false;
+}
+
+static void writeJsonString(FILE* file, const char* string)
+{
+	fputc('"', file);
+	for (const char* c = string; *c; c++)
+	{
+		if (*c == '"' || *c == '\\') fputc('\\', file);
+		if ((unsigned char)*c < 0x20) continue;
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+//https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+bool Util::Profiler::exportChromeTrace(const char* filepath) const
+{
+	FILE* file = fopen(filepath, "w");
+	if (!file)
+	{
+		printf("Failed to open trace file %s\n", filepath);
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", PROFILER_GPU_THREAD_ID);
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		for (uint32_t threadId = 0; threadId < _threadNames.size(); threadId++)
+		{
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", threadId);
+			if (!_threadNames[threadId].empty()) writeJsonString(file, _threadNames[threadId].c_str());
+			else fprintf(file, "\"Thread %u\"", threadId);
+			fprintf(file, "}}");
+		}
+	}
+
+	for (const ProfileEvent& event : _captureEvents)
+	{
+		fprintf(file, ",\n{\"name\":");
+		writeJsonString(file, event.name);
+		fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+			event.threadId == PROFILER_GPU_THREAD_ID ? "gpu" : "cpu",
+			event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0, event.threadId);
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+//Merges events of one thread into a call tree, same-named siblings are summed
+void Util::Profiler::buildTree(const std::vector<ProfileEvent>& events, uint32_t threadId)
+{
+	_sortedEvents.clear();
+	for (const ProfileEvent& event : events)
+	{
+		if (event.threadId == threadId) _sortedEvents.push_back(event);
+	}
+	std::sort(_sortedEvents.begin(), _sortedEvents.end(), [](const ProfileEvent& lhs, const ProfileEvent& rhs)
+	{
+		return lhs.startNs != rhs.startNs ? lhs.startNs < rhs.startNs : lhs.endNs > rhs.endNs;
+	});
+
+	_treeNodes.clear();
+	_treeNodes.push_back(TreeNode{ "root", 0, 0, -1, -1 });
+
+	struct OpenScope
+	{
+		int node;
+		uint64_t endNs;
+	};
+	ArenaScope scratch(FrameArena::getThreadLocal());
+	std::vector<OpenScope, ArenaAllocator<OpenScope>> stack{ ArenaAllocator<OpenScope>(FrameArena::getThreadLocal()) };
+
+	for (const ProfileEvent& event : _sortedEvents)
+	{
+		while (!stack.empty() && stack.back().endNs < event.endNs) stack.pop_back();
+		int parent = stack.empty() ? 0 : stack.back().node;
+
+		int node = _treeNodes[parent].firstChild;
+		int lastChild = -1;
+		while (node != -1 && _treeNodes[node].name != event.name)
+		{
+			lastChild = node;
+			node = _treeNodes[node].nextSibling;
+		}
+
+		if (node == -1)
+		{
+			node = int(_treeNodes.size());
+			_treeNodes.push_back(TreeNode{ event.name, 0, 0, -1, -1 });
+			if (lastChild == -1) _treeNodes[parent].firstChild = node;
+			else _treeNodes[lastChild].nextSibling = node;
+		}
+
+		_treeNodes[node].totalNs += event.endNs - event.startNs;
+		_treeNodes[node].calls++;
+		stack.push_back(OpenScope{ node, event.endNs });
+	}
+}
+
+void Util::Profiler::drawTreeNode(int node)
+{
+	for (int child = _treeNodes[node].firstChild; child != -1; child = _treeNodes[child].nextSibling)
+	{
+		const TreeNode& treeNode = _treeNodes[child];
+		ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+		if (treeNode.firstChild == -1) flags |= ImGuiTreeNodeFlags_Leaf;
+
+		if (ImGui::TreeNodeEx(reinterpret_cast<void*>(intptr_t(child)), flags, "%s  %.3f ms (x%d)", treeNode.name, treeNode.totalNs / 1e6, treeNode.calls))
+		{
+			drawTreeNode(child);
+			ImGui::TreePop();
+		}
+	}
+}
+
+void Util::Profiler::drawImGui()
+{
+	ImGui::Begin("Profiler");
+
+	float lastGpuMs = _gpuTimesMs[(_historyIndex + PROFILER_HISTORY_SIZE - 1) % PROFILER_HISTORY_SIZE];
+	ImGui::Text("CPU frame: %.2f ms  GPU: %.2f ms", getLastFrameMs(), lastGpuMs);
+	ImGui::PlotLines("CPU (ms)", _frameTimesMs, PROFILER_HISTORY_SIZE, _historyIndex, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+	ImGui::PlotLines("GPU (ms)", _gpuTimesMs, PROFILER_HISTORY_SIZE, _historyIndex, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+	if (_droppedEvents > 0) ImGui::TextDisabled("Dropped events: %llu", (unsigned long long)_droppedEvents);
+	if (AllocationTracker::isInstalled())
+	{
+		ImGui::Text("Heap allocations: %llu (%.1f KB), frees: %llu", (unsigned long long)_frameAllocations.allocations,
+			_frameAllocations.bytes / 1024.0, (unsigned long long)_frameAllocations.frees);
+	}
+
+	if (!_capturing)
+	{
+		if (ImGui::Button("Start trace capture")) startCapture();
+	}
+	else if (ImGui::Button("Stop and export profile_trace.json"))
+	{
+		stopCapture();
+		exportChromeTrace("profile_trace.json");
+	}
+
+	ImGui::Separator();
+
+	//Names are copied into scratch memory under the lock, a thread may register while we draw
+	FrameArena& arena = FrameArena::getThreadLocal();
+	ArenaScope scratch(arena);
+	const char** threadNames;
+	uint32_t threadCount;
+	{
+		std::lock_guard<std::mutex> lock(_threadsMutex);
+		threadCount = uint32_t(_threadNames.size());
+		threadNames = arena.allocateArray<const char*>(threadCount);
+		for (uint32_t threadId = 0; threadId < threadCount; threadId++)
+		{
+			const std::string& name = _threadNames[threadId];
+			char* copy = arena.allocateArray<char>(name.size() + 1);
+			memcpy(copy, name.c_str(), name.size() + 1);
+			threadNames[threadId] = copy;
+		}
+	}
+
+	for (uint32_t threadId = 0; threadId < threadCount; threadId++)
+	{
+		buildTree(_frameEvents, threadId);
+		if (_treeNodes[0].firstChild == -1) continue;
+
+		ImGui::PushID(int(threadId));
+		if (ImGui::TreeNodeEx("thread", ImGuiTreeNodeFlags_DefaultOpen, "%s", threadNames[threadId][0] ? threadNames[threadId] : "Thread"))
+		{
+			drawTreeNode(0);
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+
+	buildTree(_gpuFrameEvents, PROFILER_GPU_THREAD_ID);
+	if (_treeNodes[0].firstChild != -1 && ImGui::TreeNodeEx("gpu", ImGuiTreeNodeFlags_DefaultOpen, "GPU"))
+	{
+		drawTreeNode(0);
+		ImGui::TreePop();
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,209 @@
+/*
+* Created by Adam Gyenes
+* Scoped CPU/GPU profiler with an ImGui panel and Chrome trace export
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../ew/external/glad.h"
+
+#include "AllocationTracker.h"
+
+//Events each thread can record between two endFrame() calls, extra events are dropped
+constexpr uint32_t PROFILER_THREAD_BUFFER_SIZE = 4096;
+//Frames of timer queries in flight, results are read back this many frames late
+constexpr int PROFILER_GPU_FRAMES = 4;
+constexpr int PROFILER_MAX_GPU_SCOPES = 256;
+constexpr int PROFILER_HISTORY_SIZE = 240;
+//Thread id used for GPU events in the UI and in traces
+constexpr uint32_t PROFILER_GPU_THREAD_ID = 0xFFFF;
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+//Names must be string literals (or otherwise outlive the profiler)
+#ifndef UTIL_DISABLE_PROFILER
+#define PROFILE_SCOPE(name) Util::ProfileScope PROFILER_CONCAT(_profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) Util::GpuProfileScope PROFILER_CONCAT(_gpuProfileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#endif
+
+namespace Util
+{
+	struct ProfileEvent
+	{
+		const char* name;
+		uint64_t startNs;
+		uint64_t endNs;
+		uint32_t threadId;
+		uint32_t depth;
+	};
+
+	class Profiler
+	{
+	public:
+		static Profiler& get();
+
+		//Call once per frame on the main thread, endFrame() collects events from every thread
+		void beginFrame();
+		void endFrame();
+
+		//When the GL context lives on another thread (see Util::RenderThread) endFrame() must not touch GL.
+		//Set before the first frame, the GL thread then calls endGpuFrame() once per frame after its GPU scopes
+		void setSeparateGpuThread(bool separate) { _separateGpuThread = separate; }
+		void endGpuFrame();
+
+		//Copied, so it may be a temporary
+		void setThreadName(const char* name);
+
+		//CPU scopes, only touch the calling thread's buffer
+		uint32_t beginCpuScope();
+		void endCpuScope(const char* name, uint64_t startNs, uint32_t depth);
+
+		//GPU scopes, GL thread only. Returns an id to pass to endGpuScope, or -1 if out of queries
+		int beginGpuScope(const char* name);
+		void endGpuScope(int scope);
+
+		//Chrome trace (chrome://tracing, Perfetto) capture
+		void startCapture();
+		void stopCapture();
+		bool isCapturing() const { return _capturing; }
+		bool exportChromeTrace(const char* filepath) const;
+
+		void drawImGui();
+
+		static uint64_t nowNs();
+
+		const std::vector<ProfileEvent>& getFrameEvents() const { return _frameEvents; }
+		const std::vector<ProfileEvent>& getGpuFrameEvents() const { return _gpuFrameEvents; }
+		float getLastFrameMs() const;
+
+		//Events lost to full thread buffers or unfinished GPU queries
+		uint64_t getDroppedEvents() const { return _droppedEvents; }
+
+		//Heap allocations on every thread between the last two endFrame() calls, zero unless the
+		//executable installed the Util::AllocationTracker hooks
+		const AllocationCounts& getLastFrameAllocations() const { return _frameAllocations; }
+
+	private:
+		//Single producer (owning thread), single consumer (endFrame)
+		struct ThreadBuffer
+		{
+			uint32_t threadId = 0;
+			uint32_t depth = 0;
+			//Set when the owning thread exits, the buffer is reused once drained
+			std::atomic<bool> retired{ false };
+			std::atomic<uint32_t> head{ 0 };
+			std::atomic<uint32_t> tail{ 0 };
+			std::atomic<uint64_t> dropped{ 0 };
+			ProfileEvent events[PROFILER_THREAD_BUFFER_SIZE];
+		};
+
+		struct GpuScope
+		{
+			const char* name;
+			uint32_t depth;
+			int queryIndex;
+		};
+
+		struct GpuFrame
+		{
+			std::vector<GLuint> queries;
+			std::vector<GpuScope> scopes;
+		};
+
+		struct TreeNode
+		{
+			const char* name;
+			uint64_t totalNs;
+			int calls;
+			int firstChild;
+			int nextSibling;
+		};
+
+		Profiler();
+
+		ThreadBuffer& threadBuffer();
+		void collectGpuFrame(GpuFrame& frame);
+		void buildTree(const std::vector<ProfileEvent>& events, uint32_t threadId);
+		void drawTreeNode(int node);
+
+		mutable std::mutex _threadsMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+		uint32_t _nextThreadId = 0;
+		//Indexed by thread id, outlives reused buffers so traces keep their names
+		std::vector<std::string> _threadNames;
+
+		GpuFrame _gpuFrames[PROFILER_GPU_FRAMES];
+		int _gpuFrame = 0;
+		uint32_t _gpuDepth = 0;
+		bool _gpuClockSynced = false;
+		int64_t _gpuToCpuOffsetNs = 0;
+		bool _separateGpuThread = false;
+
+		//Written by the GL thread, handed over to the main thread in endFrame()
+		std::mutex _gpuMutex;
+		std::vector<ProfileEvent> _gpuCollected;
+		//Start of the newest collected frame in _gpuCollected, -1 if no frame was collected since the last endFrame()
+		int _gpuLatestFrame = -1;
+		uint64_t _gpuDropped = 0;
+
+		uint64_t _frameStartNs = 0;
+		std::vector<ProfileEvent> _frameEvents;
+		std::vector<ProfileEvent> _gpuFrameEvents;
+		uint64_t _droppedEvents = 0;
+
+		AllocationCounts _allocationsAtFrameEnd;
+		AllocationCounts _frameAllocations;
+
+		float _frameTimesMs[PROFILER_HISTORY_SIZE] = {};
+		float _gpuTimesMs[PROFILER_HISTORY_SIZE] = {};
+		int _historyIndex = 0;
+
+		bool _capturing = false;
+		std::vector<ProfileEvent> _captureEvents;
+
+		std::vector<TreeNode> _treeNodes;
+		std::vector<ProfileEvent> _sortedEvents;
+	};
+
+	//RAII CPU scope, see PROFILE_SCOPE
+	class ProfileScope
+	{
+	public:
+		ProfileScope(const char* name)
+			: _name(name), _depth(Profiler::get().beginCpuScope()), _startNs(Profiler::nowNs()) {}
+		~ProfileScope() { Profiler::get().endCpuScope(_name, _startNs, _depth); }
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* _name;
+		uint32_t _depth;
+		uint64_t _startNs;
+	};
+
+	//RAII GL timer query scope, see PROFILE_GPU_SCOPE
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(const char* name) : _scope(Profiler::get().beginGpuScope(name)) {}
+		~GpuProfileScope() { Profiler::get().endGpuScope(_scope); }
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+	private:
+		int _scope;
+	};
+}
@@ -0,0 +1,144 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "RenderQueue.h"
+#include "Profiler.h"
+
+#include <cstring>
+
+//Top 16 bits of a non-negative float, bit patterns of positive floats sort like the values
+static uint64_t depthBits(float depth)
+{
+	if (!(depth > 0.f)) return 0;
+
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> 16;
+}
+
+//GL names are small sequential integers, folding them keeps the identical ones together
+static uint64_t textureBits(const Util::DrawPacket& packet)
+{
+	uint32_t hash = 2166136261u;
+	for (GLuint texture : packet.textures)
+	{
+		hash = (hash ^ texture) * 16777619u;
+	}
+	return (hash ^ (hash >> 16)) & 0xFFFF;
+}
+
+//Meshes with a vertex array of their own sort by it. Shared vertex arrays keep the few formats apart and the meshes
+//within one together, by their vertex buffer
+static uint64_t meshBits(const Util::VertexBindings& bindings)
+{
+	GLuint vertexBuffer = bindings.buffers[0].buffer;
+	if (!vertexBuffer) return bindings.vertexArray & 0xFFFF;
+	return ((bindings.vertexArray & 0xF) << 12) | (vertexBuffer & 0xFFF);
+}
+
+uint64_t Util::RenderQueue::makeKey(const DrawPacket& packet, SortOrder order)
+{
+	uint64_t layer = uint64_t(packet.layer & 0xF) << 60;
+	uint64_t program = packet.program & 0xFFF;
+	uint64_t textures = textureBits(packet);
+	uint64_t mesh = meshBits(packet.vertexBindings);
+	uint64_t depth = depthBits(packet.depth);
+
+	switch (order)
+	{
+	case SortOrder::FRONT_TO_BACK:
+		//layer:4 | depth:16 | program:12 | textures:16 | mesh:16
+		return layer | (depth << 44) | (program << 32) | (textures << 16) | mesh;
+	case SortOrder::BACK_TO_FRONT:
+		return layer | ((0xFFFF - depth) << 44) | (program << 32) | (textures << 16) | mesh;
+	default:
+		//layer:4 | program:12 | textures:16 | mesh:16 | depth:16
+		return layer | (program << 48) | (textures << 32) | (mesh << 16) | depth;
+	}
+}
+
+void Util::RenderQueue::clear()
+{
+	_packets.clear();
+	_items.clear();
+}
+
+void Util::RenderQueue::submit(const DrawPacket& packet)
+{
+	_items.push_back(SortItem{ 0, uint32_t(_packets.size()) });
+	_packets.push_back(packet);
+}
+
+void Util::RenderQueue::sort(SortOrder order)
+{
+	PROFILE_SCOPE("Util::RenderQueue::sort");
+
+	if (_items.empty()) return;
+
+	for (SortItem& item : _items)
+	{
+		item.key = makeKey(_packets[item.packet], order);
+	}
+
+	//LSD radix sort, 8 bits per pass. Stable, and passes where every key shares the byte are skipped
+	_scratch.resize(_items.size());
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256] = {};
+		for (const SortItem& item : _items)
+		{
+			counts[(item.key >> shift) & 0xFF]++;
+		}
+
+		if (counts[(_items[0].key >> shift) & 0xFF] == _items.size()) continue;
+
+		size_t offset = 0;
+		for (size_t& count : counts)
+		{
+			size_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+
+		for (const SortItem& item : _items)
+		{
+			_scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+		}
+		_items.swap(_scratch);
+	}
+}
+
+int Util::RenderQueue::execute(GLStateCache& stateCache) const
+{
+	PROFILE_SCOPE("Util::RenderQueue::execute");
+
+	for (const SortItem& item : _items)
+	{
+		const DrawPacket& packet = _packets[item.packet];
+
+		stateCache.useProgram(packet.program);
+		stateCache.bindVertexBindings(packet.vertexBindings);
+		for (int unit = 0; unit < RENDER_QUEUE_MAX_TEXTURES; unit++)
+		{
+			if (packet.textures[unit]) stateCache.bindTexture(unit, GL_TEXTURE_2D, packet.textures[unit]);
+		}
+		if (packet.instanceBuffer)
+		{
+			stateCache.bindBufferRange(GL_UNIFORM_BUFFER, RENDER_QUEUE_INSTANCE_BINDING, packet.instanceBuffer, packet.instanceOffset, packet.instanceSize);
+		}
+
+		if (packet.modelLocation >= 0) glUniformMatrix4fv(packet.modelLocation, 1, GL_FALSE, &packet.model[0][0]);
+
+		if (packet.instanceCount > 1)
+		{
+			glDrawElementsInstanced(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, nullptr, packet.instanceCount);
+		}
+		else
+		{
+			glDrawElements(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, nullptr);
+		}
+	}
+
+	return int(_items.size());
+}
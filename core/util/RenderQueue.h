@@ -0,0 +1,86 @@
+/*
+* Created by Adam Gyenes
+* Records draw packets, sorts them by a 64-bit state key and replays them through a GLStateCache
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../ew/external/glad.h"
+#include "../ew/ewMath/mat4.h"
+
+#include "GLStateCache.h"
+#include "VertexFormat.h"
+
+constexpr int RENDER_QUEUE_MAX_TEXTURES = 4;
+//Uniform block binding the optional per-packet instance data is bound to
+constexpr int RENDER_QUEUE_INSTANCE_BINDING = 0;
+
+namespace Util
+{
+	struct DrawPacket
+	{
+		GLuint program = 0;
+		VertexBindings vertexBindings;
+		GLsizei indexCount = 0;
+		//More than 1 draws instanced
+		GLsizei instanceCount = 1;
+
+		//Bound to units 0..RENDER_QUEUE_MAX_TEXTURES-1, 0 leaves the unit alone
+		GLuint textures[RENDER_QUEUE_MAX_TEXTURES] = {};
+
+		//Optional uniform block range bound at RENDER_QUEUE_INSTANCE_BINDING
+		GLuint instanceBuffer = 0;
+		GLintptr instanceOffset = 0;
+		GLsizeiptr instanceSize = 0;
+
+		//Uploaded per packet unless the location is -1
+		GLint modelLocation = -1;
+		ew::Mat4 model;
+
+		//View space distance, only the sort key uses it
+		float depth = 0.f;
+		//Coarsest sort criteria, lower layers draw first (0-15)
+		uint8_t layer = 0;
+	};
+
+	enum class SortOrder
+	{
+		//Program > textures > mesh > depth, fewest state changes
+		STATE = 0,
+		//Depth before state, best early-z rejection
+		FRONT_TO_BACK,
+		//For blending
+		BACK_TO_FRONT
+	};
+
+	class RenderQueue
+	{
+	public:
+		void clear();
+		void submit(const DrawPacket& packet);
+
+		//Sorts by key, packets with equal keys keep their submission order
+		void sort(SortOrder order);
+		//Replays in sorted order, returns the number of draw calls
+		int execute(GLStateCache& stateCache) const;
+
+		int getSize() const { return int(_packets.size()); }
+		const DrawPacket& getPacket(int sortedIndex) const { return _packets[_items[sortedIndex].packet]; }
+
+		static uint64_t makeKey(const DrawPacket& packet, SortOrder order);
+
+	private:
+		struct SortItem
+		{
+			uint64_t key;
+			uint32_t packet;
+		};
+
+		std::vector<DrawPacket> _packets;
+		std::vector<SortItem> _items;
+		std::vector<SortItem> _scratch;
+	};
+}
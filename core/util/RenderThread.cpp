@@ -0,0 +1,57 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "RenderThread.h"
+#include "Profiler.h"
+
+Util::RenderThread::~RenderThread()
+{
+	stop();
+}
+
+void Util::RenderThread::start(std::function<void()> init, std::function<void(int)> render, std::function<void()> shutdown)
+{
+	if (isRunning()) return;
+
+	Profiler::get().setSeparateGpuThread(true);
+
+	_ready = false;
+	_thread = std::thread(&RenderThread::threadLoop, this, std::move(init), std::move(render), std::move(shutdown));
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_initialized.wait(lock, [this] { return _ready; });
+}
+
+void Util::RenderThread::stop()
+{
+	if (!isRunning()) return;
+
+	_pipeline.stop();
+	_thread.join();
+}
+
+void Util::RenderThread::threadLoop(std::function<void()> init, std::function<void(int)> render, std::function<void()> shutdown)
+{
+	Profiler& profiler = Profiler::get();
+	profiler.setThreadName("Render");
+
+	init();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_ready = true;
+	}
+	_initialized.notify_one();
+
+	for (int slot = _pipeline.beginRead(); slot >= 0; slot = _pipeline.beginRead())
+	{
+		{
+			PROFILE_SCOPE("Util::RenderThread::render");
+			render(slot);
+		}
+		profiler.endGpuFrame();
+		_pipeline.endRead();
+	}
+
+	shutdown();
+}
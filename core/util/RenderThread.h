@@ -0,0 +1,47 @@
+/*
+* Created by Adam Gyenes
+* Dedicated thread owning the GL context, renders the packets a Util::FramePipeline hands it
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "FramePipeline.h"
+
+namespace Util
+{
+	class RenderThread
+	{
+	public:
+		RenderThread(FramePipeline& pipeline) : _pipeline(pipeline) {}
+		//Stops the thread if it's still running
+		~RenderThread();
+
+		RenderThread(const RenderThread&) = delete;
+		RenderThread& operator=(const RenderThread&) = delete;
+
+		//All three run on the render thread. Release the context on the calling thread first, init must make it current.
+		//render(slot) draws and presents the packet in that slot, shutdown runs last with the context still current.
+		//Returns once init returned, so anything init creates (GL objects, the ImGui backend) is ready.
+		//Also routes Util::Profiler's GPU scopes to this thread
+		void start(std::function<void()> init, std::function<void(int)> render, std::function<void()> shutdown);
+		//Renders the packets still in the pipeline, runs shutdown and joins
+		void stop();
+
+		bool isRunning() const { return _thread.joinable(); }
+
+	private:
+		void threadLoop(std::function<void()> init, std::function<void(int)> render, std::function<void()> shutdown);
+
+		FramePipeline& _pipeline;
+		std::thread _thread;
+
+		std::mutex _mutex;
+		std::condition_variable _initialized;
+		bool _ready = false;
+	};
+}
@@ -0,0 +1,216 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "Renderer.h"
+#include "Profiler.h"
+
+Util::Renderer::Renderer(const char* depthVertFilepath, const char* depthFragFilepath)
+	: _depthShader(depthVertFilepath, depthFragFilepath)
+{
+}
+
+Util::Renderer::~Renderer()
+{
+	if (!_queriesInitialized) return;
+	glDeleteQueries(OVERDRAW_QUERY_FRAMES, _prePassQueries);
+	glDeleteQueries(OVERDRAW_QUERY_FRAMES, _shadedQueries);
+}
+
+void Util::Renderer::begin(const ew::Camera& camera)
+{
+	_drawItems.clear();
+
+	_view = camera.ViewMatrix();
+	_viewProjection = camera.ProjectionMatrix() * _view;
+}
+
+void Util::Renderer::submit(const Util::Mesh& mesh, const ew::Mat4& model, const MaterialTextures& textures, int occlusionId, bool expensive)
+{
+	//Depth of the bounds center in view space, camera looks down -Z
+	ew::Vec4 viewPos = _view * (model * ew::Vec4(mesh.getBoundsCenter(), 1.f));
+	_drawItems.push_back(DrawItem{ &mesh, model, -viewPos.z, textures, occlusionId, expensive, OcclusionDecision::DRAW });
+}
+
+void Util::Renderer::flush(const ew::Shader& shader, int viewportWidth, int viewportHeight, GLStateCache& stateCache)
+{
+	PROFILE_SCOPE("Util::Renderer::flush");
+	PROFILE_GPU_SCOPE("Renderer");
+
+	if (!_queriesInitialized)
+	{
+		glGenQueries(OVERDRAW_QUERY_FRAMES, _prePassQueries);
+		glGenQueries(OVERDRAW_QUERY_FRAMES, _shadedQueries);
+		_queriesInitialized = true;
+	}
+
+	_stats.drawCalls = 0;
+	_stats.prePassDrawCalls = 0;
+	_stats.triangles = 0;
+	_stats.conditionalDrawCalls = 0;
+
+	//Last frame's query results pick what is drawn now, hidden objects only get their box drawn
+	if (settings.occlusionQueries)
+	{
+		_occlusionQueries.begin(_viewProjection);
+		for (DrawItem& item : _drawItems)
+		{
+			if (item.occlusionId < 0) continue;
+			item.decision = _occlusionQueries.classify(item.occlusionId, item.mesh->getBoundsMin(), item.mesh->getBoundsMax(), item.model, item.expensive);
+		}
+	}
+
+	//Oldest slot is about to be reused, grab its results first
+	readBackQueries();
+
+	_queryPixels[_queryFrame] = viewportWidth * viewportHeight;
+
+	if (settings.depthPrePass)
+	{
+		PROFILE_SCOPE("Depth pre-pass");
+		PROFILE_GPU_SCOPE("Depth pre-pass");
+
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+
+		if (settings.countOverdraw) glBeginQuery(GL_SAMPLES_PASSED, _prePassQueries[_queryFrame]);
+
+		stateCache.useProgram(_depthShader.getId());
+		_depthShader.setMat4("_ViewProjection", _viewProjection);
+
+		_prePassQueue.clear();
+		DrawPacket packet;
+		packet.program = _depthShader.getId();
+		packet.modelLocation = glGetUniformLocation(packet.program, "_Model");
+		for (const DrawItem& item : _drawItems)
+		{
+			if (item.decision != OcclusionDecision::DRAW) continue;
+			packet.vertexBindings = item.mesh->getDepthVertexBindings();
+			packet.indexCount = item.mesh->getIndexCount();
+			packet.model = item.model;
+			packet.depth = item.viewDepth;
+			_prePassQueue.submit(packet);
+		}
+		_prePassQueue.sort(SortOrder::FRONT_TO_BACK);
+		_stats.prePassDrawCalls = _prePassQueue.execute(stateCache);
+
+		if (settings.countOverdraw)
+		{
+			glEndQuery(GL_SAMPLES_PASSED);
+			_prePassQueryPending[_queryFrame] = true;
+		}
+
+		//Depth is final, only shade the fragments that won
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_FALSE);
+		glDepthFunc(GL_EQUAL);
+	}
+
+	if (settings.countOverdraw) glBeginQuery(GL_SAMPLES_PASSED, _shadedQueries[_queryFrame]);
+
+	{
+		PROFILE_SCOPE("Main pass");
+		PROFILE_GPU_SCOPE("Main pass");
+
+		stateCache.useProgram(shader.getId());
+		shader.setMat4("_ViewProjection", _viewProjection);
+
+		_mainQueue.clear();
+		DrawPacket packet;
+		packet.program = shader.getId();
+		packet.modelLocation = glGetUniformLocation(packet.program, "_Model");
+		for (const DrawItem& item : _drawItems)
+		{
+			if (item.decision != OcclusionDecision::DRAW) continue;
+			packet.vertexBindings = item.mesh->getVertexBindings();
+			packet.indexCount = item.mesh->getIndexCount();
+			for (int unit = 0; unit < RENDER_QUEUE_MAX_TEXTURES; unit++) packet.textures[unit] = item.textures.units[unit];
+			packet.model = item.model;
+			packet.depth = item.viewDepth;
+			_mainQueue.submit(packet);
+			_stats.triangles += item.mesh->getIndexCount() / 3;
+		}
+
+		//Depth is already resolved with the pre-pass, so state changes are all that's left to save
+		bool frontToBack = settings.sortFrontToBack && !settings.depthPrePass;
+		_mainQueue.sort(frontToBack ? SortOrder::FRONT_TO_BACK : SortOrder::STATE);
+		_stats.drawCalls = _mainQueue.execute(stateCache);
+	}
+
+	if (settings.countOverdraw)
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+		_queryPending[_queryFrame] = true;
+	}
+
+	if (settings.depthPrePass)
+	{
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+
+	//Occlusion queries can't overlap the overdraw query, so the boxes and conditional draws come after it
+	if (settings.occlusionQueries)
+	{
+		PROFILE_SCOPE("Occlusion queries");
+
+		_occlusionQueries.issueQueries(_depthShader, stateCache);
+
+		stateCache.useProgram(shader.getId());
+		DrawPacket packet;
+		packet.program = shader.getId();
+		packet.modelLocation = glGetUniformLocation(packet.program, "_Model");
+		for (const DrawItem& item : _drawItems)
+		{
+			if (item.decision != OcclusionDecision::DRAW_CONDITIONAL) continue;
+
+			packet.vertexBindings = item.mesh->getVertexBindings();
+			packet.indexCount = item.mesh->getIndexCount();
+			for (int unit = 0; unit < RENDER_QUEUE_MAX_TEXTURES; unit++) packet.textures[unit] = item.textures.units[unit];
+			packet.model = item.model;
+			_conditionalQueue.clear();
+			_conditionalQueue.submit(packet);
+
+			_occlusionQueries.beginConditional(item.occlusionId);
+			_stats.conditionalDrawCalls += _conditionalQueue.execute(stateCache);
+			_occlusionQueries.endConditional();
+			_stats.triangles += item.mesh->getIndexCount() / 3;
+		}
+		_stats.drawCalls += _stats.conditionalDrawCalls;
+	}
+
+	_queryFrame = (_queryFrame + 1) % OVERDRAW_QUERY_FRAMES;
+}
+
+static bool isQueryAvailable(GLuint query)
+{
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	return available != GL_FALSE;
+}
+
+void Util::Renderer::readBackQueries()
+{
+	//Slot was issued OVERDRAW_QUERY_FRAMES frames ago and is reused now either way. Never wait on the GPU, a result
+	//that still isn't there is dropped
+	if (_prePassQueryPending[_queryFrame])
+	{
+		if (isQueryAvailable(_prePassQueries[_queryFrame])) glGetQueryObjectui64v(_prePassQueries[_queryFrame], GL_QUERY_RESULT, &_stats.prePassSamples);
+		_prePassQueryPending[_queryFrame] = false;
+	}
+	else
+	{
+		_stats.prePassSamples = 0;
+	}
+
+	if (_queryPending[_queryFrame])
+	{
+		_queryPending[_queryFrame] = false;
+		if (!isQueryAvailable(_shadedQueries[_queryFrame])) return;
+		glGetQueryObjectui64v(_shadedQueries[_queryFrame], GL_QUERY_RESULT, &_stats.shadedSamples);
+
+		int pixels = _queryPixels[_queryFrame];
+		_stats.overdraw = pixels > 0 ? float(_stats.shadedSamples) / pixels : 0.f;
+	}
+}
@@ -0,0 +1,120 @@
+/*
+* Created by Adam Gyenes
+* Opaque draw list with optional depth pre-pass, sorted and replayed through Util::RenderQueue
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "../ew/external/glad.h"
+#include "../ew/camera.h"
+#include "../ew/shader.h"
+
+#include "GLStateCache.h"
+#include "Mesh.h"
+#include "OcclusionQueries.h"
+#include "RenderQueue.h"
+
+//Number of frames a samples query result is allowed to lag behind
+constexpr int OVERDRAW_QUERY_FRAMES = 3;
+
+namespace Util
+{
+	struct RenderSettings
+	{
+		//Lay down depth with a position-only shader first, then shade with GL_EQUAL
+		//Only valid if the main shader does not discard fragments
+		bool depthPrePass = false;
+		//Ignored with the pre-pass, which already rejects hidden fragments, otherwise draws are grouped by state
+		bool sortFrontToBack = true;
+		bool countOverdraw = true;
+		//Bounding box queries decide the next frame's draws of objects submitted with an occlusion id
+		bool occlusionQueries = false;
+	};
+
+	struct RenderStats
+	{
+		int drawCalls = 0;
+		int prePassDrawCalls = 0;
+		//Triangles submitted in the main pass
+		int triangles = 0;
+		//Drawn under conditional rendering after the occlusion queries, part of drawCalls
+		int conditionalDrawCalls = 0;
+
+		//Samples counts are read back a few frames late to avoid stalling, a result that still isn't ready by then keeps
+		//the previous one
+		GLuint64 shadedSamples = 0;
+		GLuint64 prePassSamples = 0;
+
+		//Shaded samples per pixel, 1.0 means every pixel was shaded exactly once
+		float overdraw = 0.f;
+	};
+
+	//Bound to units 0..RENDER_QUEUE_MAX_TEXTURES-1, the shader's sampler uniforms pick the unit
+	struct MaterialTextures
+	{
+		GLuint units[RENDER_QUEUE_MAX_TEXTURES] = {};
+	};
+
+	class Renderer
+	{
+	public:
+		Renderer(const char* depthVertFilepath, const char* depthFragFilepath);
+		~Renderer();
+
+		Renderer(const Renderer&) = delete;
+		Renderer& operator=(const Renderer&) = delete;
+
+		//Clears the draw list and captures the camera used for sorting
+		void begin(const ew::Camera& camera);
+		//occlusionId is a small index that stays with the object across frames, -1 is never queried. Expensive objects
+		//are drawn under conditional rendering rather than skipped while their last query failed
+		void submit(const Util::Mesh& mesh, const ew::Mat4& model, const MaterialTextures& textures = MaterialTextures(), int occlusionId = -1, bool expensive = false);
+
+		//Draws everything submitted since begin() with shader, which must already have its per-frame uniforms set
+		//(bind it through stateCache so the cache knows). Shader is expected to use the _Model and _ViewProjection uniforms
+		void flush(const ew::Shader& shader, int viewportWidth, int viewportHeight, GLStateCache& stateCache);
+
+		const RenderStats& getStats() const { return _stats; }
+		const OcclusionQueryStats& getOcclusionStats() const { return _occlusionQueries.getStats(); }
+
+		RenderSettings settings;
+
+	private:
+		struct DrawItem
+		{
+			const Util::Mesh* mesh;
+			ew::Mat4 model;
+			float viewDepth;
+			MaterialTextures textures;
+			int occlusionId;
+			bool expensive;
+			OcclusionDecision decision;
+		};
+
+		void readBackQueries();
+
+		ew::Shader _depthShader;
+
+		std::vector<DrawItem> _drawItems;
+		RenderQueue _prePassQueue;
+		RenderQueue _mainQueue;
+		//Holds a single packet at a time, every conditional draw needs its own begin/end
+		RenderQueue _conditionalQueue;
+		OcclusionQueryPool _occlusionQueries;
+		ew::Mat4 _view;
+		ew::Mat4 _viewProjection;
+
+		bool _queriesInitialized = false;
+		//Pre-pass and main pass query for each frame in flight
+		GLuint _prePassQueries[OVERDRAW_QUERY_FRAMES] = {};
+		GLuint _shadedQueries[OVERDRAW_QUERY_FRAMES] = {};
+		bool _queryPending[OVERDRAW_QUERY_FRAMES] = {};
+		bool _prePassQueryPending[OVERDRAW_QUERY_FRAMES] = {};
+		int _queryPixels[OVERDRAW_QUERY_FRAMES] = {};
+		int _queryFrame = 0;
+
+		RenderStats _stats;
+	};
+}
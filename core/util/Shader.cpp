@@ -1,29 +1,35 @@
 #include "Shader.h"
+#include "Profiler.h"
 
 Util::Shader::Shader(const char* vertFilepath, const char* fragFilepath)
 {
+	PROFILE_SCOPE("Util::Shader::Shader");
+
 	std::string vertSource = loadSourceFromFile(vertFilepath);
 	std::string fragSource = loadSourceFromFile(fragFilepath);
 
 	GLuint vertShader = createShader(GL_VERTEX_SHADER, vertSource.c_str());
 	GLuint fragShader = createShader(GL_FRAGMENT_SHADER, fragSource.c_str());
 
-	_shaderProgram = glCreateProgram();
-	glAttachShader(_shaderProgram, vertShader);
-	glAttachShader(_shaderProgram, fragShader);
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertShader);
+	glAttachShader(program, fragShader);
 
 	GLint status;
-	glLinkProgram(_shaderProgram);
-	glGetProgramiv(_shaderProgram, GL_LINK_STATUS, &status);
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
 	if (!status)
 	{
 		char log[INFO_LOG_SIZE];
-		glGetProgramInfoLog(_shaderProgram, INFO_LOG_SIZE, nullptr, log);
+		glGetProgramInfoLog(program, INFO_LOG_SIZE, nullptr, log);
 		std::cout << "Failed to link shader program: " << log << "\n";
 	}
 
 	glDeleteShader(vertShader);
 	glDeleteShader(fragShader);
+
+	//Registered once linked, so the registry can size it
+	_shaderProgram = GpuResource(GpuResourceType::PROGRAM, program, vertFilepath);
 }
 
 std::string Util::Shader::loadSourceFromFile(const char* filepath)
@@ -40,37 +46,49 @@ std::string Util::Shader::loadSourceFromFile(const char* filepath)
 
 void Util::Shader::setInt(const char* name, int value)
 {
-	glUniform1i(glGetUniformLocation(_shaderProgram, name), value);
+	GLint location = glGetUniformLocation(_shaderProgram.get(), name);
+	if (GLAD_GL_VERSION_4_1) glProgramUniform1i(_shaderProgram.get(), location, value);
+	else glUniform1i(location, value);
 }
 
 void Util::Shader::setFloat(const char* name, float value)
 {
-	glUniform1f(glGetUniformLocation(_shaderProgram, name), value);
+	GLint location = glGetUniformLocation(_shaderProgram.get(), name);
+	if (GLAD_GL_VERSION_4_1) glProgramUniform1f(_shaderProgram.get(), location, value);
+	else glUniform1f(location, value);
 }
 
 void Util::Shader::setVec2(const char* name, float x, float y)
 {
-	glUniform2f(glGetUniformLocation(_shaderProgram, name), x, y);
+	GLint location = glGetUniformLocation(_shaderProgram.get(), name);
+	if (GLAD_GL_VERSION_4_1) glProgramUniform2f(_shaderProgram.get(), location, x, y);
+	else glUniform2f(location, x, y);
 }
 
 void Util::Shader::setVec3(const char* name, float x, float y, float z)
 {
-	glUniform3f(glGetUniformLocation(_shaderProgram, name), x, y, z);
+	GLint location = glGetUniformLocation(_shaderProgram.get(), name);
+	if (GLAD_GL_VERSION_4_1) glProgramUniform3f(_shaderProgram.get(), location, x, y, z);
+	else glUniform3f(location, x, y, z);
 }
 
 void Util::Shader::setVec4(const char* name, float x, float y, float z, float w)
 {
-	glUniform4f(glGetUniformLocation(_shaderProgram, name), x, y, z, w);
+	GLint location = glGetUniformLocation(_shaderProgram.get(), name);
+	if (GLAD_GL_VERSION_4_1) glProgramUniform4f(_shaderProgram.get(), location, x, y, z, w);
+	else glUniform4f(location, x, y, z, w);
 }
 
 void Util::Shader::setMat4(const char* name, const ew::Mat4& value)
 {
-	glUniformMatrix4fv(glGetUniformLocation(_shaderProgram, name), 1, GL_FALSE, &value[0][0]);
+	GLint location = glGetUniformLocation(_shaderProgram.get(), name);
+	if (GLAD_GL_VERSION_4_1) glProgramUniformMatrix4fv(_shaderProgram.get(), location, 1, GL_FALSE, &value[0][0]);
+	else glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
 }
 
 void Util::Shader::exec()
 {
-	glUseProgram(_shaderProgram);
+	glUseProgram(_shaderProgram.get());
 }
 
 GLuint Util::Shader::createShader(GLenum type, const char* source)
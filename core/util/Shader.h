@@ -10,6 +10,7 @@
 #include <GLFW/glfw3.h>
 
 #include "Global.h"
+#include "GpuResources.h"
 
 #define SET_SHADER_TEXTURE(shader, name, texture, id) \
 	glActiveTexture(GL_TEXTURE##id); \
@@ -25,6 +26,7 @@ namespace Util
 
 		static std::string loadSourceFromFile(const char* filepath);
 
+		//glProgramUniform with GL 4.1, so the shader doesn't have to be in use. Older contexts need exec() first
 		void setInt(const char* name, int value);
 		void setFloat(const char* name, float value);
 		void setVec2(const char* name, float x, float y);
@@ -37,6 +39,6 @@ namespace Util
 	private:
 		GLuint createShader(GLenum type, const char* source);
 
-		GLuint _shaderProgram;
+		GpuResource _shaderProgram;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,703 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "SoftwareRasterizer.h"
+#include "Float4.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory_resource>
+
+#include "../ew/external/stb_image.h"
+
+//Vertices transformed per job, a multiple of the SIMD width
+constexpr int SOFTWARE_VERTEX_JOB_SIZE = 1024;
+//Triangles set up and binned per chunk
+constexpr int SOFTWARE_CHUNK_TRIANGLES = 2048;
+constexpr int SOFTWARE_SUBPIXEL_BITS = 4;
+constexpr int SOFTWARE_SUBPIXEL_STEP = 1 << SOFTWARE_SUBPIXEL_BITS;
+//Largest screen coordinate in pixels, 2^22 keeps every edge function product well inside 64 bits
+constexpr float SOFTWARE_GUARD_BAND_PIXELS = float(1 << 22);
+
+//Rows of a column major matrix as splatted lanes, out[r] = dot(row r, (x, y, z, w))
+static inline void transform4(const float m[4][4], int rows, Util::Float4 x, Util::Float4 y, Util::Float4 z, float w, Util::Float4* out)
+{
+	for (int r = 0; r < rows; r++)
+	{
+		out[r] = Util::splat4(m[0][r]) * x + Util::splat4(m[1][r]) * y + Util::splat4(m[2][r]) * z;
+		if (w != 0.f) out[r] = out[r] + Util::splat4(m[3][r] * w);
+	}
+}
+
+static inline void normalize4(Util::Float4* v)
+{
+	Util::Float4 length = sqrt4(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	v[0] = v[0] / length;
+	v[1] = v[1] / length;
+	v[2] = v[2] / length;
+}
+
+static void toArray(const ew::Mat4& matrix, float out[4][4])
+{
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++) out[c][r] = matrix[c][r];
+	}
+}
+
+static inline int wrap(int i, int size)
+{
+	i %= size;
+	return i < 0 ? i + size : i;
+}
+
+static inline long long floorDiv(long long a, long long b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+bool Util::SoftwareTexture::load(const char* filepath, bool flipVertical)
+{
+	PROFILE_SCOPE("Util::SoftwareTexture::load");
+
+	stbi_set_flip_vertically_on_load(flipVertical);
+	stbi_uc* data = stbi_load(filepath, &width, &height, &channels, 0);
+	if (!data)
+	{
+		printf("Failed to load image %s", filepath);
+		return false;
+	}
+
+	pixels.assign(data, data + size_t(width) * height * channels);
+	stbi_image_free(data);
+	return true;
+}
+
+ew::Vec4 Util::SoftwareTexture::sample(ew::Vec2 uv) const
+{
+	if (pixels.empty()) return ew::Vec4(1.f);
+
+	auto texel = [this](int x, int y)
+	{
+		const unsigned char* p = &pixels[(size_t(wrap(y, height)) * width + wrap(x, width)) * channels];
+		ew::Vec4 result(0.f, 0.f, 0.f, 1.f);
+		for (int c = 0; c < channels; c++) result[c] = p[c] / 255.f;
+		return result;
+	};
+
+	float x = uv.x * width - 0.5f;
+	float y = uv.y * height - 0.5f;
+	if (!bilinear) return texel(int(floorf(x + 0.5f)), int(floorf(y + 0.5f)));
+
+	float x0 = floorf(x);
+	float y0 = floorf(y);
+	float fx = x - x0;
+	float fy = y - y0;
+	int ix = int(x0);
+	int iy = int(y0);
+
+	ew::Vec4 bottom = texel(ix, iy) * (1.f - fx) + texel(ix + 1, iy) * fx;
+	ew::Vec4 top = texel(ix, iy + 1) * (1.f - fx) + texel(ix + 1, iy + 1) * fx;
+	return bottom * (1.f - fy) + top * fy;
+}
+
+Util::SoftwareMesh::SoftwareMesh(const ew::MeshData& meshData)
+{
+	load(meshData);
+}
+
+void Util::SoftwareMesh::load(const ew::MeshData& meshData)
+{
+	PROFILE_SCOPE("Util::SoftwareMesh::load");
+
+	//The tangents are only needed until they're split into attribute streams
+	std::pmr::monotonic_buffer_resource scratch;
+	Util::Mesh::TBArray tb = Util::Mesh::calculateTB(meshData, &scratch, &scratch);
+
+	_vertexCount = int(meshData.vertices.size());
+	size_t padded = (meshData.vertices.size() + 3) & ~size_t(3);
+	for (std::vector<float>& attribute : _attributes) attribute.assign(padded, 0.f);
+
+	for (size_t i = 0; i < meshData.vertices.size(); i++)
+	{
+		const ew::Vertex& vertex = meshData.vertices[i];
+		const ew::Vec3* vectors[4] = { &vertex.pos, &vertex.normal, &tb[i].first, &tb[i].second };
+		for (int v = 0; v < 4; v++)
+		{
+			_attributes[v * 3 + 0][i] = vectors[v]->x;
+			_attributes[v * 3 + 1][i] = vectors[v]->y;
+			_attributes[v * 3 + 2][i] = vectors[v]->z;
+		}
+		_attributes[12][i] = vertex.uv.x;
+		_attributes[13][i] = vertex.uv.y;
+	}
+
+	_indices.assign(meshData.indices.begin(), meshData.indices.end());
+}
+
+Util::SoftwareRasterizer::SoftwareRasterizer(int width, int height, JobSystem& jobs)
+	: _jobs(jobs)
+{
+	_scratch.resize(_jobs.getThreadCount());
+	for (TileScratch& scratch : _scratch)
+	{
+		scratch.depth.resize(SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE);
+		scratch.triangle.resize(SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE);
+		scratch.lambda1.resize(SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE);
+		scratch.lambda2.resize(SOFTWARE_TILE_SIZE * SOFTWARE_TILE_SIZE);
+	}
+	resize(width, height);
+}
+
+void Util::SoftwareRasterizer::resize(int width, int height)
+{
+	_width = width;
+	_height = height;
+	_tilesX = (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+	_tilesY = (height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+	_guardBand = SOFTWARE_GUARD_BAND_PIXELS / std::max(width, height);
+
+	_color.assign(size_t(width) * height, 0);
+	_depth.assign(size_t(width) * height, 1.f);
+}
+
+void Util::SoftwareRasterizer::begin(const ew::Camera& camera, const SoftwareLighting& lighting)
+{
+	_viewProjection = camera.ProjectionMatrix() * camera.ViewMatrix();
+	_cameraPosition = camera.position;
+	_lighting = lighting;
+	_lighting.activeLights = std::min(std::max(lighting.activeLights, 0), SOFTWARE_MAX_LIGHTS);
+
+	_draws.clear();
+	_vertexJobs.clear();
+	_vertexCount = 0;
+	_triangleCount = 0;
+}
+
+void Util::SoftwareRasterizer::submit(const SoftwareMesh& mesh, const ew::Transform& transform, const SoftwareMaterial& material)
+{
+	Draw draw;
+	draw.mesh = &mesh;
+	draw.material = &material;
+	draw.model = transform.getModelMatrix();
+	draw.firstVertex = _vertexCount;
+	draw.firstTriangle = _triangleCount;
+
+	for (int begin = 0; begin < mesh.getVertexCount(); begin += SOFTWARE_VERTEX_JOB_SIZE)
+	{
+		_vertexJobs.push_back({ int(_draws.size()), begin });
+	}
+
+	_draws.push_back(draw);
+	_vertexCount += mesh.getVertexCount();
+	_triangleCount += mesh.getIndexCount() / 3;
+}
+
+void Util::SoftwareRasterizer::flush()
+{
+	PROFILE_SCOPE("Util::SoftwareRasterizer::flush");
+
+	typedef std::chrono::steady_clock Clock;
+	auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	_stats = SoftwareRasterStats();
+	_stats.triangles = _triangleCount;
+
+	Clock::time_point start = Clock::now();
+	{
+		PROFILE_SCOPE("Vertex");
+		_vertices.resize(_vertexCount);
+		_jobs.parallelFor(int(_vertexJobs.size()), [this](int begin, int end, int)
+			{
+				for (int job = begin; job < end; job++) transformVertices(_vertexJobs[job]);
+			});
+	}
+	_stats.vertexMs = elapsedMs(start);
+
+	start = Clock::now();
+	int chunkCount = (_triangleCount + SOFTWARE_CHUNK_TRIANGLES - 1) / SOFTWARE_CHUNK_TRIANGLES;
+	{
+		PROFILE_SCOPE("Setup and binning");
+		//Chunks are kept between frames so their vectors keep their capacity
+		if (int(_chunks.size()) < chunkCount) _chunks.resize(chunkCount);
+		_jobs.parallelFor(chunkCount, [this](int begin, int end, int)
+			{
+				for (int chunk = begin; chunk < end; chunk++) setupTriangles(chunk);
+			});
+	}
+	_stats.binningMs = elapsedMs(start);
+	for (int i = 0; i < chunkCount; i++) _stats.rasterizedTriangles += int(_chunks[i].triangles.size());
+
+	start = Clock::now();
+	{
+		PROFILE_SCOPE("Raster");
+		for (TileScratch& scratch : _scratch) scratch.shadedSamples = 0;
+		_jobs.parallelFor(_tilesX * _tilesY, [this](int begin, int end, int worker)
+			{
+				for (int tile = begin; tile < end; tile++) rasterizeTile(tile, worker);
+			});
+	}
+	_stats.rasterMs = elapsedMs(start);
+	for (const TileScratch& scratch : _scratch) _stats.shadedSamples += scratch.shadedSamples;
+
+	//Stale chunks from bigger frames must not be rasterized next time
+	for (size_t i = chunkCount; i < _chunks.size(); i++) _chunks[i].triangles.clear();
+}
+
+void Util::SoftwareRasterizer::transformVertices(const VertexJob& job)
+{
+	const Draw& draw = _draws[job.draw];
+	const SoftwareMesh& mesh = *draw.mesh;
+
+	float mvp[4][4];
+	float model[4][4];
+	toArray(_viewProjection * draw.model, mvp);
+	toArray(draw.model, model);
+
+	int end = std::min(job.begin + SOFTWARE_VERTEX_JOB_SIZE, mesh._vertexCount);
+	for (int i = job.begin; i < end; i += 4)
+	{
+		Float4 x = load4(&mesh._attributes[0][i]);
+		Float4 y = load4(&mesh._attributes[1][i]);
+		Float4 z = load4(&mesh._attributes[2][i]);
+
+		Float4 clip[4];
+		transform4(mvp, 4, x, y, z, 1.f, clip);
+
+		//Same as defaultLit.vert: the surface position skips the model translation, directions are normalized
+		Float4 position[3];
+		transform4(model, 3, x, y, z, 0.f, position);
+
+		Float4 directions[3][3];
+		for (int d = 0; d < 3; d++)
+		{
+			int attribute = 3 + d * 3;
+			transform4(model, 3, load4(&mesh._attributes[attribute][i]), load4(&mesh._attributes[attribute + 1][i]), load4(&mesh._attributes[attribute + 2][i]), 0.f, directions[d]);
+			normalize4(directions[d]);
+		}
+
+		float lanes[SOFTWARE_VERTEX_FLOATS + 4][4];
+		for (int r = 0; r < 4; r++) store4(lanes[r], clip[r]);
+		for (int r = 0; r < 3; r++) store4(lanes[4 + r], position[r]);
+		for (int d = 0; d < 3; d++)
+		{
+			for (int r = 0; r < 3; r++) store4(lanes[7 + d * 3 + r], directions[d][r]);
+		}
+		store4(lanes[16], load4(&mesh._attributes[12][i]));
+		store4(lanes[17], load4(&mesh._attributes[13][i]));
+
+		int count = std::min(4, end - i);
+		for (int lane = 0; lane < count; lane++)
+		{
+			ClipVertex& out = _vertices[draw.firstVertex + i + lane];
+			for (int r = 0; r < 4; r++) out.clip[r] = lanes[r][lane];
+			for (int a = 0; a < SOFTWARE_VERTEX_FLOATS; a++) out.attributes[a] = lanes[4 + a][lane];
+		}
+	}
+}
+
+//Clip planes as dot(plane, clip position) >= 0
+enum ClipPlane
+{
+	CLIP_NEAR = 0,
+	CLIP_LEFT,
+	CLIP_RIGHT,
+	CLIP_BOTTOM,
+	CLIP_TOP,
+	CLIP_PLANE_COUNT
+};
+
+void Util::SoftwareRasterizer::setupTriangles(int chunkIndex)
+{
+	Chunk& chunk = _chunks[chunkIndex];
+	chunk.triangles.clear();
+	chunk.bins.resize(_tilesX * _tilesY);
+	for (std::vector<uint32_t>& bin : chunk.bins) bin.clear();
+
+	int first = chunkIndex * SOFTWARE_CHUNK_TRIANGLES;
+	int last = std::min(first + SOFTWARE_CHUNK_TRIANGLES, _triangleCount);
+
+	//Draw containing the first triangle, later ones are found by walking forward
+	int drawIndex = int(std::upper_bound(_draws.begin(), _draws.end(), first, [](int triangle, const Draw& draw) { return triangle < draw.firstTriangle; }) - _draws.begin()) - 1;
+
+	const float planes[CLIP_PLANE_COUNT][4] = {
+		{ 0.f, 0.f, 1.f, 1.f },
+		{ 1.f, 0.f, 0.f, _guardBand },
+		{ -1.f, 0.f, 0.f, _guardBand },
+		{ 0.f, 1.f, 0.f, _guardBand },
+		{ 0.f, -1.f, 0.f, _guardBand },
+	};
+	auto distance = [&planes](const ClipVertex& v, int plane)
+	{
+		return planes[plane][0] * v.clip[0] + planes[plane][1] * v.clip[1] + planes[plane][2] * v.clip[2] + planes[plane][3] * v.clip[3];
+	};
+	//Trivial reject against the real frustum, x/y/z within +-w
+	auto outcode = [](const ClipVertex& v)
+	{
+		float w = v.clip[3];
+		return (v.clip[0] < -w ? 1 : 0) | (v.clip[0] > w ? 2 : 0) | (v.clip[1] < -w ? 4 : 0) | (v.clip[1] > w ? 8 : 0) | (v.clip[2] < -w ? 16 : 0) | (v.clip[2] > w ? 32 : 0);
+	};
+
+	for (int t = first; t < last; t++)
+	{
+		while (drawIndex + 1 < int(_draws.size()) && _draws[drawIndex + 1].firstTriangle <= t) drawIndex++;
+		const Draw& draw = _draws[drawIndex];
+		const unsigned int* indices = &draw.mesh->_indices[(t - draw.firstTriangle) * 3];
+
+		const ClipVertex* v[3];
+		for (int i = 0; i < 3; i++) v[i] = &_vertices[draw.firstVertex + indices[i]];
+
+		if (outcode(*v[0]) & outcode(*v[1]) & outcode(*v[2])) continue;
+
+		int clipMask = 0;
+		for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (distance(*v[i], plane) < 0.f) clipMask |= 1 << plane;
+			}
+		}
+
+		if (!clipMask)
+		{
+			emitTriangle(chunk, *v[0], *v[1], *v[2], draw.material);
+			continue;
+		}
+
+		//Sutherland-Hodgman, attributes are linear in clip space so plain lerps are correct
+		ClipVertex polygons[2][3 + CLIP_PLANE_COUNT];
+		int count = 3;
+		for (int i = 0; i < 3; i++) polygons[0][i] = *v[i];
+
+		int current = 0;
+		for (int plane = 0; plane < CLIP_PLANE_COUNT && count >= 3; plane++)
+		{
+			if (!(clipMask & (1 << plane))) continue;
+
+			const ClipVertex* in = polygons[current];
+			ClipVertex* out = polygons[current ^ 1];
+			int outCount = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const ClipVertex& a = in[i];
+				const ClipVertex& b = in[(i + 1) % count];
+				float da = distance(a, plane);
+				float db = distance(b, plane);
+
+				if (da >= 0.f) out[outCount++] = a;
+				if ((da >= 0.f) != (db >= 0.f))
+				{
+					float s = da / (da - db);
+					ClipVertex& lerped = out[outCount++];
+					for (int c = 0; c < 4; c++) lerped.clip[c] = a.clip[c] + (b.clip[c] - a.clip[c]) * s;
+					for (int c = 0; c < SOFTWARE_VERTEX_FLOATS; c++) lerped.attributes[c] = a.attributes[c] + (b.attributes[c] - a.attributes[c]) * s;
+				}
+			}
+			count = outCount;
+			current ^= 1;
+		}
+
+		for (int i = 1; i + 1 < count; i++)
+		{
+			emitTriangle(chunk, polygons[current][0], polygons[current][i], polygons[current][i + 1], draw.material);
+		}
+	}
+}
+
+void Util::SoftwareRasterizer::emitTriangle(Chunk& chunk, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, const SoftwareMaterial* material)
+{
+	const ClipVertex* v[3] = { &v0, &v1, &v2 };
+
+	Triangle triangle;
+	for (int i = 0; i < 3; i++)
+	{
+		float invW = 1.f / v[i]->clip[3];
+		float sx = (v[i]->clip[0] * invW * 0.5f + 0.5f) * _width;
+		float sy = (v[i]->clip[1] * invW * 0.5f + 0.5f) * _height;
+		triangle.x[i] = int(lroundf(sx * SOFTWARE_SUBPIXEL_STEP));
+		triangle.y[i] = int(lroundf(sy * SOFTWARE_SUBPIXEL_STEP));
+		triangle.z[i] = v[i]->clip[2] * invW * 0.5f + 0.5f;
+		triangle.invW[i] = invW;
+		std::copy(v[i]->attributes, v[i]->attributes + SOFTWARE_VERTEX_FLOATS, triangle.attributes[i]);
+	}
+
+	//Counter clockwise is front facing, back faces and degenerates are culled
+	long long area = (long long)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (long long)(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	if (area <= 0) return;
+
+	//Pixels whose centers can be covered
+	long long half = SOFTWARE_SUBPIXEL_STEP / 2;
+	long long minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+	long long maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+	long long minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+	long long maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+	triangle.minX = int(std::max(floorDiv(minX - half + SOFTWARE_SUBPIXEL_STEP - 1, SOFTWARE_SUBPIXEL_STEP), 0LL));
+	triangle.minY = int(std::max(floorDiv(minY - half + SOFTWARE_SUBPIXEL_STEP - 1, SOFTWARE_SUBPIXEL_STEP), 0LL));
+	triangle.maxX = int(std::min(floorDiv(maxX - half, SOFTWARE_SUBPIXEL_STEP), (long long)_width - 1));
+	triangle.maxY = int(std::min(floorDiv(maxY - half, SOFTWARE_SUBPIXEL_STEP), (long long)_height - 1));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+	triangle.material = material;
+
+	uint32_t index = uint32_t(chunk.triangles.size());
+	chunk.triangles.push_back(triangle);
+
+	for (int ty = triangle.minY / SOFTWARE_TILE_SIZE; ty <= triangle.maxY / SOFTWARE_TILE_SIZE; ty++)
+	{
+		for (int tx = triangle.minX / SOFTWARE_TILE_SIZE; tx <= triangle.maxX / SOFTWARE_TILE_SIZE; tx++)
+		{
+			chunk.bins[ty * _tilesX + tx].push_back(index);
+		}
+	}
+}
+
+//defaultLit.frag ported to C++, parallax functions from https://learnopengl.com/Advanced-Lighting/Parallax-Mapping
+static ew::Vec2 parallax(const Util::SoftwareMaterial& material, ew::Vec2 uv, const ew::Vec3& viewDir)
+{
+	auto height = [&material](ew::Vec2 uv) { return material.heightTexture ? material.heightTexture->sample(uv).x : 0.f; };
+
+	if (material.parallaxMethod == 1)
+	{
+		ew::Vec2 p = ew::Vec2(viewDir.x, viewDir.y) / viewDir.z * (height(uv) * material.heightScale);
+		return uv - p;
+	}
+
+	float t = std::max(viewDir.z, 0.f);
+	float numLayers = material.maxLayers + (material.minLayers - material.maxLayers) * t;
+	float layerDepth = 1.f / numLayers;
+	float currentLayerDepth = 0.f;
+
+	ew::Vec2 deltaUV = ew::Vec2(viewDir.x, viewDir.y) * material.heightScale / numLayers;
+	ew::Vec2 currentUV = uv;
+	float currentHeight = height(currentUV);
+	while (currentLayerDepth < currentHeight)
+	{
+		currentUV -= deltaUV;
+		currentHeight = height(currentUV);
+		currentLayerDepth += layerDepth;
+	}
+
+	if (material.parallaxMethod == 2) return currentUV;
+
+	ew::Vec2 prevUV = currentUV + deltaUV;
+	float afterHeight = currentHeight - currentLayerDepth;
+	float beforeHeight = height(prevUV) - currentLayerDepth + layerDepth;
+	float weight = afterHeight / (afterHeight - beforeHeight);
+	return prevUV * weight + currentUV * (1.f - weight);
+}
+
+//Returns false when the fragment is discarded
+static bool shade(const float* attributes, const Util::SoftwareMaterial& material, const Util::SoftwareLighting& lighting, const ew::Vec3& cameraPosition, uint32_t& color)
+{
+	ew::Vec3 position(attributes[0], attributes[1], attributes[2]);
+	ew::Vec3 normal(attributes[3], attributes[4], attributes[5]);
+	ew::Vec3 tangent(attributes[6], attributes[7], attributes[8]);
+	ew::Vec3 bitangent(attributes[9], attributes[10], attributes[11]);
+	ew::Vec2 uv(attributes[12], attributes[13]);
+
+	ew::Vec3 camera = ew::Normalize(cameraPosition - position);
+	ew::Vec3 light = lighting.ambientColor * material.ambientK;
+
+	//Rows of the interpolated tbn, same as transpose(mat3(t, b, n)) in the shader
+	ew::Vec3 toView = cameraPosition - position;
+	ew::Vec3 viewDir = ew::Normalize(ew::Vec3(ew::Dot(tangent, toView), ew::Dot(bitangent, toView), ew::Dot(normal, toView)));
+
+	ew::Vec2 finalUV = material.parallaxMethod == 0 ? uv : parallax(material, uv, viewDir);
+	if (material.discardOutOfBoundFrags && (finalUV.x > 1.f || finalUV.y > 1.f || finalUV.x < 0.f || finalUV.y < 0.f)) return false;
+
+	normal = ew::Normalize(normal);
+	for (int i = 0; i < lighting.activeLights; i++)
+	{
+		const Util::SoftwareLight& source = lighting.lights[i];
+		ew::Vec3 lightDirection = ew::Normalize(source.position - position);
+		ew::Vec3 halfVec = ew::Normalize(lightDirection + camera);
+
+		light += source.color * (material.diffuseK * std::max(ew::Dot(normal, lightDirection), 0.f));
+		light += source.color * (material.specularK * powf(std::max(ew::Dot(halfVec, normal), 0.f), material.shininess));
+	}
+
+	ew::Vec4 texColor = material.colorTexture ? material.colorTexture->sample(finalUV) : ew::Vec4(1.f);
+	float rgb[3] = { texColor.x * light.x, texColor.y * light.y, texColor.z * light.z };
+
+	//The shader multiplies alpha by 0
+	color = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		float value = std::min(std::max(rgb[c], 0.f), 1.f);
+		color |= uint32_t(value * 255.f + 0.5f) << (c * 8);
+	}
+	return true;
+}
+
+void Util::SoftwareRasterizer::rasterizeTile(int tile, int worker)
+{
+	TileScratch& scratch = _scratch[worker];
+
+	int tileX = (tile % _tilesX) * SOFTWARE_TILE_SIZE;
+	int tileY = (tile / _tilesX) * SOFTWARE_TILE_SIZE;
+	int tileWidth = std::min(SOFTWARE_TILE_SIZE, _width - tileX);
+	int tileHeight = std::min(SOFTWARE_TILE_SIZE, _height - tileY);
+
+	std::fill(scratch.depth.begin(), scratch.depth.end(), 1.f);
+	std::fill(scratch.triangle.begin(), scratch.triangle.end(), nullptr);
+
+	const float clearRgb[3] = { clearColor.x, clearColor.y, clearColor.z };
+	uint32_t clear = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		float value = std::min(std::max(clearRgb[c], 0.f), 1.f);
+		clear |= uint32_t(value * 255.f + 0.5f) << (c * 8);
+	}
+	clear |= 0xFFu << 24;
+	for (int y = 0; y < tileHeight; y++)
+	{
+		std::fill_n(&_color[size_t(tileY + y) * _width + tileX], tileWidth, clear);
+	}
+
+	float attributes[SOFTWARE_VERTEX_FLOATS];
+	auto interpolate = [&attributes](const Triangle& triangle, float lambda1, float lambda2)
+	{
+		//Perspective correct weights
+		float b0 = (1.f - lambda1 - lambda2) * triangle.invW[0];
+		float b1 = lambda1 * triangle.invW[1];
+		float b2 = lambda2 * triangle.invW[2];
+		float inv = 1.f / (b0 + b1 + b2);
+		b0 *= inv;
+		b1 *= inv;
+		b2 *= inv;
+		for (int a = 0; a < SOFTWARE_VERTEX_FLOATS; a++)
+		{
+			attributes[a] = triangle.attributes[0][a] * b0 + triangle.attributes[1][a] * b1 + triangle.attributes[2][a] * b2;
+		}
+	};
+
+	for (const Chunk& chunk : _chunks)
+	{
+		if (chunk.triangles.empty()) continue;
+
+		for (uint32_t index : chunk.bins[tile])
+		{
+			const Triangle& triangle = chunk.triangles[index];
+			//Discarding materials have to shade before writing depth, everything else defers shading to one sample per pixel
+			bool forward = triangle.material->discardOutOfBoundFrags;
+
+			int minX = std::max(triangle.minX, tileX);
+			int maxX = std::min(triangle.maxX, tileX + tileWidth - 1);
+			int minY = std::max(triangle.minY, tileY);
+			int maxY = std::min(triangle.maxY, tileY + tileHeight - 1);
+			if (minX > maxX || minY > maxY) continue;
+
+			//Edge i is opposite vertex i, top-left edges own the pixels exactly on them
+			long long stepX[3];
+			long long stepY[3];
+			long long rowStart[3];
+			long long px = (long long)minX * SOFTWARE_SUBPIXEL_STEP + SOFTWARE_SUBPIXEL_STEP / 2;
+			long long py = (long long)minY * SOFTWARE_SUBPIXEL_STEP + SOFTWARE_SUBPIXEL_STEP / 2;
+			for (int e = 0; e < 3; e++)
+			{
+				int a = (e + 1) % 3;
+				int b = (e + 2) % 3;
+				long long dx = triangle.x[b] - triangle.x[a];
+				long long dy = triangle.y[b] - triangle.y[a];
+				bool topLeft = dy < 0 || (dy == 0 && dx < 0);
+				rowStart[e] = dx * (py - triangle.y[a]) - dy * (px - triangle.x[a]) + (topLeft ? 0 : -1);
+				stepX[e] = -dy * SOFTWARE_SUBPIXEL_STEP;
+				stepY[e] = dx * SOFTWARE_SUBPIXEL_STEP;
+			}
+
+			long long area = (long long)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (long long)(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+			float invArea = 1.f / float(area);
+			float dz1 = triangle.z[1] - triangle.z[0];
+			float dz2 = triangle.z[2] - triangle.z[0];
+
+			for (int y = minY; y <= maxY; y++)
+			{
+				long long w0 = rowStart[0];
+				long long w1 = rowStart[1];
+				long long w2 = rowStart[2];
+				int row = (y - tileY) * SOFTWARE_TILE_SIZE;
+
+				for (int x = minX; x <= maxX; x++, w0 += stepX[0], w1 += stepX[1], w2 += stepX[2])
+				{
+					if ((w0 | w1 | w2) < 0) continue;
+
+					float lambda1 = float(w1) * invArea;
+					float lambda2 = float(w2) * invArea;
+					float z = triangle.z[0] + lambda1 * dz1 + lambda2 * dz2;
+
+					int i = row + (x - tileX);
+					if (z < 0.f || z > 1.f || z >= scratch.depth[i]) continue;
+
+					if (forward)
+					{
+						interpolate(triangle, lambda1, lambda2);
+						uint32_t color;
+						scratch.shadedSamples++;
+						if (!shade(attributes, *triangle.material, _lighting, _cameraPosition, color)) continue;
+						_color[size_t(y) * _width + x] = color;
+						scratch.triangle[i] = nullptr;
+					}
+					else
+					{
+						scratch.triangle[i] = &triangle;
+						scratch.lambda1[i] = lambda1;
+						scratch.lambda2[i] = lambda2;
+					}
+					scratch.depth[i] = z;
+				}
+
+				for (int e = 0; e < 3; e++) rowStart[e] += stepY[e];
+			}
+		}
+	}
+
+	//Resolve: shade the surviving sample of every pixel once
+	for (int y = 0; y < tileHeight; y++)
+	{
+		for (int x = 0; x < tileWidth; x++)
+		{
+			int i = y * SOFTWARE_TILE_SIZE + x;
+			size_t pixel = size_t(tileY + y) * _width + tileX + x;
+			_depth[pixel] = scratch.depth[i];
+
+			const Triangle* triangle = scratch.triangle[i];
+			if (!triangle) continue;
+
+			interpolate(*triangle, scratch.lambda1[i], scratch.lambda2[i]);
+			uint32_t color;
+			shade(attributes, *triangle->material, _lighting, _cameraPosition, color);
+			_color[pixel] = color;
+			scratch.shadedSamples++;
+		}
+	}
+}
+
+bool Util::SoftwareRasterizer::writePPM(const char* filepath) const
+{
+	FILE* file = fopen(filepath, "wb");
+	if (!file)
+	{
+		printf("Failed to open image file %s\n", filepath);
+		return false;
+	}
+
+	fprintf(file, "P6\n%d %d\n255\n", _width, _height);
+	std::vector<unsigned char> row(size_t(_width) * 3);
+	for (int y = _height - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < _width; x++)
+		{
+			uint32_t color = _color[size_t(y) * _width + x];
+			for (int c = 0; c < 3; c++) row[x * 3 + c] = (color >> (c * 8)) & 0xFF;
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+
+	fclose(file);
+	return true;
+}
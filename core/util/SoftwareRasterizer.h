@@ -0,0 +1,214 @@
+/*
+* Created by Adam Gyenes
+* CPU rendering backend for machines without a GPU, renders the final project's
+* lit/parallax material into an RGBA8 image. Triangles are binned into screen tiles
+* and tiles are rasterized in parallel on a Util::JobSystem.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../ew/camera.h"
+#include "../ew/mesh.h"
+#include "../ew/transform.h"
+
+#include "JobSystem.h"
+
+namespace Util
+{
+	constexpr int SOFTWARE_MAX_LIGHTS = 4;
+	constexpr int SOFTWARE_TILE_SIZE = 64;
+	//Floats per vertex: position, normal, tangent, bitangent, uv
+	constexpr int SOFTWARE_VERTEX_FLOATS = 14;
+
+	struct SoftwareTexture
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		std::vector<unsigned char> pixels;
+		//false matches GL_NEAREST
+		bool bilinear = true;
+
+		//Same conventions as Util::loadTexture
+		bool load(const char* filepath, bool flipVertical = true);
+		//GL_REPEAT wrapping, missing channels read as 0 and alpha as 1 like GL
+		ew::Vec4 sample(ew::Vec2 uv) const;
+	};
+
+	//Vertex data laid out for the transform loop, built once like Util::Mesh
+	class SoftwareMesh
+	{
+	public:
+		SoftwareMesh() {};
+		SoftwareMesh(const ew::MeshData& meshData);
+
+		void load(const ew::MeshData& meshData);
+
+		int getVertexCount() const { return _vertexCount; }
+		int getIndexCount() const { return int(_indices.size()); }
+
+	private:
+		friend class SoftwareRasterizer;
+
+		int _vertexCount = 0;
+		//Structure of arrays padded to a multiple of 4 so the transform can always load full SIMD lanes
+		std::vector<float> _attributes[SOFTWARE_VERTEX_FLOATS];
+		std::vector<unsigned int> _indices;
+	};
+
+	struct SoftwareLight
+	{
+		ew::Vec3 position;
+		ew::Vec3 color;
+	};
+
+	//Mirrors the defaultLit.frag uniforms
+	struct SoftwareMaterial
+	{
+		float ambientK = 0.2f;
+		float diffuseK = 0.4f;
+		float specularK = 0.5f;
+		float shininess = 10.f;
+
+		//Same numbering as the final project: off, simple, steep, occlusion
+		int parallaxMethod = 0;
+		bool discardOutOfBoundFrags = false;
+		float heightScale = 0.1f;
+		float minLayers = 8.f;
+		float maxLayers = 32.f;
+
+		const SoftwareTexture* colorTexture = nullptr;
+		const SoftwareTexture* heightTexture = nullptr;
+	};
+
+	struct SoftwareLighting
+	{
+		ew::Vec3 ambientColor = ew::Vec3(0.341f, 0.365f, 0.51f);
+		int activeLights = 0;
+		SoftwareLight lights[SOFTWARE_MAX_LIGHTS];
+	};
+
+	struct SoftwareRasterStats
+	{
+		int triangles = 0;
+		//After culling and clipping
+		int rasterizedTriangles = 0;
+		long long shadedSamples = 0;
+
+		double vertexMs = 0.0;
+		double binningMs = 0.0;
+		double rasterMs = 0.0;
+	};
+
+	class SoftwareRasterizer
+	{
+	public:
+		//Every stage runs as parallelFor jobs on jobs, which must outlive the rasterizer
+		SoftwareRasterizer(int width, int height, JobSystem& jobs);
+
+		void resize(int width, int height);
+
+		//Meshes, materials and textures are referenced until flush()
+		void begin(const ew::Camera& camera, const SoftwareLighting& lighting);
+		void submit(const SoftwareMesh& mesh, const ew::Transform& transform, const SoftwareMaterial& material);
+		void flush();
+
+		int getWidth() const { return _width; }
+		int getHeight() const { return _height; }
+		int getThreadCount() const { return _jobs.getThreadCount(); }
+
+		//Bottom row first like glReadPixels, RGBA8 packed little endian
+		const std::vector<uint32_t>& getColorBuffer() const { return _color; }
+		const std::vector<float>& getDepthBuffer() const { return _depth; }
+		const SoftwareRasterStats& getStats() const { return _stats; }
+
+		//Binary PPM, top row first
+		bool writePPM(const char* filepath) const;
+
+		ew::Vec3 clearColor = ew::Vec3(0.f);
+
+	private:
+		struct ClipVertex
+		{
+			float clip[4];
+			float attributes[SOFTWARE_VERTEX_FLOATS];
+		};
+
+		struct Triangle
+		{
+			//Screen space, 4 bits of subpixel precision
+			int x[3];
+			int y[3];
+			float z[3];
+			float invW[3];
+			float attributes[3][SOFTWARE_VERTEX_FLOATS];
+			int minX, minY, maxX, maxY;
+			const SoftwareMaterial* material;
+		};
+
+		struct Draw
+		{
+			const SoftwareMesh* mesh;
+			const SoftwareMaterial* material;
+			ew::Mat4 model;
+			int firstVertex;
+			int firstTriangle;
+		};
+
+		//Fixed ranges of the frame's triangles, each with its own bins so rasterization order stays deterministic
+		struct Chunk
+		{
+			std::vector<Triangle> triangles;
+			std::vector<std::vector<uint32_t>> bins;
+		};
+
+		struct TileScratch
+		{
+			std::vector<float> depth;
+			std::vector<const Triangle*> triangle;
+			std::vector<float> lambda1;
+			std::vector<float> lambda2;
+			long long shadedSamples = 0;
+		};
+
+		struct VertexJob
+		{
+			int draw;
+			int begin;
+		};
+
+		void transformVertices(const VertexJob& job);
+		void setupTriangles(int chunk);
+		void emitTriangle(Chunk& chunk, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, const SoftwareMaterial* material);
+		void rasterizeTile(int tile, int worker);
+
+		JobSystem& _jobs;
+
+		int _width = 0;
+		int _height = 0;
+		int _tilesX = 0;
+		int _tilesY = 0;
+
+		ew::Mat4 _viewProjection;
+		ew::Vec3 _cameraPosition;
+		//Clip space x/y limit before triangles get clipped, keeps fixed point edge math in range
+		float _guardBand = 1.f;
+		SoftwareLighting _lighting;
+
+		std::vector<Draw> _draws;
+		std::vector<VertexJob> _vertexJobs;
+		std::vector<ClipVertex> _vertices;
+		std::vector<Chunk> _chunks;
+		std::vector<TileScratch> _scratch;
+		int _triangleCount = 0;
+		int _vertexCount = 0;
+
+		std::vector<uint32_t> _color;
+		std::vector<float> _depth;
+
+		SoftwareRasterStats _stats;
+	};
+}
@@ -0,0 +1,94 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "SphereImpostors.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//A quad as a triangle strip
+constexpr GLsizei SPHERE_IMPOSTOR_VERTICES = 4;
+
+Util::SphereImpostorRenderer::SphereImpostorRenderer(int maxInstances) :
+	_instanceBuffer(sizeof(SphereImpostor), maxInstances, SPHERE_IMPOSTOR_STORAGE_BINDING, "Util::SphereImpostorRenderer")
+{
+	//Reserved once, queuing never allocates
+	_instances.reserve(_instanceBuffer.getCapacity());
+}
+
+bool Util::SphereImpostorRenderer::add(const ew::Vec3& center, float radius, const ew::Vec3& color)
+{
+	if (!_instanceBuffer.hasRoom(_instances.size())) return false;
+
+	SphereImpostor instance;
+	instance.center = center;
+	instance.radius = radius;
+	instance.color = color;
+	instance.padding = 0.f;
+	_instances.push_back(instance);
+	return true;
+}
+
+bool Util::SphereImpostorRenderer::addSphere(const ew::Mat4& model, float radius, const ew::Vec3& color)
+{
+	ew::Vec4 center = model * ew::Vec4(0.f, 0.f, 0.f, 1.f);
+	float scale = 0.f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		ew::Vec4 direction = model * ew::Vec4(axis == 0 ? 1.f : 0.f, axis == 1 ? 1.f : 0.f, axis == 2 ? 1.f : 0.f, 0.f);
+		scale = std::max(scale, ew::Magnitude(ew::Vec3(direction.x, direction.y, direction.z)));
+	}
+	return add(ew::Vec3(center.x, center.y, center.z), radius * scale, color);
+}
+
+void Util::SphereImpostorRenderer::draw(GLStateCache& stateCache, GLuint program, const ew::Camera& camera, FrameSync* frameSync)
+{
+	PROFILE_SCOPE("Util::SphereImpostorRenderer::draw");
+
+	_stats = SphereImpostorStats();
+	_stats.overflows = _instanceBuffer.getOverflows();
+	if (!isSupported() || _instances.empty()) return;
+
+	if (_instanceBuffer.changeProgram(program))
+	{
+		_cameraPositionLocation = glGetUniformLocation(program, "_CameraPosition");
+		_cameraForwardLocation = glGetUniformLocation(program, "_CameraForward");
+		_orthographicLocation = glGetUniformLocation(program, "_Orthographic");
+	}
+
+	GLsizei instanceCount = GLsizei(_instances.size());
+	//The quad corners come from gl_VertexID, the spheres from gl_InstanceID
+	_instanceBuffer.bind(stateCache, program, _instances.data(), instanceCount, frameSync);
+
+	//Rays start at the camera, or for an orthographic one on the quad and all go forward
+	ew::Vec3 forward = ew::Normalize(camera.target - camera.position);
+	glUniform3f(_cameraPositionLocation, camera.position.x, camera.position.y, camera.position.z);
+	glUniform3f(_cameraForwardLocation, forward.x, forward.y, forward.z);
+	glUniform1i(_orthographicLocation, camera.orthographic ? 1 : 0);
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, SPHERE_IMPOSTOR_VERTICES, instanceCount);
+
+	_stats.instances = instanceCount;
+	_stats.draws = 1;
+	_stats.vertices = SPHERE_IMPOSTOR_VERTICES * instanceCount;
+}
+
+void Util::SphereImpostorRenderer::clear()
+{
+	_instances.clear();
+	_instanceBuffer.resetOverflows();
+}
+
+float Util::SphereImpostorRenderer::getScreenRadius(const ew::Camera& camera, int viewportHeight, const ew::Vec3& center, float radius)
+{
+	if (camera.orthographic) return radius * viewportHeight / camera.orthoHeight;
+
+	//Tangent of the silhouette cone's half angle, over the tangent of the half field of view
+	float distance = ew::Magnitude(center - camera.position);
+	if (distance <= radius) return std::numeric_limits<float>::infinity();
+	float tangent = radius / sqrtf(distance * distance - radius * radius);
+	return tangent * viewportHeight / (2.f * tanf(ew::Radians(camera.fov) * 0.5f));
+}
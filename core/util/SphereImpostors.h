@@ -0,0 +1,87 @@
+/*
+* Created by Adam Gyenes
+* Spheres as camera facing quads, ray cast in the fragment shader (sphereImpostor.vert/.frag) with their exact depth
+* written. Four vertices per sphere however close it gets, for light gizmos, particles and as the far LOD of
+* ew::createSphere meshes
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "../ew/camera.h"
+#include "../ew/external/glad.h"
+#include "../ew/ewMath/mat4.h"
+
+#include "GLStateCache.h"
+#include "InstanceBuffer.h"
+
+//Shader storage binding sphereImpostor.vert reads its instances from
+constexpr GLuint SPHERE_IMPOSTOR_STORAGE_BINDING = 2;
+
+namespace Util
+{
+	//std430 layout of the shader's instance array
+	struct SphereImpostor
+	{
+		ew::Vec3 center;
+		float radius;
+		ew::Vec3 color;
+		float padding;
+	};
+
+	struct SphereImpostorStats
+	{
+		int instances = 0;
+		int draws = 0;
+		GLsizei vertices = 0;
+		//Spheres add() turned away since the last clear()
+		int overflows = 0;
+	};
+
+	//GL thread only. Queue spheres every frame, then draw them with a program built from sphereImpostor.vert/.frag
+	//that already has _ViewProjection set:
+	//  Util::SphereImpostorRenderer impostors(MAX_LIGHTS);
+	//  impostors.add(light.position, 0.3f, light.color);
+	//  impostors.draw(stateCache, impostorShader.getId(), camera, &frameSync);
+	//  impostors.clear();
+	//The depth written assumes the default glDepthRange of 0 to 1
+	class SphereImpostorRenderer
+	{
+	public:
+		explicit SphereImpostorRenderer(int maxInstances);
+
+		SphereImpostorRenderer(const SphereImpostorRenderer&) = delete;
+		SphereImpostorRenderer& operator=(const SphereImpostorRenderer&) = delete;
+
+		static bool isSupported() { return InstanceBuffer::isSupported(); }
+
+		//False if the renderer is full
+		bool add(const ew::Vec3& center, float radius, const ew::Vec3& color);
+		//A sphere mesh of radius drawn with model, as the impostor enclosing it. Non-uniform scale takes the largest axis
+		bool addSphere(const ew::Mat4& model, float radius, const ew::Vec3& color);
+		//Draws every queued sphere with one instanced draw. The instances go through frameSync's ring when given, see
+		//InstanceBuffer::bind
+		void draw(GLStateCache& stateCache, GLuint program, const ew::Camera& camera, FrameSync* frameSync = nullptr);
+		//Forgets this frame's spheres and overflows
+		void clear();
+
+		//Radius in pixels a sphere covers on screen, to pick between a mesh and its impostor. Infinite once the camera
+		//is inside it
+		static float getScreenRadius(const ew::Camera& camera, int viewportHeight, const ew::Vec3& center, float radius);
+
+		//Of the last draw()
+		const SphereImpostorStats& getStats() const { return _stats; }
+
+	private:
+		InstanceBuffer _instanceBuffer;
+		std::vector<SphereImpostor> _instances;
+
+		//Looked up in whichever program _instanceBuffer last drew with
+		GLint _cameraPositionLocation = -1;
+		GLint _cameraForwardLocation = -1;
+		GLint _orthographicLocation = -1;
+
+		SphereImpostorStats _stats;
+	};
+}
@@ -1,25 +1,56 @@
 #include "Texture.h"
+#include "Profiler.h"
 
-GLuint Util::loadTexture(const char* filepath, GLint wrapMode, GLint filtering, bool flipVertical)
+#include <algorithm>
+
+Util::GpuResource Util::loadTexture(const char* filepath, GLint wrapMode, GLint filtering, bool flipVertical)
 {
+	PROFILE_SCOPE("Util::loadTexture");
+
 	stbi_set_flip_vertically_on_load(flipVertical);
 
 	int width;
 	int height;
 	int numComponents;
 
-	stbi_uc* data = stbi_load(filepath, &width, &height, &numComponents, 0);
+	stbi_uc* data;
+	{
+		PROFILE_SCOPE("stbi_load");
+		data = stbi_load(filepath, &width, &height, &numComponents, 0);
+	}
 	if (!data)
 	{
 		printf("Failed to load image %s", filepath);
 		stbi_image_free(data);
-		return 0;
+		return GpuResource();
 	}
 
-	GLuint texture;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	GpuResource texture = GpuResource::create(GpuResourceType::TEXTURE, filepath);
 	GLenum format = COMPONENTS_TO_FORMAT.at(numComponents);
+	texture.setBytes(getTextureBytes(width, height, numComponents, true));
+
+	if (GLAD_GL_VERSION_4_5)
+	{
+		//Immutable storage for the full mip chain, filled without binding anything
+		GLuint name = texture.get();
+		GLsizei levels = 1;
+		while ((std::max(width, height) >> levels) > 0) levels++;
+		glTextureStorage2D(name, levels, COMPONENTS_TO_SIZED_FORMAT.at(numComponents), width, height);
+		glTextureSubImage2D(name, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+
+		glTextureParameteri(name, GL_TEXTURE_WRAP_S, wrapMode);
+		glTextureParameteri(name, GL_TEXTURE_WRAP_T, wrapMode);
+
+		glTextureParameteri(name, GL_TEXTURE_MIN_FILTER, filtering);
+		glTextureParameteri(name, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glGenerateTextureMipmap(name);
+
+		stbi_image_free(data);
+		return texture;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture.get());
 	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
@@ -4,6 +4,7 @@
 
 #include "../ew/external/glad.h"
 #include "../ew/external/stb_image.h"
+#include "GpuResources.h"
 
 const auto COMPONENTS_TO_FORMAT = std::map<int, GLenum>{
 	{1, GL_RED},
@@ -12,7 +13,16 @@ const auto COMPONENTS_TO_FORMAT = std::map<int, GLenum>{
 	{4, GL_RGBA},
 };
 
+//Immutable storage needs a sized format
+const auto COMPONENTS_TO_SIZED_FORMAT = std::map<int, GLenum>{
+	{1, GL_R8},
+	{2, GL_RG8},
+	{3, GL_RGB8},
+	{4, GL_RGBA8},
+};
+
 namespace Util
 {
-	GLuint loadTexture(const char* filepath, GLint wrapMode = GL_CLAMP_TO_EDGE, GLint filtering = GL_LINEAR, bool flipVertical = true);
+	//Owned texture, deleted once the returned resource is destroyed or reassigned. Invalid if the file failed to load
+	GpuResource loadTexture(const char* filepath, GLint wrapMode = GL_CLAMP_TO_EDGE, GLint filtering = GL_LINEAR, bool flipVertical = true);
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "VertexFormat.h"
+
+#include <cassert>
+
+Util::VertexFormat& Util::VertexFormat::add(GLuint index, GLint size, GLenum type, GLuint relativeOffset, GLuint binding, GLboolean normalized)
+{
+	assert(attributeCount < VERTEX_FORMAT_MAX_ATTRIBUTES && binding < GLuint(VERTEX_FORMAT_MAX_BINDINGS));
+
+	VertexAttribute& attribute = attributes[attributeCount++];
+	attribute.index = index;
+	attribute.size = size;
+	attribute.type = type;
+	attribute.normalized = normalized;
+	attribute.relativeOffset = relativeOffset;
+	attribute.binding = binding;
+	return *this;
+}
+
+bool Util::VertexFormat::operator==(const VertexFormat& other) const
+{
+	if (attributeCount != other.attributeCount) return false;
+
+	for (int i = 0; i < attributeCount; i++)
+	{
+		const VertexAttribute& a = attributes[i];
+		const VertexAttribute& b = other.attributes[i];
+		if (a.index != b.index || a.size != b.size || a.type != b.type || a.normalized != b.normalized ||
+			a.relativeOffset != b.relativeOffset || a.binding != b.binding) return false;
+	}
+	return true;
+}
+
+void Util::VertexBindings::bind() const
+{
+	glBindVertexArray(vertexArray);
+	for (int i = 0; i < VERTEX_FORMAT_MAX_BINDINGS; i++)
+	{
+		if (buffers[i].buffer) glBindVertexBuffer(i, buffers[i].buffer, buffers[i].offset, buffers[i].stride);
+	}
+	if (indexBuffer) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+Util::VertexFormatRegistry& Util::VertexFormatRegistry::get()
+{
+	static VertexFormatRegistry registry;
+	return registry;
+}
+
+GLuint Util::VertexFormatRegistry::getVertexArray(const VertexFormat& format)
+{
+	if (!isSupported()) return 0;
+
+	for (const Entry& entry : _entries)
+	{
+		if (entry.format == format) return entry.vertexArray.get();
+	}
+
+	Entry entry;
+	entry.format = format;
+	entry.vertexArray = GpuResource::create(GpuResourceType::VERTEX_ARRAY, "Util::VertexFormatRegistry");
+	GLuint vertexArray = entry.vertexArray.get();
+	for (int i = 0; i < format.attributeCount; i++)
+	{
+		const VertexAttribute& attribute = format.attributes[i];
+		glVertexArrayAttribFormat(vertexArray, attribute.index, attribute.size, attribute.type, attribute.normalized, attribute.relativeOffset);
+		glVertexArrayAttribBinding(vertexArray, attribute.index, attribute.binding);
+		glEnableVertexArrayAttrib(vertexArray, attribute.index);
+	}
+
+	_entries.push_back(std::move(entry));
+	return vertexArray;
+}
+
+void Util::VertexFormatRegistry::clear()
+{
+	_entries.clear();
+}
@@ -0,0 +1,89 @@
+/*
+* Created by Adam Gyenes
+* Vertex layouts shared between meshes. Every distinct layout gets one VAO with the format set up once, a mesh only
+* brings the buffers bound to it (glBindVertexBuffer), so switching meshes never switches vertex arrays
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "../ew/external/glad.h"
+#include "GpuResources.h"
+
+constexpr int VERTEX_FORMAT_MAX_ATTRIBUTES = 8;
+constexpr int VERTEX_FORMAT_MAX_BINDINGS = 2;
+
+namespace Util
+{
+	struct VertexAttribute
+	{
+		GLuint index = 0;
+		GLint size = 0;
+		GLenum type = GL_FLOAT;
+		GLboolean normalized = GL_FALSE;
+		//From the start of a vertex in the buffer bound to binding
+		GLuint relativeOffset = 0;
+		GLuint binding = 0;
+	};
+
+	struct VertexFormat
+	{
+		VertexAttribute attributes[VERTEX_FORMAT_MAX_ATTRIBUTES] = {};
+		int attributeCount = 0;
+
+		VertexFormat& add(GLuint index, GLint size, GLenum type, GLuint relativeOffset, GLuint binding = 0, GLboolean normalized = GL_FALSE);
+
+		bool operator==(const VertexFormat& other) const;
+		bool operator!=(const VertexFormat& other) const { return !(*this == other); }
+	};
+
+	struct VertexBufferBinding
+	{
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizei stride = 0;
+	};
+
+	//Everything a draw needs bound: a vertex array and the buffers behind its bindings. Buffer 0 leaves a binding
+	//alone, which is all a mesh with a VAO of its own needs
+	struct VertexBindings
+	{
+		GLuint vertexArray = 0;
+		VertexBufferBinding buffers[VERTEX_FORMAT_MAX_BINDINGS];
+		GLuint indexBuffer = 0;
+
+		//Binds straight through GL, Util::GLStateCache::bindVertexBindings skips what is already bound
+		void bind() const;
+	};
+
+	//GL thread only
+	class VertexFormatRegistry
+	{
+	public:
+		static VertexFormatRegistry& get();
+
+		VertexFormatRegistry(const VertexFormatRegistry&) = delete;
+		VertexFormatRegistry& operator=(const VertexFormatRegistry&) = delete;
+
+		//Shared VAO of format, created on first use. Needs GL 4.5, meshes keep a VAO of their own before that
+		GLuint getVertexArray(const VertexFormat& format);
+		static bool isSupported() { return GLAD_GL_VERSION_4_5 != 0; }
+
+		int getFormatCount() const { return int(_entries.size()); }
+		//Releases every shared VAO. Only once nothing loaded against them is drawn anymore, e.g. before the context
+		//is destroyed
+		void clear();
+
+	private:
+		VertexFormatRegistry() {};
+
+		struct Entry
+		{
+			VertexFormat format;
+			GpuResource vertexArray;
+		};
+
+		std::vector<Entry> _entries;
+	};
+}
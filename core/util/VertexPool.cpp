@@ -0,0 +1,160 @@
+/*
+* Created by Adam Gyenes
+*/
+
+#include "VertexPool.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory_resource>
+
+static uint32_t packSnorm16(float value)
+{
+	float clamped = fminf(fmaxf(value, -1.f), 1.f);
+	return uint32_t(uint16_t(int16_t(lroundf(clamped * 32767.f))));
+}
+
+//Octahedral mapping onto the [-1, 1] square, the lower hemisphere folded over the diagonals
+static uint32_t packOctahedral(const ew::Vec3& direction)
+{
+	float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	//Degenerate UVs leave calculateTB with NaN tangents, those decode as +Z
+	if (!(length > 0.f)) return 0;
+
+	float x = direction.x / length;
+	float y = direction.y / length;
+	if (direction.z < 0.f)
+	{
+		float foldedX = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+		float foldedY = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+		x = foldedX;
+		y = foldedY;
+	}
+	return packSnorm16(x) | (packSnorm16(y) << 16);
+}
+
+//Round to nearest. Values too small for a normal half flush to zero, which texture coordinates never get near
+static uint32_t packHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = int((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	if (exponent <= 0) return sign;
+	if (exponent >= 31) return sign | 0x7C00;
+
+	uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+	//A carry out of the mantissa correctly bumps the exponent
+	if (mantissa & 0x1000) half++;
+	return half;
+}
+
+Util::PackedVertex Util::PackedVertex::pack(const ew::Vertex& vertex, const ew::Vec3& tangent)
+{
+	PackedVertex packed;
+	packed.position[0] = vertex.pos.x;
+	packed.position[1] = vertex.pos.y;
+	packed.position[2] = vertex.pos.z;
+	packed.normal = packOctahedral(vertex.normal);
+	packed.tangent = packOctahedral(tangent);
+	packed.uv = packHalf(vertex.uv.x) | (packHalf(vertex.uv.y) << 16);
+	return packed;
+}
+
+Util::VertexPool::VertexPool(GLsizei vertexCapacity, GLsizei indexCapacity)
+{
+	if (!isSupported() || vertexCapacity <= 0 || indexCapacity <= 0) return;
+
+	//Written once per mesh with glNamedBufferSubData, read by the GPU only
+	_vertexBuffer = GpuResource::create(GpuResourceType::BUFFER, "Util::VertexPool vertices");
+	glNamedBufferStorage(_vertexBuffer.get(), sizeof(PackedVertex) * vertexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	_vertexBuffer.setBytes(sizeof(PackedVertex) * vertexCapacity);
+
+	_indexBuffer = GpuResource::create(GpuResourceType::BUFFER, "Util::VertexPool indices");
+	glNamedBufferStorage(_indexBuffer.get(), sizeof(GLuint) * indexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	_indexBuffer.setBytes(sizeof(GLuint) * indexCapacity);
+
+	//No attributes, only the index buffer. Core profiles can't draw without a vertex array bound
+	_vertexArray = GpuResource::create(GpuResourceType::VERTEX_ARRAY, "Util::VertexPool");
+	glVertexArrayElementBuffer(_vertexArray.get(), _indexBuffer.get());
+	_bindings.vertexArray = _vertexArray.get();
+
+	_stats.vertexCapacity = vertexCapacity;
+	_stats.indexCapacity = indexCapacity;
+}
+
+Util::PooledMesh Util::VertexPool::add(const ew::MeshData& meshData)
+{
+	PROFILE_SCOPE("Util::VertexPool::add");
+
+	GLsizei vertexCount = GLsizei(meshData.vertices.size());
+	GLsizei indexCount = GLsizei(meshData.indices.size());
+	if (vertexCount == 0 || indexCount == 0) return PooledMesh();
+	if (_stats.vertices + vertexCount > _stats.vertexCapacity || _stats.indices + indexCount > _stats.indexCapacity)
+	{
+		_stats.overflows++;
+		return PooledMesh();
+	}
+
+	PooledMesh mesh;
+	mesh.baseVertex = _stats.vertices;
+	mesh.firstIndex = GLuint(_stats.indices);
+	mesh.indexCount = indexCount;
+	mesh.vertexCount = vertexCount;
+	mesh.boundsMin = meshData.vertices[0].pos;
+	mesh.boundsMax = meshData.vertices[0].pos;
+
+	//Tangents and the packed copy are scratch, gone once they're uploaded
+	std::pmr::monotonic_buffer_resource scratch;
+	Mesh::TBArray tangents = Mesh::calculateTB(meshData, &scratch, &scratch);
+	std::pmr::vector<PackedVertex> packed(&scratch);
+	packed.reserve(vertexCount);
+	for (GLsizei i = 0; i < vertexCount; i++)
+	{
+		const ew::Vertex& vertex = meshData.vertices[i];
+		packed.push_back(PackedVertex::pack(vertex, tangents[i].first));
+
+		mesh.boundsMin = ew::Vec3(fminf(mesh.boundsMin.x, vertex.pos.x), fminf(mesh.boundsMin.y, vertex.pos.y), fminf(mesh.boundsMin.z, vertex.pos.z));
+		mesh.boundsMax = ew::Vec3(fmaxf(mesh.boundsMax.x, vertex.pos.x), fmaxf(mesh.boundsMax.y, vertex.pos.y), fmaxf(mesh.boundsMax.z, vertex.pos.z));
+	}
+
+	//Indices stay relative to the mesh, baseVertex offsets them at draw time
+	glNamedBufferSubData(_vertexBuffer.get(), sizeof(PackedVertex) * mesh.baseVertex, sizeof(PackedVertex) * vertexCount, packed.data());
+	glNamedBufferSubData(_indexBuffer.get(), sizeof(GLuint) * mesh.firstIndex, sizeof(GLuint) * indexCount, meshData.indices.data());
+
+	_stats.meshes++;
+	_stats.vertices += vertexCount;
+	_stats.indices += indexCount;
+	return mesh;
+}
+
+void Util::VertexPool::reset()
+{
+	_stats.meshes = 0;
+	_stats.vertices = 0;
+	_stats.indices = 0;
+	_stats.overflows = 0;
+}
+
+void Util::VertexPool::bind(GLStateCache& stateCache) const
+{
+	stateCache.bindVertexBindings(_bindings);
+	stateCache.bindBufferRange(GL_SHADER_STORAGE_BUFFER, VERTEX_POOL_STORAGE_BINDING, _vertexBuffer.get());
+}
+
+void Util::VertexPool::draw(const PooledMesh& mesh, GLsizei instanceCount) const
+{
+	const void* indexOffset = reinterpret_cast<const void*>(sizeof(GLuint) * size_t(mesh.firstIndex));
+	if (instanceCount > 1)
+	{
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, indexOffset, instanceCount, mesh.baseVertex);
+	}
+	else
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, indexOffset, mesh.baseVertex);
+	}
+}
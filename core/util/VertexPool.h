@@ -0,0 +1,104 @@
+/*
+* Created by Adam Gyenes
+* Vertex pulling: the vertices of many meshes packed into one shader storage buffer and their indices into one index
+* buffer. Vertex shaders fetch and decode their vertex by gl_VertexID, so there is no attribute setup at all and the
+* same buffers serve every mesh and every program
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "../ew/external/glad.h"
+#include "../ew/mesh.h"
+
+#include "GLStateCache.h"
+#include "GpuResources.h"
+#include "VertexFormat.h"
+
+//Shader storage binding the pulling shaders declare their vertex array at
+constexpr GLuint VERTEX_POOL_STORAGE_BINDING = 0;
+
+namespace Util
+{
+	//24 bytes against the 56 of ew::Vertex plus its tangent and bitangent. Decoded in the shader as
+	//  struct PackedVertex { float px, py, pz; uint normal; uint tangent; uint uv; };
+	//normal and tangent are octahedral unpackSnorm2x16, uv is unpackHalf2x16, the bitangent is cross(normal, tangent)
+	//exactly like Util::Mesh::calculateTB builds it
+	struct PackedVertex
+	{
+		float position[3];
+		uint32_t normal;
+		uint32_t tangent;
+		uint32_t uv;
+
+		static PackedVertex pack(const ew::Vertex& vertex, const ew::Vec3& tangent);
+	};
+
+	//A mesh's range in the pool, drawn with glDrawElementsBaseVertex
+	struct PooledMesh
+	{
+		GLint baseVertex = 0;
+		GLuint firstIndex = 0;
+		GLsizei indexCount = 0;
+		GLsizei vertexCount = 0;
+
+		//Local space AABB
+		ew::Vec3 boundsMin;
+		ew::Vec3 boundsMax;
+
+		bool isValid() const { return indexCount > 0; }
+	};
+
+	struct VertexPoolStats
+	{
+		int meshes = 0;
+		GLsizei vertices = 0;
+		GLsizei vertexCapacity = 0;
+		GLsizei indices = 0;
+		GLsizei indexCapacity = 0;
+		//Meshes that didn't fit and were never added
+		int overflows = 0;
+	};
+
+	//GL thread only. Append-only, reset() makes the whole pool reusable. Usage:
+	//  Util::VertexPool pool(vertexCount, indexCount);
+	//  Util::PooledMesh torus = pool.add(Util::createTorus(0.25f, 0.5f, 64, 32));
+	//  pool.bind(stateCache);
+	//  pool.draw(torus);
+	class VertexPool
+	{
+	public:
+		VertexPool(GLsizei vertexCapacity, GLsizei indexCapacity);
+
+		VertexPool(const VertexPool&) = delete;
+		VertexPool& operator=(const VertexPool&) = delete;
+
+		//Storage buffers need GL 4.3, the pool also relies on direct state access
+		static bool isSupported() { return GLAD_GL_VERSION_4_5 != 0; }
+
+		//Packs meshData with its tangents into the pool. Invalid if it doesn't fit
+		PooledMesh add(const ew::MeshData& meshData);
+		//Everything added before must not be drawn anymore
+		void reset();
+
+		//The vertex storage buffer at VERTEX_POOL_STORAGE_BINDING and the attribute-less vertex array that owns the
+		//index buffer. Stays valid for every mesh in the pool
+		void bind(GLStateCache& stateCache) const;
+		//After bind()
+		void draw(const PooledMesh& mesh, GLsizei instanceCount = 1) const;
+
+		const VertexBindings& getVertexBindings() const { return _bindings; }
+		GLuint getStorageBuffer() const { return _vertexBuffer.get(); }
+
+		VertexPoolStats getStats() const { return _stats; }
+
+	private:
+		GpuResource _vertexArray;
+		GpuResource _vertexBuffer;
+		GpuResource _indexBuffer;
+		VertexBindings _bindings;
+
+		VertexPoolStats _stats;
+	};
+}